@@ -1,7 +1,9 @@
 ﻿#include "pch.h"
 #include "App.h"
 
+#include <fstream>
 #include <ppltasks.h>
+#include "Common\Profiler.h"
 
 using namespace Open_Glider_Simulator;
 
@@ -102,7 +104,7 @@ void App::Run()
 
 			if (m_main->Render())
 			{
-				m_deviceResources->Present();
+				m_main->Present();
 			}
 		}
 		else
@@ -139,6 +141,19 @@ void App::OnSuspending(Platform::Object^ sender, SuspendingEventArgs^ args)
 	{
         m_deviceResources->Trim();
 
+		// Neu verwendete Pipelines für das Vorwärmen beim nächsten Start festhalten.
+		if (m_main != nullptr)
+		{
+			m_main->SavePipelineManifest();
+		}
+
+#if DX_PROFILER_ENABLED
+		// Die gesammelten Profilerzonen als Chrome-Trace im lokalen App-Ordner ablegen.
+		std::wstring tracePath = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) + L"\\profile.json";
+		std::ofstream traceFile(tracePath);
+		DX::Profiler::Get().WriteChromeTrace(traceFile);
+#endif
+
 		// Code hier eingeben.
 
 		deferral->Complete();
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace DX
+{
+	// Allokator für Container, deren Daten mit SIMD-Befehlen oder cachezeilenweise verarbeitet werden.
+	template<typename T, size_t Alignment = 64>
+	class AlignedAllocator
+	{
+	public:
+		typedef T value_type;
+
+		template<typename U>
+		struct rebind
+		{
+			typedef AlignedAllocator<U, Alignment> other;
+		};
+
+		AlignedAllocator() {}
+
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+		T* allocate(size_t count)
+		{
+			void* memory = nullptr;
+#if defined(_MSC_VER)
+			memory = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+			if (posix_memalign(&memory, Alignment, count * sizeof(T)) != 0)
+			{
+				memory = nullptr;
+			}
+#endif
+			if (memory == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+
+			return static_cast<T*>(memory);
+		}
+
+		void deallocate(T* memory, size_t)
+		{
+#if defined(_MSC_VER)
+			_aligned_free(memory);
+#else
+			free(memory);
+#endif
+		}
+
+		template<typename U>
+		bool operator==(const AlignedAllocator<U, Alignment>&) const	{ return true; }
+
+		template<typename U>
+		bool operator!=(const AlignedAllocator<U, Alignment>&) const	{ return false; }
+	};
+
+	template<typename T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+}
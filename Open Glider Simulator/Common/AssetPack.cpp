@@ -0,0 +1,249 @@
+﻿#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "Lz4.h"
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t FileMagic = 0x50414f47;	// "GOAP"
+	const uint32_t FileVersion = 1;
+	const uint64_t HeaderSize = 64;
+
+	// LZ4 kann höchstens etwa 255 Bytes je gespeichertem Byte erzeugen; größere Angaben sind beschädigt.
+	const uint64_t MaxLz4Ratio = 255;
+
+	struct FileHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	entryCount;
+		uint32_t	namesSize;
+		uint64_t	tocOffset;				// Inhaltsverzeichnis, direkt danach die Namen
+	};
+
+	static_assert(sizeof(FileHeader) <= HeaderSize, "Der Dateikopf muss in den reservierten Bereich passen.");
+	static_assert(sizeof(AssetPackEntry) == 32, "Einträge werden unverändert in die Datei geschrieben.");
+
+	uint64_t AlignOffset(uint64_t offset, uint64_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	void WritePadding(std::ostream& stream, uint64_t& position, uint64_t target)
+	{
+		static const char zeros[AssetPack::BlobAlignment] = {};
+		while (position < target)
+		{
+			uint64_t count = (std::min)(target - position, static_cast<uint64_t>(sizeof(zeros)));
+			stream.write(zeros, static_cast<std::streamsize>(count));
+			position += count;
+		}
+	}
+}
+
+AssetData::AssetData() :
+	m_data(nullptr),
+	m_size(0)
+{
+}
+
+AssetData::AssetData(std::vector<uint8_t>&& data)
+{
+	auto storage = std::make_shared<std::vector<uint8_t>>(std::move(data));
+	m_data = storage->data();
+	m_size = storage->size();
+	m_storage = storage;
+}
+
+AssetPack::AssetPack() :
+	m_names(nullptr)
+{
+}
+
+void AssetPack::Open(const std::wstring& path)
+{
+	Close();
+	m_file.Open(path);
+
+	uint64_t fileSize = m_file.GetSize();
+	if (fileSize < HeaderSize)
+	{
+		m_file.Close();
+		throw std::runtime_error("AssetPack: unbekanntes Dateiformat.");
+	}
+
+	m_view = m_file.Map(0, static_cast<size_t>(fileSize));
+
+	FileHeader header;
+	memcpy(&header, m_view.GetData(), sizeof(header));
+	uint64_t tocSize = static_cast<uint64_t>(header.entryCount) * sizeof(AssetPackEntry);
+	if (header.magic != FileMagic || header.version != FileVersion ||
+		header.tocOffset < HeaderSize || header.tocOffset % sizeof(uint64_t) != 0 || header.tocOffset > fileSize ||
+		tocSize + header.namesSize > fileSize - header.tocOffset)
+	{
+		Close();
+		throw std::runtime_error("AssetPack: unbekanntes Dateiformat.");
+	}
+
+	m_entries.resize(header.entryCount);
+	memcpy(m_entries.data(), m_view.GetData() + header.tocOffset, static_cast<size_t>(tocSize));
+	m_names = reinterpret_cast<const char*>(m_view.GetData() + header.tocOffset + tocSize);
+
+	// Einmal beim Öffnen geprüft, damit Load den Einträgen vertrauen kann.
+	bool valid = header.namesSize > 0 ? m_names[header.namesSize - 1] == '\0' : header.entryCount == 0;
+	for (size_t i = 0; i < m_entries.size() && valid; i++)
+	{
+		const AssetPackEntry& entry = m_entries[i];
+		valid = entry.offset % BlobAlignment == 0 &&
+			entry.offset >= HeaderSize && entry.offset <= header.tocOffset && entry.storedSize <= header.tocOffset - entry.offset &&
+			entry.nameOffset < header.namesSize &&
+			(i == 0 || m_entries[i - 1].nameHash < entry.nameHash) &&
+			((entry.compression == AssetCompression::None && entry.storedSize == entry.size) ||
+			(entry.compression == AssetCompression::Lz4 && entry.size <= static_cast<uint64_t>(entry.storedSize) * MaxLz4Ratio));
+	}
+	if (!valid)
+	{
+		Close();
+		throw std::runtime_error("AssetPack: Inhaltsverzeichnis ist beschädigt.");
+	}
+}
+
+void AssetPack::Close()
+{
+	m_entries.clear();
+	m_names = nullptr;
+	m_view.Reset();
+	m_file.Close();
+}
+
+// FNV-1a mit 64 Bit.
+uint64_t AssetPack::HashName(const std::string& name)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : name)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+const AssetPackEntry* AssetPack::Find(const std::string& name) const
+{
+	uint64_t hash = HashName(name);
+	auto entry = std::lower_bound(m_entries.begin(), m_entries.end(), hash,
+		[](const AssetPackEntry& e, uint64_t value) { return e.nameHash < value; });
+	if (entry == m_entries.end() || entry->nameHash != hash || name != GetName(*entry))
+	{
+		return nullptr;
+	}
+	return &*entry;
+}
+
+AssetData AssetPack::Load(const std::string& name) const
+{
+	const AssetPackEntry* entry = Find(name);
+	if (!entry)
+	{
+		throw std::out_of_range("AssetPack: unbekanntes Asset.");
+	}
+
+	const uint8_t* stored = m_view.GetData() + entry->offset;
+	if (entry->compression == AssetCompression::None)
+	{
+		AssetData data;
+		data.m_data = stored;
+		data.m_size = entry->size;
+		return data;
+	}
+
+	std::vector<uint8_t> unpacked(entry->size);
+	if (!Lz4Decompress(stored, entry->storedSize, unpacked.data(), unpacked.size()))
+	{
+		throw std::runtime_error("AssetPack: Asset ist beschädigt.");
+	}
+	return AssetData(std::move(unpacked));
+}
+
+void AssetPackWriter::Add(const std::string& name, const void* data, size_t size, AssetCompression compression)
+{
+	if (size > UINT32_MAX)
+	{
+		throw std::invalid_argument("AssetPackWriter: Asset ist zu groß.");
+	}
+
+	Asset asset;
+	asset.name = name;
+	asset.nameHash = AssetPack::HashName(name);
+	asset.size = static_cast<uint32_t>(size);
+	for (const Asset& other : m_assets)
+	{
+		if (other.nameHash == asset.nameHash)
+		{
+			throw std::invalid_argument("AssetPackWriter: Name ist bereits vergeben oder hat denselben Hash.");
+		}
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	asset.compression = AssetCompression::None;
+	if (compression == AssetCompression::Lz4 && size > 0)
+	{
+		asset.data.resize(Lz4CompressBound(size));
+		size_t packed = Lz4Compress(bytes, size, asset.data.data(), asset.data.size());
+		if (packed != 0 && packed < size)
+		{
+			asset.data.resize(packed);
+			asset.compression = AssetCompression::Lz4;
+		}
+	}
+	if (asset.compression == AssetCompression::None)
+	{
+		asset.data.assign(bytes, bytes + size);
+	}
+
+	m_assets.push_back(std::move(asset));
+}
+
+void AssetPackWriter::Write(std::ostream& stream) const
+{
+	std::vector<const Asset*> sorted;
+	for (const Asset& asset : m_assets)
+	{
+		sorted.push_back(&asset);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const Asset* a, const Asset* b) { return a->nameHash < b->nameHash; });
+
+	std::vector<AssetPackEntry> entries;
+	std::string names;
+	uint64_t offset = HeaderSize;
+	for (const Asset* asset : sorted)
+	{
+		offset = AlignOffset(offset, AssetPack::BlobAlignment);
+		AssetPackEntry entry = { asset->nameHash, offset, static_cast<uint32_t>(asset->data.size()), asset->size, asset->compression, static_cast<uint32_t>(names.size()) };
+		entries.push_back(entry);
+		names.append(asset->name);
+		names.push_back('\0');
+		offset += asset->data.size();
+	}
+
+	FileHeader fileHeader = { FileMagic, FileVersion, static_cast<uint32_t>(entries.size()), static_cast<uint32_t>(names.size()), AlignOffset(offset, sizeof(uint64_t)) };
+	uint8_t header[HeaderSize] = {};
+	memcpy(header, &fileHeader, sizeof(fileHeader));
+	stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	uint64_t position = HeaderSize;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		WritePadding(stream, position, entries[i].offset);
+		stream.write(reinterpret_cast<const char*>(sorted[i]->data.data()), sorted[i]->data.size());
+		position += sorted[i]->data.size();
+	}
+
+	WritePadding(stream, position, fileHeader.tocOffset);
+	stream.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPackEntry));
+	stream.write(names.data(), names.size());
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "MemoryMappedFile.h"
+
+namespace DX
+{
+	enum class AssetCompression : uint32_t
+	{
+		None,
+		Lz4,
+	};
+
+	// Inhalt eines Assets. Unkomprimierte Einträge zeigen direkt in die Einblendung des Archivs und gelten,
+	// solange das Archiv offen ist; entpackte und einzeln gelesene Dateien besitzen ihren Puffer selbst.
+	class AssetData
+	{
+	public:
+		AssetData();
+		explicit AssetData(std::vector<uint8_t>&& data);
+
+		const uint8_t* GetData() const						{ return m_data; }
+		size_t GetSize() const								{ return m_size; }
+
+	private:
+		friend class AssetPack;
+
+		std::shared_ptr<const std::vector<uint8_t>>	m_storage;
+		const uint8_t*								m_data;
+		size_t										m_size;
+	};
+
+	// Eintrag des Inhaltsverzeichnisses. Die Einträge sind nach nameHash sortiert.
+	struct AssetPackEntry
+	{
+		uint64_t			nameHash;
+		uint64_t			offset;			// in Bytes ab Dateibeginn, Vielfaches von AssetPack::BlobAlignment
+		uint32_t			storedSize;
+		uint32_t			size;
+		AssetCompression	compression;
+		uint32_t			nameOffset;		// in der Namenstabelle
+	};
+
+	// Archiv aus vielen Assets in einer Datei: Kopf, ausgerichtete Daten, danach Inhaltsverzeichnis und
+	// Namen. Die Datei wird einmal ganz eingeblendet; gesucht wird binär über den FNV-1a-Hash des Namens,
+	// der Name selbst wird zur Sicherheit verglichen. Load ist von mehreren Threads zugleich aufrufbar.
+	class AssetPack
+	{
+	public:
+		static const uint32_t BlobAlignment = 64;
+
+		AssetPack();
+
+		// Wirft std::system_error, wenn die Datei nicht geöffnet werden kann, und std::runtime_error bei
+		// fremdem oder beschädigtem Format.
+		void Open(const std::wstring& path);
+		void Close();
+		bool IsOpen() const									{ return m_view.IsValid(); }
+
+		static uint64_t HashName(const std::string& name);
+
+		const AssetPackEntry* Find(const std::string& name) const;
+		bool Contains(const std::string& name) const		{ return Find(name) != nullptr; }
+
+		// Wirft std::out_of_range für unbekannte Namen und std::runtime_error für beschädigte Daten.
+		AssetData Load(const std::string& name) const;
+
+		size_t GetAssetCount() const						{ return m_entries.size(); }
+		const AssetPackEntry& GetEntry(size_t index) const	{ return m_entries[index]; }
+		const char* GetName(const AssetPackEntry& entry) const	{ return m_names + entry.nameOffset; }
+
+	private:
+		MemoryMappedFile				m_file;
+		MemoryMappedView				m_view;
+		std::vector<AssetPackEntry>		m_entries;
+		const char*						m_names;
+	};
+
+	// Stellt ein AssetPack zusammen. Add kopiert oder packt die Daten sofort; Einträge, die gepackt nicht
+	// kleiner werden, bleiben ungepackt und damit ohne Kopie lesbar.
+	class AssetPackWriter
+	{
+	public:
+		// Wirft std::invalid_argument für doppelte Namen oder Namen mit gleichem Hash.
+		void Add(const std::string& name, const void* data, size_t size, AssetCompression compression);
+
+		void Write(std::ostream& stream) const;
+
+		size_t GetAssetCount() const						{ return m_assets.size(); }
+
+	private:
+		struct Asset
+		{
+			std::string				name;
+			uint64_t				nameHash;
+			uint32_t				size;
+			AssetCompression		compression;
+			std::vector<uint8_t>	data;
+		};
+
+		std::vector<Asset>	m_assets;
+	};
+}
@@ -0,0 +1,410 @@
+﻿#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <stdexcept>
+#include "SimdMath.h"
+
+using namespace DX;
+using namespace DX::Simd;
+
+namespace
+{
+	// Ergebnis des Tests von vier Boxen gegen alle Ebenen: außerhalb mindestens einer Ebene bzw.
+	// vollständig innerhalb aller Ebenen, je als Bitmaske der vier Elemente.
+	struct CullMasks
+	{
+		int	outside;
+		int	inside;
+	};
+
+	inline CullMasks TestBoxes(const Frustum& frustum, Vec4 minX, Vec4 minY, Vec4 minZ, Vec4 maxX, Vec4 maxY, Vec4 maxZ)
+	{
+		Vec4 outside = Zero();
+		Vec4 partial = Zero();
+		for (const auto& plane : frustum.planes)
+		{
+			Vec4 a = Set(plane[0]);
+			Vec4 b = Set(plane[1]);
+			Vec4 c = Set(plane[2]);
+			Vec4 d = Set(plane[3]);
+
+			// Ecke in Richtung der Normalen entscheidet über außerhalb, die gegenüberliegende über innerhalb.
+			Vec4 farDistance = d + a * (plane[0] >= 0.0f ? maxX : minX) + b * (plane[1] >= 0.0f ? maxY : minY) + c * (plane[2] >= 0.0f ? maxZ : minZ);
+			Vec4 nearDistance = d + a * (plane[0] >= 0.0f ? minX : maxX) + b * (plane[1] >= 0.0f ? minY : maxY) + c * (plane[2] >= 0.0f ? minZ : maxZ);
+			outside = Or(outside, Less(farDistance, Zero()));
+			partial = Or(partial, Less(nearDistance, Zero()));
+		}
+
+		CullMasks masks = { MoveMask(outside), ~MoveMask(partial) & 0xF };
+		return masks;
+	}
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy() :
+	m_structureChanged(false),
+	m_statistics()
+{
+}
+
+BoundingVolumeHierarchy::ObjectId BoundingVolumeHierarchy::Insert(const Aabb& bounds)
+{
+	ObjectId id;
+	if (!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+		m_objectBounds[id] = bounds;
+	}
+	else
+	{
+		id = static_cast<ObjectId>(m_objectBounds.size());
+		m_objectBounds.push_back(bounds);
+		m_objectPrimitive.push_back(Invalid);
+	}
+
+	// Die Position wird beim Neuaufbau vergeben; bis dahin gilt das Objekt als eingefügt, aber nicht eingeordnet.
+	m_objectPrimitive[id] = Invalid - 1;
+	m_statistics.objectCount++;
+	m_structureChanged = true;
+	return id;
+}
+
+void BoundingVolumeHierarchy::Remove(ObjectId id)
+{
+	if (id >= m_objectPrimitive.size() || m_objectPrimitive[id] == Invalid)
+	{
+		throw std::invalid_argument("BoundingVolumeHierarchy: unknown object");
+	}
+
+	m_objectPrimitive[id] = Invalid;
+	m_freeIds.push_back(id);
+	m_statistics.objectCount--;
+	m_structureChanged = true;
+}
+
+void BoundingVolumeHierarchy::Update(ObjectId id, const Aabb& bounds)
+{
+	if (id >= m_objectPrimitive.size() || m_objectPrimitive[id] == Invalid)
+	{
+		throw std::invalid_argument("BoundingVolumeHierarchy: unknown object");
+	}
+
+	m_objectBounds[id] = bounds;
+	if (m_structureChanged)
+	{
+		return;
+	}
+
+	uint32_t primitive = m_objectPrimitive[id];
+	WritePrimitive(primitive, bounds);
+
+	uint32_t node = m_primitiveNode[primitive];
+	if (!m_nodeDirty[node])
+	{
+		m_nodeDirty[node] = 1;
+		m_dirtyNodes.push_back(node);
+	}
+}
+
+void BoundingVolumeHierarchy::Commit()
+{
+	if (m_structureChanged)
+	{
+		Rebuild();
+		return;
+	}
+
+	for (uint32_t node : m_dirtyNodes)
+	{
+		m_nodeDirty[node] = 0;
+
+		// Blattboxen dieses Knotens neu bestimmen, dann nach oben weitergeben, bis sich nichts mehr ändert.
+		Node& dirty = m_nodes[node];
+		for (uint32_t slot = 0; slot < 4; slot++)
+		{
+			if (dirty.count[slot] > 0)
+			{
+				SetSlotBounds(node, slot, GetPrimitiveBounds(dirty.child[slot], dirty.count[slot]));
+			}
+		}
+		m_statistics.refittedNodes++;
+
+		for (uint32_t child = node; m_nodes[child].parent != Invalid; child = m_nodes[child].parent)
+		{
+			const Node& childNode = m_nodes[child];
+			Aabb bounds = GetNodeBounds(child);
+			const Node& parent = m_nodes[childNode.parent];
+			uint32_t slot = childNode.parentSlot;
+			if (parent.minX[slot] == bounds.min[0] && parent.minY[slot] == bounds.min[1] && parent.minZ[slot] == bounds.min[2] &&
+				parent.maxX[slot] == bounds.max[0] && parent.maxY[slot] == bounds.max[1] && parent.maxZ[slot] == bounds.max[2])
+			{
+				break;
+			}
+			SetSlotBounds(childNode.parent, slot, bounds);
+			m_statistics.refittedNodes++;
+		}
+	}
+	m_dirtyNodes.clear();
+}
+
+void BoundingVolumeHierarchy::Rebuild()
+{
+	m_primitives.clear();
+	for (ObjectId id = 0; id < m_objectPrimitive.size(); id++)
+	{
+		if (m_objectPrimitive[id] != Invalid)
+		{
+			m_primitives.push_back(id);
+		}
+	}
+
+	uint32_t count = static_cast<uint32_t>(m_primitives.size());
+	m_primitiveNode.assign(count, Invalid);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_primitiveMin[axis].assign(count + 3, FLT_MAX);
+		m_primitiveMax[axis].assign(count + 3, -FLT_MAX);
+	}
+
+	std::vector<float> centroids(m_objectBounds.size() * 3);
+	for (ObjectId id : m_primitives)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			centroids[id * 3 + axis] = 0.5f * (m_objectBounds[id].min[axis] + m_objectBounds[id].max[axis]);
+		}
+	}
+
+	m_nodes.clear();
+	if (count > 0)
+	{
+		m_nodes.reserve(2 * (count / LeafSize) / 3 + 1);
+		BuildNode(0, count, centroids);
+		m_nodes[0].parent = Invalid;
+		m_nodes[0].parentSlot = 0;
+	}
+
+	m_nodeDirty.assign(m_nodes.size(), 0);
+	m_dirtyNodes.clear();
+	m_structureChanged = false;
+
+	m_statistics.nodeCount = static_cast<uint32_t>(m_nodes.size());
+	m_statistics.rebuilds++;
+	m_statistics.refittedNodes = 0;
+}
+
+// Teilt einen Bereich am Median der Mittelpunkte entlang der längsten Achse ihrer Ausdehnung.
+BoundingVolumeHierarchy::Range BoundingVolumeHierarchy::SplitRange(Range range, const std::vector<float>& centroids, Range& upper)
+{
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = range.first; i < range.first + range.count; i++)
+	{
+		const float* centroid = &centroids[m_primitives[i] * 3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = (std::min)(minimum[axis], centroid[axis]);
+			maximum[axis] = (std::max)(maximum[axis], centroid[axis]);
+		}
+	}
+
+	int axis = 0;
+	for (int candidate = 1; candidate < 3; candidate++)
+	{
+		if (maximum[candidate] - minimum[candidate] > maximum[axis] - minimum[axis])
+		{
+			axis = candidate;
+		}
+	}
+
+	uint32_t half = range.count / 2;
+	auto begin = m_primitives.begin() + range.first;
+	std::nth_element(begin, begin + half, begin + range.count, [&centroids, axis](ObjectId a, ObjectId b) {
+		return centroids[a * 3 + axis] < centroids[b * 3 + axis];
+	});
+
+	Range lower = { range.first, half };
+	upper.first = range.first + half;
+	upper.count = range.count - half;
+	return lower;
+}
+
+uint32_t BoundingVolumeHierarchy::BuildNode(uint32_t first, uint32_t count, const std::vector<float>& centroids)
+{
+	uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back(Node());
+	m_nodes[nodeIndex].first = first;
+	m_nodes[nodeIndex].primitiveCount = count;
+
+	// Zweimal halbieren ergibt bis zu vier Kinder; kleine Bereiche bleiben ungeteilt.
+	Range parts[4];
+	uint32_t partCount = 1;
+	parts[0].first = first;
+	parts[0].count = count;
+	for (int level = 0; level < 2; level++)
+	{
+		uint32_t previousCount = partCount;
+		for (uint32_t part = 0; part < previousCount; part++)
+		{
+			if (parts[part].count > LeafSize)
+			{
+				parts[part] = SplitRange(parts[part], centroids, parts[partCount]);
+				partCount++;
+			}
+		}
+	}
+
+	for (uint32_t slot = 0; slot < 4; slot++)
+	{
+		if (slot >= partCount)
+		{
+			m_nodes[nodeIndex].child[slot] = Invalid;
+			m_nodes[nodeIndex].count[slot] = 0;
+			SetSlotBounds(nodeIndex, slot, Aabb::Empty());
+		}
+		else if (parts[slot].count <= LeafSize)
+		{
+			for (uint32_t primitive = parts[slot].first; primitive < parts[slot].first + parts[slot].count; primitive++)
+			{
+				ObjectId id = m_primitives[primitive];
+				m_objectPrimitive[id] = primitive;
+				m_primitiveNode[primitive] = nodeIndex;
+				WritePrimitive(primitive, m_objectBounds[id]);
+			}
+			m_nodes[nodeIndex].child[slot] = parts[slot].first;
+			m_nodes[nodeIndex].count[slot] = parts[slot].count;
+			SetSlotBounds(nodeIndex, slot, GetPrimitiveBounds(parts[slot].first, parts[slot].count));
+		}
+		else
+		{
+			uint32_t child = BuildNode(parts[slot].first, parts[slot].count, centroids);
+			m_nodes[child].parent = nodeIndex;
+			m_nodes[child].parentSlot = slot;
+			m_nodes[nodeIndex].child[slot] = child;
+			m_nodes[nodeIndex].count[slot] = 0;
+			SetSlotBounds(nodeIndex, slot, GetNodeBounds(child));
+		}
+	}
+
+	return nodeIndex;
+}
+
+Aabb BoundingVolumeHierarchy::GetPrimitiveBounds(uint32_t first, uint32_t count) const
+{
+	Aabb bounds = Aabb::Empty();
+	for (uint32_t primitive = first; primitive < first + count; primitive++)
+	{
+		bounds.Extend(m_objectBounds[m_primitives[primitive]]);
+	}
+	return bounds;
+}
+
+Aabb BoundingVolumeHierarchy::GetNodeBounds(uint32_t nodeIndex) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	Aabb bounds = Aabb::Empty();
+	for (uint32_t slot = 0; slot < 4; slot++)
+	{
+		Aabb slotBounds = { { node.minX[slot], node.minY[slot], node.minZ[slot] }, { node.maxX[slot], node.maxY[slot], node.maxZ[slot] } };
+		bounds.Extend(slotBounds);
+	}
+	return bounds;
+}
+
+void BoundingVolumeHierarchy::SetSlotBounds(uint32_t nodeIndex, uint32_t slot, const Aabb& bounds)
+{
+	Node& node = m_nodes[nodeIndex];
+	node.minX[slot] = bounds.min[0];
+	node.minY[slot] = bounds.min[1];
+	node.minZ[slot] = bounds.min[2];
+	node.maxX[slot] = bounds.max[0];
+	node.maxY[slot] = bounds.max[1];
+	node.maxZ[slot] = bounds.max[2];
+}
+
+void BoundingVolumeHierarchy::WritePrimitive(uint32_t primitive, const Aabb& bounds)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_primitiveMin[axis][primitive] = bounds.min[axis];
+		m_primitiveMax[axis][primitive] = bounds.max[axis];
+	}
+}
+
+void BoundingVolumeHierarchy::Cull(const Frustum& frustum, std::vector<ObjectId>& visible, BvhCullStatistics* statistics) const
+{
+	BvhCullStatistics counters = {};
+	size_t visibleBefore = visible.size();
+
+	if (!m_nodes.empty())
+	{
+		// Die Mediansplits halten die Hierarchie ausgeglichen; drei Geschwister je Ebene liegen auf dem Stapel.
+		uint32_t stack[3 * 32 + 1];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const Node& node = m_nodes[stack[--stackSize]];
+			counters.nodeTests++;
+
+			CullMasks masks = TestBoxes(frustum,
+				Load(node.minX), Load(node.minY), Load(node.minZ),
+				Load(node.maxX), Load(node.maxY), Load(node.maxZ));
+
+			for (uint32_t slot = 0; slot < 4; slot++)
+			{
+				int bit = 1 << slot;
+				if (masks.outside & bit)
+				{
+					continue;
+				}
+
+				uint32_t first;
+				uint32_t count;
+				if (node.count[slot] > 0)
+				{
+					first = node.child[slot];
+					count = node.count[slot];
+				}
+				else
+				{
+					const Node& child = m_nodes[node.child[slot]];
+					if (!(masks.inside & bit))
+					{
+						stack[stackSize++] = node.child[slot];
+						continue;
+					}
+					first = child.first;
+					count = child.primitiveCount;
+				}
+
+				if (masks.inside & bit)
+				{
+					visible.insert(visible.end(), m_primitives.begin() + first, m_primitives.begin() + first + count);
+					continue;
+				}
+
+				// Blatt am Rand: seine bis zu vier Objekte gemeinsam prüfen.
+				counters.objectTests++;
+				CullMasks objectMasks = TestBoxes(frustum,
+					LoadUnaligned(&m_primitiveMin[0][first]), LoadUnaligned(&m_primitiveMin[1][first]), LoadUnaligned(&m_primitiveMin[2][first]),
+					LoadUnaligned(&m_primitiveMax[0][first]), LoadUnaligned(&m_primitiveMax[1][first]), LoadUnaligned(&m_primitiveMax[2][first]));
+				for (uint32_t lane = 0; lane < count; lane++)
+				{
+					if (!(objectMasks.outside & (1 << lane)))
+					{
+						visible.push_back(m_primitives[first + lane]);
+					}
+				}
+			}
+		}
+	}
+
+	counters.visibleObjects = static_cast<uint32_t>(visible.size() - visibleBefore);
+	if (statistics)
+	{
+		*statistics = counters;
+	}
+}
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "Frustum.h"
+
+namespace DX
+{
+	struct BvhStatistics
+	{
+		uint32_t	objectCount;
+		uint32_t	nodeCount;
+		uint32_t	rebuilds;
+		uint32_t	refittedNodes;		// seit dem letzten Neuaufbau
+	};
+
+	struct BvhCullStatistics
+	{
+		uint32_t	nodeTests;			// Knoten, deren vier Kindboxen geprüft wurden
+		uint32_t	objectTests;		// Blätter, deren Objekte einzeln geprüft wurden
+		uint32_t	visibleObjects;
+	};
+
+	// Hüllkörperhierarchie mit vier Kindern je Knoten über den Objekten einer Szene. Die Boxen der Kinder
+	// liegen je Achse nebeneinander, sodass ein Knoten mit einem SIMD-Test gegen jede Ebene geprüft wird;
+	// Blätter mit bis zu LeafSize Objekten ebenso. Ganz innen liegende Teilbäume werden ohne weitere Tests
+	// übernommen, da ihre Objekte zusammenhängend gespeichert sind.
+	//
+	// Bewegte Objekte werden mit Update gemeldet; Commit passt dann nur die Boxen auf ihren Pfaden zur
+	// Wurzel an. Nach Insert oder Remove baut Commit die Hierarchie neu auf (Mediansplit der Mittelpunkte).
+	// Entfernen sich viele Objekte weit von ihren Nachbarn, lohnt ein Rebuild, da Anpassen die Aufteilung
+	// nicht verbessert.
+	class BoundingVolumeHierarchy
+	{
+	public:
+		typedef uint32_t ObjectId;
+
+		static const uint32_t LeafSize = 4;
+
+		BoundingVolumeHierarchy();
+
+		ObjectId Insert(const Aabb& bounds);
+		void Remove(ObjectId id);
+		void Update(ObjectId id, const Aabb& bounds);
+
+		void Commit();
+		void Rebuild();
+
+		// Hängt die Kennungen aller Objekte an visible an, deren Box den Kegelstumpf schneidet.
+		// Die Reihenfolge folgt der Hierarchie, nicht den Kennungen. Erfordert einen Commit nach Änderungen.
+		void Cull(const Frustum& frustum, std::vector<ObjectId>& visible, BvhCullStatistics* statistics = nullptr) const;
+
+		const Aabb& GetBounds(ObjectId id) const			{ return m_objectBounds[id]; }
+		const BvhStatistics& GetStatistics() const			{ return m_statistics; }
+
+	private:
+		enum : uint32_t { Invalid = UINT32_MAX };
+
+		// count > 0: Blatt mit den Objekten m_primitives[child, child + count), count == 0: innerer Knoten
+		// child oder leer (child == Invalid). first und primitiveCount umfassen den ganzen Teilbaum.
+		// Cull lädt die Boxen mit ausgerichteten SIMD-Befehlen; das gilt für jeden Knoten im Vektor nur, solange
+		// die Größe ein Vielfaches von 16 Byte ist.
+		struct alignas(16) Node
+		{
+			float		minX[4];
+			float		minY[4];
+			float		minZ[4];
+			float		maxX[4];
+			float		maxY[4];
+			float		maxZ[4];
+			uint32_t	child[4];
+			uint32_t	count[4];
+			uint32_t	parent;
+			uint32_t	parentSlot;
+			uint32_t	first;
+			uint32_t	primitiveCount;
+		};
+
+		static_assert(sizeof(Node) == 144 && alignof(Node) == 16, "Node must keep its boxes 16-byte aligned.");
+
+		struct Range
+		{
+			uint32_t	first;
+			uint32_t	count;
+		};
+
+		uint32_t BuildNode(uint32_t first, uint32_t count, const std::vector<float>& centroids);
+		Range SplitRange(Range range, const std::vector<float>& centroids, Range& upper);
+		Aabb GetPrimitiveBounds(uint32_t first, uint32_t count) const;
+		Aabb GetNodeBounds(uint32_t node) const;
+		void SetSlotBounds(uint32_t node, uint32_t slot, const Aabb& bounds);
+		void WritePrimitive(uint32_t primitive, const Aabb& bounds);
+
+		// Je Objektkennung.
+		std::vector<Aabb>		m_objectBounds;
+		std::vector<uint32_t>	m_objectPrimitive;		// Position in m_primitives, Invalid für freie Kennungen
+		std::vector<ObjectId>	m_freeIds;
+
+		// Je Position in Blattreihenfolge; die Boxen je Achse, um drei leere Einträge verlängert, damit
+		// immer vier Objekte geladen werden können.
+		std::vector<ObjectId>	m_primitives;
+		std::vector<uint32_t>	m_primitiveNode;
+		DX::AlignedVector<float>	m_primitiveMin[3];
+		DX::AlignedVector<float>	m_primitiveMax[3];
+
+		DX::AlignedVector<Node>	m_nodes;
+		std::vector<uint32_t>	m_dirtyNodes;
+		std::vector<uint8_t>	m_nodeDirty;
+		bool					m_structureChanged;
+
+		BvhStatistics			m_statistics;
+	};
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace DX
+{
+	// Zeitquelle für StepTimer. Liefert eine monoton steigende Zeit im kanonischen Taktformat
+	// (10.000.000 Takte pro Sekunde), damit die Zeitsteuerung unabhängig von QPC und Windows bleibt.
+	class IClock
+	{
+	public:
+		virtual ~IClock() {}
+		virtual uint64_t GetTicks() const = 0;
+
+		static const uint64_t TicksPerSecond = 10000000;
+	};
+
+	// Echtzeituhr auf Basis von std::chrono::steady_clock (unter Windows intern QPC).
+	class SteadyClock : public IClock
+	{
+	public:
+		SteadyClock() :
+			m_start(std::chrono::steady_clock::now())
+		{
+		}
+
+		virtual uint64_t GetTicks() const override
+		{
+			typedef std::chrono::duration<int64_t, std::ratio<1, TicksPerSecond>> Ticks;
+			return static_cast<uint64_t>(std::chrono::duration_cast<Ticks>(std::chrono::steady_clock::now() - m_start).count());
+		}
+
+	private:
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	// Virtuelle Uhr, die nur auf ausdrücklichen Aufruf fortschreitet.
+	// Damit läuft die Simulation ohne Fenster so schnell, wie die CPU es erlaubt, und ist reproduzierbar.
+	class ManualClock : public IClock
+	{
+	public:
+		ManualClock() :
+			m_ticks(0)
+		{
+		}
+
+		virtual uint64_t GetTicks() const override	{ return m_ticks.load(std::memory_order_acquire); }
+
+		void SetTicks(uint64_t ticks)				{ m_ticks.store(ticks, std::memory_order_release); }
+		void AdvanceTicks(uint64_t ticks)			{ m_ticks.fetch_add(ticks, std::memory_order_acq_rel); }
+		void AdvanceSeconds(double seconds)			{ AdvanceTicks(static_cast<uint64_t>(seconds * TicksPerSecond)); }
+
+	private:
+		std::atomic<uint64_t> m_ticks;
+	};
+}
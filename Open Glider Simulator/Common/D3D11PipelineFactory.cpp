@@ -0,0 +1,174 @@
+﻿#include "pch.h"
+#include "D3D11PipelineFactory.h"
+
+#include "DirectXHelper.h"
+#include "Profiler.h"
+
+using namespace DX;
+
+namespace
+{
+	// Der Cache hält die Objekte typlos; die Löschfunktion gibt den Verweis der Schnittstelle frei.
+	template<typename T>
+	std::shared_ptr<void> Share(const Microsoft::WRL::ComPtr<T>& object)
+	{
+		object.Get()->AddRef();
+		return std::shared_ptr<void>(object.Get(), [](void* pointer) { static_cast<T*>(pointer)->Release(); });
+	}
+}
+
+D3D11PipelineFactory::D3D11PipelineFactory(const std::shared_ptr<DeviceResources>& deviceResources, const std::shared_ptr<const AssetPack>& assets) :
+	m_deviceResources(deviceResources),
+	m_assets(assets)
+{
+}
+
+void D3D11PipelineFactory::ReleaseDeviceDependentResources()
+{
+	m_cache.Clear();
+}
+
+// Liest zwei Threads denselben Shader gleichzeitig, gilt der zuerst eingetragene.
+std::shared_ptr<const D3D11PipelineFactory::Shader> D3D11PipelineFactory::GetShader(const std::string& name, PipelineObjectKind kind)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_shaderMutex);
+		auto found = m_shaders.find(name);
+		if (found != m_shaders.end())
+		{
+			return found->second;
+		}
+	}
+
+	DX_PROFILE_ZONE("D3D11PipelineFactory::ReadShader");
+
+	auto shader = std::make_shared<Shader>();
+	shader->bytecode = ReadAssetAsync(m_assets, std::wstring(name.begin(), name.end())).get();
+	shader->key = PipelineCache::HashShader(kind, shader->bytecode.GetData(), shader->bytecode.GetSize());
+
+	std::lock_guard<std::mutex> lock(m_shaderMutex);
+	return m_shaders.emplace(name, shader).first->second;
+}
+
+void D3D11PipelineFactory::LoadShaders(const PipelineDescription& description)
+{
+	GetShader(description.vertexShader, PipelineObjectKind::VertexShader);
+	GetShader(description.pixelShader, PipelineObjectKind::PixelShader);
+}
+
+RenderPipeline D3D11PipelineFactory::CreatePipeline(const PipelineDescription& description)
+{
+	std::shared_ptr<const Shader> vertexShader = GetShader(description.vertexShader, PipelineObjectKind::VertexShader);
+	std::shared_ptr<const Shader> pixelShader = GetShader(description.pixelShader, PipelineObjectKind::PixelShader);
+	PipelineKey inputLayoutKey = PipelineCache::HashInputLayout(description.inputLayout, vertexShader->key);
+	PipelineKey key = PipelineCache::HashPipeline(vertexShader->key, pixelShader->key, inputLayoutKey, description.topology,
+		description.blend, description.depth);
+
+	// Die Generation vor dem Gerät holen: Wird das Gerät danach zurückgesetzt, verwirft der Cache alles, was
+	// mit diesem Zeiger noch entsteht.
+	uint64_t generation = m_cache.GetGeneration();
+	ID3D11Device3* device = m_deviceResources->GetD3DDevice();
+	auto pipeline = std::static_pointer_cast<RenderPipeline>(m_cache.GetOrCreate(key, generation, [&]()
+	{
+		DX_PROFILE_ZONE("D3D11PipelineFactory::CreatePipeline");
+
+		std::shared_ptr<void> vertexShaderObject = m_cache.GetOrCreate(vertexShader->key, generation, [&]()
+		{
+			Microsoft::WRL::ComPtr<ID3D11VertexShader> object;
+			ThrowIfFailed(device->CreateVertexShader(vertexShader->bytecode.GetData(), vertexShader->bytecode.GetSize(), nullptr, &object));
+			return Share(object);
+		});
+
+		std::shared_ptr<void> pixelShaderObject = m_cache.GetOrCreate(pixelShader->key, generation, [&]()
+		{
+			Microsoft::WRL::ComPtr<ID3D11PixelShader> object;
+			ThrowIfFailed(device->CreatePixelShader(pixelShader->bytecode.GetData(), pixelShader->bytecode.GetSize(), nullptr, &object));
+			return Share(object);
+		});
+
+		std::shared_ptr<void> inputLayoutObject = m_cache.GetOrCreate(inputLayoutKey, generation, [&]()
+		{
+			std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+			for (const VertexElement& element : description.inputLayout)
+			{
+				D3D11_INPUT_ELEMENT_DESC desc =
+				{
+					element.semantic.c_str(),
+					element.semanticIndex,
+					static_cast<DXGI_FORMAT>(element.format),
+					element.slot,
+					element.offset,
+					element.perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA,
+					element.instanceStepRate
+				};
+				elements.push_back(desc);
+			}
+
+			Microsoft::WRL::ComPtr<ID3D11InputLayout> object;
+			ThrowIfFailed(device->CreateInputLayout(elements.data(), static_cast<UINT>(elements.size()),
+				vertexShader->bytecode.GetData(), vertexShader->bytecode.GetSize(), &object));
+			return Share(object);
+		});
+
+		// Für die Voreinstellungen des Geräts genügt nullptr; andere Zustände teilen sich alle Pipelines.
+		std::shared_ptr<void> blendStateObject;
+		if (description.blend == BlendMode::PremultipliedAlpha)
+		{
+			blendStateObject = m_cache.GetOrCreate(PipelineCache::HashState(description.blend), generation, [&]()
+			{
+				CD3D11_BLEND_DESC desc(D3D11_DEFAULT);
+				desc.RenderTarget[0].BlendEnable = TRUE;
+				desc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+				desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+				desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+				desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+
+				Microsoft::WRL::ComPtr<ID3D11BlendState> object;
+				ThrowIfFailed(device->CreateBlendState(&desc, &object));
+				return Share(object);
+			});
+		}
+
+		std::shared_ptr<void> depthStencilStateObject;
+		if (description.depth == DepthMode::Disabled)
+		{
+			depthStencilStateObject = m_cache.GetOrCreate(PipelineCache::HashState(description.depth), generation, [&]()
+			{
+				CD3D11_DEPTH_STENCIL_DESC desc(D3D11_DEFAULT);
+				desc.DepthEnable = FALSE;
+				desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+
+				Microsoft::WRL::ComPtr<ID3D11DepthStencilState> object;
+				ThrowIfFailed(device->CreateDepthStencilState(&desc, &object));
+				return Share(object);
+			});
+		}
+
+		// Die Pipeline verweist nur auf die Objekte, die der Cache unter ihren eigenen Schlüsseln hält.
+		RenderPipeline handles =
+		{
+			inputLayoutObject.get(), vertexShaderObject.get(), pixelShaderObject.get(), description.topology,
+			blendStateObject.get(), depthStencilStateObject.get()
+		};
+		return std::shared_ptr<void>(std::make_shared<RenderPipeline>(handles));
+	}));
+
+	m_cache.AddToManifest(description, key);
+	return *pipeline;
+}
+
+std::vector<ResourceId> D3D11PipelineFactory::Prewarm(ResourceLoader& loader, float priority)
+{
+	std::vector<ResourceId> resources;
+	for (const PipelineManifestEntry& entry : m_cache.GetManifest())
+	{
+		const PipelineDescription description = entry.description;
+
+		ResourceRequest request = {};
+		request.priority = priority;
+		request.read = [this, description]() { LoadShaders(description); return AssetData(); };
+		request.decode = [this, description](const AssetData&) { CreatePipeline(description); };
+		resources.push_back(loader.Request(request));
+	}
+	return resources;
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include "DeviceResources.h"
+#include "AssetPack.h"
+#include "PipelineCache.h"
+#include "ResourceLoader.h"
+
+namespace DX
+{
+	// Erstellt Pipelines aus PipelineDescriptions über einen PipelineCache: Shader und Eingabelayouts, die
+	// mehrere Pipelines teilen, gibt es nur einmal, und jede verwendete Pipeline landet im Verzeichnis für
+	// den nächsten Start. Die Handles gehören dem Cache und bleiben bis ReleaseDeviceDependentResources gültig.
+	class D3D11PipelineFactory
+	{
+	public:
+		// Ohne Asset-Archiv (nullptr) werden die Shader einzeln gelesen.
+		D3D11PipelineFactory(const std::shared_ptr<DeviceResources>& deviceResources, const std::shared_ptr<const AssetPack>& assets);
+		void ReleaseDeviceDependentResources();
+
+		// Liest den Bytecode beider Shader, sofern noch nicht geschehen. Blockiert; gedacht für die Lesestufe
+		// eines ResourceLoaders.
+		void LoadShaders(const PipelineDescription& description);
+
+		// Liefert die Pipeline und erstellt fehlende Objekte. Darf von mehreren Threads zugleich aufgerufen werden.
+		// Wirft std::runtime_error, wenn ReleaseDeviceDependentResources währenddessen aufgerufen wurde.
+		RenderPipeline CreatePipeline(const PipelineDescription& description);
+
+		// Fordert jede Pipeline des Verzeichnisses mit der angegebenen Priorität beim Lader an. Der Aufrufer
+		// gibt die Anforderungen frei, sobald sie abgeschlossen sind, und wartet vor
+		// ReleaseDeviceDependentResources mit ResourceLoader::ReleaseAndWait auf noch laufende.
+		std::vector<ResourceId> Prewarm(ResourceLoader& loader, float priority);
+
+		PipelineCache& GetCache()							{ return m_cache; }
+
+	private:
+		struct Shader
+		{
+			PipelineKey	key;
+			AssetData	bytecode;
+		};
+
+		std::shared_ptr<const Shader> GetShader(const std::string& name, PipelineObjectKind kind);
+
+		// Zeiger in den Geräteressourcen zwischengespeichert.
+		std::shared_ptr<DeviceResources>	m_deviceResources;
+		std::shared_ptr<const AssetPack>	m_assets;
+
+		PipelineCache						m_cache;
+
+		// Bytecode nach Asset-Namen; er hängt nicht vom Gerät ab und überdauert daher einen Geräteverlust.
+		std::mutex														m_shaderMutex;
+		std::unordered_map<std::string, std::shared_ptr<const Shader>>	m_shaders;
+	};
+}
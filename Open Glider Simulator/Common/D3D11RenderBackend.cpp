@@ -0,0 +1,347 @@
+﻿#include "pch.h"
+#include "D3D11RenderBackend.h"
+
+#include "DirectXHelper.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace DX;
+
+namespace
+{
+	// Die Renderer zeichnen Zeiger des passenden Typs auf, daher ist die Rückumwandlung eindeutig.
+	template<typename T>
+	T* FromHandle(RenderHandle handle)
+	{
+		return static_cast<T*>(const_cast<void*>(handle));
+	}
+
+	D3D11_PRIMITIVE_TOPOLOGY ToD3D11(PrimitiveTopology topology)
+	{
+		switch (topology)
+		{
+		case PrimitiveTopology::TriangleStrip:	return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+		case PrimitiveTopology::LineList:		return D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+		default:								return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		}
+	}
+}
+
+D3D11RenderBackend::D3D11RenderBackend(const std::shared_ptr<DeviceResources>& deviceResources) :
+	m_deviceResources(deviceResources),
+	m_uploadRing(UploadRingCapacity, ConstantBufferRangeAlignment),
+	m_uploadMapped(false),
+	m_noOverwrite(false),
+	m_nextFence(1)
+{
+	CreateDeviceDependentResources();
+}
+
+void D3D11RenderBackend::CreateDeviceDependentResources()
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	// Ausschnitte eines Konstantenpuffers zu binden, gehört zu Direct3D 11.1 und wird von den Treibern unter
+	// Windows 10 unterstützt; ohne diese Fähigkeit gibt es keinen Ring.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	ThrowIfFailed(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)));
+	if (!options.ConstantBufferOffsetting)
+	{
+		ThrowIfFailed(DXGI_ERROR_UNSUPPORTED);
+	}
+	m_noOverwrite = options.MapNoOverwriteOnDynamicConstantBuffer != FALSE;
+
+	CD3D11_BUFFER_DESC uploadBufferDesc(UploadRingCapacity, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+	ThrowIfFailed(
+		device->CreateBuffer(
+			&uploadBufferDesc,
+			nullptr,
+			&m_uploadBuffer
+			)
+		);
+
+	m_uploadRing.Reset();
+	m_uploadRing.SetMemory(nullptr, m_uploadBuffer.Get());
+}
+
+void D3D11RenderBackend::ReleaseDeviceDependentResources()
+{
+	m_uploadMapped = false;
+	m_uploadRing.Reset();
+	m_uploadRing.SetMemory(nullptr, nullptr);
+	m_uploadBuffer.Reset();
+	m_pendingFences.clear();
+	m_freeQueries.clear();
+	m_deferredContexts.clear();
+	m_commandLists.clear();
+}
+
+// Gibt die Ausschnitte aller Frames frei, deren Fence die GPU erreicht hat, und blendet den Ring für die
+// Aufzeichnung ein.
+void D3D11RenderBackend::BeginFrame()
+{
+	DX_PROFILE_ZONE("D3D11RenderBackend::BeginFrame");
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	uint64 completed = 0;
+	while (!m_pendingFences.empty() &&
+		context->GetData(m_pendingFences.front().query.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+	{
+		completed = m_pendingFences.front().value;
+		m_freeQueries.push_back(m_pendingFences.front().query);
+		m_pendingFences.pop_front();
+	}
+
+	// Beim Verwerfen legt der Treiber neuen Speicher an; die Daten der GPU bleiben dann ohnehin erhalten.
+	// Ohne ausstehende Frames, etwa beim ersten Frame nach dem Erstellen, wird daher immer verworfen.
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (!m_noOverwrite || m_pendingFences.empty())
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		m_uploadRing.Reset();
+	}
+	else if (completed != 0)
+	{
+		m_uploadRing.Retire(completed);
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	ThrowIfFailed(context->Map(m_uploadBuffer.Get(), 0, mapType, 0, &mapped));
+	m_uploadRing.SetMemory(static_cast<uint8_t*>(mapped.pData), m_uploadBuffer.Get());
+	m_uploadMapped = true;
+}
+
+void D3D11RenderBackend::UnmapUploadRing()
+{
+	if (m_uploadMapped)
+	{
+		m_deviceResources->GetD3DDeviceContext()->Unmap(m_uploadBuffer.Get(), 0);
+		m_uploadRing.SetMemory(nullptr, m_uploadBuffer.Get());
+		m_uploadMapped = false;
+	}
+}
+
+// Setzt nach den Befehlen des Frames eine Fence, an der BeginFrame später erkennt, dass die GPU fertig ist.
+void D3D11RenderBackend::EndFrame()
+{
+	UnmapUploadRing();
+
+	Microsoft::WRL::ComPtr<ID3D11Query> query;
+	if (m_freeQueries.empty())
+	{
+		CD3D11_QUERY_DESC queryDesc(D3D11_QUERY_EVENT);
+		ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateQuery(&queryDesc, &query));
+	}
+	else
+	{
+		query = m_freeQueries.back();
+		m_freeQueries.pop_back();
+	}
+
+	m_deviceResources->GetD3DDeviceContext()->End(query.Get());
+	Fence fence = { m_nextFence++, query };
+	m_pendingFences.push_back(fence);
+	m_uploadRing.EndFrame(fence.value);
+}
+
+void D3D11RenderBackend::Execute(const RenderCommandBuffer& commands)
+{
+	DX_PROFILE_ZONE("D3D11RenderBackend::Execute");
+
+	// Solange der Ring eingeblendet ist, darf die GPU ihn nicht lesen.
+	UnmapUploadRing();
+	Translate(m_deviceResources->GetD3DDeviceContext(), commands);
+}
+
+// Setzt die Puffer auf den Arbeitsthreads in je einem verzögerten Kontext in Befehlslisten um und führt diese
+// in der gegebenen Reihenfolge auf dem unmittelbaren Kontext aus. Verzögerte Kontexte beginnen ohne Zustand;
+// Renderziele und Viewport werden daher vom unmittelbaren Kontext übernommen.
+void D3D11RenderBackend::ExecuteInOrder(const RenderCommandBuffer* const* commands, size_t count, ThreadPool* pool)
+{
+	if (!pool || count < 2)
+	{
+		IRenderBackend::ExecuteInOrder(commands, count, pool);
+		return;
+	}
+
+	DX_PROFILE_ZONE("D3D11RenderBackend::ExecuteInOrder");
+
+	UnmapUploadRing();
+
+	auto device = m_deviceResources->GetD3DDevice();
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	while (m_deferredContexts.size() < count)
+	{
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext3> deferredContext;
+		ThrowIfFailed(device->CreateDeferredContext3(0, &deferredContext));
+		m_deferredContexts.push_back(deferredContext);
+	}
+	m_commandLists.resize(count);
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTarget;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencil;
+	context->OMGetRenderTargets(1, &renderTarget, &depthStencil);
+	D3D11_VIEWPORT viewport;
+	UINT viewportCount = 1;
+	context->RSGetViewports(&viewportCount, &viewport);
+	ID3D11RenderTargetView* const targets[1] = { renderTarget.Get() };
+
+	pool->ParallelFor(static_cast<uint32_t>(count), [&](uint32_t index) {
+		ID3D11DeviceContext3* deferredContext = m_deferredContexts[index].Get();
+		deferredContext->OMSetRenderTargets(1, targets, depthStencil.Get());
+		deferredContext->RSSetViewports(viewportCount, &viewport);
+		Translate(deferredContext, *commands[index]);
+		ThrowIfFailed(deferredContext->FinishCommandList(FALSE, &m_commandLists[index]));
+	});
+
+	{
+		DX_PROFILE_ZONE("D3D11RenderBackend::ExecuteCommandLists");
+		for (size_t i = 0; i < count; i++)
+		{
+			context->ExecuteCommandList(m_commandLists[i].Get(), FALSE);
+			m_commandLists[i].Reset();
+		}
+	}
+
+	// Ohne Wiederherstellen ist der unmittelbare Kontext danach leer; nachfolgende Arbeit erwartet die Renderziele.
+	context->OMSetRenderTargets(1, targets, depthStencil.Get());
+	context->RSSetViewports(viewportCount, &viewport);
+}
+
+void D3D11RenderBackend::Translate(ID3D11DeviceContext1* context, const RenderCommandBuffer& commands)
+{
+	commands.ForEach([context](const RenderCommandHeader& header) {
+		switch (header.type)
+		{
+		case RenderCommandType::SetPipeline:
+		{
+			const RenderPipeline& pipeline = reinterpret_cast<const SetPipelineCommand&>(header).pipeline;
+			context->IASetInputLayout(FromHandle<ID3D11InputLayout>(pipeline.inputLayout));
+			context->IASetPrimitiveTopology(ToD3D11(pipeline.topology));
+			context->VSSetShader(FromHandle<ID3D11VertexShader>(pipeline.vertexShader), nullptr, 0);
+			context->PSSetShader(FromHandle<ID3D11PixelShader>(pipeline.pixelShader), nullptr, 0);
+			context->OMSetBlendState(FromHandle<ID3D11BlendState>(pipeline.blendState), nullptr, 0xffffffff);
+			context->OMSetDepthStencilState(FromHandle<ID3D11DepthStencilState>(pipeline.depthStencilState), 0);
+			break;
+		}
+
+		case RenderCommandType::SetVertexBuffer:
+		{
+			const SetVertexBufferCommand& command = reinterpret_cast<const SetVertexBufferCommand&>(header);
+			ID3D11Buffer* buffer = FromHandle<ID3D11Buffer>(command.buffer);
+			UINT stride = command.stride;
+			UINT offset = command.offset;
+			context->IASetVertexBuffers(command.slot, 1, &buffer, &stride, &offset);
+			break;
+		}
+
+		case RenderCommandType::SetIndexBuffer:
+		{
+			const SetIndexBufferCommand& command = reinterpret_cast<const SetIndexBufferCommand&>(header);
+			context->IASetIndexBuffer(
+				FromHandle<ID3D11Buffer>(command.buffer),
+				command.format == IndexFormat::UInt32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT,
+				command.offset
+				);
+			break;
+		}
+
+		case RenderCommandType::SetConstantBuffers:
+		{
+			const SetConstantBuffersCommand& command = reinterpret_cast<const SetConstantBuffersCommand&>(header);
+			ID3D11Buffer* buffers[MaxConstantBuffersPerCommand];
+			for (uint32_t i = 0; i < command.count; i++)
+			{
+				buffers[i] = FromHandle<ID3D11Buffer>(command.buffers[i]);
+			}
+			if (command.stages & ShaderStageVertex)
+			{
+				context->VSSetConstantBuffers1(command.startSlot, command.count, buffers, nullptr, nullptr);
+			}
+			if (command.stages & ShaderStagePixel)
+			{
+				context->PSSetConstantBuffers1(command.startSlot, command.count, buffers, nullptr, nullptr);
+			}
+			break;
+		}
+
+		case RenderCommandType::SetConstantBufferRange:
+		{
+			// Direct3D zählt Ausschnitte in Konstanten zu 16 Bytes; die Anzahl muss ein Vielfaches von 16 sein.
+			const SetConstantBufferRangeCommand& command = reinterpret_cast<const SetConstantBufferRangeCommand&>(header);
+			ID3D11Buffer* buffer = FromHandle<ID3D11Buffer>(command.buffer);
+			UINT firstConstant = command.offset / 16;
+			UINT constantCount = (command.size / 16 + 15) & ~15u;
+			if (command.stages & ShaderStageVertex)
+			{
+				context->VSSetConstantBuffers1(command.slot, 1, &buffer, &firstConstant, &constantCount);
+			}
+			if (command.stages & ShaderStagePixel)
+			{
+				context->PSSetConstantBuffers1(command.slot, 1, &buffer, &firstConstant, &constantCount);
+			}
+			break;
+		}
+
+		case RenderCommandType::SetShaderResources:
+		{
+			const SetShaderResourcesCommand& command = reinterpret_cast<const SetShaderResourcesCommand&>(header);
+			ID3D11ShaderResourceView* views[MaxShaderResourcesPerCommand];
+			for (uint32_t i = 0; i < command.count; i++)
+			{
+				views[i] = FromHandle<ID3D11ShaderResourceView>(command.views[i]);
+			}
+			if (command.stages & ShaderStageVertex)
+			{
+				context->VSSetShaderResources(command.startSlot, command.count, views);
+			}
+			if (command.stages & ShaderStagePixel)
+			{
+				context->PSSetShaderResources(command.startSlot, command.count, views);
+			}
+			break;
+		}
+
+		case RenderCommandType::UpdateConstants:
+		{
+			const UpdateConstantsCommand& command = reinterpret_cast<const UpdateConstantsCommand&>(header);
+			context->UpdateSubresource1(FromHandle<ID3D11Buffer>(command.buffer), 0, NULL, command.GetData(), 0, 0, 0);
+			break;
+		}
+
+		case RenderCommandType::UpdateBuffer:
+		{
+			// Dynamische Puffer werden verworfen und neu beschrieben, damit die GPU nie auf die CPU wartet.
+			const UpdateBufferCommand& command = reinterpret_cast<const UpdateBufferCommand&>(header);
+			ID3D11Buffer* buffer = FromHandle<ID3D11Buffer>(command.buffer);
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			ThrowIfFailed(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+			memcpy(mapped.pData, command.GetData(), command.dataSize);
+			context->Unmap(buffer, 0);
+			break;
+		}
+
+		case RenderCommandType::Draw:
+		{
+			const DrawCommand& command = reinterpret_cast<const DrawCommand&>(header);
+			context->Draw(command.vertexCount, command.startVertex);
+			break;
+		}
+
+		case RenderCommandType::DrawIndexed:
+		{
+			const DrawIndexedCommand& command = reinterpret_cast<const DrawIndexedCommand&>(header);
+			context->DrawIndexed(command.indexCount, command.startIndex, command.baseVertex);
+			break;
+		}
+
+		case RenderCommandType::DrawIndexedInstanced:
+		{
+			const DrawIndexedInstancedCommand& command = reinterpret_cast<const DrawIndexedInstancedCommand&>(header);
+			context->DrawIndexedInstanced(command.indexCount, command.instanceCount, command.startIndex, command.baseVertex, command.startInstance);
+			break;
+		}
+		}
+	});
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <deque>
+#include "DeviceResources.h"
+#include "RenderCommands.h"
+#include "UploadRing.h"
+
+namespace DX
+{
+	// Führt aufgezeichnete Befehle auf dem Direct3D-11-Gerätekontext der Geräteressourcen aus. Die Handles
+	// sind die rohen Schnittstellenzeiger der Renderer (z. B. ID3D11Buffer*); jeder Befehl wird unverändert umgesetzt.
+	// Der UploadRing ist ein dynamischer Konstantenpuffer, der von BeginFrame bis Execute ohne Überschreiben
+	// eingeblendet bleibt; Ereignisabfragen dienen als Fence für die Freigabe abgearbeiteter Frames.
+	// Mehrere Befehlspuffer setzt ExecuteInOrder auf den Arbeitsthreads in verzögerten Kontexten um.
+	class D3D11RenderBackend : public IRenderBackend
+	{
+	public:
+		// Reicht für die Konstanten mehrerer Frames mit einigen tausend Aufrufen.
+		static const uint32 UploadRingCapacity = 4 * 1024 * 1024;
+
+		D3D11RenderBackend(const std::shared_ptr<DeviceResources>& deviceResources);
+		void CreateDeviceDependentResources();
+		void ReleaseDeviceDependentResources();
+
+		virtual void BeginFrame() override;
+		virtual UploadRing& GetUploadRing() override					{ return m_uploadRing; }
+		virtual void Execute(const RenderCommandBuffer& commands) override;
+		virtual void EndFrame() override;
+		virtual void ExecuteInOrder(const RenderCommandBuffer* const* commands, size_t count, ThreadPool* pool) override;
+
+	private:
+		struct Fence
+		{
+			uint64									value;
+			Microsoft::WRL::ComPtr<ID3D11Query>		query;
+		};
+
+		void UnmapUploadRing();
+		static void Translate(ID3D11DeviceContext1* context, const RenderCommandBuffer& commands);
+
+		// Zeiger in den Geräteressourcen zwischengespeichert.
+		std::shared_ptr<DeviceResources> m_deviceResources;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer>	m_uploadBuffer;
+		UploadRing								m_uploadRing;
+		bool									m_uploadMapped;
+
+		// Ohne Überschreibschutz für Konstantenpuffer wird der Ring jeden Frame verworfen und von vorne beschrieben.
+		bool									m_noOverwrite;
+
+		// Ausstehende Fences in Signalreihenfolge und freie Abfragen zur Wiederverwendung.
+		std::deque<Fence>										m_pendingFences;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11Query>>		m_freeQueries;
+		uint64													m_nextFence;
+
+		// Je Befehlspuffer eines ExecuteInOrder ein verzögerter Kontext; die Listen leben nur bis zur Ausführung.
+		std::vector<Microsoft::WRL::ComPtr<ID3D11DeviceContext3>>	m_deferredContexts;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11CommandList>>		m_commandLists;
+	};
+}
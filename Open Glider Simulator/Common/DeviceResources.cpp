@@ -1,6 +1,7 @@
 ﻿#include "pch.h"
 #include "DeviceResources.h"
 #include "DirectXHelper.h"
+#include "Profiler.h"
 
 using namespace D2D1;
 using namespace DirectX;
@@ -617,6 +618,8 @@ void DX::DeviceResources::Trim()
 // Die Inhalte der Swapchain auf dem Bildschirm anzeigen.
 void DX::DeviceResources::Present() 
 {
+	DX_PROFILE_ZONE("DeviceResources::Present");
+
 	// Das erste Argument weist DXGI an, bis zur VSync zu blockieren, sodass die Anwendung
 	// bis zur nächsten VSync in den Standbymodus versetzt wird. Dadurch wird sichergestellt, dass beim Rendern von
 	// Frames, die nie auf dem Display angezeigt werden, keine unnötigen Zyklen ausgeführt werden.
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <ppltasks.h>	// Für create_task
+#include "AssetPack.h"
 
 namespace DX
 {
@@ -33,6 +34,30 @@ namespace DX
 		});
 	}
 
+	// Liest eine Datei des App-Pakets aus dem Asset-Archiv, sofern es sie enthält, unkomprimiert ohne Kopie.
+	// Sonst wie ReadDataAsync einzeln. Die Namen im Archiv sind die Dateinamen in ASCII.
+	inline Concurrency::task<AssetData> ReadAssetAsync(const std::shared_ptr<const AssetPack>& assets, const std::wstring& filename)
+	{
+		std::string name;
+		for (wchar_t c : filename)
+		{
+			name.push_back(static_cast<char>(c));
+		}
+
+		if (assets && assets->Contains(name))
+		{
+			return Concurrency::create_task([assets, name]
+			{
+				return assets->Load(name);
+			});
+		}
+
+		return ReadDataAsync(filename).then([](std::vector<byte> fileData)
+		{
+			return AssetData(std::move(fileData));
+		});
+	}
+
 	// Wandelt eine Längenangabe in geräteunabhängigen Pixeln (Device-Independent Pixels, DIPs) in eine Längenangabe in physischen Pixeln um.
 	inline float ConvertDipsToPixels(float dips, float dpi)
 	{
@@ -0,0 +1,228 @@
+﻿#include "DrawQueue.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t MeshShift = DrawQueue::DepthBits;
+	const uint32_t MaterialShift = MeshShift + DrawQueue::MeshBits;
+	const uint32_t PipelineShift = MaterialShift + DrawQueue::MaterialBits;
+	const uint32_t PassShift = PipelineShift + DrawQueue::PipelineBits;
+
+	static_assert(PassShift + DrawQueue::PassBits == 64, "sort key must use all 64 bits");
+
+	uint32_t GetField(uint64_t key, uint32_t shift, uint32_t bits)
+	{
+		return static_cast<uint32_t>(key >> shift) & ((1u << bits) - 1);
+	}
+
+	// LSD-Radixsortierung in Schritten zu 8 Bit. Schritte, in denen alle Schlüssel dieselbe Ziffer haben,
+	// werden übersprungen; das trifft bei wenigen Durchgängen und Pipelines auf die oberen Bytes zu.
+	// Stabil, daher bleibt die Einreichungsreihenfolge bei gleichem Schlüssel erhalten.
+	template<typename TItem>
+	void RadixSort(std::vector<TItem>& items, std::vector<TItem>& scratch)
+	{
+		size_t count = items.size();
+		scratch.resize(count);
+
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			size_t offsets[256] = {};
+			for (const TItem& item : items)
+			{
+				offsets[(item.key >> shift) & 0xFF]++;
+			}
+			if (offsets[(items[0].key >> shift) & 0xFF] == count)
+			{
+				continue;
+			}
+
+			size_t sum = 0;
+			for (size_t& offset : offsets)
+			{
+				size_t bucketCount = offset;
+				offset = sum;
+				sum += bucketCount;
+			}
+			for (const TItem& item : items)
+			{
+				scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+			}
+			items.swap(scratch);
+		}
+	}
+
+	template<typename T>
+	uint32_t Register(std::vector<T>& table, const T& value, uint32_t bits, const char* message)
+	{
+		if (table.size() >= (size_t(1) << bits))
+		{
+			throw std::runtime_error(message);
+		}
+		table.push_back(value);
+		return static_cast<uint32_t>(table.size() - 1);
+	}
+}
+
+DrawQueue::DrawQueue() :
+	m_resources(),
+	m_statistics()
+{
+}
+
+void DrawQueue::SetResources(const DrawQueueResources& resources)
+{
+	m_resources = resources;
+}
+
+void DrawQueue::ClearResources()
+{
+	m_resources = DrawQueueResources();
+	m_pipelines.clear();
+	m_materials.clear();
+	m_meshes.clear();
+	m_items.clear();
+	m_transforms.clear();
+}
+
+uint32_t DrawQueue::RegisterPipeline(const RenderPipeline& pipeline)
+{
+	return Register(m_pipelines, pipeline, PipelineBits, "DrawQueue: too many pipelines");
+}
+
+uint32_t DrawQueue::RegisterMaterial(RenderHandle constantBuffer)
+{
+	return Register(m_materials, constantBuffer, MaterialBits, "DrawQueue: too many materials");
+}
+
+uint32_t DrawQueue::RegisterMesh(const DrawMesh& mesh)
+{
+	return Register(m_meshes, mesh, MeshBits, "DrawQueue: too many meshes");
+}
+
+uint64_t DrawQueue::MakeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+	const float depthScale = static_cast<float>((1u << DepthBits) - 1);
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+
+	return static_cast<uint64_t>(pass) << PassShift |
+		static_cast<uint64_t>(pipeline) << PipelineShift |
+		static_cast<uint64_t>(material) << MaterialShift |
+		static_cast<uint64_t>(mesh) << MeshShift |
+		static_cast<uint64_t>(depth * depthScale);
+}
+
+void DrawQueue::Submit(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth, const InstanceTransform& transform)
+{
+	if (pass >= (1u << PassBits) || pipeline >= m_pipelines.size() || material >= m_materials.size() || mesh >= m_meshes.size())
+	{
+		throw std::invalid_argument("DrawQueue: unregistered pipeline, material or mesh");
+	}
+
+	Item item = { MakeSortKey(pass, pipeline, material, mesh, depth), static_cast<uint32_t>(m_transforms.size()) };
+	m_items.push_back(item);
+	m_transforms.push_back(transform);
+}
+
+void DrawQueue::Flush(RenderCommandBuffer& commands, UploadRing& uploads)
+{
+	m_statistics = DrawQueueStatistics();
+	m_statistics.submitted = static_cast<uint32_t>(m_items.size());
+
+	if (m_items.empty())
+	{
+		return;
+	}
+	if (m_resources.instanceCapacity == 0)
+	{
+		throw std::runtime_error("DrawQueue: no instance buffer");
+	}
+
+	RadixSort(m_items, m_sortScratch);
+	size_t count = m_items.size();
+
+	commands.SetShaderResources(ShaderStageVertex, InstanceBufferSlot, 1, &m_resources.instanceView);
+
+	const uint32_t none = UINT32_MAX;
+	uint32_t currentPipeline = none;
+	uint32_t currentMaterial = none;
+	uint32_t currentMesh = none;
+
+	// Übersteigt ein Frame den Instanzpuffer, wird er abschnittsweise neu beschrieben. Ein Aufruf
+	// endet dann spätestens am Ende seines Abschnitts.
+	for (size_t chunkStart = 0; chunkStart < count; chunkStart += m_resources.instanceCapacity)
+	{
+		size_t chunkEnd = (std::min)(count, chunkStart + m_resources.instanceCapacity);
+
+		// Die Instanzdaten in Zeichenreihenfolge direkt in den Befehlspuffer schreiben, damit jeder
+		// zusammengefasste Aufruf einen zusammenhängenden Bereich des Instanzpuffers liest.
+		InstanceTransform* instances = static_cast<InstanceTransform*>(commands.UpdateBuffer(m_resources.instanceBuffer,
+			static_cast<uint32_t>((chunkEnd - chunkStart) * sizeof(InstanceTransform))));
+		for (size_t i = chunkStart; i < chunkEnd; i++)
+		{
+			instances[i - chunkStart] = m_transforms[m_items[i].instance];
+		}
+		m_statistics.instanceUploads++;
+
+		size_t first = chunkStart;
+		while (first < chunkEnd)
+		{
+			uint64_t state = m_items[first].key >> DepthBits;
+			size_t last = first + 1;
+			while (last < chunkEnd && (m_items[last].key >> DepthBits) == state)
+			{
+				last++;
+			}
+
+			uint64_t key = m_items[first].key;
+			uint32_t pipeline = GetField(key, PipelineShift, PipelineBits);
+			uint32_t material = GetField(key, MaterialShift, MaterialBits);
+			uint32_t mesh = GetField(key, MeshShift, MeshBits);
+
+			if (pipeline != currentPipeline)
+			{
+				commands.SetPipeline(m_pipelines[pipeline]);
+				currentPipeline = pipeline;
+				m_statistics.pipelineChanges++;
+			}
+			if (material != currentMaterial)
+			{
+				// Auch ohne eigenen Puffer binden, damit nicht der Puffer des vorigen Materials stehen bleibt.
+				commands.SetConstantBuffers(ShaderStageVertex | ShaderStagePixel, MaterialSlot, 1, &m_materials[material]);
+				currentMaterial = material;
+				m_statistics.materialChanges++;
+			}
+			const DrawMesh& drawMesh = m_meshes[mesh];
+			if (mesh != currentMesh)
+			{
+				commands.SetVertexBuffer(0, drawMesh.vertexBuffer, drawMesh.vertexStride, 0);
+				commands.SetIndexBuffer(drawMesh.indexBuffer, drawMesh.indexFormat, 0);
+				currentMesh = mesh;
+				m_statistics.meshChanges++;
+			}
+
+			// SV_InstanceID beginnt bei jedem Aufruf mit 0, daher steht der Beginn in den Aufrufkonstanten.
+			// Ist der Ring voll, fehlt der Aufruf in diesem Frame, statt Daten der GPU zu überschreiben.
+			DrawConstants drawConstants = { static_cast<uint32_t>(first - chunkStart), { 0, 0, 0 } };
+			UploadAllocation allocation = uploads.Upload(drawConstants);
+			if (allocation.IsValid())
+			{
+				commands.SetConstantBufferRange(ShaderStageVertex, DrawConstantsSlot, uploads.GetBuffer(), allocation.offset, allocation.size);
+				commands.DrawIndexedInstanced(drawMesh.indexCount, static_cast<uint32_t>(last - first), drawMesh.startIndex, drawMesh.baseVertex, 0);
+				m_statistics.batches++;
+			}
+			else
+			{
+				m_statistics.droppedBatches++;
+			}
+
+			first = last;
+		}
+	}
+
+	m_items.clear();
+	m_transforms.clear();
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "RenderCommands.h"
+#include "UploadRing.h"
+
+namespace DX
+{
+	// Geometrie eines Zeichenaufrufs: Ausschnitt aus einem Scheitelpunkt- und einem Indexpuffer.
+	struct DrawMesh
+	{
+		RenderHandle	vertexBuffer;
+		uint32_t		vertexStride;
+		RenderHandle	indexBuffer;
+		IndexFormat		indexFormat;
+		uint32_t		indexCount;
+		uint32_t		startIndex;
+		int32_t			baseVertex;
+	};
+
+	// Modellmatrix einer Instanz, transponiert wie die Matrizen in den Konstantenpuffern.
+	struct InstanceTransform
+	{
+		float m[4][4];
+	};
+
+	// Gerätepuffer der Warteschlange. Der Instanzpuffer ist ein dynamischer strukturierter Puffer mit
+	// instanceCapacity Elementen vom Typ InstanceTransform.
+	struct DrawQueueResources
+	{
+		RenderHandle	instanceBuffer;
+		RenderHandle	instanceView;
+		uint32_t		instanceCapacity;
+	};
+
+	// Zahlen des letzten Flush.
+	struct DrawQueueStatistics
+	{
+		uint32_t	submitted;
+		uint32_t	batches;
+		uint32_t	pipelineChanges;
+		uint32_t	materialChanges;
+		uint32_t	meshChanges;
+		uint32_t	instanceUploads;
+		uint32_t	droppedBatches;			// kein Platz mehr im UploadRing
+	};
+
+	// Sammelt Zeichenaufrufe eines Frames, sortiert sie nach einem 64-Bit-Schlüssel aus Durchgang, Pipeline,
+	// Material, Netz und Tiefe und zeichnet sie in einen Befehlspuffer auf. Aufeinanderfolgende Aufrufe mit
+	// gleichem Durchgang, gleicher Pipeline, gleichem Material und gleichem Netz werden zu einem instanzierten
+	// Aufruf zusammengefasst; Zustände werden nur bei einem Wechsel gesetzt. Die Vertex-Shader lesen ihre
+	// Modellmatrix aus dem Instanzpuffer an Register t0 mit dem Index SV_InstanceID + erste Instanz aus b1.
+	// Die Aufrufkonstanten mit 16 Bytes, deren x-Komponente diese erste Instanz angibt, liegen im UploadRing.
+	class DrawQueue
+	{
+	public:
+		// Aufteilung des Sortierschlüssels vom höchst- zum niederwertigen Bit.
+		static const uint32_t PassBits = 4;
+		static const uint32_t PipelineBits = 12;
+		static const uint32_t MaterialBits = 12;
+		static const uint32_t MeshBits = 16;
+		static const uint32_t DepthBits = 20;
+
+		// Register der Shader für Instanzpuffer (t), Aufrufkonstanten (b) und Materialkonstanten (b).
+		static const uint32_t InstanceBufferSlot = 0;
+		static const uint32_t DrawConstantsSlot = 1;
+		static const uint32_t MaterialSlot = 2;
+
+		DrawQueue();
+
+		// Die Gerätepuffer gehören dem Aufrufer. ClearResources vergisst sie samt aller Registrierungen,
+		// etwa bei Geräteverlust; danach müssen Pipelines, Materialien und Netze neu registriert werden.
+		void SetResources(const DrawQueueResources& resources);
+		void ClearResources();
+
+		uint32_t RegisterPipeline(const RenderPipeline& pipeline);
+		uint32_t RegisterMaterial(RenderHandle constantBuffer);			// nullptr für Pipelines ohne Materialkonstanten
+		uint32_t RegisterMesh(const DrawMesh& mesh);
+
+		// depth in [0, 1] mit 0 beim Betrachter ordnet innerhalb gleicher Zustände von vorne nach hinten.
+		// Für durchsichtige Durchgänge 1 - depth übergeben.
+		void Submit(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth, const InstanceTransform& transform);
+
+		// Sortiert, fasst zusammen, zeichnet auf und leert die Warteschlange für den nächsten Frame.
+		void Flush(RenderCommandBuffer& commands, UploadRing& uploads);
+
+		static uint64_t MakeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+		size_t GetSubmittedCount() const					{ return m_items.size(); }
+		const DrawQueueStatistics& GetStatistics() const	{ return m_statistics; }
+
+	private:
+		struct Item
+		{
+			uint64_t	key;
+			uint32_t	instance;		// Index in m_transforms
+		};
+
+		struct DrawConstants
+		{
+			uint32_t	firstInstance;
+			uint32_t	padding[3];
+		};
+
+		DrawQueueResources					m_resources;
+		std::vector<RenderPipeline>			m_pipelines;
+		std::vector<RenderHandle>			m_materials;
+		std::vector<DrawMesh>				m_meshes;
+
+		std::vector<Item>					m_items;
+		std::vector<Item>					m_sortScratch;
+		std::vector<InstanceTransform>		m_transforms;
+
+		DrawQueueStatistics					m_statistics;
+	};
+}
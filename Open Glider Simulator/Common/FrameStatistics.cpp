@@ -0,0 +1,115 @@
+﻿#include "FrameStatistics.h"
+
+#include <iomanip>
+
+using namespace DX;
+
+FrameStatistics::FrameStatistics() :
+	m_windowTicks(IClock::TicksPerSecond),
+	m_hitchThresholdTicks(IClock::TicksPerSecond / 30)
+{
+	Reset();
+}
+
+void FrameStatistics::Reset()
+{
+	for (uint32_t stage = 0; stage < StageCount; stage++)
+	{
+		m_window[stage].Reset();
+		m_total[stage].Reset();
+		m_windowSummaries[stage] = Summarize(m_window[stage]);
+	}
+
+	m_windowElapsedTicks = 0;
+	m_windowHitches = 0;
+	m_windowHitchCount = 0;
+	m_totalHitchCount = 0;
+	m_windowCompleted = false;
+}
+
+void FrameStatistics::Record(FrameStage stage, uint64_t ticks)
+{
+	// Die Histogramme arbeiten in Mikrosekunden.
+	uint64_t microseconds = ticks / (IClock::TicksPerSecond / 1000000);
+	m_window[Index(stage)].Record(microseconds);
+	m_total[Index(stage)].Record(microseconds);
+
+	// Der Frameabstand bestimmt Ruckler und das Ende eines Zeitfensters.
+	if (stage == FrameStage::Frame)
+	{
+		if (ticks > m_hitchThresholdTicks)
+		{
+			m_windowHitches++;
+			m_totalHitchCount++;
+		}
+
+		m_windowElapsedTicks += ticks;
+		if (m_windowElapsedTicks >= m_windowTicks)
+		{
+			CompleteWindow();
+		}
+	}
+}
+
+bool FrameStatistics::ConsumeWindowCompleted()
+{
+	bool completed = m_windowCompleted;
+	m_windowCompleted = false;
+	return completed;
+}
+
+void FrameStatistics::CompleteWindow()
+{
+	for (uint32_t stage = 0; stage < StageCount; stage++)
+	{
+		m_windowSummaries[stage] = Summarize(m_window[stage]);
+		m_window[stage].Reset();
+	}
+
+	m_windowHitchCount = m_windowHitches;
+	m_windowHitches = 0;
+	m_windowElapsedTicks = 0;
+	m_windowCompleted = true;
+}
+
+FrameStageSummary FrameStatistics::Summarize(const FrameTimeHistogram& histogram)
+{
+	FrameStageSummary summary;
+	summary.count = histogram.GetCount();
+	summary.p50 = histogram.GetPercentile(0.50) / 1000.0;
+	summary.p95 = histogram.GetPercentile(0.95) / 1000.0;
+	summary.p99 = histogram.GetPercentile(0.99) / 1000.0;
+	summary.max = histogram.GetMax() / 1000.0;
+	return summary;
+}
+
+const char* FrameStatistics::GetStageName(FrameStage stage)
+{
+	switch (stage)
+	{
+	case FrameStage::Update:	return "Update";
+	case FrameStage::Render:	return "Render";
+	case FrameStage::Present:	return "Present";
+	case FrameStage::Frame:		return "Frame";
+	default:					return "?";
+	}
+}
+
+void FrameStatistics::WriteReport(std::ostream& stream) const
+{
+	stream << "stage      count       p50 ms    p95 ms    p99 ms    max ms\n";
+	stream << std::fixed << std::setprecision(3);
+
+	for (uint32_t stage = 0; stage < StageCount; stage++)
+	{
+		FrameStageSummary summary = GetTotalSummary(static_cast<FrameStage>(stage));
+		stream << std::left << std::setw(8) << GetStageName(static_cast<FrameStage>(stage)) << std::right
+			<< std::setw(10) << summary.count
+			<< std::setw(10) << summary.p50
+			<< std::setw(10) << summary.p95
+			<< std::setw(10) << summary.p99
+			<< std::setw(10) << summary.max << "\n";
+	}
+
+	stream << "hitches " << m_totalHitchCount << "\n";
+}
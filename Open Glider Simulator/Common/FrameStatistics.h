@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include "Clock.h"
+#include "FrameTimeHistogram.h"
+
+namespace DX
+{
+	// Abschnitte eines Frames, deren Dauer getrennt erfasst wird. Frame ist der Abstand zwischen zwei Frames.
+	enum class FrameStage : uint32_t
+	{
+		Update,
+		Render,
+		Present,
+		Frame,
+		Count
+	};
+
+	// Zusammenfassung der Zeiten eines Abschnitts in Millisekunden.
+	struct FrameStageSummary
+	{
+		uint64_t	count;
+		double		p50;
+		double		p95;
+		double		p99;
+		double		max;
+	};
+
+	// Erfasst die Dauer jedes Frameabschnitts in Histogrammen fester Größe, ohne Speicher zuzuweisen.
+	// Die Anzeige liest die Werte des zuletzt abgeschlossenen Zeitfensters; daneben werden alle Messungen
+	// seit dem Start gesammelt, damit Läufe ohne Fenster einen Gesamtbericht schreiben können.
+	class FrameStatistics
+	{
+	public:
+		FrameStatistics();
+
+		// Eine Messung im kanonischen Taktformat (10.000.000 Takte pro Sekunde) aufzeichnen.
+		void Record(FrameStage stage, uint64_t ticks);
+
+		// Frames, die länger als dieser Wert dauern, zählen als Ruckler.
+		void SetHitchThresholdTicks(uint64_t ticks)			{ m_hitchThresholdTicks = ticks; }
+
+		// Länge des Zeitfensters, über das die Anzeigewerte gebildet werden.
+		void SetWindowTicks(uint64_t ticks)					{ m_windowTicks = ticks; }
+
+		// Werte des zuletzt abgeschlossenen Zeitfensters.
+		FrameStageSummary GetWindowSummary(FrameStage stage) const	{ return m_windowSummaries[Index(stage)]; }
+		uint32_t GetWindowHitchCount() const						{ return m_windowHitchCount; }
+
+		// Gibt True zurück, wenn seit dem letzten Aufruf ein Zeitfenster abgeschlossen wurde.
+		bool ConsumeWindowCompleted();
+
+		// Werte aller Messungen seit dem Start bzw. dem letzten Reset.
+		FrameStageSummary GetTotalSummary(FrameStage stage) const	{ return Summarize(m_total[Index(stage)]); }
+		uint64_t GetTotalHitchCount() const							{ return m_totalHitchCount; }
+
+		void Reset();
+
+		// Schreibt die Gesamtwerte als Text, z. B. in eine Datei am Ende eines Laufs ohne Fenster.
+		void WriteReport(std::ostream& stream) const;
+
+		static const char* GetStageName(FrameStage stage);
+
+		// Misst die Dauer eines Gültigkeitsbereichs mit der angegebenen Zeitquelle.
+		class ScopedStage
+		{
+		public:
+			ScopedStage(FrameStatistics& statistics, FrameStage stage, const IClock& clock) :
+				m_statistics(statistics),
+				m_stage(stage),
+				m_clock(clock),
+				m_start(clock.GetTicks())
+			{
+			}
+
+			~ScopedStage()
+			{
+				m_statistics.Record(m_stage, m_clock.GetTicks() - m_start);
+			}
+
+		private:
+			ScopedStage(const ScopedStage&);
+			ScopedStage& operator=(const ScopedStage&);
+
+			FrameStatistics&	m_statistics;
+			FrameStage			m_stage;
+			const IClock&		m_clock;
+			uint64_t			m_start;
+		};
+
+	private:
+		static const uint32_t StageCount = static_cast<uint32_t>(FrameStage::Count);
+
+		static uint32_t Index(FrameStage stage)				{ return static_cast<uint32_t>(stage); }
+		static FrameStageSummary Summarize(const FrameTimeHistogram& histogram);
+
+		void CompleteWindow();
+
+		FrameTimeHistogram	m_window[StageCount];
+		FrameTimeHistogram	m_total[StageCount];
+		FrameStageSummary	m_windowSummaries[StageCount];
+
+		uint64_t	m_windowTicks;
+		uint64_t	m_windowElapsedTicks;
+		uint64_t	m_hitchThresholdTicks;
+		uint32_t	m_windowHitches;
+		uint32_t	m_windowHitchCount;
+		uint64_t	m_totalHitchCount;
+		bool		m_windowCompleted;
+	};
+}
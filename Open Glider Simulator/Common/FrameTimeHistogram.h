@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace DX
+{
+	// Log-lineares Histogramm fester Größe für Zeitdauern in Mikrosekunden.
+	// Jede Zweierpotenz wird in SubBucketCount lineare Fächer unterteilt, sodass der relative Fehler
+	// eines Perzentils unter 1/SubBucketCount bleibt. Record weist nie Speicher zu.
+	class FrameTimeHistogram
+	{
+	public:
+		static const uint32_t SubBucketBits = 5;
+		static const uint32_t SubBucketCount = 1u << SubBucketBits;
+		static const uint32_t MaxExponent = 31;
+		static const uint32_t BucketCount = SubBucketCount + (MaxExponent - SubBucketBits + 1) * SubBucketCount;
+
+		FrameTimeHistogram()
+		{
+			Reset();
+		}
+
+		void Reset()
+		{
+			std::memset(m_buckets, 0, sizeof(m_buckets));
+			m_count = 0;
+			m_sum = 0;
+			m_max = 0;
+		}
+
+		void Record(uint64_t microseconds)
+		{
+			if (microseconds > 0xffffffffull)
+			{
+				microseconds = 0xffffffffull;
+			}
+
+			uint32_t value = static_cast<uint32_t>(microseconds);
+			m_buckets[BucketIndex(value)]++;
+			m_count++;
+			m_sum += value;
+
+			if (value > m_max)
+			{
+				m_max = value;
+			}
+		}
+
+		uint64_t GetCount() const							{ return m_count; }
+		uint32_t GetMax() const								{ return m_max; }
+		double GetMean() const								{ return m_count > 0 ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+		// Wert, unter dem der angegebene Anteil (0 bis 1) der Messungen liegt. Liefert die Mitte des Fachs.
+		uint32_t GetPercentile(double fraction) const
+		{
+			if (m_count == 0)
+			{
+				return 0;
+			}
+
+			uint64_t rank = static_cast<uint64_t>(fraction * m_count + 0.5);
+			if (rank < 1)
+			{
+				rank = 1;
+			}
+
+			uint64_t seen = 0;
+			for (uint32_t index = 0; index < BucketCount; index++)
+			{
+				seen += m_buckets[index];
+				if (seen >= rank)
+				{
+					uint32_t value = BucketMidpoint(index);
+					return value < m_max ? value : m_max;
+				}
+			}
+
+			return m_max;
+		}
+
+	private:
+		static uint32_t HighestBit(uint32_t value)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse(&index, value);
+			return index;
+#else
+			return 31u - static_cast<uint32_t>(__builtin_clz(value));
+#endif
+		}
+
+		static uint32_t BucketIndex(uint32_t value)
+		{
+			if (value < SubBucketCount)
+			{
+				return value;
+			}
+
+			uint32_t exponent = HighestBit(value);
+			uint32_t shift = exponent - SubBucketBits;
+			uint32_t subBucket = (value >> shift) & (SubBucketCount - 1);
+			return SubBucketCount + shift * SubBucketCount + subBucket;
+		}
+
+		static uint32_t BucketMidpoint(uint32_t index)
+		{
+			if (index < SubBucketCount)
+			{
+				return index;
+			}
+
+			uint32_t shift = (index - SubBucketCount) / SubBucketCount;
+			uint32_t subBucket = (index - SubBucketCount) % SubBucketCount;
+			uint64_t lower = static_cast<uint64_t>(SubBucketCount + subBucket) << shift;
+			uint64_t middle = lower + ((1ull << shift) >> 1);
+			return middle > 0xffffffffull ? 0xffffffffu : static_cast<uint32_t>(middle);
+		}
+
+		uint32_t	m_buckets[BucketCount];
+		uint64_t	m_count;
+		uint64_t	m_sum;
+		uint32_t	m_max;
+	};
+}
@@ -0,0 +1,135 @@
+﻿#include "Frustum.h"
+
+#include <cfloat>
+#include <cmath>
+#include "SimdMath.h"
+
+using namespace DX;
+using namespace DX::Simd;
+
+Aabb Aabb::Empty()
+{
+	Aabb bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+	return bounds;
+}
+
+void Aabb::Extend(const Aabb& other)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		min[axis] = other.min[axis] < min[axis] ? other.min[axis] : min[axis];
+		max[axis] = other.max[axis] > max[axis] ? other.max[axis] : max[axis];
+	}
+}
+
+// Mittelpunkt transformieren, Halbachsen mit den Beträgen der Matrixeinträge.
+Aabb DX::TransformBounds(const Aabb& local, const float matrix[4][4])
+{
+	float center[3];
+	float extent[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		center[axis] = 0.5f * (local.min[axis] + local.max[axis]);
+		extent[axis] = 0.5f * (local.max[axis] - local.min[axis]);
+	}
+
+	Aabb bounds;
+	for (int column = 0; column < 3; column++)
+	{
+		float c = matrix[3][column];
+		float e = 0.0f;
+		for (int row = 0; row < 3; row++)
+		{
+			c += center[row] * matrix[row][column];
+			e += extent[row] * std::fabs(matrix[row][column]);
+		}
+		bounds.min[column] = c - e;
+		bounds.max[column] = c + e;
+	}
+	return bounds;
+}
+
+// Ebenen nach Gribb und Hartmann aus den Spalten der Matrix.
+Frustum Frustum::FromViewProjection(const float m[4][4])
+{
+	Frustum frustum;
+	for (int i = 0; i < 4; i++)
+	{
+		frustum.planes[Left][i] = m[i][3] + m[i][0];
+		frustum.planes[Right][i] = m[i][3] - m[i][0];
+		frustum.planes[Bottom][i] = m[i][3] + m[i][1];
+		frustum.planes[Top][i] = m[i][3] - m[i][1];
+		frustum.planes[Near][i] = m[i][2];
+		frustum.planes[Far][i] = m[i][3] - m[i][2];
+	}
+
+	for (auto& plane : frustum.planes)
+	{
+		float inverseLength = 1.0f / std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (float& coefficient : plane)
+		{
+			coefficient *= inverseLength;
+		}
+	}
+	return frustum;
+}
+
+// Die Ecke in Richtung der Normalen muss für jede Ebene innen liegen.
+bool Frustum::Intersects(const Aabb& bounds) const
+{
+	for (const auto& plane : planes)
+	{
+		float x = plane[0] >= 0.0f ? bounds.max[0] : bounds.min[0];
+		float y = plane[1] >= 0.0f ? bounds.max[1] : bounds.min[1];
+		float z = plane[2] >= 0.0f ? bounds.max[2] : bounds.min[2];
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DX::CullBounds(const Frustum& frustum, const Aabb* bounds, size_t count, std::vector<uint32_t>& visible)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		// Vier Boxen in Strukturen je Achse umordnen.
+		Vec4 minimum[3];
+		Vec4 maximum[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = Set(bounds[i].min[axis], bounds[i + 1].min[axis], bounds[i + 2].min[axis], bounds[i + 3].min[axis]);
+			maximum[axis] = Set(bounds[i].max[axis], bounds[i + 1].max[axis], bounds[i + 2].max[axis], bounds[i + 3].max[axis]);
+		}
+
+		Vec4 outside = Zero();
+		for (const auto& plane : frustum.planes)
+		{
+			Vec4 distance = Set(plane[3]);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				distance += Set(plane[axis]) * (plane[axis] >= 0.0f ? maximum[axis] : minimum[axis]);
+			}
+			outside = Or(outside, Less(distance, Zero()));
+		}
+
+		int visibleMask = ~MoveMask(outside) & 0xF;
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if (visibleMask & (1 << lane))
+			{
+				visible.push_back(static_cast<uint32_t>(i + lane));
+			}
+		}
+	}
+
+	for (; i < count; i++)
+	{
+		if (frustum.Intersects(bounds[i]))
+		{
+			visible.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
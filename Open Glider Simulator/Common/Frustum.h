@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// Achsenparallele Box in Szenenachsen.
+	struct Aabb
+	{
+		float min[3];
+		float max[3];
+
+		// Leere Box, die mit jeder anderen vereinigt genau diese ergibt und nichts schneidet.
+		static Aabb Empty();
+
+		void Extend(const Aabb& other);
+		bool IsEmpty() const								{ return min[0] > max[0]; }
+	};
+
+	// Box um die mit matrix transformierte Box local. matrix in Zeilenvektorform (v * M) wie XMMATRIX,
+	// also nicht transponiert.
+	Aabb TransformBounds(const Aabb& local, const float matrix[4][4]);
+
+	// Sechs Ebenen ax + by + cz + d >= 0 für das Innere, mit Einheitsnormalen.
+	struct Frustum
+	{
+		enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+		float planes[PlaneCount][4];
+
+		// Aus Ansicht mal Projektion in Zeilenvektorform mit Direct3D-Tiefenbereich [0, w].
+		static Frustum FromViewProjection(const float viewProjection[4][4]);
+
+		// Konservativ: Boxen, die den Kegelstumpf nur nahe einer Ecke verfehlen, gelten als sichtbar.
+		bool Intersects(const Aabb& bounds) const;
+	};
+
+	// Prüft count Boxen je vier auf einmal und hängt die Indizes der sichtbaren an visible an.
+	void CullBounds(const Frustum& frustum, const Aabb* bounds, size_t count, std::vector<uint32_t>& visible);
+}
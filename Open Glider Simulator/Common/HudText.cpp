@@ -0,0 +1,418 @@
+﻿#include "HudText.h"
+
+#include <cmath>
+#include <stdexcept>
+#include "Profiler.h"
+
+using namespace DX;
+
+namespace
+{
+	// Abstand zwischen den Zellen, damit beim Zeichnen keine Nachbarglyphe in die Zelle ragt.
+	const uint32_t CellPadding = 1;
+
+	// Größter Betrag, der nach dem Skalieren noch sicher in int64_t passt.
+	const double MaxFieldValue = 9.0e18;
+
+	const uint32_t MaxDecimals = 9;
+}
+
+GlyphAtlas::GlyphAtlas(uint32_t width, uint32_t height, uint32_t lineHeight) :
+	m_width(width),
+	m_height(height),
+	m_lineHeight(lineHeight),
+	m_cursorX(0),
+	m_cursorY(0),
+	m_fallback(-1)
+{
+	if (width == 0 || height == 0 || lineHeight == 0 || lineHeight > height || width > 0xffff || height > 0xffff)
+	{
+		throw std::invalid_argument("GlyphAtlas: invalid size");
+	}
+
+	for (int32_t& index : m_direct)
+	{
+		index = -1;
+	}
+}
+
+bool GlyphAtlas::Add(uint32_t codepoint, uint32_t cellWidth, float advance, float offsetX)
+{
+	if (cellWidth == 0 || cellWidth > m_width)
+	{
+		throw std::invalid_argument("GlyphAtlas: invalid cell width");
+	}
+	if (FindIndex(codepoint) >= 0)
+	{
+		throw std::invalid_argument("GlyphAtlas: glyph already added");
+	}
+
+	// Passt die Zelle nicht mehr in die Zeile, in der nächsten weitermachen.
+	if (m_cursorX + cellWidth > m_width)
+	{
+		m_cursorX = 0;
+		m_cursorY += m_lineHeight + CellPadding;
+	}
+	if (m_cursorY + m_lineHeight > m_height)
+	{
+		return false;
+	}
+
+	AtlasGlyph glyph;
+	glyph.x = static_cast<uint16_t>(m_cursorX);
+	glyph.y = static_cast<uint16_t>(m_cursorY);
+	glyph.width = static_cast<uint16_t>(cellWidth);
+	glyph.height = static_cast<uint16_t>(m_lineHeight);
+	glyph.advance = advance;
+	glyph.offsetX = offsetX;
+
+	int32_t index = static_cast<int32_t>(m_glyphs.size());
+	m_glyphs.push_back(glyph);
+	if (codepoint < DirectCount)
+	{
+		m_direct[codepoint] = index;
+	}
+	else
+	{
+		m_other[codepoint] = index;
+	}
+
+	m_cursorX += cellWidth + CellPadding;
+	return true;
+}
+
+int32_t GlyphAtlas::FindIndex(uint32_t codepoint) const
+{
+	if (codepoint < DirectCount)
+	{
+		return m_direct[codepoint];
+	}
+
+	auto entry = m_other.find(codepoint);
+	return entry != m_other.end() ? entry->second : -1;
+}
+
+const AtlasGlyph* GlyphAtlas::Find(uint32_t codepoint) const
+{
+	int32_t index = FindIndex(codepoint);
+	if (index < 0)
+	{
+		index = m_fallback;
+	}
+	return index >= 0 ? &m_glyphs[index] : nullptr;
+}
+
+void GlyphAtlas::SetFallback(uint32_t codepoint)
+{
+	int32_t index = FindIndex(codepoint);
+	if (index < 0)
+	{
+		throw std::invalid_argument("GlyphAtlas: fallback glyph missing");
+	}
+	m_fallback = index;
+}
+
+HudText::HudText() :
+	m_screenWidth(0.0f),
+	m_screenHeight(0.0f),
+	m_version(0),
+	m_dirty(false),
+	m_statistics()
+{
+}
+
+void HudText::SetAtlas(const std::shared_ptr<const GlyphAtlas>& atlas)
+{
+	if (atlas != m_atlas)
+	{
+		m_atlas = atlas;
+		Invalidate();
+	}
+}
+
+void HudText::SetScreenSize(float width, float height)
+{
+	if (width != m_screenWidth || height != m_screenHeight)
+	{
+		m_screenWidth = width;
+		m_screenHeight = height;
+		Invalidate();
+	}
+}
+
+void HudText::Invalidate()
+{
+	for (Widget& widget : m_widgets)
+	{
+		widget.dirty = true;
+	}
+	m_dirty = true;
+}
+
+HudWidgetId HudText::AddWidget(HudCorner corner, float margin, uint32_t lineOffset, const std::wstring& pattern)
+{
+	Widget widget;
+	widget.corner = corner;
+	widget.margin = margin;
+	widget.lineOffset = lineOffset;
+	widget.dirty = true;
+
+	Part literal = { std::wstring(), -1 };
+	for (size_t i = 0; i < pattern.size(); i++)
+	{
+		if (pattern[i] != L'{')
+		{
+			literal.text += pattern[i];
+			continue;
+		}
+		if (i + 1 < pattern.size() && pattern[i + 1] == L'{')
+		{
+			literal.text += L'{';
+			i++;
+			continue;
+		}
+
+		// Breite und Nachkommastellen bis zur schließenden Klammer lesen.
+		Field field = { 0, 0, 1.0, 0, false };
+		uint32_t* number = &field.width;
+		size_t end = i + 1;
+		for (; end < pattern.size() && pattern[end] != L'}'; end++)
+		{
+			if (pattern[end] == L'.' && number == &field.width)
+			{
+				number = &field.decimals;
+			}
+			else if (pattern[end] >= L'0' && pattern[end] <= L'9' && *number < 100)
+			{
+				*number = *number * 10 + static_cast<uint32_t>(pattern[end] - L'0');
+			}
+			else
+			{
+				throw std::invalid_argument("HudText: invalid field in pattern");
+			}
+		}
+		if (end == pattern.size() || field.decimals > MaxDecimals)
+		{
+			throw std::invalid_argument("HudText: invalid field in pattern");
+		}
+		field.scale = std::pow(10.0, static_cast<double>(field.decimals));
+
+		if (!literal.text.empty())
+		{
+			widget.parts.push_back(literal);
+			literal.text.clear();
+		}
+
+		Part part = { std::wstring(), static_cast<int32_t>(widget.fields.size()) };
+		widget.parts.push_back(part);
+		widget.fields.push_back(field);
+		i = end;
+	}
+	if (!literal.text.empty())
+	{
+		widget.parts.push_back(literal);
+	}
+
+	m_widgets.push_back(std::move(widget));
+	m_dirty = true;
+	return static_cast<HudWidgetId>(m_widgets.size() - 1);
+}
+
+void HudText::SetField(HudWidgetId widget, uint32_t field, double value)
+{
+	if (widget >= m_widgets.size() || field >= m_widgets[widget].fields.size())
+	{
+		throw std::invalid_argument("HudText: unknown field");
+	}
+
+	Widget& target = m_widgets[widget];
+	Field& entry = target.fields[field];
+	m_statistics.fieldUpdates++;
+
+	// Verglichen wird der gerundete Wert, also genau das, was angezeigt würde.
+	double scaled = value * entry.scale;
+	bool valid = std::abs(scaled) < MaxFieldValue;
+	int64_t rounded = valid ? std::llround(scaled) : 0;
+
+	if (valid == entry.valid && rounded == entry.value)
+	{
+		m_statistics.unchangedFieldUpdates++;
+		return;
+	}
+
+	entry.valid = valid;
+	entry.value = rounded;
+	target.dirty = true;
+	m_dirty = true;
+}
+
+// Schreibt die Ziffern von Hand; swprintf wäre je Feld und Frame deutlich teurer.
+void HudText::AppendField(const Field& field, std::wstring& text)
+{
+	wchar_t digits[32];
+	uint32_t count = 0;
+
+	if (!field.valid)
+	{
+		digits[count++] = L'-';
+	}
+	else
+	{
+		uint64_t magnitude = field.value < 0 ? 0 - static_cast<uint64_t>(field.value) : static_cast<uint64_t>(field.value);
+		for (uint32_t i = 0; i < field.decimals; i++)
+		{
+			digits[count++] = static_cast<wchar_t>(L'0' + magnitude % 10);
+			magnitude /= 10;
+		}
+		if (field.decimals > 0)
+		{
+			digits[count++] = L'.';
+		}
+		do
+		{
+			digits[count++] = static_cast<wchar_t>(L'0' + magnitude % 10);
+			magnitude /= 10;
+		}
+		while (magnitude > 0);
+
+		if (field.value < 0)
+		{
+			digits[count++] = L'-';
+		}
+	}
+
+	for (uint32_t padding = count; padding < field.width; padding++)
+	{
+		text += L' ';
+	}
+	while (count > 0)
+	{
+		text += digits[--count];
+	}
+}
+
+void HudText::Rebuild(Widget& widget)
+{
+	widget.glyphs.clear();
+	if (!m_atlas)
+	{
+		return;
+	}
+
+	m_text.clear();
+	for (const Part& part : widget.parts)
+	{
+		if (part.field < 0)
+		{
+			m_text += part.text;
+		}
+		else
+		{
+			AppendField(widget.fields[part.field], m_text);
+		}
+	}
+
+	const float lineHeight = static_cast<float>(m_atlas->GetLineHeight());
+	const bool right = widget.corner == HudCorner::TopRight || widget.corner == HudCorner::BottomRight;
+	const bool bottom = widget.corner == HudCorner::BottomLeft || widget.corner == HudCorner::BottomRight;
+
+	uint32_t lineCount = 1;
+	for (wchar_t character : m_text)
+	{
+		lineCount += character == L'\n' ? 1 : 0;
+	}
+
+	float top = bottom ?
+		m_screenHeight - widget.margin - (widget.lineOffset + lineCount) * lineHeight :
+		widget.margin + widget.lineOffset * lineHeight;
+
+	size_t lineStart = 0;
+	while (lineStart <= m_text.size())
+	{
+		size_t lineEnd = m_text.find(L'\n', lineStart);
+		if (lineEnd == std::wstring::npos)
+		{
+			lineEnd = m_text.size();
+		}
+
+		// Rechtsbündige Zeilen brauchen ihre Breite vorab; die Glyphen werden dabei nur einmal nachgeschlagen.
+		float width = 0.0f;
+		m_lineGlyphs.clear();
+		for (size_t i = lineStart; i < lineEnd; i++)
+		{
+			const AtlasGlyph* glyph = m_atlas->Find(m_text[i]);
+			m_lineGlyphs.push_back(glyph);
+			width += glyph ? glyph->advance : 0.0f;
+		}
+
+		float pen = right ? m_screenWidth - widget.margin - width : widget.margin;
+		for (size_t i = lineStart; i < lineEnd; i++)
+		{
+			const AtlasGlyph* glyph = m_lineGlyphs[i - lineStart];
+			if (!glyph)
+			{
+				continue;
+			}
+
+			// Leerzeichen nur vorrücken. Ganze Pixel halten die Glyphen scharf, weil der Shader die
+			// Texel des Atlas unverändert übernimmt.
+			if (m_text[i] != L' ')
+			{
+				HudGlyph instance =
+				{
+					std::floor(pen + 0.5f) + glyph->offsetX,
+					std::floor(top + 0.5f),
+					static_cast<float>(glyph->width),
+					static_cast<float>(glyph->height),
+					static_cast<float>(glyph->x),
+					static_cast<float>(glyph->y)
+				};
+				widget.glyphs.push_back(instance);
+			}
+			pen += glyph->advance;
+		}
+
+		top += lineHeight;
+		lineStart = lineEnd + 1;
+	}
+}
+
+bool HudText::Update()
+{
+	if (!m_dirty)
+	{
+		return false;
+	}
+
+	DX_PROFILE_ZONE("HudText::Update");
+
+	for (Widget& widget : m_widgets)
+	{
+		if (widget.dirty)
+		{
+			Rebuild(widget);
+			widget.dirty = false;
+			m_statistics.widgetRebuilds++;
+		}
+	}
+
+	// Der Puffer wird ohnehin vollständig hochgeladen; das Zusammenfügen ist gegen das Layout vernachlässigbar.
+	m_glyphs.clear();
+	for (const Widget& widget : m_widgets)
+	{
+		m_glyphs.insert(m_glyphs.end(), widget.glyphs.begin(), widget.glyphs.end());
+	}
+
+	m_statistics.batchRebuilds++;
+	m_version++;
+	m_dirty = false;
+	return true;
+}
+
+HudTextStatistics HudText::GetStatistics() const
+{
+	HudTextStatistics statistics = m_statistics;
+	statistics.widgets = static_cast<uint32_t>(m_widgets.size());
+	statistics.glyphs = static_cast<uint32_t>(m_glyphs.size());
+	return statistics;
+}
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DX
+{
+	// Zelle einer Glyphe im Atlas in Pixeln.
+	struct AtlasGlyph
+	{
+		uint16_t	x;
+		uint16_t	y;
+		uint16_t	width;
+		uint16_t	height;
+		float		advance;		// Vorschub des Stifts
+		float		offsetX;		// Abstand der Zelle vom Stift, wegen des Rands für Überhänge meist negativ
+	};
+
+	// Packt Glyphen gleicher Zeilenhöhe zeilenweise in eine Textur. Der Atlas verwaltet nur die Zellen;
+	// wer ihn füllt, zeichnet jede Glyphe nach Add in ihre Zelle.
+	class GlyphAtlas
+	{
+	public:
+		GlyphAtlas(uint32_t width, uint32_t height, uint32_t lineHeight);
+
+		// Gibt false zurück, wenn die Textur voll ist. Eine Glyphe lässt sich nur einmal hinzufügen.
+		bool Add(uint32_t codepoint, uint32_t cellWidth, float advance, float offsetX);
+
+		// Liefert für unbekannte Zeichen die Ersatzglyphe und ohne sie nullptr.
+		const AtlasGlyph* Find(uint32_t codepoint) const;
+		void SetFallback(uint32_t codepoint);
+
+		uint32_t GetWidth() const							{ return m_width; }
+		uint32_t GetHeight() const							{ return m_height; }
+		uint32_t GetLineHeight() const						{ return m_lineHeight; }
+		uint32_t GetGlyphCount() const						{ return static_cast<uint32_t>(m_glyphs.size()); }
+
+	private:
+		// Zeichen unterhalb dieser Grenze werden ohne Hashtabelle gefunden.
+		static const uint32_t DirectCount = 128;
+
+		int32_t FindIndex(uint32_t codepoint) const;
+
+		uint32_t								m_width;
+		uint32_t								m_height;
+		uint32_t								m_lineHeight;
+		uint32_t								m_cursorX;
+		uint32_t								m_cursorY;
+		std::vector<AtlasGlyph>					m_glyphs;
+		int32_t									m_direct[DirectCount];	// Index in m_glyphs oder -1
+		std::unordered_map<uint32_t, int32_t>	m_other;
+		int32_t									m_fallback;
+	};
+
+	// Eine Instanz des HUD-Zeichenaufrufs: Rechteck auf dem Bildschirm und linke obere Ecke im Atlas in Pixeln.
+	struct HudGlyph
+	{
+		float x;
+		float y;
+		float width;
+		float height;
+		float texelX;
+		float texelY;
+	};
+
+	enum class HudCorner : uint32_t
+	{
+		TopLeft,
+		TopRight,
+		BottomLeft,
+		BottomRight,
+	};
+
+	typedef uint32_t HudWidgetId;
+
+	struct HudTextStatistics
+	{
+		uint32_t	widgets;
+		uint32_t	glyphs;
+		uint64_t	fieldUpdates;
+		uint64_t	unchangedFieldUpdates;		// ohne Wirkung, weil der angezeigte Wert gleich blieb
+		uint64_t	widgetRebuilds;
+		uint64_t	batchRebuilds;
+	};
+
+	// Text der Instrumente als Glyphen aus einem GlyphAtlas. Jedes Anzeigeelement hat ein festes Muster mit
+	// Zahlenfeldern; sein Layout wird nur neu aufgebaut, wenn sich die angezeigte Zeichenfolge eines Felds
+	// ändert. Unveränderte Werte kosten daher nur einen Vergleich, und alle Glyphen liegen in einem Puffer,
+	// der mit einem einzigen instanzierten Aufruf gezeichnet wird.
+	class HudText
+	{
+	public:
+		HudText();
+
+		// Ohne Atlas entstehen keine Glyphen, etwa solange er noch geladen wird.
+		void SetAtlas(const std::shared_ptr<const GlyphAtlas>& atlas);
+		void SetScreenSize(float width, float height);
+
+		// Felder im Muster haben die Form {Breite.Nachkommastellen} oder {Breite}; Zahlen werden rechtsbündig
+		// auf die Breite aufgefüllt, {{ ergibt eine Klammer und \n beginnt eine neue Zeile. margin ist der
+		// Abstand zu beiden Rändern der Ecke in Pixeln, lineOffset der Abstand zum oberen oder unteren Rand in
+		// Zeilen. In den rechten Ecken werden die Zeilen rechtsbündig ausgerichtet.
+		HudWidgetId AddWidget(HudCorner corner, float margin, uint32_t lineOffset, const std::wstring& pattern);
+
+		// NaN und Werte außerhalb des darstellbaren Bereichs erscheinen als -.
+		void SetField(HudWidgetId widget, uint32_t field, double value);
+
+		// Baut geänderte Anzeigeelemente neu auf und gibt true zurück, wenn sich die Glyphen geändert haben.
+		bool Update();
+
+		const std::vector<HudGlyph>& GetGlyphs() const		{ return m_glyphs; }
+		uint64_t GetVersion() const							{ return m_version; }		// steigt mit jeder Änderung der Glyphen
+		HudTextStatistics GetStatistics() const;
+
+	private:
+		struct Field
+		{
+			uint32_t	width;
+			uint32_t	decimals;
+			double		scale;			// 10 hoch decimals
+			int64_t		value;			// auf die Nachkommastellen gerundet
+			bool		valid;
+		};
+
+		// Ein Abschnitt des Musters: fester Text oder ein Feld.
+		struct Part
+		{
+			std::wstring	text;
+			int32_t			field;		// -1 für festen Text
+		};
+
+		struct Widget
+		{
+			HudCorner				corner;
+			float					margin;
+			uint32_t				lineOffset;
+			std::vector<Part>		parts;
+			std::vector<Field>		fields;
+			std::vector<HudGlyph>	glyphs;
+			bool					dirty;
+		};
+
+		void Invalidate();
+		void Rebuild(Widget& widget);
+		static void AppendField(const Field& field, std::wstring& text);
+
+		std::vector<Widget>					m_widgets;
+		std::shared_ptr<const GlyphAtlas>	m_atlas;
+		float								m_screenWidth;
+		float								m_screenHeight;
+		std::vector<HudGlyph>				m_glyphs;
+		std::wstring						m_text;			// wiederverwendet, damit Update nicht allokiert
+		std::vector<const AtlasGlyph*>		m_lineGlyphs;
+		uint64_t							m_version;
+		bool								m_dirty;
+		HudTextStatistics					m_statistics;
+	};
+}
@@ -0,0 +1,249 @@
+﻿#include "Lz4.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+
+	// Das Format verlangt, dass die letzten fünf Bytes Literale sind und der letzte Rückverweis
+	// mindestens zwölf Bytes vor dem Ende beginnt.
+	const size_t LastLiterals = 5;
+	const size_t MatchStartLimit = 12;
+
+	const uint32_t HashBits = 12;
+
+	// Blocklänge, mit der das Entpacken kurze Strecken kopiert.
+	const size_t WildCopy = 16;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Schreibt den Rest einer Länge über 15 als Folge von 255ern und einem letzten Byte.
+	bool WriteLength(size_t length, uint8_t*& output, const uint8_t* end)
+	{
+		while (length >= 255)
+		{
+			if (output == end)
+			{
+				return false;
+			}
+			*output++ = 255;
+			length -= 255;
+		}
+		if (output == end)
+		{
+			return false;
+		}
+		*output++ = static_cast<uint8_t>(length);
+		return true;
+	}
+
+	bool ReadLength(size_t& length, const uint8_t*& input, const uint8_t* end)
+	{
+		uint8_t value;
+		do
+		{
+			if (input == end)
+			{
+				return false;
+			}
+			value = *input++;
+			length += value;
+		} while (value == 255);
+		return true;
+	}
+
+	// Eine Folge: Kennbyte mit beiden Längen, Literale, Abstand und Rest der Rückverweislänge. Ohne
+	// Rückverweis (matchLength 0) ist es die letzte Folge des Blocks.
+	bool WriteSequence(const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength, uint8_t*& output, const uint8_t* end)
+	{
+		if (output == end)
+		{
+			return false;
+		}
+
+		uint8_t& token = *output++;
+		token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+		if (literalLength >= 15 && !WriteLength(literalLength - 15, output, end))
+		{
+			return false;
+		}
+		if (static_cast<size_t>(end - output) < literalLength)
+		{
+			return false;
+		}
+		memcpy(output, literals, literalLength);
+		output += literalLength;
+
+		if (matchLength == 0)
+		{
+			return true;
+		}
+
+		if (end - output < 2)
+		{
+			return false;
+		}
+		*output++ = static_cast<uint8_t>(offset);
+		*output++ = static_cast<uint8_t>(offset >> 8);
+
+		size_t code = matchLength - MinMatch;
+		token |= static_cast<uint8_t>(code < 15 ? code : 15);
+		return code < 15 || WriteLength(code - 15, output, end);
+	}
+}
+
+size_t DX::Lz4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t DX::Lz4Compress(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity)
+{
+	uint8_t* output = destination;
+	const uint8_t* outputEnd = destination + capacity;
+	size_t anchor = 0;
+
+	if (size > MatchStartLimit)
+	{
+		// Positionen um eins versetzt, damit 0 ein leeres Fach bedeutet.
+		std::vector<uint32_t> table(1u << HashBits, 0);
+		size_t matchEnd = size - LastLiterals;
+		size_t position = 0;
+		while (position + MatchStartLimit < size)
+		{
+			uint32_t sequence = Read32(source + position);
+			uint32_t& entry = table[Hash(sequence)];
+			size_t candidate = entry;
+			entry = static_cast<uint32_t>(position + 1);
+
+			if (candidate == 0 || position - (candidate - 1) > MaxOffset || Read32(source + candidate - 1) != sequence)
+			{
+				// Lange Strecken ohne Treffer werden zunehmend schneller übersprungen.
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			size_t match = candidate - 1;
+			size_t length = MinMatch;
+			while (position + length < matchEnd && source[match + length] == source[position + length])
+			{
+				length++;
+			}
+			while (position > anchor && match > 0 && source[position - 1] == source[match - 1])
+			{
+				position--;
+				match--;
+				length++;
+			}
+
+			if (!WriteSequence(source + anchor, position - anchor, position - match, length, output, outputEnd))
+			{
+				return 0;
+			}
+			position += length;
+			anchor = position;
+		}
+	}
+
+	if (!WriteSequence(source + anchor, size - anchor, 0, 0, output, outputEnd))
+	{
+		return 0;
+	}
+	return output - destination;
+}
+
+bool DX::Lz4Decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t size)
+{
+	const uint8_t* input = source;
+	const uint8_t* inputEnd = source + sourceSize;
+	uint8_t* output = destination;
+	uint8_t* outputEnd = destination + size;
+
+	while (input != inputEnd)
+	{
+		uint8_t token = *input++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(literalLength, input, inputEnd))
+		{
+			return false;
+		}
+		if (static_cast<size_t>(inputEnd - input) < literalLength || static_cast<size_t>(outputEnd - output) < literalLength)
+		{
+			return false;
+		}
+		// Kurze Literale, das Übliche, als ein Block fester Länge, solange beide Puffer Platz dahinter haben.
+		if (literalLength <= WildCopy && static_cast<size_t>(inputEnd - input) >= WildCopy && static_cast<size_t>(outputEnd - output) >= WildCopy)
+		{
+			memcpy(output, input, WildCopy);
+		}
+		else
+		{
+			memcpy(output, input, literalLength);
+		}
+		input += literalLength;
+		output += literalLength;
+
+		// Die letzte Folge endet nach ihren Literalen.
+		if (input == inputEnd)
+		{
+			break;
+		}
+
+		if (inputEnd - input < 2)
+		{
+			return false;
+		}
+		size_t offset = input[0] | static_cast<size_t>(input[1]) << 8;
+		input += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(matchLength, input, inputEnd))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+
+		if (offset == 0 || offset > static_cast<size_t>(output - destination) || static_cast<size_t>(outputEnd - output) < matchLength)
+		{
+			return false;
+		}
+
+		// Überlappende Rückverweise wiederholen die letzten offset Bytes. Ab WildCopy Bytes Abstand überlappt
+		// kein Block mit seiner Quelle; mit Platz dahinter darf der letzte über das Ende hinaus schreiben.
+		const uint8_t* match = output - offset;
+		uint8_t* matchEnd = output + matchLength;
+		if (offset >= WildCopy && static_cast<size_t>(outputEnd - output) >= matchLength + WildCopy)
+		{
+			do
+			{
+				memcpy(output, match, WildCopy);
+				output += WildCopy;
+				match += WildCopy;
+			} while (output < matchEnd);
+			output = matchEnd;
+		}
+		else
+		{
+			while (output != matchEnd)
+			{
+				*output++ = *match++;
+			}
+		}
+	}
+
+	return output == outputEnd;
+}
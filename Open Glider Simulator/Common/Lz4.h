@@ -0,0 +1,20 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// Blockformat von LZ4: Folgen aus Literalen und Rückverweisen von höchstens 64 KB Abstand. Gepackt wird
+	// gierig mit einer Hashtabelle über vier Bytes, was etwa die Rate des schnellen Modus von LZ4 ergibt;
+	// das Entpacken ist ein einfaches Kopieren und prüft jede Länge gegen beide Puffer.
+
+	// Größte Länge, die Lz4Compress aus size Bytes erzeugen kann.
+	size_t Lz4CompressBound(size_t size);
+
+	// Gibt die gepackte Länge zurück, 0 wenn capacity nicht ausreicht.
+	size_t Lz4Compress(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity);
+
+	// Entpackt genau size Bytes. false bei beschädigten Daten oder abweichender Länge.
+	bool Lz4Decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t size);
+}
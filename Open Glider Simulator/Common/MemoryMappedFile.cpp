@@ -0,0 +1,221 @@
+﻿#include "MemoryMappedFile.h"
+
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+	[[noreturn]] void ThrowLastError(const char* what)
+	{
+#if defined(_WIN32)
+		throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+#else
+		throw std::system_error(errno, std::generic_category(), what);
+#endif
+	}
+}
+
+MemoryMappedView::MemoryMappedView() :
+	m_base(nullptr),
+	m_baseSize(0),
+	m_data(nullptr),
+	m_size(0)
+{
+}
+
+MemoryMappedView::MemoryMappedView(MemoryMappedView&& other) :
+	m_base(other.m_base),
+	m_baseSize(other.m_baseSize),
+	m_data(other.m_data),
+	m_size(other.m_size)
+{
+	other.m_base = nullptr;
+	other.m_data = nullptr;
+	other.m_baseSize = 0;
+	other.m_size = 0;
+}
+
+MemoryMappedView& MemoryMappedView::operator=(MemoryMappedView&& other)
+{
+	if (this != &other)
+	{
+		Reset();
+		std::swap(m_base, other.m_base);
+		std::swap(m_baseSize, other.m_baseSize);
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+	}
+
+	return *this;
+}
+
+MemoryMappedView::~MemoryMappedView()
+{
+	Reset();
+}
+
+void MemoryMappedView::Reset()
+{
+	if (m_base != nullptr)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_base);
+#else
+		munmap(m_base, m_baseSize);
+#endif
+	}
+
+	m_base = nullptr;
+	m_baseSize = 0;
+	m_data = nullptr;
+	m_size = 0;
+}
+
+MemoryMappedFile::MemoryMappedFile() :
+#if defined(_WIN32)
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+#else
+	m_file(-1),
+#endif
+	m_size(0),
+	m_granularity(1)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+void MemoryMappedFile::Open(const std::wstring& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	SYSTEM_INFO systemInfo;
+	GetNativeSystemInfo(&systemInfo);
+	m_granularity = systemInfo.dwAllocationGranularity;
+
+	m_file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		ThrowLastError("MemoryMappedFile: Datei kann nicht geöffnet werden");
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), "MemoryMappedFile: leere Datei");
+	}
+
+	m_mapping = CreateFileMappingFromApp(m_file, nullptr, PAGE_READONLY, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		Close();
+		ThrowLastError("MemoryMappedFile: Einblendung fehlgeschlagen");
+	}
+
+	m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+	m_granularity = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+	std::string narrowPath(path.size() * MB_LEN_MAX, '\0');
+	size_t length = std::wcstombs(&narrowPath[0], path.c_str(), narrowPath.size());
+	if (length == static_cast<size_t>(-1))
+	{
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), "MemoryMappedFile: ungültiger Pfad");
+	}
+	narrowPath.resize(length);
+
+	m_file = open(narrowPath.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		ThrowLastError("MemoryMappedFile: Datei kann nicht geöffnet werden");
+	}
+
+	struct stat status;
+	if (fstat(m_file, &status) != 0 || status.st_size == 0)
+	{
+		Close();
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), "MemoryMappedFile: leere Datei");
+	}
+
+	m_size = static_cast<uint64_t>(status.st_size);
+#endif
+}
+
+void MemoryMappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_file >= 0)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+#endif
+
+	m_size = 0;
+}
+
+// Der Anfang der Einblendung muss auf der Granularität des Systems liegen (64 KB unter Windows,
+// eine Seite unter POSIX); die Ansicht beginnt entsprechend weiter hinten.
+MemoryMappedView MemoryMappedFile::Map(uint64_t offset, size_t size) const
+{
+	if (!IsOpen() || size == 0 || offset > m_size || size > m_size - offset)
+	{
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), "MemoryMappedFile: Bereich außerhalb der Datei");
+	}
+
+	uint64_t alignedOffset = offset - offset % m_granularity;
+	size_t delta = static_cast<size_t>(offset - alignedOffset);
+
+	MemoryMappedView view;
+	view.m_baseSize = size + delta;
+
+#if defined(_WIN32)
+	view.m_base = MapViewOfFileFromApp(m_mapping, FILE_MAP_READ, alignedOffset, view.m_baseSize);
+	if (view.m_base == nullptr)
+	{
+		ThrowLastError("MemoryMappedFile: Ansicht kann nicht eingeblendet werden");
+	}
+#else
+	void* base = mmap(nullptr, view.m_baseSize, PROT_READ, MAP_SHARED, m_file, static_cast<off_t>(alignedOffset));
+	if (base == MAP_FAILED)
+	{
+		ThrowLastError("MemoryMappedFile: Ansicht kann nicht eingeblendet werden");
+	}
+	view.m_base = base;
+#endif
+
+	view.m_data = static_cast<const uint8_t*>(view.m_base) + delta;
+	view.m_size = size;
+	return view;
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace DX
+{
+	// Schreibgeschützt eingeblendeter Ausschnitt einer Datei. Nur verschiebbar; gibt die Einblendung beim Zerstören frei.
+	class MemoryMappedView
+	{
+	public:
+		MemoryMappedView();
+		MemoryMappedView(MemoryMappedView&& other);
+		MemoryMappedView& operator=(MemoryMappedView&& other);
+		~MemoryMappedView();
+
+		const uint8_t* GetData() const						{ return m_data; }
+		size_t GetSize() const								{ return m_size; }
+		bool IsValid() const								{ return m_data != nullptr; }
+
+		void Reset();
+
+	private:
+		friend class MemoryMappedFile;
+
+		MemoryMappedView(const MemoryMappedView&);
+		MemoryMappedView& operator=(const MemoryMappedView&);
+
+		void*			m_base;			// Beginn der Einblendung, auf die Granularität des Systems abgerundet
+		size_t			m_baseSize;
+		const uint8_t*	m_data;
+		size_t			m_size;
+	};
+
+	// Datei, aus der beliebige Bereiche bei Bedarf eingeblendet werden. Seiten werden erst beim Zugriff
+	// geladen und mit der Ansicht wieder freigegeben, sodass auch Dateien größer als der Adressraum
+	// eines 32-Bit-Prozesses stückweise gelesen werden können.
+	class MemoryMappedFile
+	{
+	public:
+		MemoryMappedFile();
+		~MemoryMappedFile();
+
+		// Wirft std::system_error, wenn die Datei nicht geöffnet werden kann.
+		void Open(const std::wstring& path);
+		void Close();
+
+		bool IsOpen() const									{ return m_size != 0; }
+		uint64_t GetSize() const							{ return m_size; }
+
+		MemoryMappedView Map(uint64_t offset, size_t size) const;
+
+	private:
+		MemoryMappedFile(const MemoryMappedFile&);
+		MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+#if defined(_WIN32)
+		void*		m_file;
+		void*		m_mapping;
+#else
+		int			m_file;
+#endif
+		uint64_t	m_size;
+		uint64_t	m_granularity;
+	};
+}
@@ -0,0 +1,275 @@
+﻿#include "MeshProcessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace DX;
+
+namespace
+{
+	// Größe des nachgebildeten LRU-Caches und Gewichte der Bewertung nach Forsyth.
+	const uint32_t CacheSize = 32;
+	const float LastTriangleScore = 0.75f;
+	const float CacheDecayPower = 1.5f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+	const uint32_t NotCached = std::numeric_limits<uint32_t>::max();
+	const uint32_t NoTriangle = std::numeric_limits<uint32_t>::max();
+
+	struct VertexState
+	{
+		uint32_t	cachePosition;
+		uint32_t	remaining;		// noch nicht ausgegebene Dreiecke
+		uint32_t	firstTriangle;	// in der Adjazenzliste
+		float		score;
+	};
+
+	// Die drei zuletzt benutzten Scheitelpunkte erhalten eine feste Bewertung, damit das nächste Dreieck
+	// nicht bevorzugt am eben gezeichneten klebt; danach fällt die Bewertung zum Cacheende hin ab.
+	// Scheitelpunkte mit wenigen offenen Dreiecken werden vorgezogen, damit keine Inseln zurückbleiben.
+	float ScoreVertex(const VertexState& vertex)
+	{
+		if (vertex.remaining == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (vertex.cachePosition != NotCached)
+		{
+			if (vertex.cachePosition < 3)
+			{
+				score = LastTriangleScore;
+			}
+			else
+			{
+				float scale = 1.0f / (CacheSize - 3);
+				score = std::pow(1.0f - (vertex.cachePosition - 3) * scale, CacheDecayPower);
+			}
+		}
+		return score + ValenceBoostScale * std::pow(static_cast<float>(vertex.remaining), -ValenceBoostPower);
+	}
+}
+
+void Mesh::EncodeOctahedral(float x, float y, float z, int8_t encoded[2])
+{
+	float sum = std::abs(x) + std::abs(y) + std::abs(z);
+	float inverseSum = sum > 0.0f ? 1.0f / sum : 0.0f;
+	float u = x * inverseSum;
+	float v = y * inverseSum;
+	if (z < 0.0f)
+	{
+		float foldedU = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		float foldedV = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+	encoded[0] = QuantizeSnorm8(u);
+	encoded[1] = QuantizeSnorm8(v);
+}
+
+void Mesh::DecodeOctahedral(const int8_t encoded[2], float normal[3])
+{
+	float x = std::max(encoded[0] / 127.0f, -1.0f);
+	float y = std::max(encoded[1] / 127.0f, -1.0f);
+	float z = 1.0f - std::abs(x) - std::abs(y);
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = std::sqrt(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+// Gierig: Es wird stets das Dreieck mit der höchsten Summe der Scheitelpunktbewertungen ausgegeben.
+// Neu bewertet werden nur die Scheitelpunkte im Cache und ihre Dreiecke; erst wenn keines davon offen ist,
+// wird linear nach dem besten verbleibenden Dreieck gesucht.
+void Mesh::OptimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	std::vector<VertexState> vertices(vertexCount);
+	for (VertexState& vertex : vertices)
+	{
+		vertex.cachePosition = NotCached;
+		vertex.remaining = 0;
+	}
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		vertices[indices[i]].remaining++;
+	}
+
+	// Adjazenz: Dreiecke je Scheitelpunkt zusammenhängend; offene stehen vorne.
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	uint32_t offset = 0;
+	for (VertexState& vertex : vertices)
+	{
+		vertex.firstTriangle = offset;
+		offset += vertex.remaining;
+	}
+	std::vector<uint32_t> fill(vertexCount, 0);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			adjacency[vertices[vertex].firstTriangle + fill[vertex]++] = static_cast<uint32_t>(triangle);
+		}
+	}
+
+	for (VertexState& vertex : vertices)
+	{
+		vertex.score = ScoreVertex(vertex);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		triangleScores[triangle] = vertices[indices[triangle * 3]].score + vertices[indices[triangle * 3 + 1]].score + vertices[indices[triangle * 3 + 2]].score;
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	uint32_t cache[CacheSize + 3];
+	uint32_t cacheCount = 0;
+	size_t scanStart = 0;
+	uint32_t best = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+	while (best != NoTriangle)
+	{
+		emitted[best] = true;
+		uint32_t corners[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+		output.insert(output.end(), corners, corners + 3);
+
+		// Das Dreieck aus den offenen Listen seiner Scheitelpunkte nehmen.
+		for (uint32_t vertex : corners)
+		{
+			VertexState& state = vertices[vertex];
+			uint32_t* triangles = &adjacency[state.firstTriangle];
+			std::swap(*std::find(triangles, triangles + state.remaining, best), triangles[state.remaining - 1]);
+			state.remaining--;
+		}
+
+		// Die drei Scheitelpunkte vorne in den Cache stellen; was hinten herausfällt, verliert seine Position.
+		uint32_t newCache[CacheSize + 3];
+		uint32_t newCount = 0;
+		for (uint32_t vertex : corners)
+		{
+			newCache[newCount++] = vertex;
+		}
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			uint32_t vertex = cache[i];
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+			{
+				newCache[newCount++] = vertex;
+			}
+		}
+		for (uint32_t i = CacheSize; i < newCount; i++)
+		{
+			vertices[newCache[i]].cachePosition = NotCached;
+			vertices[newCache[i]].score = ScoreVertex(vertices[newCache[i]]);
+		}
+		cacheCount = std::min(newCount, CacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			vertices[cache[i]].cachePosition = i;
+			vertices[cache[i]].score = ScoreVertex(vertices[cache[i]]);
+		}
+
+		// Offene Dreiecke der Cache-Scheitelpunkte neu bewerten und das beste wählen.
+		best = NoTriangle;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			const VertexState& state = vertices[cache[i]];
+			for (uint32_t j = 0; j < state.remaining; j++)
+			{
+				uint32_t triangle = adjacency[state.firstTriangle + j];
+				float score = vertices[indices[triangle * 3]].score + vertices[indices[triangle * 3 + 1]].score + vertices[indices[triangle * 3 + 2]].score;
+				triangleScores[triangle] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = triangle;
+				}
+			}
+		}
+
+		if (best == NoTriangle)
+		{
+			for (; scanStart < triangleCount; scanStart++)
+			{
+				if (!emitted[scanStart])
+				{
+					break;
+				}
+			}
+			for (size_t triangle = scanStart; triangle < triangleCount; triangle++)
+			{
+				if (!emitted[triangle] && triangleScores[triangle] > bestScore)
+				{
+					bestScore = triangleScores[triangle];
+					best = static_cast<uint32_t>(triangle);
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+float Mesh::ComputeAcmr(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return 0.0f;
+	}
+
+	// Zeitstempel des Eintritts in den FIFO; ein Scheitelpunkt ist im Cache, solange seit seinem Eintritt
+	// weniger als cacheSize weitere Fehlgriffe aufgetreten sind.
+	std::vector<uint64_t> entered(vertexCount, 0);
+	uint64_t misses = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		uint64_t& stamp = entered[indices[i]];
+		if (stamp == 0 || misses - stamp >= cacheSize)
+		{
+			misses++;
+			stamp = misses;
+		}
+	}
+	return static_cast<float>(misses) / triangleCount;
+}
+
+void Mesh::PackIndices(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, PackedIndices& packed)
+{
+	packed.count = indexCount;
+	packed.is32Bit = vertexCount > 65536;
+
+	if (packed.is32Bit)
+	{
+		packed.data.resize(indexCount * sizeof(uint32_t));
+		std::memcpy(packed.data.data(), indices, packed.data.size());
+		return;
+	}
+
+	packed.data.resize(indexCount * sizeof(uint16_t));
+	uint16_t* target = reinterpret_cast<uint16_t*>(packed.data.data());
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		target[i] = static_cast<uint16_t>(indices[i]);
+	}
+}
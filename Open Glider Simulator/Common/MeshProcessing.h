@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	namespace Mesh
+	{
+		// Wert in [minimum, minimum + 1 / inverseExtent] auf 16 Bit ohne Vorzeichen (UNORM) abbilden.
+		// Der Kehrwert wird übergeben, weil dieselbe Ausdehnung meist für viele Werte gilt.
+		inline uint16_t QuantizeUnorm16(float value, float minimum, float inverseExtent)
+		{
+			float t = (value - minimum) * inverseExtent;
+			t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+			return static_cast<uint16_t>(t * 65535.0f + 0.5f);
+		}
+
+		// Wert in [0, 1] auf 8 Bit (UNORM) bzw. in [-1, 1] auf 8 Bit mit Vorzeichen (SNORM) abbilden.
+		inline uint8_t QuantizeUnorm8(float value)
+		{
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			return static_cast<uint8_t>(value * 255.0f + 0.5f);
+		}
+
+		inline int8_t QuantizeSnorm8(float value)
+		{
+			value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+			return static_cast<int8_t>(value * 127.0f + (value < 0.0f ? -0.5f : 0.5f));
+		}
+
+		// Einheitsvektor auf das Oktaeder projizieren und die untere Hälfte nach außen klappen. Zwei
+		// Komponenten mit 8 Bit ergeben einen Winkelfehler unter einem Grad. Gegenstück zu DecodeOctahedral
+		// in den Shadern.
+		void EncodeOctahedral(float x, float y, float z, int8_t encoded[2]);
+		void DecodeOctahedral(const int8_t encoded[2], float normal[3]);
+
+		// Ordnet die Dreiecke einer Dreiecksliste so um, dass aufeinanderfolgende Dreiecke möglichst viele
+		// Scheitelpunkte im Cache der Vertex-Shader-Ergebnisse wiederverwenden (Verfahren nach Tom Forsyth).
+		void OptimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+		// Durchschnittliche Anzahl transformierter Scheitelpunkte je Dreieck (ACMR) bei einem FIFO-Cache
+		// der angegebenen Größe. 0,5 ist für große Gitter das Minimum, 3 das Maximum.
+		float ComputeAcmr(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+		// Indizes in der kleinsten passenden Breite: 16 Bit, solange alle Scheitelpunkte adressierbar sind.
+		struct PackedIndices
+		{
+			std::vector<uint8_t>	data;
+			size_t					count;
+			bool					is32Bit;
+		};
+
+		void PackIndices(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, PackedIndices& packed);
+	}
+}
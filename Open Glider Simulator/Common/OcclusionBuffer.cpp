@@ -0,0 +1,481 @@
+﻿#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "SimdMath.h"
+#include "ThreadPool.h"
+
+using namespace DX;
+using namespace DX::Simd;
+
+namespace
+{
+	// Kleinere Flächen in Bildpunkten zeichnen nichts und würden die Tiefenebene instabil machen.
+	const float MinTriangleArea = 1.0e-6f;
+
+	// Schnitt der Kante von a nach b im Clipraum mit der nahen Ebene z = 0.
+	void ClipNear(const float* a, const float* b, float* result)
+	{
+		float t = a[2] / (a[2] - b[2]);
+		for (int i = 0; i < 4; i++)
+		{
+			result[i] = a[i] + (b[i] - a[i]) * t;
+		}
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) :
+	m_width(width),
+	m_height(height),
+	m_binsX(width / BinWidth),
+	m_binsY(height / BinHeight),
+	m_chunkCount(0),
+	m_statistics()
+{
+	if (width == 0 || height == 0 || width % BinWidth != 0 || height % BinHeight != 0)
+	{
+		throw std::invalid_argument("OcclusionBuffer: size must be a non-zero multiple of the bin size");
+	}
+
+	uint32_t levelWidth = width, levelHeight = height;
+	for (;;)
+	{
+		m_levels.push_back(AlignedVector<float>(levelWidth * levelHeight, 1.0f));
+		m_levelWidths.push_back(levelWidth);
+		m_levelHeights.push_back(levelHeight);
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			m_viewProjection[row][column] = row == column ? 1.0f : 0.0f;
+		}
+	}
+}
+
+void OcclusionBuffer::Begin(const float viewProjection[4][4])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			m_viewProjection[row][column] = viewProjection[row][column];
+		}
+	}
+
+	m_positions.clear();
+	m_indices.clear();
+	m_statistics = OcclusionStatistics();
+}
+
+void OcclusionBuffer::AddOccluder(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	if (indexCount % 3 != 0)
+	{
+		throw std::invalid_argument("OcclusionBuffer: occluders are triangle lists");
+	}
+
+	uint32_t base = static_cast<uint32_t>(m_positions.size() / 3);
+	m_positions.insert(m_positions.end(), positions, positions + 3 * vertexCount);
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		if (indices[i] >= vertexCount)
+		{
+			throw std::invalid_argument("OcclusionBuffer: occluder index out of range");
+		}
+		m_indices.push_back(base + indices[i]);
+	}
+	m_statistics.occluderTriangles += indexCount / 3;
+}
+
+// Vier Eckpunkte auf einmal: Spalten der Matrix als Vektoren, die Eckpunkte je Achse.
+void OcclusionBuffer::TransformVertices(uint32_t first, uint32_t count)
+{
+	Vec4 m[4][4];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			m[row][column] = Set(m_viewProjection[row][column]);
+		}
+	}
+
+	uint32_t end = first + count;
+	for (uint32_t vertex = first; vertex < end; vertex += 4)
+	{
+		float x[4] = {}, y[4] = {}, z[4] = {};
+		uint32_t lanes = (std::min)(4u, end - vertex);
+		for (uint32_t lane = 0; lane < lanes; lane++)
+		{
+			const float* position = &m_positions[3 * (vertex + lane)];
+			x[lane] = position[0];
+			y[lane] = position[1];
+			z[lane] = position[2];
+		}
+
+		Vec4 vx = LoadUnaligned(x), vy = LoadUnaligned(y), vz = LoadUnaligned(z);
+		float clip[4][4];
+		for (int column = 0; column < 4; column++)
+		{
+			StoreUnaligned(clip[column], MultiplyAdd(vx, m[0][column], MultiplyAdd(vy, m[1][column], MultiplyAdd(vz, m[2][column], m[3][column]))));
+		}
+		for (uint32_t lane = 0; lane < lanes; lane++)
+		{
+			float* result = &m_clipPositions[4 * (vertex + lane)];
+			for (int column = 0; column < 4; column++)
+			{
+				result[column] = clip[column][lane];
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::SetupChunk(uint32_t chunkIndex)
+{
+	Chunk& chunk = m_chunks[chunkIndex];
+	chunk.triangles.clear();
+	for (std::vector<uint32_t>& bin : chunk.bins)
+	{
+		bin.clear();
+	}
+
+	size_t begin = static_cast<size_t>(chunkIndex) * TrianglesPerChunk * 3;
+	size_t end = (std::min)(m_indices.size(), begin + TrianglesPerChunk * 3);
+	for (size_t i = begin; i < end; i += 3)
+	{
+		const float* v[3] =
+		{
+			&m_clipPositions[4 * m_indices[i]],
+			&m_clipPositions[4 * m_indices[i + 1]],
+			&m_clipPositions[4 * m_indices[i + 2]],
+		};
+
+		// Ganz außerhalb einer Seitenebene, vor der nahen oder hinter der fernen Ebene: nichts zu zeichnen.
+		int left = 0, right = 0, bottom = 0, top = 0, beyond = 0, before = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			left += v[k][0] < -v[k][3];
+			right += v[k][0] > v[k][3];
+			bottom += v[k][1] < -v[k][3];
+			top += v[k][1] > v[k][3];
+			beyond += v[k][2] > v[k][3];
+			before += v[k][2] < 0.0f;
+		}
+		if (left == 3 || right == 3 || bottom == 3 || top == 3 || beyond == 3 || before == 3)
+		{
+			continue;
+		}
+
+		if (before == 0)
+		{
+			SetupTriangle(v[0], v[1], v[2], chunk);
+			continue;
+		}
+
+		// An der nahen Ebene abschneiden; es bleiben ein Dreieck oder ein Viereck als zwei Dreiecke.
+		float polygon[4][4];
+		int count = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			const float* a = v[k];
+			const float* b = v[(k + 1) % 3];
+			if (a[2] >= 0.0f)
+			{
+				std::copy(a, a + 4, polygon[count++]);
+			}
+			if ((a[2] >= 0.0f) != (b[2] >= 0.0f))
+			{
+				ClipNear(a, b, polygon[count++]);
+			}
+		}
+		for (int k = 1; k + 1 < count; k++)
+		{
+			SetupTriangle(polygon[0], polygon[k], polygon[k + 1], chunk);
+		}
+	}
+}
+
+void OcclusionBuffer::SetupTriangle(const float* v0, const float* v1, const float* v2, Chunk& chunk)
+{
+	// Bildpunkte mit y nach unten; die Mitte von Punkt (i, j) liegt bei (i + 0,5, j + 0,5).
+	float x[3], y[3], z[3];
+	const float* v[3] = { v0, v1, v2 };
+	for (int k = 0; k < 3; k++)
+	{
+		float inverseW = 1.0f / v[k][3];
+		x[k] = (v[k][0] * inverseW * 0.5f + 0.5f) * m_width;
+		y[k] = (0.5f - v[k][1] * inverseW * 0.5f) * m_height;
+		z[k] = v[k][2] * inverseW;
+	}
+
+	// Beide Umlaufrichtungen zeichnen, damit Verdecker nicht geschlossen sein müssen.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (std::fabs(area) < MinTriangleArea)
+	{
+		return;
+	}
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+
+	Triangle triangle;
+	triangle.minX = (std::max)(0, static_cast<int32_t>(std::floor((std::min)({ x[0], x[1], x[2] }))));
+	triangle.minY = (std::max)(0, static_cast<int32_t>(std::floor((std::min)({ y[0], y[1], y[2] }))));
+	triangle.maxX = (std::min)(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(std::floor((std::max)({ x[0], x[1], x[2] }))));
+	triangle.maxY = (std::min)(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(std::floor((std::max)({ y[0], y[1], y[2] }))));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+	{
+		return;
+	}
+
+	// Kante k läuft von Punkt k zu Punkt k + 1 und ist gegenüber von Punkt k + 2 positiv.
+	for (int k = 0; k < 3; k++)
+	{
+		int next = (k + 1) % 3;
+		triangle.edgeA[k] = y[k] - y[next];
+		triangle.edgeB[k] = x[next] - x[k];
+		triangle.edgeC[k] = -(triangle.edgeA[k] * x[k] + triangle.edgeB[k] * y[k]);
+	}
+
+	// Baryzentrische Gewichte von Punkt 1 und 2 sind die Kanten 1→2 bzw. 2→0 gegenüber, geteilt durch die Fläche.
+	float inverseArea = 1.0f / area;
+	float dz1 = (z[1] - z[0]) * inverseArea;
+	float dz2 = (z[2] - z[0]) * inverseArea;
+	triangle.depthA = dz1 * triangle.edgeA[2] + dz2 * triangle.edgeA[0];
+	triangle.depthB = dz1 * triangle.edgeB[2] + dz2 * triangle.edgeB[0];
+	triangle.depthC = z[0] + dz1 * triangle.edgeC[2] + dz2 * triangle.edgeC[0];
+
+	uint32_t index = static_cast<uint32_t>(chunk.triangles.size());
+	chunk.triangles.push_back(triangle);
+
+	for (uint32_t binY = triangle.minY / BinHeight; binY <= static_cast<uint32_t>(triangle.maxY) / BinHeight; binY++)
+	{
+		for (uint32_t binX = triangle.minX / BinWidth; binX <= static_cast<uint32_t>(triangle.maxX) / BinWidth; binX++)
+		{
+			chunk.bins[binY * m_binsX + binX].push_back(index);
+		}
+	}
+}
+
+// Jeder Streifen gehört genau einem Thread. Die Dreiecke werden in Einreichungsreihenfolge gezeichnet,
+// für das Ergebnis ist die Reihenfolge aber ohne Belang, da nur die kleinste Tiefe zählt.
+void OcclusionBuffer::RasterizeBin(uint32_t bin)
+{
+	int32_t binMinX = static_cast<int32_t>(bin % m_binsX * BinWidth);
+	int32_t binMinY = static_cast<int32_t>(bin / m_binsX * BinHeight);
+	int32_t binMaxX = binMinX + BinWidth - 1;
+	int32_t binMaxY = binMinY + BinHeight - 1;
+
+	float* depth = m_levels[0].data();
+	for (int32_t y = binMinY; y <= binMaxY; y++)
+	{
+		std::fill(depth + y * m_width + binMinX, depth + y * m_width + binMaxX + 1, 1.0f);
+	}
+
+	const Vec4 laneOffsets = Set(0.5f, 1.5f, 2.5f, 3.5f);
+	const Vec4 zero = Zero();
+	for (uint32_t chunkIndex = 0; chunkIndex < m_chunkCount; chunkIndex++)
+	{
+		const Chunk& chunk = m_chunks[chunkIndex];
+		for (uint32_t index : chunk.bins[bin])
+		{
+			const Triangle& triangle = chunk.triangles[index];
+
+			// Spalten in Vierergruppen ab einer durch vier teilbaren Spalte; die Streifen sind Vielfache von vier breit.
+			int32_t minX = (std::max)(triangle.minX, binMinX) & ~3;
+			int32_t maxX = (std::min)(triangle.maxX, binMaxX);
+			int32_t minY = (std::max)(triangle.minY, binMinY);
+			int32_t maxY = (std::min)(triangle.maxY, binMaxY);
+
+			Vec4 a[3] = { Set(triangle.edgeA[0]), Set(triangle.edgeA[1]), Set(triangle.edgeA[2]) };
+			Vec4 depthA = Set(triangle.depthA);
+			Vec4 stepX = Set(4.0f);
+
+			for (int32_t y = minY; y <= maxY; y++)
+			{
+				float centerY = y + 0.5f;
+				Vec4 x = Set(static_cast<float>(minX)) + laneOffsets;
+				Vec4 e[3];
+				for (int k = 0; k < 3; k++)
+				{
+					e[k] = MultiplyAdd(a[k], x, Set(triangle.edgeB[k] * centerY + triangle.edgeC[k]));
+				}
+				Vec4 z = MultiplyAdd(depthA, x, Set(triangle.depthB * centerY + triangle.depthC));
+				Vec4 zStep = depthA * stepX;
+				Vec4 eStep[3] = { a[0] * stepX, a[1] * stepX, a[2] * stepX };
+
+				float* row = depth + y * m_width;
+				for (int32_t column = minX; column <= maxX; column += 4)
+				{
+					Vec4 inside = And(And(GreaterEqual(e[0], zero), GreaterEqual(e[1], zero)), GreaterEqual(e[2], zero));
+					if (MoveMask(inside) != 0)
+					{
+						Vec4 current = Load(row + column);
+						Store(row + column, Select(inside, Min(current, z), current));
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						e[k] += eStep[k];
+					}
+					z += zStep;
+				}
+			}
+		}
+	}
+}
+
+// Jede Stufe hält die größte Tiefe der überdeckten Punkte, am ungeraden Rand doppelt gelesen.
+void OcclusionBuffer::BuildPyramid()
+{
+	for (size_t level = 1; level < m_levels.size(); level++)
+	{
+		const AlignedVector<float>& source = m_levels[level - 1];
+		AlignedVector<float>& target = m_levels[level];
+		uint32_t sourceWidth = m_levelWidths[level - 1], sourceHeight = m_levelHeights[level - 1];
+		uint32_t width = m_levelWidths[level], height = m_levelHeights[level];
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const float* row0 = &source[(2 * y) * sourceWidth];
+			const float* row1 = &source[(std::min)(2 * y + 1, sourceHeight - 1) * sourceWidth];
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint32_t x0 = 2 * x, x1 = (std::min)(2 * x + 1, sourceWidth - 1);
+				target[y * width + x] = (std::max)((std::max)(row0[x0], row0[x1]), (std::max)(row1[x0], row1[x1]));
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::Rasterize(ThreadPool* pool)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(m_positions.size() / 3);
+	m_clipPositions.resize(4 * static_cast<size_t>(vertexCount));
+	uint32_t triangleCount = static_cast<uint32_t>(m_indices.size() / 3);
+	m_chunkCount = (triangleCount + TrianglesPerChunk - 1) / TrianglesPerChunk;
+	if (m_chunks.size() < m_chunkCount)
+	{
+		m_chunks.resize(m_chunkCount);
+	}
+	for (uint32_t chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		m_chunks[chunk].bins.resize(m_binsX * m_binsY);
+	}
+
+	uint32_t vertexTasks = (vertexCount + VerticesPerTask - 1) / VerticesPerTask;
+	uint32_t binCount = m_binsX * m_binsY;
+	auto transform = [this, vertexCount](uint32_t task)
+	{
+		uint32_t first = task * VerticesPerTask;
+		TransformVertices(first, (std::min)(VerticesPerTask, vertexCount - first));
+	};
+	auto setup = [this](uint32_t chunk) { SetupChunk(chunk); };
+	auto rasterize = [this](uint32_t bin) { RasterizeBin(bin); };
+
+	// Erst alle Eckpunkte, dann die Dreiecke je Abschnitt, zuletzt die Streifen; jede Stufe wartet auf die vorige.
+	if (pool)
+	{
+		pool->ParallelFor(vertexTasks, transform);
+		pool->ParallelFor(m_chunkCount, setup);
+		pool->ParallelFor(binCount, rasterize);
+	}
+	else
+	{
+		for (uint32_t task = 0; task < vertexTasks; task++) transform(task);
+		for (uint32_t chunk = 0; chunk < m_chunkCount; chunk++) setup(chunk);
+		for (uint32_t bin = 0; bin < binCount; bin++) rasterize(bin);
+	}
+
+	for (uint32_t chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		m_statistics.rasterizedTriangles += static_cast<uint32_t>(m_chunks[chunk].triangles.size());
+	}
+
+	BuildPyramid();
+}
+
+bool OcclusionBuffer::IsOccluded(const Aabb& bounds)
+{
+	m_statistics.tested++;
+
+	float minX = 1.0e30f, minY = 1.0e30f, maxX = -1.0e30f, maxY = -1.0e30f, minZ = 1.0f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float p[3] =
+		{
+			(corner & 1) ? bounds.max[0] : bounds.min[0],
+			(corner & 2) ? bounds.max[1] : bounds.min[1],
+			(corner & 4) ? bounds.max[2] : bounds.min[2],
+		};
+		float clip[4];
+		for (int column = 0; column < 4; column++)
+		{
+			clip[column] = p[0] * m_viewProjection[0][column] + p[1] * m_viewProjection[1][column] + p[2] * m_viewProjection[2][column] + m_viewProjection[3][column];
+		}
+
+		// Ecken vor der nahen Ebene: die Box reicht bis an den Betrachter.
+		if (clip[2] < 0.0f || clip[3] <= 0.0f)
+		{
+			return false;
+		}
+
+		float inverseW = 1.0f / clip[3];
+		float x = (clip[0] * inverseW * 0.5f + 0.5f) * m_width;
+		float y = (0.5f - clip[1] * inverseW * 0.5f) * m_height;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		minZ = (std::min)(minZ, clip[2] * inverseW);
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+	{
+		return false;
+	}
+
+	// Alle Punkte, die das um einen Punkt vergrößerte Rechteck berührt, auf der Stufe mit höchstens 4 × 4
+	// davon. Ein Punkt gilt als bedeckt, sobald seine Mitte es ist; ohne den Rand würde eine Box, die
+	// knapp über einen Grat ragt, hinter dem Punkt des Grats verschwinden.
+	uint32_t x0 = static_cast<uint32_t>((std::max)(minX - 1.0f, 0.0f));
+	uint32_t y0 = static_cast<uint32_t>((std::max)(minY - 1.0f, 0.0f));
+	uint32_t x1 = static_cast<uint32_t>((std::min)(maxX + 1.0f, m_width - 1.0f));
+	uint32_t y1 = static_cast<uint32_t>((std::min)(maxY + 1.0f, m_height - 1.0f));
+	size_t level = 0;
+	while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+	{
+		level++;
+	}
+
+	const float* depth = m_levels[level].data();
+	uint32_t width = m_levelWidths[level];
+	for (uint32_t y = y0 >> level; y <= y1 >> level; y++)
+	{
+		for (uint32_t x = x0 >> level; x <= x1 >> level; x++)
+		{
+			if (minZ <= depth[y * width + x])
+			{
+				return false;
+			}
+		}
+	}
+
+	m_statistics.rejected++;
+	return true;
+}
+
+void OcclusionBuffer::RemoveOccluded(const Aabb* bounds, std::vector<uint32_t>& indices)
+{
+	indices.erase(std::remove_if(indices.begin(), indices.end(), [this, bounds](uint32_t index) { return IsOccluded(bounds[index]); }), indices.end());
+}
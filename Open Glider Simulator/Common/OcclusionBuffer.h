@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "Frustum.h"
+
+namespace DX
+{
+	class ThreadPool;
+
+	// Zahlen seit dem letzten Begin.
+	struct OcclusionStatistics
+	{
+		uint32_t	occluderTriangles;			// eingereicht
+		uint32_t	rasterizedTriangles;		// nach Verwerfen und Clipping an der nahen Ebene
+		uint32_t	tested;
+		uint32_t	rejected;					// vollständig verdeckt
+
+		float GetRejectedPercent() const					{ return tested ? 100.0f * rejected / tested : 0.0f; }
+	};
+
+	// Tiefenpuffer geringer Auflösung auf der CPU für die Verdeckungsrechnung. Die Verdecker, z. B. grobe
+	// Geländenetze, werden eingereicht, mit Rasterize auf die Arbeitsthreads verteilt gezeichnet und zu einer
+	// Hi-Z-Pyramide verdichtet, deren Stufen die größte Tiefe von 2 × 2 Punkten der feineren Stufe halten.
+	// Danach prüft IsOccluded Boxen gegen die Stufe, auf der sie höchstens 4 × 4 Punkte überdecken.
+	//
+	// Die Tiefe ist z / w der Projektion (Direct3D, 0 nah, 1 fern). Gezeichnet wird in Streifen von BinWidth
+	// × BinHeight Punkten, je Streifen ein Arbeitsthread, vier Punkte einer Zeile auf einmal. Das Ergebnis
+	// ist konservativ, solange die Verdecker nicht über die gezeichnete Geometrie hinausragen.
+	class OcclusionBuffer
+	{
+	public:
+		static const uint32_t BinWidth = 32;
+		static const uint32_t BinHeight = 32;
+
+		// width und height sind Vielfache von BinWidth bzw. BinHeight.
+		OcclusionBuffer(uint32_t width, uint32_t height);
+
+		// Beginnt einen Frame mit Ansicht mal Projektion in Zeilenvektorform wie Frustum::FromViewProjection.
+		void Begin(const float viewProjection[4][4]);
+
+		// Dreiecksliste über positions mit je x, y, z in Szenenachsen. Die Daten werden kopiert.
+		void AddOccluder(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+		// Zeichnet alle Verdecker und baut die Pyramide auf; ohne pool auf dem aufrufenden Thread.
+		void Rasterize(ThreadPool* pool);
+
+		// Wahr, wenn die Box vollständig hinter den Verdeckern liegt. Boxen, die die nahe Ebene schneiden
+		// oder außerhalb des Bildes liegen, gelten als nicht verdeckt; für Letztere ist der Sichtkegel zuständig.
+		bool IsOccluded(const Aabb& bounds);
+
+		// Entfernt aus indices die Indizes der verdeckten Boxen in bounds.
+		void RemoveOccluded(const Aabb* bounds, std::vector<uint32_t>& indices);
+
+		uint32_t GetWidth() const							{ return m_width; }
+		uint32_t GetHeight() const							{ return m_height; }
+		const float* GetDepth() const						{ return m_levels[0].data(); }
+		const OcclusionStatistics& GetStatistics() const	{ return m_statistics; }
+
+	private:
+		// Dreieck nach dem Aufsetzen: Kantenfunktionen a x + b y + c >= 0 im Inneren und Tiefenebene über
+		// Bildpunktmitten, dazu die umschließenden Bildpunkte.
+		struct Triangle
+		{
+			float		edgeA[3];
+			float		edgeB[3];
+			float		edgeC[3];
+			float		depthA;
+			float		depthB;
+			float		depthC;
+			int32_t		minX;
+			int32_t		minY;
+			int32_t		maxX;
+			int32_t		maxY;
+		};
+
+		// Ergebnis eines Abschnitts der Dreiecke: aufgesetzte Dreiecke und je Streifen ihre Indizes.
+		struct Chunk
+		{
+			std::vector<Triangle>				triangles;
+			std::vector<std::vector<uint32_t>>	bins;
+		};
+
+		static const uint32_t TrianglesPerChunk = 1024;
+		static const uint32_t VerticesPerTask = 4096;
+
+		void TransformVertices(uint32_t first, uint32_t count);
+		void SetupChunk(uint32_t chunk);
+		void SetupTriangle(const float* v0, const float* v1, const float* v2, Chunk& chunk);
+		void RasterizeBin(uint32_t bin);
+		void BuildPyramid();
+
+		uint32_t	m_width;
+		uint32_t	m_height;
+		uint32_t	m_binsX;
+		uint32_t	m_binsY;
+		float		m_viewProjection[4][4];
+
+		// Eingereichte Verdecker und die Eckpunkte im Clipraum (x, y, z, w hintereinander).
+		std::vector<float>		m_positions;
+		std::vector<uint32_t>	m_indices;
+		AlignedVector<float>	m_clipPositions;
+
+		std::vector<Chunk>		m_chunks;
+		uint32_t				m_chunkCount;
+
+		// Stufe 0 ist der Tiefenpuffer, jede weitere halb so groß (aufgerundet).
+		std::vector<AlignedVector<float>>	m_levels;
+		std::vector<uint32_t>				m_levelWidths;
+		std::vector<uint32_t>				m_levelHeights;
+
+		OcclusionStatistics		m_statistics;
+	};
+}
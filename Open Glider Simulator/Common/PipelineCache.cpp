@@ -0,0 +1,401 @@
+﻿#include "PipelineCache.h"
+
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include "Profiler.h"
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t ManifestMagic = 0x43504f47;		// "GOPC"
+	const uint32_t ManifestVersion = 2;
+
+	// Grenzen gegen beschädigte Dateien; Direct3D 11 erlaubt höchstens 32 Eingabeelemente.
+	const uint32_t MaxStringLength = 1024;
+	const uint32_t MaxElements = 32;
+
+	struct ManifestHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	entryCount;
+		uint32_t	reserved;
+	};
+
+	void WriteValue(std::ostream& stream, uint32_t value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void WriteString(std::ostream& stream, const std::string& text)
+	{
+		WriteValue(stream, static_cast<uint32_t>(text.size()));
+		stream.write(text.data(), text.size());
+	}
+
+	uint32_t ReadValue(std::istream& stream)
+	{
+		uint32_t value;
+		if (!stream.read(reinterpret_cast<char*>(&value), sizeof(value)))
+		{
+			throw std::runtime_error("PipelineCache: Verzeichnis ist unvollständig.");
+		}
+		return value;
+	}
+
+	std::string ReadString(std::istream& stream)
+	{
+		uint32_t length = ReadValue(stream);
+		if (length > MaxStringLength)
+		{
+			throw std::runtime_error("PipelineCache: ungültige Zeichenkette im Verzeichnis.");
+		}
+
+		std::string text(length, '\0');
+		if (length != 0 && !stream.read(&text[0], length))
+		{
+			throw std::runtime_error("PipelineCache: Verzeichnis ist unvollständig.");
+		}
+		return text;
+	}
+}
+
+void ContentHash::Add(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t value = m_value;
+	for (size_t i = 0; i < size; i++)
+	{
+		value ^= bytes[i];
+		value *= 1099511628211ull;
+	}
+	m_value = value;
+}
+
+void ContentHash::Add(const std::string& text)
+{
+	Add(static_cast<uint32_t>(text.size()));
+	Add(text.data(), text.size());
+}
+
+PipelineCache::PipelineCache() :
+	m_generation(0),
+	m_manifestModified(false),
+	m_statistics()
+{
+}
+
+// Die Art geht in jeden Schlüssel ein, damit gleicher Inhalt verschiedener Arten nicht zusammenfällt.
+PipelineKey PipelineCache::HashShader(PipelineObjectKind kind, const void* bytecode, size_t size)
+{
+	ContentHash hash;
+	hash.Add(static_cast<uint32_t>(kind));
+	hash.Add(static_cast<uint64_t>(size));
+	hash.Add(bytecode, size);
+	return hash.GetValue();
+}
+
+// Das Layout wird gegen die Eingabesignatur des Vertex-Shaders geprüft und hängt daher auch von ihm ab.
+PipelineKey PipelineCache::HashInputLayout(const std::vector<VertexElement>& elements, PipelineKey vertexShader)
+{
+	ContentHash hash;
+	hash.Add(static_cast<uint32_t>(PipelineObjectKind::InputLayout));
+	hash.Add(vertexShader);
+	hash.Add(static_cast<uint32_t>(elements.size()));
+	for (const VertexElement& element : elements)
+	{
+		hash.Add(element.semantic);
+		hash.Add(element.semanticIndex);
+		hash.Add(element.format);
+		hash.Add(element.slot);
+		hash.Add(element.offset);
+		hash.Add(static_cast<uint32_t>(element.perInstance));
+		hash.Add(element.instanceStepRate);
+	}
+	return hash.GetValue();
+}
+
+PipelineKey PipelineCache::HashState(BlendMode blend)
+{
+	ContentHash hash;
+	hash.Add(static_cast<uint32_t>(PipelineObjectKind::BlendState));
+	hash.Add(static_cast<uint32_t>(blend));
+	return hash.GetValue();
+}
+
+PipelineKey PipelineCache::HashState(DepthMode depth)
+{
+	ContentHash hash;
+	hash.Add(static_cast<uint32_t>(PipelineObjectKind::DepthStencilState));
+	hash.Add(static_cast<uint32_t>(depth));
+	return hash.GetValue();
+}
+
+PipelineKey PipelineCache::HashPipeline(PipelineKey vertexShader, PipelineKey pixelShader, PipelineKey inputLayout, PrimitiveTopology topology,
+	BlendMode blend, DepthMode depth)
+{
+	ContentHash hash;
+	hash.Add(static_cast<uint32_t>(PipelineObjectKind::Pipeline));
+	hash.Add(vertexShader);
+	hash.Add(pixelShader);
+	hash.Add(inputLayout);
+	hash.Add(static_cast<uint32_t>(topology));
+	hash.Add(static_cast<uint32_t>(blend));
+	hash.Add(static_cast<uint32_t>(depth));
+	return hash.GetValue();
+}
+
+std::shared_ptr<void> PipelineCache::GetOrCreate(PipelineKey key, uint64_t generation, const CreateFunction& create)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_statistics.requests++;
+
+	// Ein leerer Eintrag bedeutet, dass ein anderer Thread das Objekt gerade erstellt.
+	for (;;)
+	{
+		if (generation != m_generation)
+		{
+			throw std::runtime_error("PipelineCache: device was reset");
+		}
+
+		auto found = m_objects.find(key);
+		if (found == m_objects.end())
+		{
+			break;
+		}
+
+		if (found->second)
+		{
+			m_statistics.hits++;
+			return found->second;
+		}
+
+		m_created.wait(lock);
+	}
+
+	m_objects[key] = nullptr;
+	lock.unlock();
+
+	std::shared_ptr<void> object;
+	int64_t start = Profiler::Now();
+	try
+	{
+		object = create();
+		if (!object)
+		{
+			throw std::logic_error("PipelineCache: create returned no object");
+		}
+	}
+	catch (...)
+	{
+		lock.lock();
+		if (generation == m_generation)
+		{
+			m_objects.erase(key);
+		}
+		m_statistics.failures++;
+		m_created.notify_all();
+		throw;
+	}
+	int64_t end = Profiler::Now();
+
+	// Nach einem Clear gehört der Schlüssel womöglich schon einem Ersteller der neuen Generation.
+	lock.lock();
+	if (generation != m_generation)
+	{
+		m_statistics.discarded++;
+		throw std::runtime_error("PipelineCache: device was reset");
+	}
+	m_objects[key] = object;
+	m_statistics.creations++;
+	m_statistics.creationTicks += end - start;
+	m_created.notify_all();
+	return object;
+}
+
+std::shared_ptr<void> PipelineCache::Find(PipelineKey key) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_objects.find(key);
+	return found != m_objects.end() ? found->second : nullptr;
+}
+
+uint64_t PipelineCache::GetGeneration() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_generation;
+}
+
+// Auch Einträge in Erstellung werden entfernt; ihre Ersteller verwerfen das Ergebnis, und Wartende wachen auf
+// und scheitern an der veralteten Generation.
+void PipelineCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_objects.clear();
+	m_generation++;
+	m_created.notify_all();
+}
+
+bool PipelineCache::IsSameDescription(const PipelineDescription& a, const PipelineDescription& b)
+{
+	if (a.vertexShader != b.vertexShader || a.pixelShader != b.pixelShader || a.topology != b.topology ||
+		a.blend != b.blend || a.depth != b.depth || a.inputLayout.size() != b.inputLayout.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < a.inputLayout.size(); i++)
+	{
+		const VertexElement& x = a.inputLayout[i];
+		const VertexElement& y = b.inputLayout[i];
+		if (x.semantic != y.semantic || x.semanticIndex != y.semanticIndex || x.format != y.format || x.slot != y.slot ||
+			x.offset != y.offset || x.perInstance != y.perInstance || x.instanceStepRate != y.instanceStepRate)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PipelineCache::AddToManifest(const PipelineDescription& description, PipelineKey key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (PipelineManifestEntry& entry : m_manifest)
+	{
+		if (IsSameDescription(entry.description, description))
+		{
+			if (entry.key == key)
+			{
+				return false;
+			}
+
+			entry.key = key;
+			m_manifestModified = true;
+			return true;
+		}
+	}
+
+	PipelineManifestEntry entry = { key, description };
+	m_manifest.push_back(entry);
+	m_manifestModified = true;
+	return true;
+}
+
+std::vector<PipelineManifestEntry> PipelineCache::GetManifest() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_manifest;
+}
+
+bool PipelineCache::IsManifestModified() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_manifestModified;
+}
+
+void PipelineCache::WriteManifest(std::ostream& stream)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ManifestHeader header = { ManifestMagic, ManifestVersion, static_cast<uint32_t>(m_manifest.size()), 0 };
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (const PipelineManifestEntry& entry : m_manifest)
+	{
+		const PipelineDescription& description = entry.description;
+		stream.write(reinterpret_cast<const char*>(&entry.key), sizeof(entry.key));
+		WriteValue(stream, static_cast<uint32_t>(description.topology));
+		WriteValue(stream, static_cast<uint32_t>(description.blend));
+		WriteValue(stream, static_cast<uint32_t>(description.depth));
+		WriteString(stream, description.vertexShader);
+		WriteString(stream, description.pixelShader);
+		WriteValue(stream, static_cast<uint32_t>(description.inputLayout.size()));
+		for (const VertexElement& element : description.inputLayout)
+		{
+			WriteString(stream, element.semantic);
+			WriteValue(stream, element.semanticIndex);
+			WriteValue(stream, element.format);
+			WriteValue(stream, element.slot);
+			WriteValue(stream, element.offset);
+			WriteValue(stream, element.perInstance ? 1 : 0);
+			WriteValue(stream, element.instanceStepRate);
+		}
+	}
+
+	if (stream)
+	{
+		m_manifestModified = false;
+	}
+}
+
+void PipelineCache::ReadManifest(std::istream& stream)
+{
+	ManifestHeader header;
+	if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != ManifestMagic || header.version != ManifestVersion)
+	{
+		throw std::runtime_error("PipelineCache: unbekanntes Dateiformat.");
+	}
+
+	std::vector<PipelineManifestEntry> manifest;
+	for (uint32_t index = 0; index < header.entryCount; index++)
+	{
+		PipelineManifestEntry entry;
+		if (!stream.read(reinterpret_cast<char*>(&entry.key), sizeof(entry.key)))
+		{
+			throw std::runtime_error("PipelineCache: Verzeichnis ist unvollständig.");
+		}
+
+		uint32_t topology = ReadValue(stream);
+		if (topology > static_cast<uint32_t>(PrimitiveTopology::LineList))
+		{
+			throw std::runtime_error("PipelineCache: ungültige Topologie im Verzeichnis.");
+		}
+		entry.description.topology = static_cast<PrimitiveTopology>(topology);
+
+		uint32_t blend = ReadValue(stream);
+		uint32_t depth = ReadValue(stream);
+		if (blend > static_cast<uint32_t>(BlendMode::PremultipliedAlpha) || depth > static_cast<uint32_t>(DepthMode::Disabled))
+		{
+			throw std::runtime_error("PipelineCache: ungültige Ausgabezustände im Verzeichnis.");
+		}
+		entry.description.blend = static_cast<BlendMode>(blend);
+		entry.description.depth = static_cast<DepthMode>(depth);
+		entry.description.vertexShader = ReadString(stream);
+		entry.description.pixelShader = ReadString(stream);
+
+		uint32_t elementCount = ReadValue(stream);
+		if (elementCount > MaxElements)
+		{
+			throw std::runtime_error("PipelineCache: ungültiges Eingabelayout im Verzeichnis.");
+		}
+
+		entry.description.inputLayout.resize(elementCount);
+		for (VertexElement& element : entry.description.inputLayout)
+		{
+			element.semantic = ReadString(stream);
+			element.semanticIndex = ReadValue(stream);
+			element.format = ReadValue(stream);
+			element.slot = ReadValue(stream);
+			element.offset = ReadValue(stream);
+			element.perInstance = ReadValue(stream) != 0;
+			element.instanceStepRate = ReadValue(stream);
+		}
+
+		manifest.push_back(std::move(entry));
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_manifest.swap(manifest);
+	m_manifestModified = false;
+}
+
+PipelineCacheStatistics PipelineCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	PipelineCacheStatistics statistics = m_statistics;
+	statistics.objects = static_cast<uint32_t>(m_objects.size());
+	return statistics;
+}
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RenderCommands.h"
+
+namespace DX
+{
+	// Inhaltsschlüssel eines Pipelineobjekts; gleiche Schlüssel stehen für gleiche Objekte.
+	typedef uint64_t PipelineKey;
+
+	// FNV-1a mit 64 Bit über beliebig viele Stücke.
+	class ContentHash
+	{
+	public:
+		ContentHash() : m_value(14695981039346656037ull)	{ }
+
+		void Add(const void* data, size_t size);
+		void Add(const std::string& text);					// samt Länge, damit Folgen von Zeichenketten eindeutig bleiben
+		void Add(uint32_t value)							{ Add(&value, sizeof(value)); }
+		void Add(uint64_t value)							{ Add(&value, sizeof(value)); }
+
+		uint64_t GetValue() const							{ return m_value; }
+
+	private:
+		uint64_t m_value;
+	};
+
+	enum class PipelineObjectKind : uint32_t
+	{
+		VertexShader,
+		PixelShader,
+		InputLayout,
+		BlendState,
+		DepthStencilState,
+		Pipeline,
+	};
+
+	// Zustände der Ausgabe; die Nullwerte entsprechen den Voreinstellungen des Geräts.
+	enum class BlendMode : uint32_t
+	{
+		Opaque,
+		PremultipliedAlpha,
+	};
+
+	enum class DepthMode : uint32_t
+	{
+		TestAndWrite,
+		Disabled,
+	};
+
+	// Ein Element des Eingabelayouts unabhängig vom Grafik-API; format ist der DXGI_FORMAT-Wert.
+	struct VertexElement
+	{
+		std::string	semantic;
+		uint32_t	semanticIndex;
+		uint32_t	format;
+		uint32_t	slot;
+		uint32_t	offset;
+		bool		perInstance;
+		uint32_t	instanceStepRate;
+	};
+
+	// Rezept einer Pipeline aus Asset-Namen, Eingabelayout und Zuständen. Aus ihm lässt sich die Pipeline beim
+	// nächsten Start vorab erstellen.
+	struct PipelineDescription
+	{
+		std::string					vertexShader;
+		std::string					pixelShader;
+		std::vector<VertexElement>	inputLayout;
+		PrimitiveTopology			topology;
+		BlendMode					blend;
+		DepthMode					depth;
+	};
+
+	struct PipelineManifestEntry
+	{
+		PipelineKey			key;			// Inhaltsschlüssel beim letzten Erstellen
+		PipelineDescription	description;
+	};
+
+	struct PipelineCacheStatistics
+	{
+		uint64_t	requests;
+		uint64_t	hits;
+		uint64_t	creations;
+		uint64_t	failures;
+		uint64_t	discarded;			// nach einem Clear fertig gewordene und daher verworfene Objekte
+		int64_t		creationTicks;		// Ticks von std::chrono::steady_clock
+		uint32_t	objects;
+	};
+
+	// Hält Shader, Eingabelayouts und Pipelines unter ihrem Inhaltsschlüssel, sodass gleiche Objekte nur einmal
+	// erstellt werden, auch wenn mehrere Renderer sie gleichzeitig anfordern. Die Schlüssel hängen vom Bytecode
+	// ab; neu übersetzte Shader erhalten daher neue Schlüssel und verdrängen nie veraltete Objekte.
+	// Zusätzlich führt der Cache ein Verzeichnis der verwendeten Pipelines, das zwischen zwei Läufen
+	// gespeichert wird. Jedes Clear beginnt eine neue Generation; Objekte, deren Erstellung in einer älteren
+	// begonnen hat, gehören zum alten Gerät und werden verworfen. Alle Methoden sind von beliebigen Threads
+	// aus aufrufbar.
+	class PipelineCache
+	{
+	public:
+		typedef std::function<std::shared_ptr<void>()> CreateFunction;
+
+		PipelineCache();
+
+		static PipelineKey HashShader(PipelineObjectKind kind, const void* bytecode, size_t size);
+		static PipelineKey HashInputLayout(const std::vector<VertexElement>& elements, PipelineKey vertexShader);
+		static PipelineKey HashState(BlendMode blend);
+		static PipelineKey HashState(DepthMode depth);
+		static PipelineKey HashPipeline(PipelineKey vertexShader, PipelineKey pixelShader, PipelineKey inputLayout, PrimitiveTopology topology,
+			BlendMode blend, DepthMode depth);
+
+		// Liefert das Objekt zum Schlüssel und ruft create nur auf, wenn es noch fehlt. Weitere Aufrufer mit
+		// demselben Schlüssel warten, bis es erstellt ist. Ausnahmen aus create werden weitergereicht; der
+		// nächste Aufrufer versucht es dann erneut. generation stammt von GetGeneration, bevor der Aufrufer
+		// das Gerät geholt hat; ist sie veraltet oder veraltet sie während create, wirft GetOrCreate
+		// std::runtime_error, statt ein Objekt des alten Geräts zu liefern oder einzutragen.
+		std::shared_ptr<void> GetOrCreate(PipelineKey key, uint64_t generation, const CreateFunction& create);
+		std::shared_ptr<void> Find(PipelineKey key) const;
+
+		uint64_t GetGeneration() const;
+
+		// Vergisst alle Objekte, etwa bei einem Geräteverlust, und beginnt eine neue Generation. Das
+		// Verzeichnis bleibt erhalten.
+		void Clear();
+
+		// Nimmt eine Pipeline ins Verzeichnis auf oder aktualisiert ihren Schlüssel. Gibt true zurück,
+		// wenn sich das Verzeichnis dadurch geändert hat.
+		bool AddToManifest(const PipelineDescription& description, PipelineKey key);
+		std::vector<PipelineManifestEntry> GetManifest() const;
+		bool IsManifestModified() const;
+
+		// Binärformat wie die übrigen Dateien des Simulators; Read ersetzt das Verzeichnis.
+		void WriteManifest(std::ostream& stream);
+		void ReadManifest(std::istream& stream);
+
+		PipelineCacheStatistics GetStatistics() const;
+
+	private:
+		PipelineCache(const PipelineCache&);
+		PipelineCache& operator=(const PipelineCache&);
+
+		static bool IsSameDescription(const PipelineDescription& a, const PipelineDescription& b);
+
+		mutable std::mutex										m_mutex;
+		std::condition_variable									m_created;
+		std::unordered_map<PipelineKey, std::shared_ptr<void>>	m_objects;		// nullptr, solange es erstellt wird
+		uint64_t												m_generation;
+		std::vector<PipelineManifestEntry>						m_manifest;
+		bool													m_manifestModified;
+		PipelineCacheStatistics									m_statistics;
+	};
+}
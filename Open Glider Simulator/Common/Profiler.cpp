@@ -0,0 +1,111 @@
+﻿#include "Profiler.h"
+
+#include <iomanip>
+
+using namespace DX;
+
+ProfilerThreadBuffer::ProfilerThreadBuffer(uint32_t threadId) :
+	m_threadId(threadId),
+	m_head(0),
+	m_tail(0),
+	m_droppedEvents(0)
+{
+}
+
+Profiler::Profiler()
+{
+}
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+// Jeder Thread legt beim ersten Aufruf seinen eigenen Puffer an; danach ist der Zugriff sperrfrei.
+// Die Puffer gehören dem Profiler und überleben ihren Thread, damit der Export sie noch lesen kann.
+ProfilerThreadBuffer& Profiler::GetThreadBuffer()
+{
+	static thread_local ProfilerThreadBuffer* threadBuffer = nullptr;
+
+	if (threadBuffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadBuffers.push_back(std::unique_ptr<ProfilerThreadBuffer>(new ProfilerThreadBuffer(static_cast<uint32_t>(m_threadBuffers.size() + 1))));
+		threadBuffer = m_threadBuffers.back().get();
+	}
+
+	return *threadBuffer;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	uint32_t threadId = GetThreadBuffer().GetThreadId();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_threadNames.push_back(std::make_pair(threadId, name));
+}
+
+uint64_t Profiler::GetDroppedEventCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint64_t dropped = 0;
+	for (auto& threadBuffer : m_threadBuffers)
+	{
+		dropped += threadBuffer->GetDroppedEventCount();
+	}
+
+	return dropped;
+}
+
+// Zonennamen sind Literale aus dem Quelltext; nur Anführungszeichen und Backslashes müssen maskiert werden.
+static void WriteJsonString(std::ostream& stream, const char* text)
+{
+	stream << '"';
+	for (; *text != '\0'; text++)
+	{
+		if (*text == '"' || *text == '\\')
+		{
+			stream << '\\';
+		}
+		stream << *text;
+	}
+	stream << '"';
+}
+
+void Profiler::WriteChromeTrace(std::ostream& stream)
+{
+	typedef std::chrono::steady_clock::period Period;
+	const double microsecondsPerTick = 1.0e6 * Period::num / Period::den;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	stream << std::fixed << std::setprecision(3);
+
+	bool first = true;
+	for (auto& threadName : m_threadNames)
+	{
+		stream << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << threadName.first << ",\"args\":{\"name\":";
+		WriteJsonString(stream, threadName.second);
+		stream << "}}";
+		first = false;
+	}
+
+	for (auto& threadBuffer : m_threadBuffers)
+	{
+		uint32_t threadId = threadBuffer->GetThreadId();
+		threadBuffer->Drain([&](const ProfilerEvent& profilerEvent)
+		{
+			stream << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"name\":";
+			WriteJsonString(stream, profilerEvent.name);
+			stream << ",\"pid\":1,\"tid\":" << threadId
+				<< ",\"ts\":" << profilerEvent.start * microsecondsPerTick
+				<< ",\"dur\":" << (profilerEvent.end - profilerEvent.start) * microsecondsPerTick << "}";
+			first = false;
+		});
+	}
+
+	stream << "\n]}\n";
+}
@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Profilerzonen sind in Debugbuilds aktiv und werden in Releasebuilds vollständig entfernt,
+// sofern DX_PROFILER_ENABLED nicht ausdrücklich gesetzt wird.
+#if !defined(DX_PROFILER_ENABLED)
+#if defined(_DEBUG)
+#define DX_PROFILER_ENABLED 1
+#else
+#define DX_PROFILER_ENABLED 0
+#endif
+#endif
+
+namespace DX
+{
+	// Eine abgeschlossene Zone mit Anfangs- und Endzeit in Einheiten von std::chrono::steady_clock.
+	struct ProfilerEvent
+	{
+		const char*	name;
+		int64_t		start;
+		int64_t		end;
+	};
+
+	// Ringpuffer eines einzelnen Threads. Nur dieser Thread schreibt, nur der Export liest,
+	// daher genügen zwei atomare Indizes. Ist der Puffer voll, werden neue Zonen verworfen und gezählt.
+	class ProfilerThreadBuffer
+	{
+	public:
+		static const uint32_t Capacity = 1u << 14;
+
+		explicit ProfilerThreadBuffer(uint32_t threadId);
+
+		void Push(const ProfilerEvent& profilerEvent)
+		{
+			uint32_t head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tail.load(std::memory_order_acquire) >= Capacity)
+			{
+				m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			m_events[head & (Capacity - 1)] = profilerEvent;
+			m_head.store(head + 1, std::memory_order_release);
+		}
+
+		template<typename TVisitor>
+		void Drain(const TVisitor& visitor)
+		{
+			uint32_t tail = m_tail.load(std::memory_order_relaxed);
+			uint32_t head = m_head.load(std::memory_order_acquire);
+
+			for (; tail != head; tail++)
+			{
+				visitor(m_events[tail & (Capacity - 1)]);
+			}
+
+			m_tail.store(tail, std::memory_order_release);
+		}
+
+		uint32_t GetThreadId() const						{ return m_threadId; }
+		uint64_t GetDroppedEventCount() const				{ return m_droppedEvents.load(std::memory_order_relaxed); }
+
+	private:
+		uint32_t				m_threadId;
+		std::atomic<uint32_t>	m_head;
+		std::atomic<uint32_t>	m_tail;
+		std::atomic<uint64_t>	m_droppedEvents;
+		ProfilerEvent			m_events[Capacity];
+	};
+
+	// Sammelt die Zonen aller Threads und exportiert sie im Chrome-Trace-JSON-Format
+	// (chrome://tracing, Perfetto UI).
+	class Profiler
+	{
+	public:
+		static Profiler& Get();
+
+		static int64_t Now()								{ return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+		void Record(const char* name, int64_t start, int64_t end)
+		{
+			ProfilerEvent profilerEvent = { name, start, end };
+			GetThreadBuffer().Push(profilerEvent);
+		}
+
+		// Benennt den aufrufenden Thread in der Trace-Ansicht. Der Name muss dauerhaft gültig sein.
+		void SetThreadName(const char* name);
+
+		// Leert alle Thread-Puffer und schreibt die enthaltenen Zonen als Chrome-Trace-JSON.
+		void WriteChromeTrace(std::ostream& stream);
+
+		uint64_t GetDroppedEventCount();
+
+	private:
+		Profiler();
+
+		ProfilerThreadBuffer& GetThreadBuffer();
+
+		std::mutex											m_mutex;
+		std::vector<std::unique_ptr<ProfilerThreadBuffer>>	m_threadBuffers;
+		std::vector<std::pair<uint32_t, const char*>>		m_threadNames;
+	};
+
+	// Misst die Dauer eines Gültigkeitsbereichs als Profilerzone.
+	class ProfileZone
+	{
+	public:
+		explicit ProfileZone(const char* name) :
+			m_name(name),
+			m_start(Profiler::Now())
+		{
+		}
+
+		~ProfileZone()
+		{
+			Profiler::Get().Record(m_name, m_start, Profiler::Now());
+		}
+
+	private:
+		ProfileZone(const ProfileZone&);
+		ProfileZone& operator=(const ProfileZone&);
+
+		const char*	m_name;
+		int64_t		m_start;
+	};
+}
+
+#define DX_PROFILE_CONCAT_INNER(a, b) a##b
+#define DX_PROFILE_CONCAT(a, b) DX_PROFILE_CONCAT_INNER(a, b)
+
+#if DX_PROFILER_ENABLED
+#define DX_PROFILE_ZONE(name) DX::ProfileZone DX_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define DX_PROFILE_THREAD(name) DX::Profiler::Get().SetThreadName(name)
+#else
+#define DX_PROFILE_ZONE(name) ((void)0)
+#define DX_PROFILE_THREAD(name) ((void)0)
+#endif
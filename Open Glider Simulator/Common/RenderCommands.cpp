@@ -0,0 +1,511 @@
+﻿#include "RenderCommands.h"
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+	uint32_t AlignCommandSize(size_t size)
+	{
+		return static_cast<uint32_t>((size + RenderCommandAlignment - 1) & ~static_cast<size_t>(RenderCommandAlignment - 1));
+	}
+
+	uint64_t GetPrimitiveCount(PrimitiveTopology topology, uint32_t vertexCount)
+	{
+		switch (topology)
+		{
+		case PrimitiveTopology::TriangleList:	return vertexCount / 3;
+		case PrimitiveTopology::TriangleStrip:	return vertexCount >= 3 ? vertexCount - 2 : 0;
+		case PrimitiveTopology::LineList:		return vertexCount / 2;
+		}
+		return 0;
+	}
+
+	bool IsCompleteTopology(PrimitiveTopology topology, uint32_t vertexCount)
+	{
+		switch (topology)
+		{
+		case PrimitiveTopology::TriangleList:	return vertexCount % 3 == 0;
+		case PrimitiveTopology::LineList:		return vertexCount % 2 == 0;
+		default:								return true;
+		}
+	}
+}
+
+RenderCommandBuffer::RenderCommandBuffer() :
+	m_size(0),
+	m_commandCount(0)
+{
+}
+
+void RenderCommandBuffer::Reset()
+{
+	m_size = 0;
+	m_commandCount = 0;
+}
+
+template<typename TCommand>
+TCommand& RenderCommandBuffer::Append(RenderCommandType type, uint32_t payloadSize)
+{
+	uint32_t size = AlignCommandSize(sizeof(TCommand) + payloadSize);
+	if (m_size + size > m_data.size())
+	{
+		// Verdoppeln, damit ein Frame nach dem Einschwingen ohne Speicheranforderung auskommt.
+		m_data.resize((std::max)(m_data.size() * 2, m_size + size));
+	}
+
+	TCommand& command = *reinterpret_cast<TCommand*>(m_data.data() + m_size);
+	command.header.type = type;
+	command.header.size = size;
+	m_size += size;
+	m_commandCount++;
+	return command;
+}
+
+void RenderCommandBuffer::SetPipeline(const RenderPipeline& pipeline)
+{
+	SetPipelineCommand& command = Append<SetPipelineCommand>(RenderCommandType::SetPipeline);
+	command.pipeline = pipeline;
+}
+
+void RenderCommandBuffer::SetVertexBuffer(uint32_t slot, RenderHandle buffer, uint32_t stride, uint32_t offset)
+{
+	if (slot >= MaxVertexBufferSlots)
+	{
+		throw std::invalid_argument("RenderCommandBuffer: vertex buffer slot out of range");
+	}
+
+	SetVertexBufferCommand& command = Append<SetVertexBufferCommand>(RenderCommandType::SetVertexBuffer);
+	command.buffer = buffer;
+	command.slot = slot;
+	command.stride = stride;
+	command.offset = offset;
+}
+
+void RenderCommandBuffer::SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset)
+{
+	SetIndexBufferCommand& command = Append<SetIndexBufferCommand>(RenderCommandType::SetIndexBuffer);
+	command.buffer = buffer;
+	command.format = format;
+	command.offset = offset;
+}
+
+void RenderCommandBuffer::SetConstantBuffers(uint32_t stages, uint32_t startSlot, uint32_t count, const RenderHandle* buffers)
+{
+	if (count == 0 || count > MaxConstantBuffersPerCommand || startSlot + count > MaxConstantBufferSlots)
+	{
+		throw std::invalid_argument("RenderCommandBuffer: constant buffer slots out of range");
+	}
+
+	SetConstantBuffersCommand& command = Append<SetConstantBuffersCommand>(RenderCommandType::SetConstantBuffers);
+	command.stages = stages;
+	command.startSlot = startSlot;
+	command.count = count;
+	for (uint32_t i = 0; i < MaxConstantBuffersPerCommand; i++)
+	{
+		command.buffers[i] = i < count ? buffers[i] : nullptr;
+	}
+}
+
+void RenderCommandBuffer::SetConstantBufferRange(uint32_t stages, uint32_t slot, RenderHandle buffer, uint32_t offset, uint32_t size)
+{
+	if (slot >= MaxConstantBufferSlots)
+	{
+		throw std::invalid_argument("RenderCommandBuffer: constant buffer slot out of range");
+	}
+
+	SetConstantBufferRangeCommand& command = Append<SetConstantBufferRangeCommand>(RenderCommandType::SetConstantBufferRange);
+	command.stages = stages;
+	command.slot = slot;
+	command.buffer = buffer;
+	command.offset = offset;
+	command.size = size;
+}
+
+void RenderCommandBuffer::SetShaderResources(uint32_t stages, uint32_t startSlot, uint32_t count, const RenderHandle* views)
+{
+	if (count == 0 || count > MaxShaderResourcesPerCommand || startSlot + count > MaxShaderResourceSlots)
+	{
+		throw std::invalid_argument("RenderCommandBuffer: shader resource slots out of range");
+	}
+
+	SetShaderResourcesCommand& command = Append<SetShaderResourcesCommand>(RenderCommandType::SetShaderResources);
+	command.stages = stages;
+	command.startSlot = startSlot;
+	command.count = count;
+	for (uint32_t i = 0; i < MaxShaderResourcesPerCommand; i++)
+	{
+		command.views[i] = i < count ? views[i] : nullptr;
+	}
+}
+
+void RenderCommandBuffer::UpdateConstants(RenderHandle buffer, const void* data, uint32_t dataSize)
+{
+	UpdateConstantsCommand& command = Append<UpdateConstantsCommand>(RenderCommandType::UpdateConstants, dataSize);
+	command.buffer = buffer;
+	command.dataSize = dataSize;
+	memcpy(&command + 1, data, dataSize);
+}
+
+void RenderCommandBuffer::UpdateBuffer(RenderHandle buffer, const void* data, uint32_t dataSize)
+{
+	memcpy(UpdateBuffer(buffer, dataSize), data, dataSize);
+}
+
+void* RenderCommandBuffer::UpdateBuffer(RenderHandle buffer, uint32_t dataSize)
+{
+	UpdateBufferCommand& command = Append<UpdateBufferCommand>(RenderCommandType::UpdateBuffer, dataSize);
+	command.buffer = buffer;
+	command.dataSize = dataSize;
+	return &command + 1;
+}
+
+void RenderCommandBuffer::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+	DrawCommand& command = Append<DrawCommand>(RenderCommandType::Draw);
+	command.vertexCount = vertexCount;
+	command.startVertex = startVertex;
+}
+
+void RenderCommandBuffer::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	DrawIndexedCommand& command = Append<DrawIndexedCommand>(RenderCommandType::DrawIndexed);
+	command.indexCount = indexCount;
+	command.startIndex = startIndex;
+	command.baseVertex = baseVertex;
+}
+
+void RenderCommandBuffer::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	DrawIndexedInstancedCommand& command = Append<DrawIndexedInstancedCommand>(RenderCommandType::DrawIndexedInstanced);
+	command.indexCount = indexCount;
+	command.instanceCount = instanceCount;
+	command.startIndex = startIndex;
+	command.baseVertex = baseVertex;
+	command.startInstance = startInstance;
+}
+
+void IRenderBackend::ExecuteInOrder(const RenderCommandBuffer* const* commands, size_t count, ThreadPool*)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		Execute(*commands[i]);
+	}
+}
+
+NullRenderBackend::NullRenderBackend(uint32_t uploadCapacity) :
+	m_uploadMemory(uploadCapacity),
+	m_uploadRing(new UploadRing(uploadCapacity, ConstantBufferRangeAlignment)),
+	m_frame(0)
+{
+	ResetStatistics();
+	ResetState();
+}
+
+NullRenderBackend::~NullRenderBackend()
+{
+}
+
+void NullRenderBackend::BeginFrame()
+{
+	if (m_frame > FramesInFlight)
+	{
+		m_uploadRing->Retire(m_frame - FramesInFlight);
+	}
+	m_uploadRing->SetMemory(m_uploadMemory.data(), m_uploadMemory.data());
+}
+
+UploadRing& NullRenderBackend::GetUploadRing()
+{
+	return *m_uploadRing;
+}
+
+void NullRenderBackend::EndFrame()
+{
+	m_uploadRing->SetMemory(nullptr, m_uploadMemory.data());
+	m_uploadRing->EndFrame(++m_frame);
+}
+
+void NullRenderBackend::ExecuteInOrder(const RenderCommandBuffer* const* commands, size_t count, ThreadPool*)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		ResetState();
+		Execute(*commands[i]);
+	}
+}
+
+void NullRenderBackend::ResetStatistics()
+{
+	m_statistics = RenderCommandStatistics();
+	m_validationErrors.clear();
+}
+
+void NullRenderBackend::ResetState()
+{
+	m_pipeline = RenderPipeline();
+	m_hasPipeline = false;
+	for (uint32_t slot = 0; slot < MaxVertexBufferSlots; slot++)
+	{
+		m_vertexBuffers[slot] = nullptr;
+		m_vertexStrides[slot] = 0;
+		m_vertexOffsets[slot] = 0;
+	}
+	m_indexBuffer = nullptr;
+	m_indexFormat = IndexFormat::UInt16;
+	m_indexOffset = 0;
+	for (uint32_t slot = 0; slot < MaxConstantBufferSlots; slot++)
+	{
+		m_vertexConstantBuffers[slot] = nullptr;
+		m_pixelConstantBuffers[slot] = nullptr;
+		m_vertexConstantOffsets[slot] = 0;
+		m_pixelConstantOffsets[slot] = 0;
+	}
+	for (uint32_t slot = 0; slot < MaxShaderResourceSlots; slot++)
+	{
+		m_vertexShaderResources[slot] = nullptr;
+		m_pixelShaderResources[slot] = nullptr;
+	}
+}
+
+void NullRenderBackend::CountStateChange(bool redundant)
+{
+	m_statistics.stateChanges++;
+	if (redundant)
+	{
+		m_statistics.redundantStateChanges++;
+	}
+}
+
+void NullRenderBackend::Fail(const char* message)
+{
+	m_statistics.validationErrors++;
+	if (m_validationErrors.size() < MaxStoredValidationErrors)
+	{
+		m_validationErrors.push_back(message);
+	}
+}
+
+void NullRenderBackend::Execute(const RenderCommandBuffer& commands)
+{
+	commands.ForEach([this](const RenderCommandHeader& header) {
+		m_statistics.commands++;
+
+		switch (header.type)
+		{
+		case RenderCommandType::SetPipeline:
+		{
+			const RenderPipeline& pipeline = reinterpret_cast<const SetPipelineCommand&>(header).pipeline;
+			CountStateChange(m_hasPipeline &&
+				pipeline.inputLayout == m_pipeline.inputLayout &&
+				pipeline.vertexShader == m_pipeline.vertexShader &&
+				pipeline.pixelShader == m_pipeline.pixelShader &&
+				pipeline.topology == m_pipeline.topology &&
+				pipeline.blendState == m_pipeline.blendState &&
+				pipeline.depthStencilState == m_pipeline.depthStencilState);
+			if (!pipeline.inputLayout || !pipeline.vertexShader)
+			{
+				Fail("SetPipeline: input layout or vertex shader missing");
+			}
+			m_pipeline = pipeline;
+			m_hasPipeline = true;
+			break;
+		}
+
+		case RenderCommandType::SetVertexBuffer:
+		{
+			const SetVertexBufferCommand& command = reinterpret_cast<const SetVertexBufferCommand&>(header);
+			CountStateChange(m_vertexBuffers[command.slot] == command.buffer &&
+				m_vertexStrides[command.slot] == command.stride &&
+				m_vertexOffsets[command.slot] == command.offset);
+			if (command.buffer && command.stride == 0)
+			{
+				Fail("SetVertexBuffer: zero stride");
+			}
+			m_vertexBuffers[command.slot] = command.buffer;
+			m_vertexStrides[command.slot] = command.stride;
+			m_vertexOffsets[command.slot] = command.offset;
+			break;
+		}
+
+		case RenderCommandType::SetIndexBuffer:
+		{
+			const SetIndexBufferCommand& command = reinterpret_cast<const SetIndexBufferCommand&>(header);
+			CountStateChange(m_indexBuffer == command.buffer && m_indexFormat == command.format && m_indexOffset == command.offset);
+			m_indexBuffer = command.buffer;
+			m_indexFormat = command.format;
+			m_indexOffset = command.offset;
+			break;
+		}
+
+		case RenderCommandType::SetConstantBuffers:
+		{
+			const SetConstantBuffersCommand& command = reinterpret_cast<const SetConstantBuffersCommand&>(header);
+			bool redundant = true;
+			for (uint32_t i = 0; i < command.count; i++)
+			{
+				uint32_t slot = command.startSlot + i;
+				if (command.stages & ShaderStageVertex)
+				{
+					redundant = redundant && m_vertexConstantBuffers[slot] == command.buffers[i] && m_vertexConstantOffsets[slot] == 0;
+					m_vertexConstantBuffers[slot] = command.buffers[i];
+					m_vertexConstantOffsets[slot] = 0;
+				}
+				if (command.stages & ShaderStagePixel)
+				{
+					redundant = redundant && m_pixelConstantBuffers[slot] == command.buffers[i] && m_pixelConstantOffsets[slot] == 0;
+					m_pixelConstantBuffers[slot] = command.buffers[i];
+					m_pixelConstantOffsets[slot] = 0;
+				}
+			}
+			CountStateChange(redundant);
+			break;
+		}
+
+		case RenderCommandType::SetConstantBufferRange:
+		{
+			const SetConstantBufferRangeCommand& command = reinterpret_cast<const SetConstantBufferRangeCommand&>(header);
+			bool redundant = true;
+			if (command.stages & ShaderStageVertex)
+			{
+				redundant = redundant && m_vertexConstantBuffers[command.slot] == command.buffer && m_vertexConstantOffsets[command.slot] == command.offset;
+				m_vertexConstantBuffers[command.slot] = command.buffer;
+				m_vertexConstantOffsets[command.slot] = command.offset;
+			}
+			if (command.stages & ShaderStagePixel)
+			{
+				redundant = redundant && m_pixelConstantBuffers[command.slot] == command.buffer && m_pixelConstantOffsets[command.slot] == command.offset;
+				m_pixelConstantBuffers[command.slot] = command.buffer;
+				m_pixelConstantOffsets[command.slot] = command.offset;
+			}
+			CountStateChange(redundant);
+
+			if (!command.buffer)
+			{
+				Fail("SetConstantBufferRange: no buffer");
+			}
+			if (command.offset % ConstantBufferRangeAlignment != 0)
+			{
+				Fail("SetConstantBufferRange: offset is not aligned to 256 bytes");
+			}
+			if (command.size == 0 || command.size % 16 != 0 || command.size > MaxConstantBufferRangeSize)
+			{
+				Fail("SetConstantBufferRange: size is not a positive multiple of 16 bytes up to 64 KB");
+			}
+			if (command.buffer == m_uploadRing->GetBuffer() && command.offset + command.size > m_uploadRing->GetCapacity())
+			{
+				Fail("SetConstantBufferRange: range exceeds the upload ring");
+			}
+			break;
+		}
+
+		case RenderCommandType::SetShaderResources:
+		{
+			const SetShaderResourcesCommand& command = reinterpret_cast<const SetShaderResourcesCommand&>(header);
+			bool redundant = true;
+			for (uint32_t i = 0; i < command.count; i++)
+			{
+				uint32_t slot = command.startSlot + i;
+				if (command.stages & ShaderStageVertex)
+				{
+					redundant = redundant && m_vertexShaderResources[slot] == command.views[i];
+					m_vertexShaderResources[slot] = command.views[i];
+				}
+				if (command.stages & ShaderStagePixel)
+				{
+					redundant = redundant && m_pixelShaderResources[slot] == command.views[i];
+					m_pixelShaderResources[slot] = command.views[i];
+				}
+			}
+			CountStateChange(redundant);
+			break;
+		}
+
+		case RenderCommandType::UpdateConstants:
+		{
+			const UpdateConstantsCommand& command = reinterpret_cast<const UpdateConstantsCommand&>(header);
+			m_statistics.constantUploads++;
+			m_statistics.constantBytes += command.dataSize;
+			if (!command.buffer)
+			{
+				Fail("UpdateConstants: no buffer");
+			}
+			// Direct3D verlangt Konstantenpuffer in Vielfachen von 16 Bytes.
+			if (command.dataSize == 0 || command.dataSize % 16 != 0)
+			{
+				Fail("UpdateConstants: size is not a positive multiple of 16 bytes");
+			}
+			break;
+		}
+
+		case RenderCommandType::UpdateBuffer:
+		{
+			const UpdateBufferCommand& command = reinterpret_cast<const UpdateBufferCommand&>(header);
+			m_statistics.bufferUploads++;
+			m_statistics.bufferBytes += command.dataSize;
+			if (!command.buffer || command.dataSize == 0)
+			{
+				Fail("UpdateBuffer: no buffer or no data");
+			}
+			break;
+		}
+
+		case RenderCommandType::Draw:
+		case RenderCommandType::DrawIndexed:
+		case RenderCommandType::DrawIndexedInstanced:
+		{
+			bool indexed = header.type != RenderCommandType::Draw;
+			uint32_t count = 0;
+			uint32_t instanceCount = 1;
+			switch (header.type)
+			{
+			case RenderCommandType::Draw:
+				count = reinterpret_cast<const DrawCommand&>(header).vertexCount;
+				break;
+			case RenderCommandType::DrawIndexed:
+				count = reinterpret_cast<const DrawIndexedCommand&>(header).indexCount;
+				break;
+			default:
+				count = reinterpret_cast<const DrawIndexedInstancedCommand&>(header).indexCount;
+				instanceCount = reinterpret_cast<const DrawIndexedInstancedCommand&>(header).instanceCount;
+				break;
+			}
+
+			m_statistics.draws++;
+			m_statistics.instances += instanceCount;
+			if (!m_hasPipeline)
+			{
+				Fail("Draw: no pipeline set");
+				break;
+			}
+			m_statistics.primitives += GetPrimitiveCount(m_pipeline.topology, count) * instanceCount;
+
+			if (instanceCount == 0)
+			{
+				Fail("DrawIndexedInstanced: no instances");
+			}
+
+			if (!m_vertexBuffers[0])
+			{
+				Fail("Draw: no vertex buffer in slot 0");
+			}
+			if (indexed && !m_indexBuffer)
+			{
+				Fail("DrawIndexed: no index buffer");
+			}
+			if (count == 0 || !IsCompleteTopology(m_pipeline.topology, count))
+			{
+				Fail("Draw: count does not form whole primitives");
+			}
+			break;
+		}
+
+		default:
+			throw std::logic_error("NullRenderBackend: unknown render command");
+		}
+	});
+}
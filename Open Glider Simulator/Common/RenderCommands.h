@@ -0,0 +1,338 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+	// Undurchsichtiger Verweis auf ein Objekt des Backends, für Direct3D 11 der rohe Schnittstellenzeiger.
+	// Der Aufrufer hält das Objekt am Leben, bis der Befehlspuffer ausgeführt wurde.
+	typedef const void* RenderHandle;
+
+	enum class PrimitiveTopology : uint32_t
+	{
+		TriangleList,
+		TriangleStrip,
+		LineList,
+	};
+
+	enum class IndexFormat : uint32_t
+	{
+		UInt16,
+		UInt32,
+	};
+
+	// Shaderstufen als Bitmaske, an die Konstantenpuffer gebunden werden.
+	enum ShaderStageFlags : uint32_t
+	{
+		ShaderStageVertex = 1,
+		ShaderStagePixel = 2,
+	};
+
+	// Alle Zustände, die ein Zeichenbefehl außer Puffern benötigt.
+	struct RenderPipeline
+	{
+		RenderHandle		inputLayout;
+		RenderHandle		vertexShader;
+		RenderHandle		pixelShader;
+		PrimitiveTopology	topology;
+		RenderHandle		blendState;			// nullptr: deckend
+		RenderHandle		depthStencilState;	// nullptr: Tiefentest mit Schreiben
+	};
+
+	enum class RenderCommandType : uint32_t
+	{
+		SetPipeline,
+		SetVertexBuffer,
+		SetIndexBuffer,
+		SetConstantBuffers,
+		SetConstantBufferRange,
+		SetShaderResources,
+		UpdateConstants,
+		UpdateBuffer,
+		Draw,
+		DrawIndexed,
+		DrawIndexedInstanced,
+	};
+
+	// Jeder Befehl beginnt mit diesem Kopf. size umfasst Kopf, Befehl und angehängte Daten und ist
+	// ein Vielfaches von RenderCommandAlignment, damit der nächste Befehl ausgerichtet folgt.
+	struct RenderCommandHeader
+	{
+		RenderCommandType	type;
+		uint32_t			size;
+	};
+
+	static const uint32_t RenderCommandAlignment = 8;
+	static const uint32_t MaxVertexBufferSlots = 16;
+	static const uint32_t MaxConstantBufferSlots = 14;
+	static const uint32_t MaxConstantBuffersPerCommand = 4;
+	static const uint32_t ConstantBufferRangeAlignment = 256;
+	static const uint32_t MaxConstantBufferRangeSize = 65536;
+	static const uint32_t MaxShaderResourceSlots = 128;
+	static const uint32_t MaxShaderResourcesPerCommand = 4;
+
+	struct SetPipelineCommand
+	{
+		RenderCommandHeader	header;
+		RenderPipeline		pipeline;
+	};
+
+	struct SetVertexBufferCommand
+	{
+		RenderCommandHeader	header;
+		RenderHandle		buffer;
+		uint32_t			slot;
+		uint32_t			stride;
+		uint32_t			offset;
+	};
+
+	struct SetIndexBufferCommand
+	{
+		RenderCommandHeader	header;
+		RenderHandle		buffer;
+		IndexFormat			format;
+		uint32_t			offset;
+	};
+
+	struct SetConstantBuffersCommand
+	{
+		RenderCommandHeader	header;
+		uint32_t			stages;			// ShaderStageFlags
+		uint32_t			startSlot;
+		uint32_t			count;
+		RenderHandle		buffers[MaxConstantBuffersPerCommand];
+	};
+
+	// Bindet einen Ausschnitt eines größeren Puffers, etwa aus dem UploadRing, als Konstantenpuffer. offset ist
+	// ein Vielfaches von ConstantBufferRangeAlignment, size ein Vielfaches von 16 Bytes.
+	struct SetConstantBufferRangeCommand
+	{
+		RenderCommandHeader	header;
+		uint32_t			stages;			// ShaderStageFlags
+		uint32_t			slot;
+		RenderHandle		buffer;
+		uint32_t			offset;
+		uint32_t			size;
+	};
+
+	struct SetShaderResourcesCommand
+	{
+		RenderCommandHeader	header;
+		uint32_t			stages;			// ShaderStageFlags
+		uint32_t			startSlot;
+		uint32_t			count;
+		RenderHandle		views[MaxShaderResourcesPerCommand];
+	};
+
+	// Der neue Inhalt des ganzen Konstantenpuffers folgt dem Befehl im Befehlspuffer.
+	struct UpdateConstantsCommand
+	{
+		RenderCommandHeader	header;
+		RenderHandle		buffer;
+		uint32_t			dataSize;
+
+		const void* GetData() const							{ return this + 1; }
+	};
+
+	// Überschreibt den Anfang eines dynamischen Puffers und verwirft den bisherigen Inhalt. Die Daten
+	// folgen dem Befehl im Befehlspuffer.
+	struct UpdateBufferCommand
+	{
+		RenderCommandHeader	header;
+		RenderHandle		buffer;
+		uint32_t			dataSize;
+
+		const void* GetData() const							{ return this + 1; }
+	};
+
+	struct DrawCommand
+	{
+		RenderCommandHeader	header;
+		uint32_t			vertexCount;
+		uint32_t			startVertex;
+	};
+
+	struct DrawIndexedCommand
+	{
+		RenderCommandHeader	header;
+		uint32_t			indexCount;
+		uint32_t			startIndex;
+		int32_t				baseVertex;
+	};
+
+	struct DrawIndexedInstancedCommand
+	{
+		RenderCommandHeader	header;
+		uint32_t			indexCount;
+		uint32_t			instanceCount;
+		uint32_t			startIndex;
+		int32_t				baseVertex;
+		uint32_t			startInstance;
+	};
+
+	// Zeichnet Zustands-, Upload- und Zeichenbefehle kompakt hintereinander in einen Speicherblock auf.
+	// Die Aufzeichnung kennt kein Grafik-API und läuft daher auch ohne Gerät; ausgeführt wird sie von
+	// einem IRenderBackend. Nach Reset bleibt der Speicher für den nächsten Frame reserviert.
+	class RenderCommandBuffer
+	{
+	public:
+		RenderCommandBuffer();
+
+		void Reset();
+
+		void SetPipeline(const RenderPipeline& pipeline);
+		void SetVertexBuffer(uint32_t slot, RenderHandle buffer, uint32_t stride, uint32_t offset);
+		void SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset);
+		void SetConstantBuffers(uint32_t stages, uint32_t startSlot, uint32_t count, const RenderHandle* buffers);
+		void SetConstantBufferRange(uint32_t stages, uint32_t slot, RenderHandle buffer, uint32_t offset, uint32_t size);
+		void SetShaderResources(uint32_t stages, uint32_t startSlot, uint32_t count, const RenderHandle* views);
+
+		// Kopiert data sofort, der Aufrufer darf seine Struktur danach für den nächsten Befehl ändern.
+		void UpdateConstants(RenderHandle buffer, const void* data, uint32_t dataSize);
+
+		template<typename T>
+		void UpdateConstants(RenderHandle buffer, const T& data)
+		{
+			UpdateConstants(buffer, &data, static_cast<uint32_t>(sizeof(T)));
+		}
+
+		// Wie UpdateConstants, aber für dynamische Puffer beliebiger Größe, etwa Instanzdaten. Die zweite
+		// Form gibt den Platz für die Daten zurück, damit der Aufrufer sie direkt hineinschreiben kann;
+		// der Zeiger gilt bis zum nächsten Befehl.
+		void UpdateBuffer(RenderHandle buffer, const void* data, uint32_t dataSize);
+		void* UpdateBuffer(RenderHandle buffer, uint32_t dataSize);
+
+		void Draw(uint32_t vertexCount, uint32_t startVertex);
+		void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+
+		const uint8_t* GetData() const						{ return m_data.data(); }
+		size_t GetSize() const								{ return m_size; }
+		uint32_t GetCommandCount() const					{ return m_commandCount; }
+		bool IsEmpty() const								{ return m_commandCount == 0; }
+
+		// Ruft visitor(const RenderCommandHeader&) für jeden Befehl in Aufzeichnungsreihenfolge auf.
+		template<typename TVisitor>
+		void ForEach(TVisitor&& visitor) const
+		{
+			const uint8_t* command = m_data.data();
+			const uint8_t* end = command + m_size;
+			while (command != end)
+			{
+				const RenderCommandHeader& header = *reinterpret_cast<const RenderCommandHeader*>(command);
+				visitor(header);
+				command += header.size;
+			}
+		}
+
+	private:
+		// Reserviert Platz für einen Befehl mit payloadSize angehängten Bytes und füllt den Kopf.
+		template<typename TCommand>
+		TCommand& Append(RenderCommandType type, uint32_t payloadSize = 0);
+
+		std::vector<uint8_t>	m_data;
+		size_t					m_size;
+		uint32_t				m_commandCount;
+	};
+
+	class ThreadPool;
+	class UploadRing;
+
+	// Führt aufgezeichnete Befehle auf einem Grafik-API aus oder wertet sie nur aus. Ein Frame beginnt mit
+	// BeginFrame; bis zum ersten Execute dürfen die Renderer Daten in den UploadRing schreiben. EndFrame
+	// schließt die Daten des Frames ab, sie werden freigegeben, sobald die GPU ihn abgearbeitet hat.
+	class IRenderBackend
+	{
+	public:
+		virtual ~IRenderBackend() {}
+
+		virtual void BeginFrame() = 0;
+		virtual UploadRing& GetUploadRing() = 0;
+		virtual void Execute(const RenderCommandBuffer& commands) = 0;
+		virtual void EndFrame() = 0;
+
+		// Führt mehrere Befehlspuffer in der gegebenen Reihenfolge aus. Jeder Puffer beginnt ohne gebundenen
+		// Zustand außer den Renderzielen, damit Backends sie mit pool getrennt voneinander umsetzen können;
+		// ohne eigene Umsetzung werden sie nacheinander an Execute übergeben.
+		virtual void ExecuteInOrder(const RenderCommandBuffer* const* commands, size_t count, ThreadPool* pool);
+	};
+
+	// Zähler über alle ausgeführten Befehlspuffer seit dem letzten Zurücksetzen.
+	struct RenderCommandStatistics
+	{
+		uint64_t	commands;
+		uint64_t	stateChanges;
+		uint64_t	redundantStateChanges;		// Zustand war bereits so gesetzt
+		uint64_t	constantUploads;
+		uint64_t	constantBytes;
+		uint64_t	bufferUploads;
+		uint64_t	bufferBytes;
+		uint64_t	draws;
+		uint64_t	instances;
+		uint64_t	primitives;				// über alle Instanzen
+		uint64_t	validationErrors;
+	};
+
+	// Backend ohne Grafikgerät: verfolgt den gebundenen Zustand wie ein Gerätekontext, zählt die Befehle
+	// und prüft, ob jeder Zeichenbefehl auf dem Gerät gültig wäre. Damit lässt sich die Aufzeichnung ohne
+	// Direct3D messen und auf Zeichenzahlen prüfen. Der UploadRing liegt im Hauptspeicher; ein Frame gilt
+	// FramesInFlight Frames nach seinem Ende als abgearbeitet, wie bei einer GPU mit dieser Latenz.
+	class NullRenderBackend : public IRenderBackend
+	{
+	public:
+		static const uint32_t FramesInFlight = 2;
+
+		explicit NullRenderBackend(uint32_t uploadCapacity = 1024 * 1024);
+		virtual ~NullRenderBackend();
+
+		virtual void BeginFrame() override;
+		virtual UploadRing& GetUploadRing() override;
+		virtual void Execute(const RenderCommandBuffer& commands) override;
+		virtual void EndFrame() override;
+
+		// Vergisst vor jedem Puffer den Zustand wie ein Direct3D-Backend mit getrennten Befehlslisten, damit
+		// die Prüfung Durchgänge meldet, die sich auf Zustand eines vorigen verlassen.
+		virtual void ExecuteInOrder(const RenderCommandBuffer* const* commands, size_t count, ThreadPool* pool) override;
+
+		const RenderCommandStatistics& GetStatistics() const	{ return m_statistics; }
+		const std::vector<std::string>& GetValidationErrors() const	{ return m_validationErrors; }
+
+		void ResetStatistics();
+
+		// Vergisst den gebundenen Zustand wie ClearState auf einem Gerätekontext.
+		void ResetState();
+
+	private:
+		// Höchstens so viele Fehlermeldungen werden aufbewahrt; gezählt werden alle.
+		static const size_t MaxStoredValidationErrors = 64;
+
+		void CountStateChange(bool redundant);
+		void Fail(const char* message);
+
+		RenderCommandStatistics		m_statistics;
+		std::vector<std::string>	m_validationErrors;
+
+		RenderPipeline	m_pipeline;
+		bool			m_hasPipeline;
+		RenderHandle	m_vertexBuffers[MaxVertexBufferSlots];
+		uint32_t		m_vertexStrides[MaxVertexBufferSlots];
+		uint32_t		m_vertexOffsets[MaxVertexBufferSlots];
+		RenderHandle	m_indexBuffer;
+		IndexFormat		m_indexFormat;
+		uint32_t		m_indexOffset;
+		RenderHandle	m_vertexConstantBuffers[MaxConstantBufferSlots];
+		RenderHandle	m_pixelConstantBuffers[MaxConstantBufferSlots];
+		uint32_t		m_vertexConstantOffsets[MaxConstantBufferSlots];
+		uint32_t		m_pixelConstantOffsets[MaxConstantBufferSlots];
+		RenderHandle	m_vertexShaderResources[MaxShaderResourceSlots];
+		RenderHandle	m_pixelShaderResources[MaxShaderResourceSlots];
+
+		std::vector<uint8_t>		m_uploadMemory;
+		std::unique_ptr<UploadRing>	m_uploadRing;
+		uint64_t					m_frame;
+	};
+}
@@ -0,0 +1,65 @@
+﻿#include "RenderPassRecorder.h"
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace DX;
+
+uint32_t RenderPassRecorder::AddPass(const char* name, const RecordFunction& record)
+{
+	Pass pass;
+	pass.name = name;
+	pass.record = record;
+	pass.statistics = RenderPassStatistics();
+	m_passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void RenderPassRecorder::RecordPass(Pass& pass, UploadRing& uploads)
+{
+	int64_t start = Profiler::Now();
+	pass.commands.Reset();
+	pass.record(pass.commands, uploads);
+	int64_t end = Profiler::Now();
+
+#if DX_PROFILER_ENABLED
+	Profiler::Get().Record(pass.name, start, end);
+#endif
+
+	pass.statistics.commands = pass.commands.GetCommandCount();
+	pass.statistics.bytes = pass.commands.GetSize();
+	pass.statistics.recordTicks = end - start;
+}
+
+void RenderPassRecorder::Record(UploadRing& uploads, ThreadPool* pool)
+{
+	DX_PROFILE_ZONE("RenderPassRecorder::Record");
+
+	if (pool && m_passes.size() > 1)
+	{
+		pool->ParallelFor(GetPassCount(), [this, &uploads](uint32_t pass) { RecordPass(m_passes[pass], uploads); });
+	}
+	else
+	{
+		for (Pass& pass : m_passes)
+		{
+			RecordPass(pass, uploads);
+		}
+	}
+}
+
+void RenderPassRecorder::Submit(IRenderBackend& backend, ThreadPool* pool)
+{
+	DX_PROFILE_ZONE("RenderPassRecorder::Submit");
+
+	m_submitList.clear();
+	for (const Pass& pass : m_passes)
+	{
+		if (!pass.commands.IsEmpty())
+		{
+			m_submitList.push_back(&pass.commands);
+		}
+	}
+
+	backend.ExecuteInOrder(m_submitList.data(), m_submitList.size(), pool);
+}
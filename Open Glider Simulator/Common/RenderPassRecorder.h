@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "RenderCommands.h"
+
+namespace DX
+{
+	class ThreadPool;
+	class UploadRing;
+
+	// Zahlen eines Durchgangs aus dem letzten Record.
+	struct RenderPassStatistics
+	{
+		uint32_t	commands;
+		uint64_t	bytes;
+		int64_t		recordTicks;		// Ticks von std::chrono::steady_clock
+	};
+
+	// Zeichnet die Durchgänge eines Frames (Gelände, Szenerie, Flugzeuge, ...) gleichzeitig auf den
+	// Arbeitsthreads auf, jeden in einen eigenen Befehlspuffer, und reicht sie danach in der Reihenfolge
+	// ihrer Anmeldung beim Backend ein. Da Backends die Puffer getrennt umsetzen dürfen, setzt kein
+	// Durchgang Zustand eines anderen voraus, sondern bindet alles selbst, was er braucht. Gemeinsam
+	// verändern die Durchgänge beim Aufzeichnen nur den UploadRing.
+	class RenderPassRecorder
+	{
+	public:
+		typedef std::function<void(RenderCommandBuffer& commands, UploadRing& uploads)> RecordFunction;
+
+		// Der Name muss dauerhaft gültig sein; er erscheint als Profilerzone.
+		uint32_t AddPass(const char* name, const RecordFunction& record);
+		uint32_t GetPassCount() const						{ return static_cast<uint32_t>(m_passes.size()); }
+
+		// Leert alle Puffer und ruft die Durchgänge auf, mit pool nebeneinander, sonst nacheinander.
+		void Record(UploadRing& uploads, ThreadPool* pool);
+
+		// Übergibt die nicht leeren Puffer in Anmeldereihenfolge an das Backend.
+		void Submit(IRenderBackend& backend, ThreadPool* pool);
+
+		const char* GetName(uint32_t pass) const			{ return m_passes[pass].name; }
+		const RenderCommandBuffer& GetCommands(uint32_t pass) const	{ return m_passes[pass].commands; }
+		const RenderPassStatistics& GetStatistics(uint32_t pass) const	{ return m_passes[pass].statistics; }
+
+	private:
+		struct Pass
+		{
+			const char*				name;
+			RecordFunction			record;
+			RenderCommandBuffer		commands;
+			RenderPassStatistics	statistics;
+		};
+
+		void RecordPass(Pass& pass, UploadRing& uploads);
+
+		std::vector<Pass>						m_passes;
+		std::vector<const RenderCommandBuffer*>	m_submitList;
+	};
+}
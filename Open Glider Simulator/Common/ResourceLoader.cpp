@@ -0,0 +1,531 @@
+﻿#include "ResourceLoader.h"
+
+#include <stdexcept>
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace DX;
+
+ResourceLoader::ResourceLoader(ThreadPool& threadPool, uint32_t maxReads, uint32_t maxDecodes, uint32_t staleFrames) :
+	m_threadPool(threadPool),
+	m_maxReads(maxReads),
+	m_maxDecodes(maxDecodes),
+	m_staleFrames(staleFrames),
+	m_nextId(1),
+	m_nextSequence(0),
+	m_frame(0),
+	m_stopping(false),
+	m_statistics()
+{
+	if (maxReads == 0 || maxDecodes == 0)
+	{
+		throw std::invalid_argument("ResourceLoader: at least one read and one decode must be allowed in flight");
+	}
+}
+
+ResourceLoader::~ResourceLoader()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_stopping = true;
+
+	std::vector<ResourceId> ids;
+	ids.reserve(m_entries.size());
+	for (const auto& entry : m_entries)
+	{
+		ids.push_back(entry.first);
+	}
+
+	for (ResourceId id : ids)
+	{
+		CancelLocked(id, ResourceState::Cancelled);
+	}
+
+	// Laufende Stufen greifen noch auf die Einträge zu.
+	m_idle.wait(lock, [this]() { return m_statistics.readsInFlight == 0 && m_statistics.decodesInFlight == 0; });
+}
+
+ResourceId ResourceLoader::Request(const ResourceRequest& request)
+{
+	std::vector<Job> jobs;
+	ResourceId id;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		bool dependencyFailed = false;
+		uint32_t pendingDependencies = 0;
+		for (ResourceId dependency : request.dependencies)
+		{
+			auto found = m_entries.find(dependency);
+			if (found == m_entries.end() || found->second.released)
+			{
+				throw std::invalid_argument("ResourceLoader: unknown dependency");
+			}
+
+			ResourceState state = found->second.state;
+			if (state == ResourceState::Failed || state == ResourceState::Cancelled || found->second.cancelRequested)
+			{
+				dependencyFailed = true;
+			}
+			else if (state != ResourceState::Ready)
+			{
+				pendingDependencies++;
+			}
+		}
+
+		id = m_nextId++;
+		Entry& entry = m_entries[id];
+		entry.request = request;
+		entry.inheritedPriority = request.priority;
+		entry.state = ResourceState::Queued;
+		entry.cancelState = ResourceState::Cancelled;
+		entry.cancelRequested = false;
+		entry.released = false;
+		entry.lastTouch = m_frame;
+		entry.pendingDependencies = pendingDependencies;
+
+		m_statistics.requested++;
+		m_statistics.pending++;
+
+		if (m_stopping)
+		{
+			Finish(id, ResourceState::Cancelled);
+			return id;
+		}
+
+		if (dependencyFailed)
+		{
+			entry.error = std::make_exception_ptr(std::runtime_error("ResourceLoader: dependency failed"));
+			Finish(id, ResourceState::Failed);
+			return id;
+		}
+
+		for (ResourceId dependency : request.dependencies)
+		{
+			Entry& dependencyEntry = m_entries.find(dependency)->second;
+			if (dependencyEntry.state != ResourceState::Ready)
+			{
+				dependencyEntry.dependents.push_back(id);
+			}
+
+			Renew(dependency, request.priority);
+		}
+
+		// Ohne read gibt es nichts zu lesen; die Anforderung wartet gleich auf ihre Abhängigkeiten.
+		if (!entry.request.read)
+		{
+			entry.state = ResourceState::Waiting;
+		}
+
+		Enqueue(id, entry);
+		Dispatch(jobs);
+	}
+
+	Start(jobs);
+	return id;
+}
+
+void ResourceLoader::Touch(ResourceId id, float priority)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_entries.find(id);
+	if (found == m_entries.end())
+	{
+		return;
+	}
+
+	Entry& entry = found->second;
+	float previous = GetPriority(entry);
+	entry.request.priority = priority;
+	entry.lastTouch = m_frame;
+	if (GetPriority(entry) != previous)
+	{
+		Enqueue(id, entry);
+	}
+
+	for (ResourceId dependency : entry.request.dependencies)
+	{
+		Renew(dependency, priority);
+	}
+}
+
+void ResourceLoader::Cancel(ResourceId id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	CancelLocked(id, ResourceState::Cancelled);
+}
+
+void ResourceLoader::Release(ResourceId id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ReleaseLocked(id);
+}
+
+// Ein Eintrag ohne laufende Stufe wird sofort entfernt, sonst von Finish, sobald die Stufe zurückkehrt.
+void ResourceLoader::ReleaseAndWait(ResourceId id)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	ReleaseLocked(id);
+	m_released.wait(lock, [this, id]() { return m_entries.find(id) == m_entries.end(); });
+}
+
+void ResourceLoader::ReleaseLocked(ResourceId id)
+{
+	auto found = m_entries.find(id);
+	if (found == m_entries.end())
+	{
+		return;
+	}
+
+	ResourceState state = found->second.state;
+	if (state == ResourceState::Ready || state == ResourceState::Failed || state == ResourceState::Cancelled)
+	{
+		m_entries.erase(found);
+		return;
+	}
+
+	// Finish entfernt den Eintrag, sobald keine Stufe mehr auf ihn zugreift.
+	found->second.released = true;
+	CancelLocked(id, ResourceState::Cancelled);
+}
+
+void ResourceLoader::Update()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_frame++;
+
+	if (m_frame <= m_staleFrames)
+	{
+		return;
+	}
+
+	std::vector<ResourceId> stale;
+	for (const auto& item : m_entries)
+	{
+		const Entry& entry = item.second;
+		if (!entry.request.streaming || entry.cancelRequested || entry.lastTouch >= m_frame - m_staleFrames ||
+			(entry.state != ResourceState::Queued && entry.state != ResourceState::Waiting))
+		{
+			continue;
+		}
+
+		// Eine nicht verfallende Anforderung hält ihre Abhängigkeiten am Leben.
+		bool needed = false;
+		for (ResourceId dependent : entry.dependents)
+		{
+			auto found = m_entries.find(dependent);
+			if (found != m_entries.end() && !found->second.request.streaming && !found->second.cancelRequested &&
+				found->second.state != ResourceState::Failed && found->second.state != ResourceState::Cancelled)
+			{
+				needed = true;
+				break;
+			}
+		}
+
+		if (!needed)
+		{
+			stale.push_back(item.first);
+		}
+	}
+
+	for (ResourceId id : stale)
+	{
+		CancelLocked(id, ResourceState::Cancelled);
+	}
+}
+
+void ResourceLoader::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_statistics.pending == 0; });
+}
+
+ResourceState ResourceLoader::GetState(ResourceId id) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return GetEntry(id).state;
+}
+
+std::exception_ptr ResourceLoader::GetError(ResourceId id) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return GetEntry(id).error;
+}
+
+ResourceLoaderStatistics ResourceLoader::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_statistics;
+}
+
+const ResourceLoader::Entry& ResourceLoader::GetEntry(ResourceId id) const
+{
+	auto found = m_entries.find(id);
+	if (found == m_entries.end() || found->second.released)
+	{
+		throw std::invalid_argument("ResourceLoader: unknown resource");
+	}
+
+	return found->second;
+}
+
+// Die Warteschlangen werden nicht umsortiert: bei einer Prioritätsänderung kommt ein weiterer Eintrag hinzu,
+// und Dispatch verwirft alle, deren Priorität oder Zustand nicht mehr stimmt.
+void ResourceLoader::Enqueue(ResourceId id, Entry& entry)
+{
+	if (entry.cancelRequested)
+	{
+		return;
+	}
+
+	QueueItem item = { GetPriority(entry), m_nextSequence++, id };
+	if (entry.state == ResourceState::Queued)
+	{
+		m_readQueue.push(item);
+	}
+	else if (entry.state == ResourceState::Waiting && entry.pendingDependencies == 0)
+	{
+		m_decodeQueue.push(item);
+	}
+}
+
+void ResourceLoader::Renew(ResourceId id, float priority)
+{
+	auto found = m_entries.find(id);
+	if (found == m_entries.end())
+	{
+		return;
+	}
+
+	Entry& entry = found->second;
+	entry.lastTouch = m_frame;
+	if (priority > entry.inheritedPriority)
+	{
+		float previous = GetPriority(entry);
+		entry.inheritedPriority = priority;
+		if (GetPriority(entry) != previous)
+		{
+			Enqueue(id, entry);
+		}
+	}
+
+	for (ResourceId dependency : entry.request.dependencies)
+	{
+		Renew(dependency, priority);
+	}
+}
+
+void ResourceLoader::CancelLocked(ResourceId id, ResourceState state)
+{
+	auto found = m_entries.find(id);
+	if (found == m_entries.end())
+	{
+		return;
+	}
+
+	Entry& entry = found->second;
+	if (entry.cancelRequested || entry.state == ResourceState::Ready || entry.state == ResourceState::Failed ||
+		entry.state == ResourceState::Cancelled)
+	{
+		return;
+	}
+
+	if (entry.state == ResourceState::Loading || entry.state == ResourceState::Decoding)
+	{
+		// Die laufende Stufe beendet die Anforderung, sobald sie zurückkehrt.
+		entry.cancelRequested = true;
+		entry.cancelState = state;
+	}
+	else
+	{
+		Finish(id, state);
+	}
+}
+
+void ResourceLoader::Finish(ResourceId id, ResourceState state)
+{
+	Entry& entry = m_entries.find(id)->second;
+	entry.state = state;
+	entry.data = AssetData();
+
+	std::vector<ResourceId> dependents;
+	dependents.swap(entry.dependents);
+
+	switch (state)
+	{
+	case ResourceState::Ready:		m_statistics.completed++;	break;
+	case ResourceState::Failed:		m_statistics.failed++;		break;
+	default:						m_statistics.cancelled++;	break;
+	}
+
+	m_statistics.pending--;
+	if (entry.released)
+	{
+		m_entries.erase(id);
+		m_released.notify_all();
+	}
+
+	for (ResourceId dependent : dependents)
+	{
+		auto found = m_entries.find(dependent);
+		if (found == m_entries.end())
+		{
+			continue;
+		}
+
+		Entry& dependentEntry = found->second;
+		if (state == ResourceState::Ready)
+		{
+			dependentEntry.pendingDependencies--;
+			Enqueue(dependent, dependentEntry);
+		}
+		else if (!dependentEntry.cancelRequested && !dependentEntry.error &&
+			dependentEntry.state != ResourceState::Ready && dependentEntry.state != ResourceState::Failed &&
+			dependentEntry.state != ResourceState::Cancelled)
+		{
+			dependentEntry.error = std::make_exception_ptr(std::runtime_error("ResourceLoader: dependency failed"));
+			CancelLocked(dependent, ResourceState::Failed);
+		}
+	}
+
+	if (m_statistics.pending == 0 || (m_stopping && m_statistics.readsInFlight == 0 && m_statistics.decodesInFlight == 0))
+	{
+		m_idle.notify_all();
+	}
+}
+
+// Entnimmt so viele Anforderungen, wie die Grenzen zulassen. Gestartet werden sie erst nach dem Entsperren.
+void ResourceLoader::Dispatch(std::vector<Job>& jobs)
+{
+	if (m_stopping)
+	{
+		return;
+	}
+
+	while (m_statistics.readsInFlight < m_maxReads && !m_readQueue.empty())
+	{
+		QueueItem item = m_readQueue.top();
+		m_readQueue.pop();
+
+		auto found = m_entries.find(item.id);
+		if (found == m_entries.end() || found->second.state != ResourceState::Queued || found->second.cancelRequested ||
+			GetPriority(found->second) != item.priority)
+		{
+			continue;
+		}
+
+		found->second.state = ResourceState::Loading;
+		m_statistics.readsInFlight++;
+		m_statistics.peakReadsInFlight = (std::max)(m_statistics.peakReadsInFlight, m_statistics.readsInFlight);
+
+		Job job = { false, item.id, &found->second };
+		jobs.push_back(job);
+	}
+
+	while (m_statistics.decodesInFlight < m_maxDecodes && !m_decodeQueue.empty())
+	{
+		QueueItem item = m_decodeQueue.top();
+		m_decodeQueue.pop();
+
+		auto found = m_entries.find(item.id);
+		if (found == m_entries.end() || found->second.state != ResourceState::Waiting || found->second.cancelRequested ||
+			found->second.pendingDependencies != 0 || GetPriority(found->second) != item.priority)
+		{
+			continue;
+		}
+
+		found->second.state = ResourceState::Decoding;
+		m_statistics.decodesInFlight++;
+		m_statistics.peakDecodesInFlight = (std::max)(m_statistics.peakDecodesInFlight, m_statistics.decodesInFlight);
+
+		Job job = { true, item.id, &found->second };
+		jobs.push_back(job);
+	}
+}
+
+void ResourceLoader::Start(const std::vector<Job>& jobs)
+{
+	for (const Job& job : jobs)
+	{
+		m_threadPool.Submit([this, job]() { Run(job); });
+	}
+}
+
+// Die Stufe selbst läuft ohne Sperre. Der Eintrag bleibt gültig, weil weder Release noch der Destruktor
+// ihn entfernen, solange eine Stufe läuft, und die Knoten der Tabelle beim Einfügen nicht wandern.
+void ResourceLoader::Run(const Job& job)
+{
+	Entry& entry = *job.entry;
+	AssetData data;
+	std::exception_ptr error;
+	int64_t start = Profiler::Now();
+
+	try
+	{
+		if (job.decode)
+		{
+			if (entry.request.decode)
+			{
+				entry.request.decode(entry.data);
+			}
+		}
+		else
+		{
+			data = entry.request.read();
+		}
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+#if DX_PROFILER_ENABLED
+	Profiler::Get().Record(job.decode ? "ResourceLoader::Decode" : "ResourceLoader::Read", start, Profiler::Now());
+#else
+	(void)start;
+#endif
+
+	std::vector<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (job.decode)
+		{
+			m_statistics.decodesInFlight--;
+		}
+		else
+		{
+			m_statistics.readsInFlight--;
+		}
+
+		if (entry.cancelRequested)
+		{
+			Finish(job.id, entry.cancelState);
+		}
+		else if (error)
+		{
+			entry.error = error;
+			Finish(job.id, ResourceState::Failed);
+		}
+		else if (job.decode)
+		{
+			Finish(job.id, ResourceState::Ready);
+		}
+		else
+		{
+			m_statistics.bytesRead += data.GetSize();
+			entry.data = std::move(data);
+			entry.state = ResourceState::Waiting;
+			Enqueue(job.id, entry);
+		}
+
+		Dispatch(jobs);
+
+		if (m_stopping && m_statistics.readsInFlight == 0 && m_statistics.decodesInFlight == 0)
+		{
+			m_idle.notify_all();
+		}
+	}
+
+	Start(jobs);
+}
@@ -0,0 +1,168 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "AssetPack.h"
+
+namespace DX
+{
+	class ThreadPool;
+
+	// Eindeutig über die Lebensdauer des Laders; 0 steht für keine Ressource.
+	typedef uint64_t ResourceId;
+
+	enum class ResourceState : uint32_t
+	{
+		Queued,			// wartet auf einen Platz zum Lesen
+		Loading,
+		Waiting,		// gelesen, wartet auf Abhängigkeiten oder einen Platz zum Aufbereiten
+		Decoding,
+		Ready,
+		Failed,			// Ausnahme in read oder decode oder in einer Abhängigkeit
+		Cancelled,
+	};
+
+	struct ResourceRequest
+	{
+		float									priority;		// größere Werte zuerst
+		bool									streaming;		// verfällt, wenn Touch sie länger nicht erneuert
+		std::vector<ResourceId>					dependencies;	// müssen fertig sein, bevor decode beginnt
+		std::function<AssetData()>				read;			// E/A, darf fehlen
+		std::function<void(const AssetData&)>	decode;			// Aufbereitung, etwa Geräteobjekte erstellen; darf fehlen
+	};
+
+	struct ResourceLoaderStatistics
+	{
+		uint64_t	requested;
+		uint64_t	completed;
+		uint64_t	failed;
+		uint64_t	cancelled;
+		uint64_t	bytesRead;
+		uint32_t	pending;				// weder fertig noch abgebrochen
+		uint32_t	readsInFlight;
+		uint32_t	decodesInFlight;
+		uint32_t	peakReadsInFlight;
+		uint32_t	peakDecodesInFlight;
+	};
+
+	// Lädt Ressourcen auf den Arbeitsthreads in zwei Stufen: read liest die Daten, decode bereitet sie auf.
+	// Beide Stufen sind getrennt begrenzt, damit viele Lesevorgänge weder die Platte überlasten noch alle
+	// Arbeitsthreads belegen; innerhalb einer Stufe beginnt die Anforderung mit der höchsten Priorität zuerst.
+	// Eine Abhängigkeit erbt die höchste Priorität der Anforderungen, die auf sie warten. decode beginnt erst,
+	// wenn alle Abhängigkeiten fertig sind; scheitert eine, scheitert auch die abhängige Anforderung.
+	// Streaming-Anforderungen, die länger als staleFrames Aufrufe von Update nicht erneuert wurden, werden
+	// abgebrochen, solange sie noch nicht laufen. Laufende Stufen werden nicht unterbrochen; ihr Ergebnis
+	// wird nach einem Abbruch verworfen. Alle Methoden sind von beliebigen Threads aus aufrufbar.
+	class ResourceLoader
+	{
+	public:
+		ResourceLoader(ThreadPool& threadPool, uint32_t maxReads, uint32_t maxDecodes, uint32_t staleFrames);
+
+		// Bricht alles Wartende ab und wartet auf die laufenden Stufen.
+		~ResourceLoader();
+
+		// Wirft std::invalid_argument für unbekannte Abhängigkeiten.
+		ResourceId Request(const ResourceRequest& request);
+
+		// Erneuert eine Streaming-Anforderung samt ihrer Abhängigkeiten und setzt ihre Priorität.
+		void Touch(ResourceId id, float priority);
+		void Cancel(ResourceId id);
+
+		// Bricht ab, falls nötig, und vergisst die Ressource. Abhängige Anforderungen scheitern, wenn sie
+		// noch nicht fertig waren.
+		void Release(ResourceId id);
+
+		// Wie Release, kehrt aber erst zurück, wenn keine Stufe der Ressource mehr läuft. Danach schreibt decode
+		// nicht mehr in Objekte des Aufrufers, die dieser gleich zurücksetzen will. Nicht aus read oder decode
+		// heraus aufrufen.
+		void ReleaseAndWait(ResourceId id);
+
+		// Einmal je Frame: bricht verfallene Streaming-Anforderungen ab.
+		void Update();
+
+		// Blockiert, bis keine Anforderung mehr aussteht.
+		void WaitIdle();
+
+		// Wirft std::invalid_argument für unbekannte oder freigegebene Ressourcen.
+		ResourceState GetState(ResourceId id) const;
+		bool IsReady(ResourceId id) const					{ return GetState(id) == ResourceState::Ready; }
+		std::exception_ptr GetError(ResourceId id) const;
+
+		ResourceLoaderStatistics GetStatistics() const;
+
+	private:
+		struct Entry
+		{
+			ResourceRequest			request;
+			float					inheritedPriority;
+			ResourceState			state;
+			ResourceState			cancelState;		// Endzustand einer laufenden Stufe nach einem Abbruch
+			bool					cancelRequested;
+			bool					released;
+			uint64_t				lastTouch;
+			uint32_t				pendingDependencies;
+			std::vector<ResourceId>	dependents;
+			AssetData				data;
+			std::exception_ptr		error;
+		};
+
+		struct QueueItem
+		{
+			float		priority;
+			uint64_t	sequence;
+			ResourceId	id;
+
+			// Höhere Priorität zuerst, bei gleicher die ältere Anforderung.
+			bool operator<(const QueueItem& other) const
+			{
+				return priority < other.priority || (priority == other.priority && sequence > other.sequence);
+			}
+		};
+
+		struct Job
+		{
+			bool		decode;
+			ResourceId	id;
+			Entry*		entry;
+		};
+
+		ResourceLoader(const ResourceLoader&);
+		ResourceLoader& operator=(const ResourceLoader&);
+
+		static float GetPriority(const Entry& entry)		{ return (std::max)(entry.request.priority, entry.inheritedPriority); }
+
+		const Entry& GetEntry(ResourceId id) const;
+		void Enqueue(ResourceId id, Entry& entry);
+		void Renew(ResourceId id, float priority);
+		void CancelLocked(ResourceId id, ResourceState state);
+		void ReleaseLocked(ResourceId id);
+		void Finish(ResourceId id, ResourceState state);
+		void Dispatch(std::vector<Job>& jobs);
+		void Start(const std::vector<Job>& jobs);
+		void Run(const Job& job);
+
+		ThreadPool&								m_threadPool;
+		uint32_t								m_maxReads;
+		uint32_t								m_maxDecodes;
+		uint32_t								m_staleFrames;
+
+		mutable std::mutex						m_mutex;
+		std::condition_variable					m_idle;
+		std::condition_variable					m_released;		// ein freigegebener Eintrag wurde entfernt
+		std::unordered_map<ResourceId, Entry>	m_entries;
+		std::priority_queue<QueueItem>			m_readQueue;
+		std::priority_queue<QueueItem>			m_decodeQueue;
+		ResourceId								m_nextId;
+		uint64_t								m_nextSequence;
+		uint64_t								m_frame;
+		bool									m_stopping;
+		ResourceLoaderStatistics				m_statistics;
+	};
+}
@@ -0,0 +1,231 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define DX_SIMD_SSE 1
+#include <emmintrin.h>
+#else
+#define DX_SIMD_SSE 0
+#endif
+
+namespace DX
+{
+	namespace Simd
+	{
+		// Vier Gleitkommazahlen, die gemeinsam verarbeitet werden. Auf x86/x64 wird SSE2 verwendet,
+		// auf anderen Plattformen (ARM) eine skalare Umsetzung mit identischer Schnittstelle.
+		// Vergleiche liefern Masken, in denen alle Bits eines Elements gesetzt oder gelöscht sind.
+#if DX_SIMD_SSE
+		struct Vec4
+		{
+			__m128 v;
+		};
+
+		inline Vec4 Make(__m128 v)							{ Vec4 r; r.v = v; return r; }
+		inline Vec4 Set(float x)							{ return Make(_mm_set1_ps(x)); }
+		inline Vec4 Set(float x, float y, float z, float w)	{ return Make(_mm_setr_ps(x, y, z, w)); }
+		inline Vec4 Zero()									{ return Make(_mm_setzero_ps()); }
+		inline Vec4 Load(const float* p)					{ return Make(_mm_load_ps(p)); }
+		inline Vec4 LoadUnaligned(const float* p)			{ return Make(_mm_loadu_ps(p)); }
+		inline void Store(float* p, Vec4 a)					{ _mm_store_ps(p, a.v); }
+		inline void StoreUnaligned(float* p, Vec4 a)		{ _mm_storeu_ps(p, a.v); }
+
+		inline Vec4 operator+(Vec4 a, Vec4 b)				{ return Make(_mm_add_ps(a.v, b.v)); }
+		inline Vec4 operator-(Vec4 a, Vec4 b)				{ return Make(_mm_sub_ps(a.v, b.v)); }
+		inline Vec4 operator*(Vec4 a, Vec4 b)				{ return Make(_mm_mul_ps(a.v, b.v)); }
+		inline Vec4 operator/(Vec4 a, Vec4 b)				{ return Make(_mm_div_ps(a.v, b.v)); }
+		inline Vec4 operator-(Vec4 a)						{ return Make(_mm_sub_ps(_mm_setzero_ps(), a.v)); }
+
+		inline Vec4 Min(Vec4 a, Vec4 b)						{ return Make(_mm_min_ps(a.v, b.v)); }
+		inline Vec4 Max(Vec4 a, Vec4 b)						{ return Make(_mm_max_ps(a.v, b.v)); }
+		inline Vec4 Sqrt(Vec4 a)							{ return Make(_mm_sqrt_ps(a.v)); }
+		inline Vec4 Abs(Vec4 a)								{ return Make(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+
+		inline Vec4 Less(Vec4 a, Vec4 b)					{ return Make(_mm_cmplt_ps(a.v, b.v)); }
+		inline Vec4 LessEqual(Vec4 a, Vec4 b)				{ return Make(_mm_cmple_ps(a.v, b.v)); }
+		inline Vec4 Greater(Vec4 a, Vec4 b)					{ return Make(_mm_cmpgt_ps(a.v, b.v)); }
+		inline Vec4 GreaterEqual(Vec4 a, Vec4 b)			{ return Make(_mm_cmpge_ps(a.v, b.v)); }
+		inline Vec4 And(Vec4 a, Vec4 b)						{ return Make(_mm_and_ps(a.v, b.v)); }
+		inline Vec4 Or(Vec4 a, Vec4 b)						{ return Make(_mm_or_ps(a.v, b.v)); }
+		inline Vec4 AndNot(Vec4 mask, Vec4 a)				{ return Make(_mm_andnot_ps(mask.v, a.v)); }
+		inline int MoveMask(Vec4 mask)						{ return _mm_movemask_ps(mask.v); }
+
+		// Wählt elementweise a, wo die Maske gesetzt ist, sonst b.
+		inline Vec4 Select(Vec4 mask, Vec4 a, Vec4 b)		{ return Make(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))); }
+
+		// Abrunden ohne SSE4.1: abschneiden und bei negativen Nachkommastellen um eins verringern.
+		inline Vec4 Floor(Vec4 a)
+		{
+			__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+			__m128 correction = _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f));
+			return Make(_mm_sub_ps(truncated, correction));
+		}
+
+		// Abschneiden zur Ganzzahl und elementweise speichern.
+		inline void StoreInt(int32_t* p, Vec4 a)			{ _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(a.v)); }
+
+		// Vier vorzeichenbehaftete 16-Bit-Werte laden und in Gleitkommazahlen wandeln (z. B. quantisierte Daten).
+		inline Vec4 LoadInt16(const int16_t* p)
+		{
+			__m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+			return Make(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16)));
+		}
+#else
+		struct Vec4
+		{
+			float v[4];
+		};
+
+		inline Vec4 Set(float x)							{ Vec4 r = { { x, x, x, x } }; return r; }
+		inline Vec4 Set(float x, float y, float z, float w)	{ Vec4 r = { { x, y, z, w } }; return r; }
+		inline Vec4 Zero()									{ return Set(0.0f); }
+		inline Vec4 Load(const float* p)					{ Vec4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+		inline Vec4 LoadUnaligned(const float* p)			{ return Load(p); }
+		inline void Store(float* p, Vec4 a)					{ std::memcpy(p, a.v, sizeof(a.v)); }
+		inline void StoreUnaligned(float* p, Vec4 a)		{ Store(p, a); }
+
+		template<typename TOperation>
+		inline Vec4 Map(Vec4 a, Vec4 b, TOperation operation)
+		{
+			Vec4 r;
+			for (int i = 0; i < 4; i++)
+			{
+				r.v[i] = operation(a.v[i], b.v[i]);
+			}
+			return r;
+		}
+
+		inline float MaskValue(bool set)					{ uint32_t bits = set ? 0xffffffffu : 0u; float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+		inline uint32_t Bits(float f)						{ uint32_t bits; std::memcpy(&bits, &f, sizeof(bits)); return bits; }
+		inline float FromBits(uint32_t bits)				{ float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+
+		inline Vec4 operator+(Vec4 a, Vec4 b)				{ return Map(a, b, [](float x, float y) { return x + y; }); }
+		inline Vec4 operator-(Vec4 a, Vec4 b)				{ return Map(a, b, [](float x, float y) { return x - y; }); }
+		inline Vec4 operator*(Vec4 a, Vec4 b)				{ return Map(a, b, [](float x, float y) { return x * y; }); }
+		inline Vec4 operator/(Vec4 a, Vec4 b)				{ return Map(a, b, [](float x, float y) { return x / y; }); }
+		inline Vec4 operator-(Vec4 a)						{ return Zero() - a; }
+
+		inline Vec4 Min(Vec4 a, Vec4 b)						{ return Map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+		inline Vec4 Max(Vec4 a, Vec4 b)						{ return Map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+		inline Vec4 Sqrt(Vec4 a)							{ return Map(a, a, [](float x, float) { return std::sqrt(x); }); }
+		inline Vec4 Abs(Vec4 a)								{ return Map(a, a, [](float x, float) { return std::fabs(x); }); }
+
+		inline Vec4 Less(Vec4 a, Vec4 b)					{ return Map(a, b, [](float x, float y) { return MaskValue(x < y); }); }
+		inline Vec4 LessEqual(Vec4 a, Vec4 b)				{ return Map(a, b, [](float x, float y) { return MaskValue(x <= y); }); }
+		inline Vec4 Greater(Vec4 a, Vec4 b)					{ return Map(a, b, [](float x, float y) { return MaskValue(x > y); }); }
+		inline Vec4 GreaterEqual(Vec4 a, Vec4 b)			{ return Map(a, b, [](float x, float y) { return MaskValue(x >= y); }); }
+		inline Vec4 And(Vec4 a, Vec4 b)						{ return Map(a, b, [](float x, float y) { return FromBits(Bits(x) & Bits(y)); }); }
+		inline Vec4 Or(Vec4 a, Vec4 b)						{ return Map(a, b, [](float x, float y) { return FromBits(Bits(x) | Bits(y)); }); }
+		inline Vec4 AndNot(Vec4 mask, Vec4 a)				{ return Map(mask, a, [](float x, float y) { return FromBits(~Bits(x) & Bits(y)); }); }
+
+		inline int MoveMask(Vec4 mask)
+		{
+			int result = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				result |= static_cast<int>(Bits(mask.v[i]) >> 31) << i;
+			}
+			return result;
+		}
+
+		inline Vec4 Select(Vec4 mask, Vec4 a, Vec4 b)		{ return Or(And(mask, a), AndNot(mask, b)); }
+		inline Vec4 Floor(Vec4 a)							{ return Map(a, a, [](float x, float) { return std::floor(x); }); }
+
+		inline void StoreInt(int32_t* p, Vec4 a)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				p[i] = static_cast<int32_t>(a.v[i]);
+			}
+		}
+
+		inline Vec4 LoadInt16(const int16_t* p)				{ return Set(p[0], p[1], p[2], p[3]); }
+#endif
+
+		inline Vec4& operator+=(Vec4& a, Vec4 b)			{ a = a + b; return a; }
+		inline Vec4& operator-=(Vec4& a, Vec4 b)			{ a = a - b; return a; }
+		inline Vec4& operator*=(Vec4& a, Vec4 b)			{ a = a * b; return a; }
+
+		inline Vec4 MultiplyAdd(Vec4 a, Vec4 b, Vec4 c)		{ return a * b + c; }
+		inline Vec4 Clamp(Vec4 a, Vec4 low, Vec4 high)		{ return Min(Max(a, low), high); }
+		inline Vec4 Lerp(Vec4 a, Vec4 b, Vec4 t)			{ return a + (b - a) * t; }
+
+		// Arkustangens für |z| <= 1 als Minimax-Polynom (Fehler unter 1e-5 rad).
+		inline Vec4 AtanUnit(Vec4 z)
+		{
+			Vec4 z2 = z * z;
+			Vec4 p = Set(-0.01172120f);
+			p = MultiplyAdd(p, z2, Set(0.05265332f));
+			p = MultiplyAdd(p, z2, Set(-0.11643287f));
+			p = MultiplyAdd(p, z2, Set(0.19354346f));
+			p = MultiplyAdd(p, z2, Set(-0.33262347f));
+			p = MultiplyAdd(p, z2, Set(0.99997726f));
+			return p * z;
+		}
+
+		// Vierquadranten-Arkustangens wie std::atan2.
+		inline Vec4 Atan2(Vec4 y, Vec4 x)
+		{
+			const float halfPi = 1.57079632679f;
+			const float pi = 3.14159265359f;
+
+			Vec4 absX = Abs(x);
+			Vec4 absY = Abs(y);
+			Vec4 numerator = Min(absX, absY);
+			Vec4 denominator = Max(absX, absY);
+			Vec4 ratio = Select(Greater(denominator, Zero()), numerator / Max(denominator, Set(1e-30f)), Zero());
+
+			Vec4 angle = AtanUnit(ratio);
+			angle = Select(Greater(absY, absX), Set(halfPi) - angle, angle);
+			angle = Select(Less(x, Zero()), Set(pi) - angle, angle);
+			return Select(Less(y, Zero()), -angle, angle);
+		}
+
+		// Elemente paarweise horizontal addieren.
+		inline float HorizontalSum(Vec4 a)
+		{
+			float values[4];
+			StoreUnaligned(values, a);
+			return (values[0] + values[1]) + (values[2] + values[3]);
+		}
+
+		// Behandelt denormalisierte Zahlen im Gültigkeitsbereich als null (FTZ und DAZ) und stellt danach den
+		// vorherigen Modus wieder her. Abklingende Größen wie Drehraten am Boden erreichen sonst den
+		// Mikrocode-Pfad der SSE-Einheit, der jede Operation um ein Vielfaches verlangsamt. Der Modus gilt
+		// je Thread; auf anderen Plattformen bleibt er unverändert.
+		class FlushDenormals
+		{
+		public:
+#if DX_SIMD_SSE
+			FlushDenormals() :
+				m_previous(_mm_getcsr())
+			{
+				_mm_setcsr(m_previous | FlushToZero | DenormalsAreZero);
+			}
+
+			~FlushDenormals()
+			{
+				_mm_setcsr(m_previous);
+			}
+#else
+			FlushDenormals()
+			{
+			}
+#endif
+
+		private:
+			FlushDenormals(const FlushDenormals&);
+			FlushDenormals& operator=(const FlushDenormals&);
+
+#if DX_SIMD_SSE
+			static const uint32_t FlushToZero = 0x8000;
+			static const uint32_t DenormalsAreZero = 0x0040;
+
+			uint32_t	m_previous;
+#endif
+		};
+	}
+}
@@ -1,6 +1,9 @@
 ﻿#pragma once
 
-#include <wrl.h>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include "Clock.h"
 
 namespace DX
 {
@@ -8,57 +11,98 @@ namespace DX
 	class StepTimer
 	{
 	public:
-		StepTimer() : 
+
+		StepTimer() :
+			StepTimer(std::make_shared<SteadyClock>())
+		{
+		}
+
+		// Den Timer mit einer bestimmten Zeitquelle betreiben, z. B. einer ManualClock für Läufe ohne Fenster.
+		explicit StepTimer(const std::shared_ptr<IClock>& clock) :
+			m_clock(clock),
 			m_elapsedTicks(0),
 			m_totalTicks(0),
 			m_leftOverTicks(0),
+			m_droppedTicks(0),
 			m_frameCount(0),
 			m_framesPerSecond(0),
 			m_framesThisSecond(0),
-			m_qpcSecondCounter(0),
+			m_updatesThisTick(0),
+			m_secondCounter(0),
 			m_isFixedTimeStep(false),
-			m_targetElapsedTicks(TicksPerSecond / 60)
+			m_targetElapsedTicks(TicksPerSecond / 60),
+			m_maxUpdatesPerTick(0)
 		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_lastTime = m_clock->GetTicks();
 
 			// Max. Differenz auf 1/10 einer Sekunde initialisieren.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_maxDelta = TicksPerSecond / 10;
 		}
 
+		// Die Zeitquelle austauschen. Die Zeitmessung beginnt danach neu.
+		void SetClock(const std::shared_ptr<IClock>& clock)
+		{
+			m_clock = clock;
+			ResetElapsedTime();
+		}
+
+		const std::shared_ptr<IClock>& GetClock() const		{ return m_clock; }
+
+		// Ungewöhnlich große Zeitunterschiede pro Tick werden auf diesen Wert begrenzt.
+		void SetMaxDeltaTicks(uint64_t maxDelta)			{ m_maxDelta = maxDelta; }
+
 		// Verstrichene Zeit seit dem vorherigen Update-Aufruf.
-		uint64 GetElapsedTicks() const						{ return m_elapsedTicks; }
+		uint64_t GetElapsedTicks() const						{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
 
 		// Gesamtzeit seit dem Programmstart abrufen.
-		uint64 GetTotalTicks() const						{ return m_totalTicks; }
+		uint64_t GetTotalTicks() const						{ return m_totalTicks; }
 		double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
 		// Gesamtzahl an Aktualisierungen seit dem Programmstart abrufen.
-		uint32 GetFrameCount() const						{ return m_frameCount; }
+		uint32_t GetFrameCount() const						{ return m_frameCount; }
 
 		// Die aktuelle Framerate abrufen.
-		uint32 GetFramesPerSecond() const					{ return m_framesPerSecond; }
+		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
+
+		// Anzahl der Update-Aufrufe im letzten Tick-Aufruf.
+		uint32_t GetUpdatesThisTick() const					{ return m_updatesThisTick; }
+
+		// Zeit, die wegen des Aufholbudgets verworfen wurde, seit dem Programmstart.
+		uint64_t GetDroppedTicks() const						{ return m_droppedTicks; }
+		double GetDroppedSeconds() const					{ return TicksToSeconds(m_droppedTicks); }
+
+		// Im festen Zeitschrittmodus der Anteil eines Schritts, der noch nicht simuliert wurde (0 bis < 1).
+		// Der Renderer interpoliert damit zwischen den letzten beiden Simulationszuständen.
+		// Im variablen Zeitschrittmodus ist der zuletzt simulierte Zustand immer aktuell.
+		double GetInterpolationAlpha() const
+		{
+			if (!m_isFixedTimeStep || m_targetElapsedTicks == 0)
+			{
+				return 1.0;
+			}
+
+			return static_cast<double>(m_leftOverTicks) / m_targetElapsedTicks;
+		}
 
 		// Festlegen, ob der feste oder variable Zeitschrittmodus verwendet wird.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
 		// Im festen Zeitschrittmodus festlegen, wie oft Update aufgerufen werden soll.
-		void SetTargetElapsedTicks(uint64 targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
+		void SetTargetElapsedTicks(uint64_t targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
 		void SetTargetElapsedSeconds(double targetElapsed)	{ m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
+		uint64_t GetTargetElapsedTicks() const				{ return m_targetElapsedTicks; }
+
+		// Im festen Zeitschrittmodus die maximale Anzahl an Update-Aufrufen pro Tick festlegen (0 = unbegrenzt).
+		// Kann die Simulation nicht Schritt halten, wird die überzählige Zeit verworfen, statt
+		// in den folgenden Frames immer mehr Aufholschritte auszuführen.
+		void SetMaxUpdatesPerTick(uint32_t maxUpdates)		{ m_maxUpdatesPerTick = maxUpdates; }
 
 		// Ganzzahliges Format stellt die Zeit in 10.000.000 Takten pro Sekunde dar.
-		static const uint64 TicksPerSecond = 10000000;
+		static const uint64_t TicksPerSecond = IClock::TicksPerSecond;
 
-		static double TicksToSeconds(uint64 ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
-		static uint64 SecondsToTicks(double seconds)		{ return static_cast<uint64>(seconds * TicksPerSecond); }
+		static double TicksToSeconds(uint64_t ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
+		static uint64_t SecondsToTicks(double seconds)		{ return static_cast<uint64_t>(seconds * TicksPerSecond); }
 
 		// Nach einer absichtlichen Zeitsteuerungsdiskontinuität (z. B. ein blockierender EA-Vorgang)
 		// Dies aufrufen, um zu vermeiden, dass die feste Zeitschrittlogik versucht, einen Satz von aufholenden 
@@ -66,45 +110,42 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_lastTime = m_clock->GetTicks();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
 			m_framesThisSecond = 0;
-			m_qpcSecondCounter = 0;
+			m_secondCounter = 0;
 		}
 
 		// Timerzustand aktualisieren, dabei die angegebene Aktualisierungsfunktion entsprechend häufig aufrufen.
 		template<typename TUpdate>
 		void Tick(const TUpdate& update)
 		{
-			// Die aktuelle Uhrzeit abfragen.
-			LARGE_INTEGER currentTime;
+			// Die aktuelle Uhrzeit abfragen. Die Zeitquelle liefert bereits das kanonische Taktformat.
+			uint64_t currentTime = m_clock->GetTicks();
+			uint64_t timeDelta = currentTime - m_lastTime;
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			uint64 timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
+			m_lastTime = currentTime;
 
-			m_qpcLastTime = currentTime;
-			m_qpcSecondCounter += timeDelta;
-
-			// Ungewöhnlich große Zeitunterschiede binden (z. B. nach Anhalten im Debugger).
-			if (timeDelta > m_qpcMaxDelta)
+			// Ungewöhnlich große Zeitunterschiede binden (z. B. nach Anhalten im Debugger).
+			if (timeDelta > m_maxDelta)
 			{
-				timeDelta = m_qpcMaxDelta;
+				timeDelta = m_maxDelta;
 			}
 
-			// QPC-Einheiten in ein kanonisches Taktformat umwandeln. Ein Überlaufen ist aufgrund des vorherigen Clamps nicht möglich.
-			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
+			Advance(timeDelta, update);
+		}
+
+		// Timerzustand um eine vorgegebene Zeitspanne im kanonischen Taktformat fortschreiben.
+		// Wird von Tick verwendet und erlaubt es, den Timer mit einer synthetischen Uhr zu betreiben.
+		template<typename TUpdate>
+		void Advance(uint64_t timeDelta, const TUpdate& update)
+		{
+			m_secondCounter += timeDelta;
 
-			uint32 lastFrameCount = m_frameCount;
+			uint32_t lastFrameCount = m_frameCount;
+			m_updatesThisTick = 0;
 
 			if (m_isFixedTimeStep)
 			{
@@ -117,7 +158,7 @@ namespace DX
 				// sammelt genug winzige Fehler, dass dadurch ein Frame abgelegt würde. Besser wäre ein Runden 
 				// kleine Abweichungen auf Null, um die Dinge ruhig laufen zu lassen.
 
-				if (abs(static_cast<int64>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
+				if (std::llabs(static_cast<int64_t>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
 				{
 					timeDelta = m_targetElapsedTicks;
 				}
@@ -126,10 +167,20 @@ namespace DX
 
 				while (m_leftOverTicks >= m_targetElapsedTicks)
 				{
+					// Aufholbudget erschöpft: ganze Schritte verwerfen, den Bruchteil für die Interpolation behalten.
+					if (m_maxUpdatesPerTick != 0 && m_updatesThisTick >= m_maxUpdatesPerTick)
+					{
+						uint64_t droppedTicks = m_leftOverTicks - m_leftOverTicks % m_targetElapsedTicks;
+						m_droppedTicks += droppedTicks;
+						m_leftOverTicks -= droppedTicks;
+						break;
+					}
+
 					m_elapsedTicks = m_targetElapsedTicks;
 					m_totalTicks += m_targetElapsedTicks;
 					m_leftOverTicks -= m_targetElapsedTicks;
 					m_frameCount++;
+					m_updatesThisTick++;
 
 					update();
 				}
@@ -141,6 +192,7 @@ namespace DX
 				m_totalTicks += timeDelta;
 				m_leftOverTicks = 0;
 				m_frameCount++;
+				m_updatesThisTick = 1;
 
 				update();
 			}
@@ -151,33 +203,36 @@ namespace DX
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64>(m_qpcFrequency.QuadPart))
+			if (m_secondCounter >= TicksPerSecond)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_secondCounter %= TicksPerSecond;
 			}
 		}
 
 	private:
-		// Quellzeiterfassungsdaten verwenden QPC-Einheiten.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
-		uint64 m_qpcMaxDelta;
+		// Zeitquelle und zuletzt gelesene Zeit.
+		std::shared_ptr<IClock> m_clock;
+		uint64_t m_lastTime;
+		uint64_t m_maxDelta;
 
 		// Abgeleitete Zeitsteuerungsdaten verwenden ein kanonisches Taktformat.
-		uint64 m_elapsedTicks;
-		uint64 m_totalTicks;
-		uint64 m_leftOverTicks;
+		uint64_t m_elapsedTicks;
+		uint64_t m_totalTicks;
+		uint64_t m_leftOverTicks;
+		uint64_t m_droppedTicks;
 
 		// Member zur Nachverfolgung der Framerate.
-		uint32 m_frameCount;
-		uint32 m_framesPerSecond;
-		uint32 m_framesThisSecond;
-		uint64 m_qpcSecondCounter;
+		uint32_t m_frameCount;
+		uint32_t m_framesPerSecond;
+		uint32_t m_framesThisSecond;
+		uint32_t m_updatesThisTick;
+		uint64_t m_secondCounter;
 
 		// Member zum Konfigurieren des festen Zeitschrittmodus.
 		bool m_isFixedTimeStep;
-		uint64 m_targetElapsedTicks;
+		uint64_t m_targetElapsedTicks;
+		uint32_t m_maxUpdatesPerTick;
 	};
 }
@@ -0,0 +1,161 @@
+﻿#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include "Profiler.h"
+
+using namespace DX;
+
+ThreadPool::ThreadPool(uint32_t threadCount) :
+	m_stopping(false)
+{
+	if (threadCount == 0)
+	{
+		uint32_t cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (uint32_t index = 0; index < threadCount; index++)
+	{
+		m_threads.emplace_back([this]() { Run(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_wake.notify_all();
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()>&& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(task));
+	}
+
+	m_wake.notify_one();
+}
+
+std::future<void> ThreadPool::Submit(const std::function<void()>& task)
+{
+	auto packaged = std::make_shared<std::packaged_task<void()>>(task);
+	std::future<void> result = packaged->get_future();
+	Enqueue([packaged]() { (*packaged)(); });
+	return result;
+}
+
+// Die Indizes werden über einen gemeinsamen Zähler verteilt. Hat der Aufrufer seinen Anteil erledigt,
+// wartet er nur auf Helfer, die bereits begonnen haben; später startende Helfer kehren sofort zurück.
+// So blockiert ein ParallelFor innerhalb einer Aufgabe nicht, auch wenn alle Arbeitsthreads belegt sind.
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& body)
+{
+	struct Shared
+	{
+		std::atomic<uint32_t>	next;
+		std::atomic<bool>		failed;
+		std::exception_ptr		exception;
+		std::mutex				mutex;
+		std::condition_variable	done;
+		uint32_t				activeHelpers;
+		bool					closed;
+	};
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	auto shared = std::make_shared<Shared>();
+	shared->next = 0;
+	shared->failed = false;
+	shared->activeHelpers = 0;
+	shared->closed = false;
+
+	// body wird nur verwendet, solange der Aufrufer wartet.
+	const std::function<void(uint32_t)>* work = &body;
+	auto run = [count, work](Shared& state)
+	{
+		for (uint32_t index = state.next++; index < count && !state.failed; index = state.next++)
+		{
+			try
+			{
+				(*work)(index);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				if (!state.failed.exchange(true))
+				{
+					state.exception = std::current_exception();
+				}
+			}
+		}
+	};
+
+	uint32_t helpers = std::min(GetThreadCount(), count - 1);
+	for (uint32_t helper = 0; helper < helpers; helper++)
+	{
+		Enqueue([shared, run]()
+		{
+			{
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				if (shared->closed)
+				{
+					return;
+				}
+				shared->activeHelpers++;
+			}
+
+			run(*shared);
+
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			if (--shared->activeHelpers == 0)
+			{
+				shared->done.notify_one();
+			}
+		});
+	}
+
+	run(*shared);
+
+	std::unique_lock<std::mutex> lock(shared->mutex);
+	shared->closed = true;
+	shared->done.wait(lock, [&shared]() { return shared->activeHelpers == 0; });
+
+	if (shared->exception)
+	{
+		std::rethrow_exception(shared->exception);
+	}
+}
+
+void ThreadPool::Run()
+{
+	DX_PROFILE_THREAD("Worker");
+
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_queue.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		task();
+	}
+}
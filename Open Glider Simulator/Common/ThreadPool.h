@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DX
+{
+	// Feste Anzahl von Arbeitsthreads mit einer gemeinsamen Warteschlange.
+	// Aufgaben dürfen selbst ParallelFor aufrufen: der Aufrufer arbeitet stets mit und wartet daher nie
+	// auf Threads, die ihrerseits blockiert sind.
+	class ThreadPool
+	{
+	public:
+		// Ohne Angabe ein Thread je Prozessorkern abzüglich des aufrufenden Threads.
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		uint32_t GetThreadCount() const						{ return static_cast<uint32_t>(m_threads.size()); }
+
+		// Führt die Aufgabe auf einem Arbeitsthread aus. Ausnahmen werden über das Future weitergereicht.
+		std::future<void> Submit(const std::function<void()>& task);
+
+		// Ruft body(index) für alle Indizes in [0, count) auf und kehrt erst zurück, wenn alle fertig sind.
+		// Die erste aufgetretene Ausnahme wird auf dem aufrufenden Thread erneut geworfen.
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& body);
+
+	private:
+		ThreadPool(const ThreadPool&);
+		ThreadPool& operator=(const ThreadPool&);
+
+		void Enqueue(std::function<void()>&& task);
+		void Run();
+
+		std::vector<std::thread>			m_threads;
+		std::deque<std::function<void()>>	m_queue;
+		std::mutex							m_mutex;
+		std::condition_variable				m_wake;
+		bool								m_stopping;
+	};
+}
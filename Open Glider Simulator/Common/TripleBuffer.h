@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace DX
+{
+	// Sperrfreier Dreifachpuffer für genau einen Schreiber und einen Leser.
+	// Der Schreiber füllt seinen Puffer und veröffentlicht ihn mit einem einzigen atomaren Austausch;
+	// er wartet nie auf den Leser. Der Leser erhält immer den zuletzt veröffentlichten, vollständigen Inhalt.
+	template<typename T>
+	class TripleBuffer
+	{
+	public:
+		TripleBuffer() :
+			m_backState(1),
+			m_writeIndex(0),
+			m_readIndex(2)
+		{
+		}
+
+		// Schreiber: Puffer, der als nächstes veröffentlicht wird. Enthält einen beliebigen älteren Inhalt.
+		T& GetWriteBuffer()								{ return m_slots[m_writeIndex].value; }
+
+		// Schreiber: den Schreibpuffer veröffentlichen und den bisherigen Rückpuffer übernehmen.
+		void Publish()
+		{
+			uint32_t previous = m_backState.exchange(m_writeIndex | FreshFlag, std::memory_order_acq_rel);
+			m_writeIndex = previous & IndexMask;
+		}
+
+		// Leser: den neuesten veröffentlichten Puffer übernehmen, falls es seit dem letzten Aufruf einen gibt.
+		// Gibt True zurück, wenn sich der Lesepuffer geändert hat.
+		bool Acquire()
+		{
+			if ((m_backState.load(std::memory_order_relaxed) & FreshFlag) == 0)
+			{
+				return false;
+			}
+
+			uint32_t previous = m_backState.exchange(m_readIndex, std::memory_order_acq_rel);
+			m_readIndex = previous & IndexMask;
+			return true;
+		}
+
+		// Leser: der zuletzt übernommene Puffer. Bleibt bis zum nächsten Acquire-Aufruf unverändert.
+		const T& GetReadBuffer() const					{ return m_slots[m_readIndex].value; }
+
+	private:
+		static const uint32_t IndexMask = 0x3;
+		static const uint32_t FreshFlag = 0x4;
+
+		// Jeder Puffer liegt in einer eigenen Cachezeile, damit Schreiber und Leser sich nicht gegenseitig ausbremsen.
+		struct alignas(64) Slot
+		{
+			T value;
+		};
+
+		Slot m_slots[3];
+
+		// Index des Rückpuffers und Kennzeichen, ob er seit dem letzten Acquire neu veröffentlicht wurde.
+		alignas(64) std::atomic<uint32_t> m_backState;
+
+		// Nur vom Schreiber bzw. nur vom Leser verwendet.
+		alignas(64) uint32_t m_writeIndex;
+		alignas(64) uint32_t m_readIndex;
+	};
+}
@@ -0,0 +1,103 @@
+﻿#include "UploadRing.h"
+
+#include <stdexcept>
+
+using namespace DX;
+
+UploadRing::UploadRing(uint32_t capacity, uint32_t alignment) :
+	m_capacity(capacity),
+	m_alignment(alignment),
+	m_head(0),
+	m_tail(0),
+	m_lastFence(0),
+	m_memory(nullptr),
+	m_buffer(nullptr),
+	m_statistics()
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0 || capacity == 0 || capacity % alignment != 0)
+	{
+		throw std::invalid_argument("UploadRing: capacity must be a non-zero multiple of a power-of-two alignment");
+	}
+}
+
+void UploadRing::SetMemory(uint8_t* memory, RenderHandle buffer)
+{
+	std::lock_guard<std::mutex> lock(m_allocationMutex);
+	m_memory = memory;
+	m_buffer = buffer;
+}
+
+UploadAllocation UploadRing::Allocate(uint32_t size)
+{
+	std::lock_guard<std::mutex> lock(m_allocationMutex);
+	if (m_memory == nullptr)
+	{
+		throw std::logic_error("UploadRing: allocation outside of a frame");
+	}
+
+	UploadAllocation allocation = { nullptr, 0, size };
+	uint64_t start = (m_head + m_alignment - 1) & ~static_cast<uint64_t>(m_alignment - 1);
+
+	// Ein Ausschnitt, der über das Ende reichen würde, beginnt am Anfang der nächsten Runde.
+	bool wraps = start % m_capacity + size > m_capacity;
+	if (wraps)
+	{
+		start = (start / m_capacity + 1) * m_capacity;
+	}
+
+	if (size == 0 || size > m_capacity || start + size - m_tail > m_capacity)
+	{
+		m_statistics.failedAllocations++;
+		return allocation;
+	}
+
+	allocation.offset = static_cast<uint32_t>(start % m_capacity);
+	allocation.data = m_memory + allocation.offset;
+
+	m_statistics.allocations++;
+	m_statistics.allocatedBytes += start + size - m_head;
+	if (wraps)
+	{
+		m_statistics.wraps++;
+	}
+
+	m_head = start + size;
+	UpdateStatistics();
+	return allocation;
+}
+
+void UploadRing::EndFrame(uint64_t fence)
+{
+	if (fence <= m_lastFence)
+	{
+		throw std::invalid_argument("UploadRing: fence values must increase");
+	}
+
+	Frame frame = { fence, m_head };
+	m_frames.push_back(frame);
+	m_lastFence = fence;
+	UpdateStatistics();
+}
+
+void UploadRing::Retire(uint64_t completedFence)
+{
+	while (!m_frames.empty() && m_frames.front().fence <= completedFence)
+	{
+		m_tail = m_frames.front().end;
+		m_frames.pop_front();
+	}
+	UpdateStatistics();
+}
+
+void UploadRing::Reset()
+{
+	m_frames.clear();
+	m_tail = m_head;
+	UpdateStatistics();
+}
+
+void UploadRing::UpdateStatistics()
+{
+	m_statistics.framesInFlight = static_cast<uint32_t>(m_frames.size());
+	m_statistics.usedBytes = static_cast<uint32_t>(m_head - m_tail);
+}
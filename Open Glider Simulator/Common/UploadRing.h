@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include "RenderCommands.h"
+
+namespace DX
+{
+	// Ausschnitt des Ringpuffers. data ist nullptr, wenn der Ring voll war.
+	struct UploadAllocation
+	{
+		void*		data;
+		uint32_t	offset;			// in Bytes ab Pufferbeginn
+		uint32_t	size;
+
+		bool IsValid() const								{ return data != nullptr; }
+	};
+
+	struct UploadRingStatistics
+	{
+		uint64_t	allocations;
+		uint64_t	allocatedBytes;			// einschließlich Ausrichtung und übersprungener Enden
+		uint64_t	failedAllocations;
+		uint64_t	wraps;
+		uint32_t	framesInFlight;
+		uint32_t	usedBytes;
+	};
+
+	// Linearer Allokator über einem großen, vom Backend eingeblendeten Ring für Daten, die nur einen Frame
+	// leben (Kamera, Zeichenkonstanten). Ausschnitte werden nie über das Ende hinweg vergeben; passt einer
+	// nicht mehr hinein, beginnt er wieder am Anfang. Speicher wird frameweise freigegeben: EndFrame ordnet
+	// alle seit dem letzten Aufruf vergebenen Ausschnitte einem Fence-Wert zu, Retire gibt sie frei, sobald
+	// die GPU diesen Wert erreicht hat. Holt der Kopf das Ende der noch benutzten Daten ein, schlägt Allocate
+	// fehl, statt Daten der GPU zu überschreiben. Allocate darf von mehreren Threads zugleich aufgerufen
+	// werden, etwa von parallel aufzeichnenden Durchgängen; alle übrigen Aufrufe nur vom Renderthread.
+	class UploadRing
+	{
+	public:
+		// capacity muss ein Vielfaches von alignment sein, alignment eine Zweierpotenz. Direct3D verlangt für
+		// Konstantenpuffer-Ausschnitte 256 Bytes.
+		UploadRing(uint32_t capacity, uint32_t alignment);
+
+		// Vom Backend für die Dauer der Aufzeichnung gesetzt; memory ist nullptr, solange nicht eingeblendet.
+		void SetMemory(uint8_t* memory, RenderHandle buffer);
+		RenderHandle GetBuffer() const						{ return m_buffer; }
+
+		UploadAllocation Allocate(uint32_t size);
+
+		template<typename T>
+		UploadAllocation Upload(const T& data)
+		{
+			UploadAllocation allocation = Allocate(static_cast<uint32_t>(sizeof(T)));
+			if (allocation.IsValid())
+			{
+				memcpy(allocation.data, &data, sizeof(T));
+			}
+			return allocation;
+		}
+
+		void EndFrame(uint64_t fence);
+		void Retire(uint64_t completedFence);
+
+		// Gibt alles frei, etwa wenn das Backend den Puffer verwirft statt ihn weiterzubeschreiben.
+		void Reset();
+
+		uint32_t GetCapacity() const						{ return m_capacity; }
+		uint32_t GetAlignment() const						{ return m_alignment; }
+		const UploadRingStatistics& GetStatistics() const	{ return m_statistics; }
+
+	private:
+		struct Frame
+		{
+			uint64_t	fence;
+			uint64_t	end;			// Kopfposition am Ende des Frames
+		};
+
+		void UpdateStatistics();
+
+		// Positionen zählen fortlaufend; die Pufferadresse ist die Position modulo Kapazität.
+		uint32_t			m_capacity;
+		uint32_t			m_alignment;
+		uint64_t			m_head;
+		uint64_t			m_tail;
+		uint64_t			m_lastFence;
+		std::deque<Frame>	m_frames;
+		std::mutex			m_allocationMutex;
+
+		uint8_t*			m_memory;
+		RenderHandle		m_buffer;
+
+		UploadRingStatistics	m_statistics;
+	};
+}
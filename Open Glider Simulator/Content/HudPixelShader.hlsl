@@ -0,0 +1,16 @@
+// Abdeckung der Glyphen; der Atlas enthlt weien Text mit vormultipliziertem Alpha.
+Texture2D<float4> atlas : register(t0);
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 texel : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// Die Glyphen liegen auf ganzen Pixeln, daher werden die Texel ohne Filter bernommen.
+float4 main(PixelShaderInput input) : SV_TARGET
+{
+	float coverage = atlas.Load(int3(input.texel, 0)).a;
+	return float4(input.color.rgb * input.color.a, input.color.a) * coverage;
+}
@@ -0,0 +1,37 @@
+// Abbildung der HUD-Pixel auf den Clipraum samt Bildschirmdrehung und Textfarbe (siehe HudConstantBuffer).
+cbuffer HudConstantBuffer : register(b1)
+{
+	matrix transform;
+	float4 color;
+};
+
+// Jede Instanz ist eine Glyphe (siehe DX::HudGlyph); die Ecken des Rechtecks folgen aus dem Index.
+struct VertexShaderInput
+{
+	float4 rect : RECT;				// x, y, Breite, Hhe in Pixeln
+	float2 texel : TEXCOORD0;		// linke obere Ecke im Atlas in Texeln
+	uint vertex : SV_VertexID;
+};
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 texel : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// Zeichnet alle Glyphen der Anzeige mit einem instanzierten Aufruf.
+PixelShaderInput main(VertexShaderInput input)
+{
+	PixelShaderInput output;
+
+	// 0 = links oben, 1 = rechts oben, 2 = links unten, 3 = rechts unten.
+	float2 corner = float2(input.vertex & 1, input.vertex >> 1);
+	float2 pos = input.rect.xy + corner * input.rect.zw;
+
+	output.pos = mul(float4(pos, 0.0f, 1.0f), transform);
+	output.texel = input.texel + corner * input.rect.zw;
+	output.color = color;
+
+	return output;
+}
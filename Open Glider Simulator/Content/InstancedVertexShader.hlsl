@@ -0,0 +1,46 @@
+// Kamera des Frames (siehe ViewConstantBuffer); die Modellmatrix kommt aus dem Instanzpuffer.
+cbuffer ViewConstantBuffer : register(b0)
+{
+	matrix view;
+	matrix projection;
+	float4 cameraPosition;
+};
+
+// Erste Instanz des aktuellen Aufrufs im Instanzpuffer (siehe DX::DrawQueue).
+cbuffer DrawConstantBuffer : register(b1)
+{
+	uint firstInstance;
+	uint3 padding;
+};
+
+// Modellmatrizen aller Instanzen des Frames, in Zeichenreihenfolge.
+StructuredBuffer<float4x4> instanceTransforms : register(t0);
+
+struct VertexShaderInput
+{
+	float3 pos : POSITION;
+	float3 color : COLOR0;
+	uint instance : SV_InstanceID;
+};
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float3 color : COLOR0;
+};
+
+// Zeichnet alle Instanzen eines Netzes mit einem Aufruf.
+PixelShaderInput main(VertexShaderInput input)
+{
+	PixelShaderInput output;
+	float4 pos = float4(input.pos, 1.0f);
+
+	pos = mul(pos, instanceTransforms[firstInstance + input.instance]);
+	pos = mul(pos, view);
+	pos = mul(pos, projection);
+	output.pos = pos;
+
+	output.color = input.color;
+
+	return output;
+}
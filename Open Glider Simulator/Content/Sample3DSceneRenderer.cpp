@@ -1,20 +1,37 @@
 ﻿#include "pch.h"
 #include "Sample3DSceneRenderer.h"
 
+#include <algorithm>
 #include "..\Common\DirectXHelper.h"
+#include "..\Common\Profiler.h"
 
 using namespace Open_Glider_Simulator;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+// Ferne Schnittebene der Projektion in m; normiert auch die Tiefe der Sortierschlüssel.
+static const float FarPlane = 20000.0f;
+
+static_assert(sizeof(DX::InstanceTransform) == sizeof(XMFLOAT4X4), "instance transforms are stored as XMFLOAT4X4");
+
 // Lädt den Scheitelpunkt und die Pixel-Shader aus den Dateien und instanziiert die Würfelgeometrie.
-Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
+Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::ResourceLoader& loader,
+	DX::D3D11PipelineFactory& pipelines) :
 	m_loadingComplete(false),
-	m_degreesPerSecond(45),
 	m_indexCount(0),
+	m_cubePipeline(0),
+	m_cubeMaterial(0),
+	m_cubeMesh(0),
 	m_tracking(false),
-	m_deviceResources(deviceResources)
+	m_cameraPosition(0.0f, 0.0f, 0.0f),
+	m_fieldOfView(0.0f),
+	m_deviceResources(deviceResources),
+	m_loader(loader),
+	m_pipelines(pipelines),
+	m_pipelineResource(0),
+	m_meshResource(0),
+	m_pipeline()
 {
 	CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
@@ -33,6 +50,7 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 	{
 		fovAngleY *= 2.0f;
 	}
+	m_fieldOfView = fovAngleY;
 
 	// Die OrientationTransform3D-Matrix wird hier im Nachhinein multipliziert
 	// um die Szene in Bezug auf die Bildschirmausrichtung ordnungsgemäß auszurichten.
@@ -44,8 +62,8 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 	XMMATRIX perspectiveMatrix = XMMatrixPerspectiveFovRH(
 		fovAngleY,
 		aspectRatio,
-		0.01f,
-		100.0f
+		0.5f,
+		FarPlane
 		);
 
 	XMFLOAT4X4 orientation = m_deviceResources->GetOrientationTransform3D();
@@ -53,37 +71,195 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 	XMMATRIX orientationMatrix = XMLoadFloat4x4(&orientation);
 
 	XMStoreFloat4x4(
-		&m_constantBufferData.projection,
+		&m_viewConstantBufferData.projection,
 		XMMatrixTranspose(perspectiveMatrix * orientationMatrix)
 		);
 
 	// Das Auge befindet sich bei (0,0.7,1.5) und betrachtet Punkt (0,-0.1,0) mit dem Up-Vektor entlang der Y-Achse.
 	static const XMVECTORF32 eye = { 0.0f, 0.7f, 1.5f, 0.0f };
 	static const XMVECTORF32 at = { 0.0f, -0.1f, 0.0f, 0.0f };
+
+	SetCamera(eye, at);
+}
+
+// Setzt Ansicht und Position der Kamera mit dem Up-Vektor entlang der Y-Achse.
+void Sample3DSceneRenderer::SetCamera(FXMVECTOR eye, FXMVECTOR at)
+{
 	static const XMVECTORF32 up = { 0.0f, 1.0f, 0.0f, 0.0f };
 
-	XMStoreFloat4x4(&m_constantBufferData.view, XMMatrixTranspose(XMMatrixLookAtRH(eye, at, up)));
+	XMStoreFloat4x4(&m_viewConstantBufferData.view, XMMatrixTranspose(XMMatrixLookAtRH(eye, at, up)));
+	XMStoreFloat4(&m_viewConstantBufferData.cameraPosition, XMVectorSetW(eye, 1.0f));
+	XMStoreFloat3(&m_cameraPosition, eye);
 }
 
-// Wird einmal pro Frame aufgerufen, dreht den Würfel und berechnet das Modell und die Anzeigematrizen.
-void Sample3DSceneRenderer::Update(DX::StepTimer const& timer)
+// Position linear und Lage normiert linear auf dem kürzeren Weg zwischen zwei Posen interpolieren.
+static GliderPose InterpolatePose(GliderPose const& from, GliderPose const& to, float t)
 {
-	if (!m_tracking)
+	float dot = 0.0f;
+	for (int i = 0; i < 4; i++)
 	{
-		// Grad in Bogenmaß und anschließend Sekunden in Drehwinkel konvertieren.
-		float radiansPerSecond = XMConvertToRadians(m_degreesPerSecond);
-		double totalRotation = timer.GetTotalSeconds() * radiansPerSecond;
-		float radians = static_cast<float>(fmod(totalRotation, XM_2PI));
+		dot += from.orientation[i] * to.orientation[i];
+	}
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
 
-		Rotate(radians);
+	GliderPose pose;
+	float lengthSquared = 0.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		pose.orientation[i] = from.orientation[i] + (sign * to.orientation[i] - from.orientation[i]) * t;
+		lengthSquared += pose.orientation[i] * pose.orientation[i];
+	}
+
+	float inverseLength = 1.0f / sqrtf(lengthSquared);
+	for (int i = 0; i < 4; i++)
+	{
+		pose.orientation[i] *= inverseLength;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		pose.position[i] = from.position[i] + (to.position[i] - from.position[i]) * t;
+	}
+
+	return pose;
+}
+
+// Wird einmal pro Frame aufgerufen und berechnet Modell und Verfolgerkamera aus dem neuesten Simulationsschnappschuss.
+// interpolationAlpha gibt an, wie weit die Anzeigezeit zwischen den beiden Zuständen des Schnappschusses liegt.
+void Sample3DSceneRenderer::Update(SimulationSnapshot const& snapshot, float interpolationAlpha)
+{
+	CompleteLoading();
+
+	if (m_tracking || snapshot.current.gliders.empty() || snapshot.previous.gliders.size() != snapshot.current.gliders.size())
+	{
+		return;
+	}
+
+	// Der Würfel steht als Platzhalter für jedes Segelflugzeug; die Kamera folgt dem ersten.
+	size_t gliderCount = snapshot.current.gliders.size();
+	SetGliderCount(gliderCount);
+	XMVECTOR eye = XMVectorZero();
+	for (size_t i = 0; i < gliderCount; i++)
+	{
+		GliderPose pose = InterpolatePose(snapshot.previous.gliders[i], snapshot.current.gliders[i], interpolationAlpha);
+
+		// Rotation von Körperachsen (vorne, rechts, unten) in Weltachsen (Nord, Ost, Unten).
+		float w = pose.orientation[0], x = pose.orientation[1], y = pose.orientation[2], z = pose.orientation[3];
+		float r[3][3] =
+		{
+			{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y) },
+			{ 2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x) },
+			{ 2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y) },
+		};
+
+		// Die Szene verwendet x = Ost, y = oben, z = Süd; das Modell x = rechts, y = oben, z = hinten.
+		// Jede Zeile der Matrix ist das Bild einer Modellachse in Szenenachsen.
+		XMMATRIX rotation(
+			r[1][1], -r[2][1], -r[0][1], 0.0f,
+			-r[1][2], r[2][2], r[0][2], 0.0f,
+			-r[1][0], r[2][0], r[0][0], 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+			);
+		XMVECTOR position = XMVectorSet(pose.position[1], -pose.position[2], -pose.position[0], 1.0f);
+
+		// Platzhaltergeometrie ungefähr in den Abmessungen eines Segelflugzeugs (Spannweite, Höhe, Länge).
+		SetGliderModel(i, XMMatrixScaling(17.0f, 1.0f, 8.0f) * rotation * XMMatrixTranslationFromVector(position));
+
+		// Die Kamera folgt dem ersten Flugzeug waagerecht von hinten und leicht erhöht.
+		if (i == 0)
+		{
+			XMVECTOR forward = XMVector3Normalize(XMVectorSet(r[1][0], 0.0f, -r[0][0], 0.0f));
+			eye = position - forward * 40.0f + XMVectorSet(0.0f, 8.0f, 0.0f, 0.0f);
+			SetCamera(eye, position);
+		}
+	}
+
+	// Sortiertiefe aus der Verschiebung der transponierten Modellmatrix.
+	for (GliderInstance& glider : m_gliders)
+	{
+		const float (&m)[4][4] = glider.transform.m;
+		XMVECTOR position = XMVectorSet(m[0][3], m[1][3], m[2][3], 1.0f);
+		glider.depth = XMVectorGetX(XMVector3Length(position - eye)) / FarPlane;
+	}
+
+	UpdateVisibility();
+}
+
+// Hält für jedes Flugzeug ein Objekt im Szenenindex.
+void Sample3DSceneRenderer::SetGliderCount(size_t count)
+{
+	while (m_gliders.size() > count)
+	{
+		m_sceneIndex.Remove(m_gliders.back().object);
+		m_gliders.pop_back();
+	}
+
+	while (m_gliders.size() < count)
+	{
+		GliderInstance glider = {};
+		glider.object = m_sceneIndex.Insert(DX::Aabb::Empty());
+		if (glider.object >= m_objectGliders.size())
+		{
+			m_objectGliders.resize(glider.object + 1);
+		}
+		m_objectGliders[glider.object] = static_cast<uint32>(m_gliders.size());
+		m_gliders.push_back(glider);
+	}
+}
+
+// Setzt die Modellmatrix eines Flugzeugs und meldet die Box des Platzhalterwürfels dem Szenenindex.
+void Sample3DSceneRenderer::SetGliderModel(size_t index, FXMMATRIX model)
+{
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&m_gliders[index].transform), XMMatrixTranspose(model));
+
+	static const DX::Aabb cubeBounds = { { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } };
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, model);
+	m_sceneIndex.Update(m_gliders[index].object, DX::TransformBounds(cubeBounds, matrix.m));
+}
+
+// Übernimmt die Änderungen in den Szenenindex und bestimmt die Objekte im Sichtkegel der aktuellen Kamera.
+void Sample3DSceneRenderer::UpdateVisibility()
+{
+	DX_PROFILE_ZONE("Sample3DSceneRenderer::UpdateVisibility");
+
+	m_sceneIndex.Commit();
+
+	XMFLOAT4X4 viewProjection = GetViewProjection();
+	m_frustumObjects.clear();
+	m_sceneIndex.Cull(DX::Frustum::FromViewProjection(viewProjection.m), m_frustumObjects);
+	m_visibleObjects = m_frustumObjects;
+}
+
+// Verwirft die Objekte im Sichtkegel, die hinter dem gerasterten Gelände liegen.
+void Sample3DSceneRenderer::CullOccluded(DX::OcclusionBuffer& occlusion)
+{
+	m_visibleObjects.clear();
+	for (DX::BoundingVolumeHierarchy::ObjectId object : m_frustumObjects)
+	{
+		if (!occlusion.IsOccluded(m_sceneIndex.GetBounds(object)))
+		{
+			m_visibleObjects.push_back(object);
+		}
 	}
 }
 
+XMFLOAT4X4 Sample3DSceneRenderer::GetViewProjection() const
+{
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection,
+		XMMatrixTranspose(XMLoadFloat4x4(&m_viewConstantBufferData.view)) * XMMatrixTranspose(XMLoadFloat4x4(&m_viewConstantBufferData.projection)));
+	return viewProjection;
+}
+
 // Das 3D-Würfelmodell um ein festgelegtes Bogenmaß drehen.
 void Sample3DSceneRenderer::Rotate(float radians)
 {
-	// Auf das Übergeben der aktualisierten Modellmatrix an den Shader vorbereiten.
-	XMStoreFloat4x4(&m_constantBufferData.model, XMMatrixTranspose(XMMatrixRotationY(radians)));
+	// Während der Nachverfolgung steht das erste Flugzeug als Würfel im Ursprung.
+	SetGliderCount((std::max)(m_gliders.size(), size_t(1)));
+	m_gliders[0].depth = 0.0f;
+	SetGliderModel(0, XMMatrixRotationY(radians));
+	UpdateVisibility();
 }
 
 void Sample3DSceneRenderer::StartTracking()
@@ -106,137 +282,85 @@ void Sample3DSceneRenderer::StopTracking()
 	m_tracking = false;
 }
 
-// Rendert einen Frame mit dem Scheitelpunkt und den Pixel-Shadern.
-void Sample3DSceneRenderer::Render()
+// Zeichnet die Befehle für einen Frame mit dem Scheitelpunkt und den Pixel-Shadern auf. Die Ansichtskonstanten
+// hat der Aufrufer bereits gebunden.
+void Sample3DSceneRenderer::Render(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads)
 {
+	DX_PROFILE_ZONE("Sample3DSceneRenderer::Render");
+
 	// Der Ladevorgang verläuft asynchron. Geometrien erst nach dem Laden zeichnen.
 	if (!m_loadingComplete)
 	{
 		return;
 	}
 
-	auto context = m_deviceResources->GetD3DDeviceContext();
-
-	// Den Konstantenpuffer für das Senden an das Grafikgerät vorbereiten.
-	context->UpdateSubresource1(
-		m_constantBuffer.Get(),
-		0,
-		NULL,
-		&m_constantBufferData,
-		0,
-		0,
-		0
-		);
-
-	// Jeder Scheitelpunkt ist eine Instanz der VertexPositionColor-Struktur.
-	UINT stride = sizeof(VertexPositionColor);
-	UINT offset = 0;
-	context->IASetVertexBuffers(
-		0,
-		1,
-		m_vertexBuffer.GetAddressOf(),
-		&stride,
-		&offset
-		);
-
-	context->IASetIndexBuffer(
-		m_indexBuffer.Get(),
-		DXGI_FORMAT_R16_UINT, // Jeder Index ist eine nicht signierte ganze 16-Bit-Zahl (kurz).
-		0
-		);
-
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	context->IASetInputLayout(m_inputLayout.Get());
-
-	// Unseren Vertex-Shader anfügen.
-	context->VSSetShader(
-		m_vertexShader.Get(),
-		nullptr,
-		0
-		);
-
-	// Den Konstantenpuffer an das Grafikgerät senden.
-	context->VSSetConstantBuffers1(
-		0,
-		1,
-		m_constantBuffer.GetAddressOf(),
-		nullptr,
-		nullptr
-		);
-
-	// Unseren Pixel-Shader anfügen.
-	context->PSSetShader(
-		m_pixelShader.Get(),
-		nullptr,
-		0
-		);
-
-	// Die Objekte zeichnen.
-	context->DrawIndexed(
-		m_indexCount,
-		0,
-		0
-		);
+	// Die sichtbaren Objekte einreihen; die Warteschlange fasst sie zu instanzierten Aufrufen zusammen.
+	for (DX::BoundingVolumeHierarchy::ObjectId object : m_visibleObjects)
+	{
+		const GliderInstance& glider = m_gliders[m_objectGliders[object]];
+		m_drawQueue.Submit(0, m_cubePipeline, m_cubeMaterial, m_cubeMesh, glider.depth, glider.transform);
+	}
+	m_drawQueue.Flush(commands, uploads);
 }
 
 void Sample3DSceneRenderer::CreateDeviceDependentResources()
 {
-	// Shader asynchron laden.
-	auto loadVSTask = DX::ReadDataAsync(L"SampleVertexShader.cso");
-	auto loadPSTask = DX::ReadDataAsync(L"SamplePixelShader.cso");
-
-	// Nach dem Laden der Vertex-Shader-Datei das Shader- und Eingabelayout erstellen.
-	auto createVSTask = loadVSTask.then([this](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateVertexShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&m_vertexShader
-				)
-			);
+	// Pipeline und Netz auf den Arbeitsthreads des Laders erstellen. Die Szene wird vor dem Gelände benötigt.
+	static const float Priority = 2.0f;
 
-		static const D3D11_INPUT_ELEMENT_DESC vertexDesc [] =
+	// Jeder Scheitelpunkt ist eine Instanz der VertexPositionColor-Struktur.
+	DX::PipelineDescription description =
+	{
+		"InstancedVertexShader.cso",
+		"SamplePixelShader.cso",
 		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		};
-
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateInputLayout(
-				vertexDesc,
-				ARRAYSIZE(vertexDesc),
-				&fileData[0],
-				fileData.size(),
-				&m_inputLayout
-				)
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, false, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, false, 0 },
+		},
+		DX::PrimitiveTopology::TriangleList,
+		DX::BlendMode::Opaque,
+		DX::DepthMode::TestAndWrite
+	};
+
+	// Die Shader teilt der Cache mit anderen Renderern; gelesen wird nur, was er noch nicht kennt.
+	DX::ResourceRequest pipeline = {};
+	pipeline.priority = Priority;
+	pipeline.read = [this, description]() { m_pipelines.LoadShaders(description); return DX::AssetData(); };
+	pipeline.decode = [this, description](const DX::AssetData&) { m_pipeline = m_pipelines.CreatePipeline(description); };
+	m_pipelineResource = m_loader.Request(pipeline);
+
+	// Wenn die Pipeline erstellt wurde, den Instanzpuffer und das Mesh erstellen. Es wird nichts gelesen.
+	DX::ResourceRequest cube = {};
+	cube.priority = Priority;
+	cube.dependencies.push_back(m_pipelineResource);
+	cube.decode = [this](const DX::AssetData&) {
+		DX_PROFILE_ZONE("Sample3DSceneRenderer::CreateCubeMesh");
+
+		// Instanzpuffer der Warteschlange; er wird jeden Frame verworfen und neu beschrieben.
+		CD3D11_BUFFER_DESC instanceBufferDesc(
+			InstanceCapacity * sizeof(DX::InstanceTransform),
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_DYNAMIC,
+			D3D11_CPU_ACCESS_WRITE,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(DX::InstanceTransform)
 			);
-	});
-
-	// Nach dem Laden der Pixel-Shader-Datei den Shader- und Konstantenpuffer erstellen.
-	auto createPSTask = loadPSTask.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreatePixelShader(
-				&fileData[0],
-				fileData.size(),
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&instanceBufferDesc,
 				nullptr,
-				&m_pixelShader
+				&m_instanceBuffer
 				)
 			);
 
-		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelViewProjectionConstantBuffer) , D3D11_BIND_CONSTANT_BUFFER);
+		CD3D11_SHADER_RESOURCE_VIEW_DESC instanceViewDesc(m_instanceBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, InstanceCapacity);
 		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&constantBufferDesc,
-				nullptr,
-				&m_constantBuffer
+			m_deviceResources->GetD3DDevice()->CreateShaderResourceView(
+				m_instanceBuffer.Get(),
+				&instanceViewDesc,
+				&m_instanceView
 				)
 			);
-	});
-
-	// Wenn beide Shader geladen wurden, das Mesh erstellen.
-	auto createCubeTask = (createPSTask && createVSTask).then([this] () {
 
 		// Mesh-Scheitelpunkte laden. Jeder Scheitelpunkt verfügt über eine Position und eine Farbe.
 		static const VertexPositionColor cubeVertices[] = 
@@ -304,21 +428,54 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 				&m_indexBuffer
 				)
 			);
-	});
+	};
+	m_meshResource = m_loader.Request(cube);
+}
 
-	// Wenn der Würfel geladen wurde, kann das Objekt gerendert werden.
-	createCubeTask.then([this] () {
-		m_loadingComplete = true;
-	});
+// Wenn der Würfel geladen wurde, die Ressourcen bei der Warteschlange anmelden; danach kann gerendert werden.
+// Ein Fehler beim Laden wird hier auf dem Renderthread erneut geworfen.
+void Sample3DSceneRenderer::CompleteLoading()
+{
+	if (m_loadingComplete || m_meshResource == 0)
+	{
+		return;
+	}
+
+	DX::ResourceState state = m_loader.GetState(m_meshResource);
+	if (state == DX::ResourceState::Failed)
+	{
+		std::rethrow_exception(m_loader.GetError(m_meshResource));
+	}
+	if (state != DX::ResourceState::Ready)
+	{
+		return;
+	}
+
+	DX::DrawQueueResources resources = { m_instanceBuffer.Get(), m_instanceView.Get(), InstanceCapacity };
+	m_drawQueue.SetResources(resources);
+
+	m_cubePipeline = m_drawQueue.RegisterPipeline(m_pipeline);
+	m_cubeMaterial = m_drawQueue.RegisterMaterial(nullptr);
+
+	// Jeder Index ist eine 16-Bit-Zahl.
+	DX::DrawMesh mesh = { m_vertexBuffer.Get(), sizeof(VertexPositionColor), m_indexBuffer.Get(), DX::IndexFormat::UInt16, m_indexCount, 0, 0 };
+	m_cubeMesh = m_drawQueue.RegisterMesh(mesh);
+
+	m_loadingComplete = true;
 }
 
 void Sample3DSceneRenderer::ReleaseDeviceDependentResources()
 {
 	m_loadingComplete = false;
-	m_vertexShader.Reset();
-	m_inputLayout.Reset();
-	m_pixelShader.Reset();
-	m_constantBuffer.Reset();
+
+	// Ein noch laufendes decode schreibt sonst in die Puffer, während sie hier zurückgesetzt werden.
+	m_loader.ReleaseAndWait(m_meshResource);
+	m_loader.ReleaseAndWait(m_pipelineResource);
+	m_meshResource = m_pipelineResource = 0;
+	m_drawQueue.ClearResources();
+	m_pipeline = DX::RenderPipeline();
 	m_vertexBuffer.Reset();
 	m_indexBuffer.Reset();
+	m_instanceBuffer.Reset();
+	m_instanceView.Reset();
 }
\ No newline at end of file
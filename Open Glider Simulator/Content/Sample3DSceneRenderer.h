@@ -1,49 +1,103 @@
 ﻿#pragma once
 
 #include "..\Common\DeviceResources.h"
+#include "..\Common\D3D11PipelineFactory.h"
+#include "..\Common\DrawQueue.h"
+#include "..\Common\ResourceLoader.h"
+#include "..\Common\BoundingVolumeHierarchy.h"
+#include "..\Common\OcclusionBuffer.h"
 #include "ShaderStructures.h"
-#include "..\Common\StepTimer.h"
+#include "..\Simulation\SimulationState.h"
 
 namespace Open_Glider_Simulator
 {
-	// Dieser Beispielrenderer instanziiert eine grundlegende Rendering-Pipeline.
+	// Dieser Beispielrenderer instanziiert eine grundlegende Rendering-Pipeline. Jedes Segelflugzeug der Flotte
+	// wird als Instanz desselben Platzhalternetzes über eine DX::DrawQueue gezeichnet, sofern seine Box laut
+	// Szenenindex den Sichtkegel schneidet.
 	class Sample3DSceneRenderer
 	{
 	public:
-		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		// Pipeline und Netz lädt der ResourceLoader; die Shader kommen aus dem gemeinsamen Pipeline-Cache.
+		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::ResourceLoader& loader,
+			DX::D3D11PipelineFactory& pipelines);
 		void CreateDeviceDependentResources();
 		void CreateWindowSizeDependentResources();
 		void ReleaseDeviceDependentResources();
-		void Update(DX::StepTimer const& timer);
-		void Render();
+		void Update(SimulationSnapshot const& snapshot, float interpolationAlpha);
+		void CullOccluded(DX::OcclusionBuffer& occlusion);
+		void Render(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads);
 		void StartTracking();
 		void TrackingUpdate(float positionX);
 		void StopTracking();
 		bool IsTracking() { return m_tracking; }
 
+		// Kamera für andere Renderer. View und Projektion wie im Konstantenpuffer, also bereits transponiert.
+		const DirectX::XMFLOAT3& GetCameraPosition() const			{ return m_cameraPosition; }
+		float GetFieldOfView() const								{ return m_fieldOfView; }
+		const DirectX::XMFLOAT4X4& GetView() const					{ return m_viewConstantBufferData.view; }
+		const DirectX::XMFLOAT4X4& GetProjection() const			{ return m_viewConstantBufferData.projection; }
+		const ViewConstantBuffer& GetViewConstants() const			{ return m_viewConstantBufferData; }
+		DirectX::XMFLOAT4X4 GetViewProjection() const;			// Zeilenvektorform, nicht transponiert
 
 	private:
+		struct GliderInstance
+		{
+			DX::InstanceTransform	transform;
+			float					depth;		// Entfernung zur Kamera relativ zur fernen Schnittebene
+			DX::BoundingVolumeHierarchy::ObjectId	object;
+		};
+
+		// Anfangsgröße des Instanzpuffers; größere Flotten werden abschnittsweise gezeichnet.
+		static const uint32 InstanceCapacity = 1024;
+
 		void Rotate(float radians);
+		void SetGliderCount(size_t count);
+		void SetGliderModel(size_t index, DirectX::FXMMATRIX model);
+		void UpdateVisibility();
+		void SetCamera(DirectX::FXMVECTOR eye, DirectX::FXMVECTOR at);
+		void CompleteLoading();
 
 	private:
 		// Zeiger in den Geräteressourcen zwischengespeichert.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
-		// Direct3D-Ressourcen für Würfelgeometrie.
-		Microsoft::WRL::ComPtr<ID3D11InputLayout>	m_inputLayout;
+		// Anforderungen beim Lader; das Netz hängt von der Pipeline ab.
+		DX::ResourceLoader&			m_loader;
+		DX::D3D11PipelineFactory&	m_pipelines;
+		DX::ResourceId				m_pipelineResource;
+		DX::ResourceId				m_meshResource;
+
+		// Direct3D-Ressourcen für Würfelgeometrie. Die Objekte der Pipeline gehören dem Pipeline-Cache.
+		DX::RenderPipeline							m_pipeline;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_vertexBuffer;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_indexBuffer;
-		Microsoft::WRL::ComPtr<ID3D11VertexShader>	m_vertexShader;
-		Microsoft::WRL::ComPtr<ID3D11PixelShader>	m_pixelShader;
-		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_constantBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_instanceBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_instanceView;
 
 		// Systemressourcen für Würfelgeometrie.
-		ModelViewProjectionConstantBuffer	m_constantBufferData;
+		ViewConstantBuffer	m_viewConstantBufferData;
 		uint32	m_indexCount;
 
-		// Für die Renderschleife verwendete Variablen.
+		// Warteschlange und ihre Registrierungen, gültig solange m_loadingComplete gesetzt ist.
+		DX::DrawQueue				m_drawQueue;
+		uint32						m_cubePipeline;
+		uint32						m_cubeMaterial;
+		uint32						m_cubeMesh;
+		std::vector<GliderInstance>	m_gliders;
+
+		// Szenenindex über allen Objekten, die im letzten Update im Sichtkegel liegenden Objekte und davon
+		// die nicht verdeckten.
+		DX::BoundingVolumeHierarchy							m_sceneIndex;
+		std::vector<uint32>									m_objectGliders;	// je Objektkennung
+		std::vector<DX::BoundingVolumeHierarchy::ObjectId>	m_frustumObjects;
+		std::vector<DX::BoundingVolumeHierarchy::ObjectId>	m_visibleObjects;
+
+		// Kamera in Szenenachsen und vertikaler Öffnungswinkel in rad.
+		DirectX::XMFLOAT3	m_cameraPosition;
+		float				m_fieldOfView;
+
+		// Für die Renderschleife verwendete Variablen. m_loadingComplete wird nur auf dem Renderthread gesetzt.
 		bool	m_loadingComplete;
-		float	m_degreesPerSecond;
 		bool	m_tracking;
 	};
 }
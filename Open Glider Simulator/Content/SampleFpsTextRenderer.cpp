@@ -1,122 +1,364 @@
 ﻿#include "pch.h"
 #include "SampleFpsTextRenderer.h"
 
+#include <algorithm>
+#include <cmath>
 #include "Common/DirectXHelper.h"
+#include "Common/Profiler.h"
 
 using namespace Open_Glider_Simulator;
 using namespace Microsoft::WRL;
 
-// Initialisiert D2D-Ressourcen, die zum Textrendering verwendet werden.
-SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) : 
-	m_text(L""),
-	m_deviceResources(deviceResources)
+using namespace DirectX;
+using namespace Windows::Foundation;
+
+// Schriftgröße in DIPs wie bisher mit DirectWrite; der Atlas wird in Pixeln der aktuellen DPI gezeichnet.
+static const float FontSize = 14.0f;
+
+// 95 Zeichen bei 14 pt passen bis etwa 300 DPI in den Atlas.
+static const uint32 AtlasWidth = 512;
+static const uint32 AtlasHeight = 256;
+
+// Rand jeder Zelle für Überhänge der Glyphen in Pixeln.
+static const uint32 GlyphPadding = 1;
+
+static_assert(sizeof(DX::HudGlyph) == 6 * sizeof(float), "HUD glyphs are read as RECT and TEXCOORD by the vertex shader");
+
+// Legt die Anzeigeelemente fest; Atlas und Puffer entstehen mit den Geräteressourcen.
+SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::ResourceLoader& loader,
+	DX::D3D11PipelineFactory& pipelines) :
+	m_deviceResources(deviceResources),
+	m_loader(loader),
+	m_pipelines(pipelines),
+	m_pipelineResource(0),
+	m_bufferResource(0),
+	m_uploadedVersion(0),
+	m_pipeline(),
+	m_atlasDpi(0.0f),
+	m_loadingComplete(false)
 {
-	ZeroMemory(&m_textMetrics, sizeof(DWRITE_TEXT_METRICS));
+	// Von unten nach oben gestapelt; die Felder haben feste Breiten, damit die Spalten stehen bleiben.
+	m_countersWidget = m_hud.AddWidget(DX::HudCorner::BottomRight, 0.0f, 0,
+		L"Ruckler {0} (gesamt {0})\n"
+		L"Verdeckt {4.1} % ({0} von {0})");
+	m_stagesWidget = m_hud.AddWidget(DX::HudCorner::BottomRight, 0.0f, 2,
+		L"Frame   p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms\n"
+		L"Update  p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms\n"
+		L"Render  p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms\n"
+		L"Present p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms");
+	m_fpsWidget = m_hud.AddWidget(DX::HudCorner::BottomRight, 0.0f, 6, L"{0} FPS");
+
+	XMStoreFloat4x4(&m_constantBufferData.transform, XMMatrixIdentity());
+	m_constantBufferData.color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+
+	DX::ThrowIfFailed(
+		m_deviceResources->GetD2DFactory()->CreateDrawingStateBlock(&m_stateBlock)
+		);
+
+	CreateDeviceDependentResources();
+}
+
+// Setzt die angezeigten Werte. Unveränderte Werte lösen weder ein neues Layout noch ein Hochladen aus.
+void SampleFpsTextRenderer::Update(DX::StepTimer const& timer, DX::FrameStatistics const& statistics, DX::OcclusionStatistics const& occlusion)
+{
+	DX_PROFILE_ZONE("SampleFpsTextRenderer::Update");
+
+	CompleteLoading();
+	if (m_loadingComplete && m_atlasDpi != m_deviceResources->GetDpi())
+	{
+		CreateAtlas();
+	}
+
+	uint32 fps = timer.GetFramesPerSecond();
+	m_hud.SetField(m_fpsWidget, 0, fps > 0 ? fps : std::nan(""));
+
+	// Perzentile des letzten Zeitfensters je Frameabschnitt in Millisekunden.
+	static const DX::FrameStage stages[] = { DX::FrameStage::Frame, DX::FrameStage::Update, DX::FrameStage::Render, DX::FrameStage::Present };
+	for (uint32 i = 0; i < ARRAYSIZE(stages); i++)
+	{
+		DX::FrameStageSummary summary = statistics.GetWindowSummary(stages[i]);
+		m_hud.SetField(m_stagesWidget, i * 4 + 0, summary.p50);
+		m_hud.SetField(m_stagesWidget, i * 4 + 1, summary.p95);
+		m_hud.SetField(m_stagesWidget, i * 4 + 2, summary.p99);
+		m_hud.SetField(m_stagesWidget, i * 4 + 3, summary.max);
+	}
 
-	// Geräteunabhängige Ressourcen erstellen
+	m_hud.SetField(m_countersWidget, 0, statistics.GetWindowHitchCount());
+	m_hud.SetField(m_countersWidget, 1, static_cast<double>(statistics.GetTotalHitchCount()));
+	m_hud.SetField(m_countersWidget, 2, occlusion.GetRejectedPercent());
+	m_hud.SetField(m_countersWidget, 3, occlusion.rejected);
+	m_hud.SetField(m_countersWidget, 4, occlusion.tested);
+
+	// Die Anzeige wird in Pixeln ohne Drehung gesetzt; die Drehung übernimmt der Vertex-Shader.
+	Size outputSize = m_deviceResources->GetOutputSize();
+	m_hud.SetScreenSize(outputSize.Width, outputSize.Height);
+	m_hud.Update();
+
+	XMMATRIX pixelsToClip = XMMatrixScaling(2.0f / outputSize.Width, -2.0f / outputSize.Height, 1.0f) * XMMatrixTranslation(-1.0f, 1.0f, 0.0f);
+	XMFLOAT4X4 orientation = m_deviceResources->GetOrientationTransform3D();
+	XMStoreFloat4x4(&m_constantBufferData.transform, XMMatrixTranspose(pixelsToClip * XMLoadFloat4x4(&orientation)));
+}
+
+// Zeichnet alle Glyphen mit einem Aufruf. Der Instanzpuffer wird nur hochgeladen, wenn sich die Glyphen geändert haben.
+void SampleFpsTextRenderer::Render(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads)
+{
+	DX_PROFILE_ZONE("SampleFpsTextRenderer::Render");
+
+	const std::vector<DX::HudGlyph>& glyphs = m_hud.GetGlyphs();
+	if (!m_loadingComplete || !m_atlasView || glyphs.empty())
+	{
+		return;
+	}
+
+	uint32 glyphCount = (std::min)(static_cast<uint32>(glyphs.size()), MaxGlyphs);
+	if (m_uploadedVersion != m_hud.GetVersion())
+	{
+		commands.UpdateBuffer(m_instanceBuffer.Get(), glyphs.data(), glyphCount * static_cast<uint32>(sizeof(DX::HudGlyph)));
+		m_uploadedVersion = m_hud.GetVersion();
+	}
+
+	DX::UploadAllocation constants = uploads.Upload(m_constantBufferData);
+	if (!constants.IsValid())
+	{
+		return;
+	}
+	commands.SetConstantBufferRange(DX::ShaderStageVertex, DrawConstantsSlot, uploads.GetBuffer(), constants.offset, constants.size);
+
+	DX::RenderHandle atlas = m_atlasView.Get();
+	commands.SetShaderResources(DX::ShaderStagePixel, 0, 1, &atlas);
+	commands.SetPipeline(m_pipeline);
+	commands.SetVertexBuffer(0, m_instanceBuffer.Get(), sizeof(DX::HudGlyph), 0);
+	commands.SetIndexBuffer(m_indexBuffer.Get(), DX::IndexFormat::UInt16, 0);
+	commands.DrawIndexedInstanced(6, glyphCount, 0, 0, 0);
+}
+
+// Zeichnet die druckbaren ASCII-Zeichen mit Direct2D in den Atlas. Das Ziel und die DPI des Kontexts werden
+// danach wiederhergestellt, weil DeviceResources sie für den Hintergrundpuffer gesetzt hat.
+void SampleFpsTextRenderer::CreateAtlas()
+{
+	DX_PROFILE_ZONE("SampleFpsTextRenderer::CreateAtlas");
+
+	float dpi = m_deviceResources->GetDpi();
+
+	// Bei 96 DPI entspricht ein DIP einem Pixel; so ergibt die Schrift die Größe in Pixeln der Anzeige.
 	ComPtr<IDWriteTextFormat> textFormat;
 	DX::ThrowIfFailed(
 		m_deviceResources->GetDWriteFactory()->CreateTextFormat(
-			L"Segoe UI",
+			L"Consolas",
 			nullptr,
 			DWRITE_FONT_WEIGHT_LIGHT,
 			DWRITE_FONT_STYLE_NORMAL,
 			DWRITE_FONT_STRETCH_NORMAL,
-			32.0f,
+			FontSize * dpi / 96.0f,
 			L"en-US",
 			&textFormat
 			)
 		);
 
+	// Alle Zeilen haben die Höhe der Schrift, nicht die der einzelnen Glyphe.
+	ComPtr<IDWriteTextLayout> lineLayout;
 	DX::ThrowIfFailed(
-		textFormat.As(&m_textFormat)
+		m_deviceResources->GetDWriteFactory()->CreateTextLayout(L"M", 1, textFormat.Get(), 1000.0f, 1000.0f, &lineLayout)
 		);
-
+	DWRITE_TEXT_METRICS lineMetrics;
 	DX::ThrowIfFailed(
-		m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR)
+		lineLayout->GetMetrics(&lineMetrics)
 		);
 
+	auto atlas = std::make_shared<DX::GlyphAtlas>(AtlasWidth, AtlasHeight, static_cast<uint32>(std::ceil(lineMetrics.height)));
+
+	ComPtr<ID3D11Texture2D> texture;
+	CD3D11_TEXTURE2D_DESC textureDesc(
+		DXGI_FORMAT_B8G8R8A8_UNORM,
+		AtlasWidth,
+		AtlasHeight,
+		1,
+		1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
+		);
 	DX::ThrowIfFailed(
-		m_deviceResources->GetD2DFactory()->CreateDrawingStateBlock(&m_stateBlock)
+		m_deviceResources->GetD3DDevice()->CreateTexture2D(&textureDesc, nullptr, &texture)
 		);
 
-	CreateDeviceDependentResources();
-}
-
-// Aktualisiert den anzuzeigenden Text.
-void SampleFpsTextRenderer::Update(DX::StepTimer const& timer)
-{
-	// Anzeigetext aktualisieren.
-	uint32 fps = timer.GetFramesPerSecond();
-
-	m_text = (fps > 0) ? std::to_wstring(fps) + L" FPS" : L" - FPS";
-
-	ComPtr<IDWriteTextLayout> textLayout;
+	ComPtr<ID3D11ShaderResourceView> atlasView;
 	DX::ThrowIfFailed(
-		m_deviceResources->GetDWriteFactory()->CreateTextLayout(
-			m_text.c_str(),
-			(uint32) m_text.length(),
-			m_textFormat.Get(),
-			240.0f, // Max. Breite des Eingabetexts.
-			50.0f, // Max. Höhe des Eingabetexts.
-			&textLayout
-			)
+		m_deviceResources->GetD3DDevice()->CreateShaderResourceView(texture.Get(), nullptr, &atlasView)
 		);
 
+	ComPtr<IDXGISurface2> surface;
 	DX::ThrowIfFailed(
-		textLayout.As(&m_textLayout)
+		texture.As(&surface)
 		);
 
+	ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
+	D2D1_BITMAP_PROPERTIES1 bitmapProperties =
+		D2D1::BitmapProperties1(
+			D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+			D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+			96.0f,
+			96.0f
+			);
+	ComPtr<ID2D1Bitmap1> bitmap;
 	DX::ThrowIfFailed(
-		m_textLayout->GetMetrics(&m_textMetrics)
+		context->CreateBitmapFromDxgiSurface(surface.Get(), &bitmapProperties, &bitmap)
 		);
-}
 
-// Rendert einen Frame für die Bildschirmdarstellung.
-void SampleFpsTextRenderer::Render()
-{
-	ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
-	Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
+	ComPtr<ID2D1Image> previousTarget;
+	float previousDpiX, previousDpiY;
+	context->GetTarget(&previousTarget);
+	context->GetDpi(&previousDpiX, &previousDpiY);
 
 	context->SaveDrawingState(m_stateBlock.Get());
+	context->SetTarget(bitmap.Get());
+	context->SetDpi(96.0f, 96.0f);
+	context->SetTransform(D2D1::Matrix3x2F::Identity());
+	context->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
 	context->BeginDraw();
+	context->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
 
-	// Position in der unteren rechten Ecke
-	D2D1::Matrix3x2F screenTranslation = D2D1::Matrix3x2F::Translation(
-		logicalSize.Width - m_textMetrics.layoutWidth,
-		logicalSize.Height - m_textMetrics.height
-		);
+	for (wchar_t character = L' '; character <= L'~'; character++)
+	{
+		ComPtr<IDWriteTextLayout> layout;
+		DX::ThrowIfFailed(
+			m_deviceResources->GetDWriteFactory()->CreateTextLayout(&character, 1, textFormat.Get(), 1000.0f, 1000.0f, &layout)
+			);
+		DWRITE_TEXT_METRICS metrics;
+		DX::ThrowIfFailed(
+			layout->GetMetrics(&metrics)
+			);
 
-	context->SetTransform(screenTranslation * m_deviceResources->GetOrientationTransform2D());
+		float advance = metrics.widthIncludingTrailingWhitespace;
+		uint32 cellWidth = static_cast<uint32>(std::ceil(advance)) + 2 * GlyphPadding;
+		if (!atlas->Add(character, cellWidth, advance, -static_cast<float>(GlyphPadding)))
+		{
+			break;
+		}
 
-	DX::ThrowIfFailed(
-		m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_TRAILING)
-		);
-
-	context->DrawTextLayout(
-		D2D1::Point2F(0.f, 0.f),
-		m_textLayout.Get(),
-		m_whiteBrush.Get()
-		);
+		const DX::AtlasGlyph* glyph = atlas->Find(character);
+		context->DrawTextLayout(
+			D2D1::Point2F(static_cast<float>(glyph->x + GlyphPadding), static_cast<float>(glyph->y)),
+			layout.Get(),
+			m_whiteBrush.Get(),
+			D2D1_DRAW_TEXT_OPTIONS_CLIP
+			);
+	}
 
 	// D2DERR_RECREATE_TARGET hier ignorieren. Dieser Fehler weist darauf hin, dass das Gerät
 	// nicht mehr vorhanden ist. Es wird beim nächsten Aufruf von "Present" behandelt.
 	HRESULT hr = context->EndDraw();
+
+	context->SetTarget(previousTarget.Get());
+	context->SetDpi(previousDpiX, previousDpiY);
+	context->RestoreDrawingState(m_stateBlock.Get());
+
 	if (hr != D2DERR_RECREATE_TARGET)
 	{
 		DX::ThrowIfFailed(hr);
 	}
 
-	context->RestoreDrawingState(m_stateBlock.Get());
+	atlas->SetFallback(L'?');
+	m_atlas = atlas;
+	m_atlasView = atlasView;
+	m_atlasDpi = dpi;
+	m_hud.SetAtlas(m_atlas);
 }
 
 void SampleFpsTextRenderer::CreateDeviceDependentResources()
 {
+	static const float Priority = 0.5f;
+
 	DX::ThrowIfFailed(
 		m_deviceResources->GetD2DDeviceContext()->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &m_whiteBrush)
 		);
+
+	// Die Glyphen liegen nur im Instanzpuffer; die Ecken ergeben sich aus den Indizes.
+	DX::PipelineDescription description =
+	{
+		"HudVertexShader.cso",
+		"HudPixelShader.cso",
+		{
+			{ "RECT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, true, 1 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 16, true, 1 },
+		},
+		DX::PrimitiveTopology::TriangleList,
+		DX::BlendMode::PremultipliedAlpha,
+		DX::DepthMode::Disabled
+	};
+
+	DX::ResourceRequest pipeline = {};
+	pipeline.priority = Priority;
+	pipeline.read = [this, description]() { m_pipelines.LoadShaders(description); return DX::AssetData(); };
+	pipeline.decode = [this, description](const DX::AssetData&) { m_pipeline = m_pipelines.CreatePipeline(description); };
+	m_pipelineResource = m_loader.Request(pipeline);
+
+	DX::ResourceRequest buffers = {};
+	buffers.priority = Priority;
+	buffers.dependencies.push_back(m_pipelineResource);
+	buffers.decode = [this](const DX::AssetData&) {
+		DX_PROFILE_ZONE("SampleFpsTextRenderer::CreateBuffers");
+
+		CD3D11_BUFFER_DESC instanceBufferDesc(
+			MaxGlyphs * sizeof(DX::HudGlyph),
+			D3D11_BIND_VERTEX_BUFFER,
+			D3D11_USAGE_DYNAMIC,
+			D3D11_CPU_ACCESS_WRITE
+			);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&instanceBufferDesc,
+				nullptr,
+				&m_instanceBuffer
+				)
+			);
+
+		// Zwei Dreiecke im Uhrzeigersinn über die Ecken 0 bis 3 (siehe HudVertexShader.hlsl).
+		static const unsigned short quadIndices[] = { 0, 1, 2, 2, 1, 3 };
+
+		D3D11_SUBRESOURCE_DATA indexBufferData = {0};
+		indexBufferData.pSysMem = quadIndices;
+		CD3D11_BUFFER_DESC indexBufferDesc(sizeof(quadIndices), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&indexBufferDesc,
+				&indexBufferData,
+				&m_indexBuffer
+				)
+			);
+	};
+	m_bufferResource = m_loader.Request(buffers);
 }
+
+// Gibt das Zeichnen frei, sobald die Puffer fertig sind; ein Fehler beim Laden wird hier erneut geworfen.
+void SampleFpsTextRenderer::CompleteLoading()
+{
+	if (m_loadingComplete || m_bufferResource == 0)
+	{
+		return;
+	}
+
+	DX::ResourceState state = m_loader.GetState(m_bufferResource);
+	if (state == DX::ResourceState::Failed)
+	{
+		std::rethrow_exception(m_loader.GetError(m_bufferResource));
+	}
+	m_loadingComplete = state == DX::ResourceState::Ready;
+}
+
 void SampleFpsTextRenderer::ReleaseDeviceDependentResources()
 {
+	m_loadingComplete = false;
+	m_loader.ReleaseAndWait(m_bufferResource);
+	m_loader.ReleaseAndWait(m_pipelineResource);
+	m_bufferResource = m_pipelineResource = 0;
+	m_pipeline = DX::RenderPipeline();
+	m_instanceBuffer.Reset();
+	m_indexBuffer.Reset();
+	m_atlasView.Reset();
 	m_whiteBrush.Reset();
-}
\ No newline at end of file
+
+	// Der neue Instanzpuffer ist leer; mit dem neuen Atlas wird alles neu hochgeladen.
+	m_atlas.reset();
+	m_atlasDpi = 0.0f;
+	m_uploadedVersion = 0;
+	m_hud.SetAtlas(nullptr);
+}
@@ -1,31 +1,71 @@
 ﻿#pragma once
 
-#include <string>
 #include "..\Common\DeviceResources.h"
+#include "..\Common\D3D11PipelineFactory.h"
+#include "..\Common\HudText.h"
+#include "..\Common\RenderCommands.h"
+#include "..\Common\UploadRing.h"
+#include "..\Common\ResourceLoader.h"
 #include "..\Common\StepTimer.h"
+#include "..\Common\FrameStatistics.h"
+#include "..\Common\OcclusionBuffer.h"
+#include "ShaderStructures.h"
 
 namespace Open_Glider_Simulator
 {
-	// Rendert den aktuellen FPS-Wert in der unteren rechten Ecke des Bildschirms mithilfe von Direct2D und DirectWrite.
+	// Rendert den aktuellen FPS-Wert, die Perzentile der Framezeiten und den Anteil verdeckter Objekte in der unteren
+	// rechten Ecke des Bildschirms. DirectWrite zeichnet die Zeichen einmal in einen Glyphenatlas; danach baut
+	// DX::HudText nur die Anzeigeelemente neu auf, deren angezeigte Werte sich geändert haben, und alle Glyphen
+	// werden mit einem instanzierten Aufruf im Durchgang der Anzeige gezeichnet.
 	class SampleFpsTextRenderer
 	{
 	public:
-		SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::ResourceLoader& loader,
+			DX::D3D11PipelineFactory& pipelines);
 		void CreateDeviceDependentResources();
 		void ReleaseDeviceDependentResources();
-		void Update(DX::StepTimer const& timer);
-		void Render();
+
+		// Auf dem Renderthread aufrufen; hier entsteht auch der Atlas, weil Direct2D nur dort zeichnet.
+		void Update(DX::StepTimer const& timer, DX::FrameStatistics const& statistics, DX::OcclusionStatistics const& occlusion);
+		void Render(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads);
+
+		DX::HudTextStatistics GetStatistics() const			{ return m_hud.GetStatistics(); }
 
 	private:
+		// Höchstzahl gleichzeitig sichtbarer Glyphen; überzählige werden nicht gezeichnet.
+		static const uint32 MaxGlyphs = 2048;
+
+		void CreateAtlas();
+		void CompleteLoading();
+
 		// Zeiger in den Geräteressourcen zwischengespeichert.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
-		// Ressourcen im Zusammenhang mit Textrendering.
-		std::wstring                                    m_text;
-		DWRITE_TEXT_METRICS	                            m_textMetrics;
-		Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>    m_whiteBrush;
-		Microsoft::WRL::ComPtr<ID2D1DrawingStateBlock1> m_stateBlock;
-		Microsoft::WRL::ComPtr<IDWriteTextLayout3>      m_textLayout;
-		Microsoft::WRL::ComPtr<IDWriteTextFormat2>      m_textFormat;
+		// Anforderungen beim Lader; die Puffer hängen von der Pipeline ab.
+		DX::ResourceLoader&			m_loader;
+		DX::D3D11PipelineFactory&	m_pipelines;
+		DX::ResourceId				m_pipelineResource;
+		DX::ResourceId				m_bufferResource;
+
+		// Anzeigeelemente und ihre Glyphen.
+		DX::HudText							m_hud;
+		DX::HudWidgetId						m_fpsWidget;
+		DX::HudWidgetId						m_stagesWidget;
+		DX::HudWidgetId						m_countersWidget;
+		std::shared_ptr<const DX::GlyphAtlas>	m_atlas;
+		uint64								m_uploadedVersion;
+
+		// Ressourcen im Zusammenhang mit Textrendering. Die Objekte der Pipeline gehören dem Pipeline-Cache.
+		Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>		m_whiteBrush;
+		Microsoft::WRL::ComPtr<ID2D1DrawingStateBlock1>		m_stateBlock;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_atlasView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>				m_instanceBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>				m_indexBuffer;
+		DX::RenderPipeline									m_pipeline;
+
+		HudConstantBuffer	m_constantBufferData;
+		float				m_atlasDpi;			// der Atlas wird neu gezeichnet, wenn sich die DPI ändern
+
+		bool	m_loadingComplete;
 	};
-}
\ No newline at end of file
+}
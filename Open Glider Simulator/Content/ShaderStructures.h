@@ -2,6 +2,22 @@
 
 namespace Open_Glider_Simulator
 {
+	// Register der Konstantenpuffer nach Änderungshäufigkeit: Ansicht (einmal je Frame aus dem UploadRing),
+	// Aufruf (je Zeichenaufruf aus dem UploadRing), Objekt (statisch, nur beim Erstellen hochgeladen) und
+	// rendererabhängige Werte je Ansicht.
+	static const uint32 ViewConstantsSlot = 0;
+	static const uint32 DrawConstantsSlot = 1;
+	static const uint32 ObjectConstantsSlot = 2;
+	static const uint32 RendererViewConstantsSlot = 3;
+
+	// Kamera eines Frames, gemeinsam für alle Renderer.
+	struct ViewConstantBuffer
+	{
+		DirectX::XMFLOAT4X4 view;
+		DirectX::XMFLOAT4X4 projection;
+		DirectX::XMFLOAT4 cameraPosition;
+	};
+
 	// Konstantenpuffer zum Senden von MVP-Matrizen an den Vertex-Shader verwendet.
 	struct ModelViewProjectionConstantBuffer
 	{
@@ -16,4 +32,27 @@ namespace Open_Glider_Simulator
 		DirectX::XMFLOAT3 pos;
 		DirectX::XMFLOAT3 color;
 	};
+
+	// Höchstzahl der Stufen einer Kachelpyramide.
+	static const uint32 TerrainMaxLevels = 16;
+
+	// Überblendbereiche aller Stufen für die aktuelle Kamera.
+	struct TerrainViewConstantBuffer
+	{
+		DirectX::XMFLOAT4 morphRanges[TerrainMaxLevels];	// x = Beginn, y = Ende der Überblendung in m
+	};
+
+	// Entquantisierung einer Geländekachel; ändert sich nie und wird mit dem Netz hochgeladen.
+	struct TerrainTileConstantBuffer
+	{
+		DirectX::XMFLOAT4 positionOffset;	// w = Stufe
+		DirectX::XMFLOAT4 positionScale;
+	};
+
+	// Abbildung der HUD-Pixel auf den Clipraum samt Bildschirmdrehung; je Frame aus dem UploadRing.
+	struct HudConstantBuffer
+	{
+		DirectX::XMFLOAT4X4 transform;
+		DirectX::XMFLOAT4 color;
+	};
 }
\ No newline at end of file
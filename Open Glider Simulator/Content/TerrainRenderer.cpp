@@ -0,0 +1,274 @@
+﻿#include "pch.h"
+#include "TerrainRenderer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <cfloat>
+#include "..\Common\DirectXHelper.h"
+#include "..\Common\Profiler.h"
+
+using namespace Open_Glider_Simulator;
+
+using namespace DirectX;
+
+// Die Überblendung beginnt bei diesem Anteil der Entfernung, ab der die Elternkachel gezeichnet wird.
+static const float MorphStartFraction = 0.7f;
+
+TerrainRenderer::TerrainRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::ResourceLoader& loader,
+	DX::D3D11PipelineFactory& pipelines, const std::shared_ptr<const TerrainMeshGenerator>& meshGenerator) :
+	m_deviceResources(deviceResources),
+	m_loader(loader),
+	m_pipelines(pipelines),
+	m_pipelineResource(0),
+	m_indexResource(0),
+	m_pipeline(),
+	m_meshGenerator(meshGenerator),
+	m_indexCount(0),
+	m_indexFormat(DX::IndexFormat::UInt16),
+	m_frame(0),
+	m_loadingComplete(false)
+{
+	m_viewConstantBufferData = TerrainViewConstantBuffer();
+	m_meshGenerator->GenerateOccluderIndices(m_occluderIndices);
+	CreateDeviceDependentResources();
+}
+
+// Bestimmt die ausgewählten Kacheln im Sichtkegel und reicht ihre groben Gitter als Verdecker ein.
+void TerrainRenderer::Update(const std::vector<std::shared_ptr<const TerrainTile>>& selection, const TerrainStreamer& streamer, const TerrainView& view,
+	const XMFLOAT4X4& viewMatrix, const XMFLOAT4X4& projection, DX::OcclusionBuffer& occlusion)
+{
+	DX_PROFILE_ZONE("TerrainRenderer::Update");
+
+	// Stufe 0 hat keine Elternkachel und wird nie überblendet. Die Kachelquellen begrenzen die Stufenzahl.
+	uint32 levelCount = (std::min)(streamer.GetSource().GetDescription().levelCount, TerrainMaxLevels);
+	m_viewConstantBufferData.morphRanges[0] = XMFLOAT4(0.5f * FLT_MAX, FLT_MAX, 0.0f, 0.0f);
+	for (uint32 level = 1; level < levelCount; level++)
+	{
+		float end = streamer.GetMorphDistance(view, level);
+		m_viewConstantBufferData.morphRanges[level] = XMFLOAT4(end * MorphStartFraction, end, 0.0f, 0.0f);
+	}
+
+	m_frame++;
+	m_drawList.clear();
+	m_candidates.clear();
+	m_candidateBounds.clear();
+	m_visibleCandidates.clear();
+
+	CompleteLoading();
+	if (!m_loadingComplete)
+	{
+		return;
+	}
+
+	// Die Boxen der Kacheln ergeben sich aus ihrer Entquantisierung; die überblendeten Höhen liegen
+	// zwischen den Höhen der Kachel und damit ebenfalls darin.
+	for (const auto& tile : selection)
+	{
+		if (!tile->mesh)
+		{
+			continue;
+		}
+
+		const TerrainMeshBlock& mesh = *tile->mesh;
+		DX::Aabb bounds;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bounds.min[axis] = mesh.positionOffset[axis];
+			bounds.max[axis] = mesh.positionOffset[axis] + mesh.positionScale[axis];
+		}
+		m_candidates.push_back(tile.get());
+		m_candidateBounds.push_back(bounds);
+	}
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix)) * XMMatrixTranspose(XMLoadFloat4x4(&projection)));
+	DX::CullBounds(DX::Frustum::FromViewProjection(viewProjection.m), m_candidateBounds.data(), m_candidateBounds.size(), m_visibleCandidates);
+
+	// Ausgewählte, aber unsichtbare Kacheln behalten vorhandene Puffer, werden aber nicht hochgeladen.
+	for (const TerrainTile* tile : m_candidates)
+	{
+		auto gpuTile = m_tiles.find(tile->key.Pack());
+		if (gpuTile != m_tiles.end())
+		{
+			gpuTile->second.lastUsedFrame = m_frame;
+		}
+	}
+
+	for (uint32 candidate : m_visibleCandidates)
+	{
+		const TerrainMeshBlock& mesh = *m_candidates[candidate]->mesh;
+		occlusion.AddOccluder(mesh.occluderPositions.data(), m_meshGenerator->GetOccluderVertexCount(),
+			m_occluderIndices.data(), static_cast<uint32>(m_occluderIndices.size()));
+	}
+}
+
+// Lädt die Kacheln hoch, die nicht hinter anderem Gelände liegen, und zeichnet sie auf. Neu sichtbare Kacheln
+// werden sofort hochgeladen, da der Streamer nur fertige Kacheln auswählt und eine fehlende Kachel ein Loch
+// hinterlassen würde.
+void TerrainRenderer::CullOccluded(DX::OcclusionBuffer& occlusion)
+{
+	DX_PROFILE_ZONE("TerrainRenderer::CullOccluded");
+
+	occlusion.RemoveOccluded(m_candidateBounds.data(), m_visibleCandidates);
+
+	for (uint32 candidate : m_visibleCandidates)
+	{
+		const TerrainTile* tile = m_candidates[candidate];
+
+		GpuTile& gpuTile = m_tiles[tile->key.Pack()];
+		if (!gpuTile.vertexBuffer)
+		{
+			Upload(*tile->mesh, tile->key.level, gpuTile);
+		}
+		gpuTile.lastUsedFrame = m_frame;
+
+		Draw draw = { gpuTile.vertexBuffer.Get(), gpuTile.constantBuffer.Get() };
+		m_drawList.push_back(draw);
+	}
+
+	for (auto tile = m_tiles.begin(); tile != m_tiles.end();)
+	{
+		tile = m_frame - tile->second.lastUsedFrame > RetainFrames ? m_tiles.erase(tile) : std::next(tile);
+	}
+}
+
+void TerrainRenderer::Upload(const TerrainMeshBlock& mesh, uint32 level, GpuTile& gpuTile)
+{
+	DX_PROFILE_ZONE("TerrainRenderer::Upload");
+
+	D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+	vertexBufferData.pSysMem = mesh.vertices.data();
+	CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(mesh.vertices.size() * sizeof(TerrainVertex)), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+	DX::ThrowIfFailed(
+		m_deviceResources->GetD3DDevice()->CreateBuffer(
+			&vertexBufferDesc,
+			&vertexBufferData,
+			&gpuTile.vertexBuffer
+			)
+		);
+
+	// Die Entquantisierung gehört zum Netz und ändert sich nie.
+	TerrainTileConstantBuffer tileConstants =
+	{
+		XMFLOAT4(mesh.positionOffset[0], mesh.positionOffset[1], mesh.positionOffset[2], static_cast<float>(level)),
+		XMFLOAT4(mesh.positionScale[0], mesh.positionScale[1], mesh.positionScale[2], 0.0f)
+	};
+	D3D11_SUBRESOURCE_DATA constantBufferData = {0};
+	constantBufferData.pSysMem = &tileConstants;
+	CD3D11_BUFFER_DESC constantBufferDesc(sizeof(TerrainTileConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+	DX::ThrowIfFailed(
+		m_deviceResources->GetD3DDevice()->CreateBuffer(
+			&constantBufferDesc,
+			&constantBufferData,
+			&gpuTile.constantBuffer
+			)
+		);
+}
+
+// Lädt je Frame nur die Überblendbereiche in den UploadRing; die Ansichtskonstanten hat der Aufrufer gebunden.
+void TerrainRenderer::Render(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads)
+{
+	DX_PROFILE_ZONE("TerrainRenderer::Render");
+
+	if (!m_loadingComplete || m_drawList.empty())
+	{
+		return;
+	}
+
+	DX::UploadAllocation viewConstants = uploads.Upload(m_viewConstantBufferData);
+	if (!viewConstants.IsValid())
+	{
+		return;
+	}
+	commands.SetConstantBufferRange(DX::ShaderStageVertex, RendererViewConstantsSlot, uploads.GetBuffer(), viewConstants.offset, viewConstants.size);
+
+	commands.SetIndexBuffer(m_indexBuffer.Get(), m_indexFormat, 0);
+
+	commands.SetPipeline(m_pipeline);
+
+	for (const Draw& draw : m_drawList)
+	{
+		DX::RenderHandle constantBuffer = draw.constantBuffer;
+		commands.SetConstantBuffers(DX::ShaderStageVertex, ObjectConstantsSlot, 1, &constantBuffer);
+		commands.SetVertexBuffer(0, draw.vertexBuffer, sizeof(TerrainVertex), 0);
+		commands.DrawIndexed(m_indexCount, 0, 0);
+	}
+}
+
+void TerrainRenderer::CreateDeviceDependentResources()
+{
+	// Der Pixel-Shader des Beispielrenderers genügt für die Höhenfarben; der Cache erstellt ihn nur einmal.
+	static const float Priority = 1.0f;
+
+	DX::PipelineDescription description =
+	{
+		"TerrainVertexShader.cso",
+		"SamplePixelShader.cso",
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, false, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R8G8B8A8_SNORM, 0, 8, false, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, false, 0 },
+		},
+		DX::PrimitiveTopology::TriangleList,
+		DX::BlendMode::Opaque,
+		DX::DepthMode::TestAndWrite
+	};
+
+	DX::ResourceRequest pipeline = {};
+	pipeline.priority = Priority;
+	pipeline.read = [this, description]() { m_pipelines.LoadShaders(description); return DX::AssetData(); };
+	pipeline.decode = [this, description](const DX::AssetData&) { m_pipeline = m_pipelines.CreatePipeline(description); };
+	m_pipelineResource = m_loader.Request(pipeline);
+
+	DX::ResourceRequest indexBuffer = {};
+	indexBuffer.priority = Priority;
+	indexBuffer.dependencies.push_back(m_pipelineResource);
+	indexBuffer.decode = [this](const DX::AssetData&) {
+		DX_PROFILE_ZONE("TerrainRenderer::CreateIndexBuffer");
+
+		DX::Mesh::PackedIndices indices;
+		m_meshGenerator->GenerateIndices(indices);
+		m_indexCount = static_cast<uint32>(indices.count);
+		m_indexFormat = indices.is32Bit ? DX::IndexFormat::UInt32 : DX::IndexFormat::UInt16;
+
+		D3D11_SUBRESOURCE_DATA indexBufferData = {0};
+		indexBufferData.pSysMem = indices.data.data();
+		CD3D11_BUFFER_DESC indexBufferDesc(static_cast<UINT>(indices.data.size()), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&indexBufferDesc,
+				&indexBufferData,
+				&m_indexBuffer
+				)
+			);
+	};
+	m_indexResource = m_loader.Request(indexBuffer);
+}
+
+// Gibt das Zeichnen frei, sobald der Indexpuffer fertig ist; ein Fehler beim Laden wird hier erneut geworfen.
+void TerrainRenderer::CompleteLoading()
+{
+	if (m_loadingComplete || m_indexResource == 0)
+	{
+		return;
+	}
+
+	DX::ResourceState state = m_loader.GetState(m_indexResource);
+	if (state == DX::ResourceState::Failed)
+	{
+		std::rethrow_exception(m_loader.GetError(m_indexResource));
+	}
+	m_loadingComplete = state == DX::ResourceState::Ready;
+}
+
+void TerrainRenderer::ReleaseDeviceDependentResources()
+{
+	m_loadingComplete = false;
+	m_loader.ReleaseAndWait(m_indexResource);
+	m_loader.ReleaseAndWait(m_pipelineResource);
+	m_indexResource = m_pipelineResource = 0;
+	m_pipeline = DX::RenderPipeline();
+	m_indexBuffer.Reset();
+	m_tiles.clear();
+	m_drawList.clear();
+}
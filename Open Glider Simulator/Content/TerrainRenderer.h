@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <unordered_map>
+#include "..\Common\DeviceResources.h"
+#include "..\Common\D3D11PipelineFactory.h"
+#include "..\Common\RenderCommands.h"
+#include "..\Common\UploadRing.h"
+#include "..\Common\Frustum.h"
+#include "..\Common\OcclusionBuffer.h"
+#include "..\Common\ResourceLoader.h"
+#include "ShaderStructures.h"
+#include "..\Terrain\TerrainStreamer.h"
+
+namespace Open_Glider_Simulator
+{
+	// Zeichnet die vom TerrainStreamer ausgewählten Kacheln im Sichtkegel als CDLOD-Netze. Die Netze werden auf den
+	// Arbeitsthreads erzeugt; hier werden sie nur noch hochgeladen. Die Scheitelpunktpuffer bleiben erhalten,
+	// bis eine Kachel eine Weile nicht mehr ausgewählt war. Alle Kacheln teilen einen Indexpuffer; jede hat einen
+	// unveränderlichen Konstantenpuffer mit ihrer Entquantisierung, sodass je Kachel nichts hochgeladen wird.
+	class TerrainRenderer
+	{
+	public:
+		// Pipeline und Indexpuffer lädt der ResourceLoader; die Shader kommen aus dem gemeinsamen Pipeline-Cache.
+		TerrainRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::ResourceLoader& loader,
+			DX::D3D11PipelineFactory& pipelines, const std::shared_ptr<const TerrainMeshGenerator>& meshGenerator);
+		void CreateDeviceDependentResources();
+		void ReleaseDeviceDependentResources();
+
+		// viewMatrix und projection wie im Konstantenpuffer, also bereits transponiert. Sie dienen nur dem Sichtkegel;
+		// die Ansichtskonstanten bindet der Aufrufer. Update reicht die Kacheln im Sichtkegel als Verdecker ein,
+		// CullOccluded verwirft nach dem Rastern die verdeckten und lädt die übrigen hoch.
+		void Update(const std::vector<std::shared_ptr<const TerrainTile>>& selection, const TerrainStreamer& streamer, const TerrainView& view,
+			const DirectX::XMFLOAT4X4& viewMatrix, const DirectX::XMFLOAT4X4& projection, DX::OcclusionBuffer& occlusion);
+		void CullOccluded(DX::OcclusionBuffer& occlusion);
+		void Render(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads);
+
+		uint32 GetResidentTileCount() const					{ return static_cast<uint32>(m_tiles.size()); }
+		uint32 GetDrawnTileCount() const					{ return static_cast<uint32>(m_drawList.size()); }
+
+	private:
+		struct GpuTile
+		{
+			Microsoft::WRL::ComPtr<ID3D11Buffer>	vertexBuffer;
+			Microsoft::WRL::ComPtr<ID3D11Buffer>	constantBuffer;
+			uint64									lastUsedFrame;
+		};
+
+		struct Draw
+		{
+			ID3D11Buffer*		vertexBuffer;
+			ID3D11Buffer*		constantBuffer;
+		};
+
+		// Nach so vielen Frames ohne Auswahl wird der Puffer einer Kachel freigegeben.
+		static const uint64 RetainFrames = 300;
+
+		void Upload(const TerrainMeshBlock& mesh, uint32 level, GpuTile& gpuTile);
+		void CompleteLoading();
+
+		// Zeiger in den Geräteressourcen zwischengespeichert.
+		std::shared_ptr<DX::DeviceResources> m_deviceResources;
+
+		// Anforderungen beim Lader; der Indexpuffer hängt von der Pipeline ab.
+		DX::ResourceLoader&			m_loader;
+		DX::D3D11PipelineFactory&	m_pipelines;
+		DX::ResourceId				m_pipelineResource;
+		DX::ResourceId				m_indexResource;
+
+		std::shared_ptr<const TerrainMeshGenerator> m_meshGenerator;
+
+		// Direct3D-Ressourcen für alle Kacheln. Die Objekte der Pipeline gehören dem Pipeline-Cache.
+		DX::RenderPipeline							m_pipeline;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_indexBuffer;
+
+		TerrainViewConstantBuffer	m_viewConstantBufferData;
+		uint32		m_indexCount;
+		DX::IndexFormat	m_indexFormat;
+
+		std::unordered_map<uint64, GpuTile>	m_tiles;
+		std::vector<Draw>					m_drawList;
+		std::vector<const TerrainTile*>		m_candidates;
+		std::vector<DX::Aabb>				m_candidateBounds;
+		std::vector<uint32>					m_visibleCandidates;
+		std::vector<uint32_t>				m_occluderIndices;
+		uint64								m_frame;
+
+		bool	m_loadingComplete;
+	};
+}
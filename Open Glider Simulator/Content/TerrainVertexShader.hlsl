@@ -0,0 +1,73 @@
+// Kamera des Frames (siehe ViewConstantBuffer).
+cbuffer ViewConstantBuffer : register(b0)
+{
+	matrix view;
+	matrix projection;
+	float4 cameraPosition;
+};
+
+// Grenzen der gezeichneten Kachel in Szenenachsen, in w ihre Stufe.
+cbuffer TerrainTileConstantBuffer : register(b2)
+{
+	float4 positionOffset;
+	float4 positionScale;
+};
+
+// berblendbereich in m je Stufe fr die aktuelle Kamera.
+cbuffer TerrainViewConstantBuffer : register(b3)
+{
+	float4 morphRanges[16];
+};
+
+// Quantisierter Gitterpunkt: Lage und berblendhhe als UNORM relativ zur Kachel, Normale oktaedrisch als
+// SNORM, Farbe als UNORM.
+struct VertexShaderInput
+{
+	float4 pos : POSITION;
+	float4 normal : NORMAL;
+	float4 color : COLOR0;
+};
+
+// Pro-Pixel-Farbdaten an den Pixelshader bergeben.
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float3 color : COLOR0;
+};
+
+static const float3 sunDirection = float3(0.5f, 0.7f, 0.5f);
+static const float ambient = 0.35f;
+
+// Gegenstck zu DX::Mesh::EncodeOctahedral.
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 normal = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = saturate(-normal.z);
+	normal.xy += (normal.xy >= 0.0f) ? -t : t;
+	return normalize(normal);
+}
+
+// Blendet die Hhe mit der Entfernung zur Kamera stetig auf die grbere Stufe ber, sodass beim Wechsel
+// der Detailstufe kein Sprung sichtbar wird.
+PixelShaderInput main(VertexShaderInput input)
+{
+	PixelShaderInput output;
+
+	float3 position = positionOffset.xyz + input.pos.xyz * positionScale.xyz;
+	float morphHeight = positionOffset.y + input.pos.w * positionScale.y;
+
+	float2 morphRange = morphRanges[(uint)positionOffset.w].xy;
+	float distance = length(position - cameraPosition.xyz);
+	float morph = saturate((distance - morphRange.x) / (morphRange.y - morphRange.x));
+	float4 pos = float4(position.x, lerp(position.y, morphHeight, morph), position.z, 1.0f);
+
+	pos = mul(pos, view);
+	pos = mul(pos, projection);
+	output.pos = pos;
+
+	float3 normal = DecodeOctahedral(max(input.normal.xy, -1.0f));
+	float diffuse = saturate(dot(normal, normalize(sunDirection)));
+	output.color = input.color.rgb * (ambient + (1.0f - ambient) * diffuse);
+
+	return output;
+}
@@ -1,6 +1,10 @@
 ﻿#include "pch.h"
 #include "Open_Glider_SimulatorMain.h"
+
+#include <algorithm>
+#include <fstream>
 #include "Common\DirectXHelper.h"
+#include "Common\Profiler.h"
 
 using namespace Open_Glider_Simulator;
 using namespace Windows::Foundation;
@@ -9,28 +13,159 @@ using namespace Concurrency;
 
 // Lädt und initialisiert die Anwendungsobjekte, wenn die Anwendung geladen wird.
 Open_Glider_SimulatorMain::Open_Glider_SimulatorMain(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-	m_deviceResources(deviceResources)
+	m_deviceResources(deviceResources),
+	m_viewConstants(),
+	m_occlusionBuffer(OcclusionBufferWidth, OcclusionBufferHeight),
+	m_lastFrameStartTicks(0)
 {
 	// Registrieren, um über Geräteverlust oder Neuerstellung benachrichtigt zu werden
 	m_deviceResources->RegisterDeviceNotify(this);
 
+	// Shader und andere Dateien aus dem Asset-Archiv im Installationsordner, falls mitgeliefert, sonst einzeln.
+	std::wstring assetPath = std::wstring(Windows::ApplicationModel::Package::Current->InstalledLocation->Path->Data()) + L"\\Content.ogp";
+	WIN32_FILE_ATTRIBUTE_DATA assetAttributes;
+	if (GetFileAttributesEx(assetPath.c_str(), GetFileExInfoStandard, &assetAttributes))
+	{
+		auto assets = std::make_shared<DX::AssetPack>();
+		assets->Open(assetPath);
+		m_assets = assets;
+	}
+
+	// Das Verzeichnis ist nur ein Cache; fehlt es oder ist es unlesbar, entsteht es im Lauf neu.
+	m_pipelines = std::unique_ptr<DX::D3D11PipelineFactory>(new DX::D3D11PipelineFactory(m_deviceResources, m_assets));
+	m_pipelineManifestPath = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) + L"\\pipelines.ogc";
+	std::ifstream manifest(m_pipelineManifestPath, std::ios::binary);
+	if (manifest)
+	{
+		try
+		{
+			m_pipelines->GetCache().ReadManifest(manifest);
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+	}
+
+	// Die Renderer laden über den ResourceLoader auf den Arbeitsthreads.
+	m_threadPool = std::unique_ptr<DX::ThreadPool>(new DX::ThreadPool());
+	m_resourceLoader = std::unique_ptr<DX::ResourceLoader>(new DX::ResourceLoader(*m_threadPool, MaxResourceReads, MaxResourceDecodes, ResourceStaleFrames));
+
 	// TODO: Dies mit Ihrer App-Inhaltsinitialisierung ersetzen.
-	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources));
+	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources, *m_resourceLoader, *m_pipelines));
+
+	m_fpsTextRenderer = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources, *m_resourceLoader, *m_pipelines));
+
+	m_renderBackend = std::unique_ptr<DX::D3D11RenderBackend>(new DX::D3D11RenderBackend(m_deviceResources));
+
+	// Bekannte Permutationen nach den Pipelines der Renderer erstellen, bevor sie zum ersten Mal gebraucht werden.
+	m_prewarmResources = m_pipelines->Prewarm(*m_resourceLoader, 0.0f);
+
+	// Die Simulation läuft mit festen Zeitschritten in einem eigenen Thread, damit ein durch VSync blockiertes
+	// Present sie nicht ausbremst. Das Aufholbudget verhindert, dass ein langsamer Schritt immer mehr
+	// Aufholschritte nach sich zieht; der Renderer interpoliert zwischen den letzten beiden Zuständen.
+	m_gliders = std::unique_ptr<GliderFleet>(new GliderFleet(GliderParameters()));
+	m_gliders->Add(GliderInitialState::Level(0.0f, 0.0f, 1000.0f, 0.0f, 0.01f, 30.0f));
+
+	// Wind aus Vorhersagedaten, falls eine Gitterdatei im lokalen Ordner der App liegt, sonst leichter Westwind.
+	m_wind = std::unique_ptr<WindField>(new WindField());
+	m_wind->SetUniform(0.0f, 3.0f, 0.0f);
+
+	std::wstring windPath = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) + L"\\wind.ogw";
+	WIN32_FILE_ATTRIBUTE_DATA windAttributes;
+	if (GetFileAttributesEx(windPath.c_str(), GetFileExInfoStandard, &windAttributes))
+	{
+		m_wind->Open(windPath);
+	}
+
+	// Aufgabengebiet von 40 × 40 km.
+	m_thermals = std::unique_ptr<ThermalField>(new ThermalField());
+	m_thermals->Populate(0.0f, 0.0f, 20000.0f, 2000, ThermalClimate(), 1);
+
+	// Hang- und Wellenaufwind über dem Aufgabengebiet im 100-m-Raster, zunächst für den Wind über der Mitte.
+	m_terrain = std::unique_ptr<ProceduralTerrain>(new ProceduralTerrain());
+
+	LiftMapRegion liftRegion = { -20000.0f, -20000.0f, 100.0f, 401, 401 };
+	const ProceduralTerrain& terrain = *m_terrain;
+	m_liftMaps = std::unique_ptr<LiftMapBaker>(new LiftMapBaker(*m_threadPool, liftRegion,
+		[&terrain](float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* heights)
+	{
+		terrain.GetHeights(originN, originE, spacing, countN, countE, heights);
+	}));
+
+	// Geländehöhen für Bodenberührung und Höhe über Grund im 20-m-Raster.
+	HeightFieldRegion heightRegion = { -20000.0f, -20000.0f, 20.0f, 2001, 2001 };
+	m_heightField = std::unique_ptr<TerrainHeightField>(new TerrainHeightField(*m_threadPool, heightRegion,
+		[&terrain](float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* heights)
+	{
+		terrain.GetHeights(originN, originE, spacing, countN, countE, heights);
+	}));
 
-	m_fpsTextRenderer = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources));
+	float wind[3];
+	m_wind->Sample(0.0f, 0.0f, -1000.0f, wind);
+	m_liftMaps->Bake(wind[0], wind[1]);
 
-	// TODO: Timereinstellungen ändern, wenn Sie etwas Anderes möchten als den standardmäßigen variablen Zeitschrittmodus.
-	// z. B. für eine Aktualisierungslogik mit festen 60 FPS-Zeitschritten Folgendes aufrufen:
-	/*
-	m_timer.SetFixedTimeStep(true);
-	m_timer.SetTargetElapsedSeconds(1.0 / 60);
-	*/
+	// Dargestelltes Gelände aus einer Kachelpyramide im lokalen Ordner, sonst prozedural über 409,6 × 409,6 km
+	// mit 25 m Punktabstand in der feinsten Stufe.
+	std::shared_ptr<ITerrainTileSource> terrainSource;
+	std::wstring terrainPath = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) + L"\\terrain.ogt";
+	WIN32_FILE_ATTRIBUTE_DATA terrainAttributes;
+	if (GetFileAttributesEx(terrainPath.c_str(), GetFileExInfoStandard, &terrainAttributes))
+	{
+		auto file = std::make_shared<TerrainTileFile>();
+		file->Open(terrainPath);
+		terrainSource = file;
+	}
+	else
+	{
+		terrainSource = std::make_shared<ProceduralTileSource>(terrain, -204800.0f, -204800.0f, 409600.0f, 9);
+	}
+
+	// Die Netze entstehen beim Laden auf den Arbeitsthreads; der Renderthread lädt sie nur noch hoch.
+	auto meshGenerator = std::make_shared<TerrainMeshGenerator>(terrainSource->GetDescription());
+	m_terrainStreamer = std::unique_ptr<TerrainStreamer>(new TerrainStreamer(*m_threadPool, terrainSource, 128 * 1024 * 1024, 8, meshGenerator));
+	m_terrainStreamer->SetLoadErrorHandler([](const TerrainTileKey& key, const char* message)
+	{
+		std::string text = "Terrain: tile " + std::to_string(key.level) + "/" + std::to_string(key.x) + "/" + std::to_string(key.y) +
+			" failed to load: " + message + "\n";
+		OutputDebugStringA(text.c_str());
+	});
+	m_terrainRenderer = std::unique_ptr<TerrainRenderer>(new TerrainRenderer(m_deviceResources, *m_resourceLoader, *m_pipelines, meshGenerator));
+
+	// Gelände und Szeneobjekte zeichnen ihre Befehle gleichzeitig auf den Arbeitsthreads auf. Das Backend setzt
+	// die Puffer getrennt um, daher bindet jeder Durchgang die Kamera selbst.
+	m_renderPasses.AddPass("RenderPass::Terrain", [this](DX::RenderCommandBuffer& commands, DX::UploadRing& uploads)
+	{
+		BindViewConstants(commands, uploads);
+		m_terrainRenderer->Render(commands, uploads);
+	});
+	m_renderPasses.AddPass("RenderPass::Scene", [this](DX::RenderCommandBuffer& commands, DX::UploadRing& uploads)
+	{
+		BindViewConstants(commands, uploads);
+		m_sceneRenderer->Render(commands, uploads);
+	});
+
+	// Die Anzeige kommt zuletzt und braucht keine Kamera.
+	m_renderPasses.AddPass("RenderPass::Hud", [this](DX::RenderCommandBuffer& commands, DX::UploadRing& uploads)
+	{
+		m_fpsTextRenderer->Render(commands, uploads);
+	});
+
+	// Leichte Turbulenz mit festem Startwert, damit Läufe mit derselben Zeitquelle reproduzierbar bleiben.
+	m_turbulence = std::unique_ptr<Turbulence>(new Turbulence(1));
+
+	m_simulation = std::unique_ptr<SimulationWorker>(new SimulationWorker([this](DX::StepTimer const& timer, SimulationState& state)
+	{
+		StepSimulation(timer, state);
+	}, SimulationStepsPerSecond, MaxSimulationStepsPerFrame));
+	m_simulation->Start();
 }
 
 Open_Glider_SimulatorMain::~Open_Glider_SimulatorMain()
 {
 	// Registrierung der Gerätebenachrichtigung aufheben
 	m_deviceResources->RegisterDeviceNotify(nullptr);
+
+	m_simulation->Stop();
 }
 
 // Aktualisiert den Anwendungszustand, wenn sich die Fenstergröße ändert (z. B. Änderung der Geräteausrichtung)
@@ -43,15 +178,121 @@ void Open_Glider_SimulatorMain::CreateWindowSizeDependentResources()
 // Aktualisiert den Anwendungszustand ein Mal pro Frame.
 void Open_Glider_SimulatorMain::Update() 
 {
-	// Die Szeneobjekte aktualisieren.
+	DX_PROFILE_ZONE("Open_Glider_SimulatorMain::Update");
+
+	// Der Abstand zwischen zwei Update-Aufrufen ist die vollständige Framezeit.
+	const DX::IClock& clock = *m_timer.GetClock();
+	uint64_t frameStartTicks = clock.GetTicks();
+	if (m_lastFrameStartTicks != 0)
+	{
+		m_frameStatistics.Record(DX::FrameStage::Frame, frameStartTicks - m_lastFrameStartTicks);
+	}
+	m_lastFrameStartTicks = frameStartTicks;
+
+	DX::FrameStatistics::ScopedStage stage(m_frameStatistics, DX::FrameStage::Update, clock);
+
+	// Verfallene Streaming-Anforderungen abbrechen, bevor die Renderer neue stellen.
+	m_resourceLoader->Update();
+
+	// Abgeschlossenes Vorwärmen freigeben; eine fehlgeschlagene Permutation wird erst bei Bedarf erneut versucht.
+	m_prewarmResources.erase(std::remove_if(m_prewarmResources.begin(), m_prewarmResources.end(), [this](DX::ResourceId id)
+	{
+		DX::ResourceState state = m_resourceLoader->GetState(id);
+		if (state != DX::ResourceState::Ready && state != DX::ResourceState::Failed && state != DX::ResourceState::Cancelled)
+		{
+			return false;
+		}
+
+		m_resourceLoader->Release(id);
+		return true;
+	}), m_prewarmResources.end());
+
+	// Ohne Simulationsthread wird die Simulation synchron fortgeschrieben.
+	if (!m_simulation->IsRunning())
+	{
+		m_simulation->Tick();
+	}
+
+	// Die Szeneobjekte aus dem neuesten Simulationsschnappschuss aktualisieren.
 	m_timer.Tick([&]()
 	{
-		// TODO: Dies mit Ihren App-Inhaltsupdatefunktionen ersetzen.
-		m_sceneRenderer->Update(m_timer);
-		m_fpsTextRenderer->Update(m_timer);
+		const SimulationSnapshot& snapshot = m_simulation->AcquireLatestSnapshot();
+		m_sceneRenderer->Update(snapshot, m_simulation->GetInterpolationAlpha(snapshot));
+
+		// Geländekacheln für die Verfolgerkamera auswählen; Szenenachsen x = Ost, y = oben, z = Süd.
+		const DirectX::XMFLOAT3& camera = m_sceneRenderer->GetCameraPosition();
+		TerrainView terrainView = { -camera.z, camera.x, camera.y, m_sceneRenderer->GetFieldOfView(), m_deviceResources->GetOutputSize().Height, 2.0f };
+		m_terrainStreamer->Update(terrainView, m_terrainSelection);
+
+		// Das Gelände im Sichtkegel verdeckt, was dahinter liegt: erst als Verdecker rastern, dann Kacheln und
+		// Flugzeuge gegen die Tiefenpyramide prüfen.
+		DirectX::XMFLOAT4X4 viewProjection = m_sceneRenderer->GetViewProjection();
+		m_occlusionBuffer.Begin(viewProjection.m);
+		m_terrainRenderer->Update(m_terrainSelection, *m_terrainStreamer, terrainView, m_sceneRenderer->GetView(), m_sceneRenderer->GetProjection(), m_occlusionBuffer);
+		{
+			DX_PROFILE_ZONE("Open_Glider_SimulatorMain::RasterizeOccluders");
+			m_occlusionBuffer.Rasterize(m_threadPool.get());
+		}
+		m_terrainRenderer->CullOccluded(m_occlusionBuffer);
+		m_sceneRenderer->CullOccluded(m_occlusionBuffer);
+
+		m_fpsTextRenderer->Update(m_timer, m_frameStatistics, m_occlusionBuffer.GetStatistics());
 	});
 }
 
+// Mit einer DX::ManualClock bestimmt der Aufrufer, wie weit jeder Update-Aufruf die Simulation fortschreibt.
+// Die Simulation läuft dann nicht mehr im eigenen Thread, sondern synchron in Update und
+// unabhängig von der Wanduhr so schnell, wie die CPU es erlaubt.
+void Open_Glider_SimulatorMain::SetClock(const std::shared_ptr<DX::IClock>& clock)
+{
+	m_simulation->SetClock(clock);
+	m_timer.SetClock(clock);
+}
+
+void Open_Glider_SimulatorMain::SavePipelineManifest()
+{
+	DX::PipelineCache& cache = m_pipelines->GetCache();
+	if (cache.IsManifestModified())
+	{
+		std::ofstream manifest(m_pipelineManifestPath, std::ios::binary);
+		cache.WriteManifest(manifest);
+	}
+}
+
+// Schreibt die Flugdynamik aller Segelflugzeuge fort und übernimmt ihre Posen in den Simulationszustand.
+void Open_Glider_SimulatorMain::StepSimulation(DX::StepTimer const& timer, SimulationState& state)
+{
+	float deltaSeconds = static_cast<float>(timer.GetElapsedSeconds());
+
+	// Luftbewegung an allen Flugzeugpositionen: Wind aus dem Gitter, darauf die Thermik.
+	uint32_t count = m_gliders->GetPaddedCount();
+	const float* north = m_gliders->GetField(GliderFleet::PositionN);
+	const float* east = m_gliders->GetField(GliderFleet::PositionE);
+	const float* down = m_gliders->GetField(GliderFleet::PositionD);
+	float* airVelocityD = m_gliders->GetField(GliderFleet::AirVelocityD);
+	float* groundHeight = m_gliders->GetField(GliderFleet::GroundHeight);
+
+	m_heightField->GetHeights(north, east, count, groundHeight);
+
+	m_wind->SetTime(static_cast<float>(timer.GetTotalSeconds()));
+	m_wind->Sample(north, east, down, count, m_gliders->GetField(GliderFleet::AirVelocityN), m_gliders->GetField(GliderFleet::AirVelocityE), airVelocityD);
+
+	// Die Thermiken ziehen mit dem Wind in mittlerer Höhe über der Mitte des Aufgabengebiets.
+	float drift[3];
+	m_wind->Sample(0.0f, 0.0f, -1000.0f, drift);
+	m_thermals->SetWind(drift[0], drift[1]);
+	m_thermals->Update(deltaSeconds);
+	m_thermals->Sample(north, east, down, groundHeight, count, airVelocityD);
+
+	// Dreht oder ändert sich der Wind über eine Stufe hinaus, wird die Lift Map im Hintergrund neu berechnet.
+	m_liftMaps->Update(drift[0], drift[1]);
+	m_liftMaps->GetCurrent()->Sample(north, east, down, count, airVelocityD);
+	m_turbulence->Step(deltaSeconds, *m_gliders);
+
+	m_gliders->Step(deltaSeconds);
+	m_gliders->GetPoses(state.gliders);
+}
+
 // Rendert den aktuellen Frame dem aktuellen Anwendungszustand entsprechend.
 // Gibt True zurück, wenn der Frame gerendert wurde und angezeigt werden kann.
 bool Open_Glider_SimulatorMain::Render() 
@@ -62,6 +303,9 @@ bool Open_Glider_SimulatorMain::Render()
 		return false;
 	}
 
+	DX::FrameStatistics::ScopedStage stage(m_frameStatistics, DX::FrameStage::Render, *m_timer.GetClock());
+	DX_PROFILE_ZONE("Open_Glider_SimulatorMain::Render");
+
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
 	// Den Viewport zurücksetzen, damit der gesamte Bildschirm das Ziel ist.
@@ -76,25 +320,60 @@ bool Open_Glider_SimulatorMain::Render()
 	context->ClearRenderTargetView(m_deviceResources->GetBackBufferRenderTargetView(), DirectX::Colors::CornflowerBlue);
 	context->ClearDepthStencilView(m_deviceResources->GetDepthStencilView(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-	// Die Szeneobjekte rendern.
-	// TODO: Dies mit den Inhaltsrenderingfunktionen Ihrer App ersetzen.
-	m_sceneRenderer->Render();
-	m_fpsTextRenderer->Render();
+	// Die Durchgänge parallel aufzeichnen und in fester Reihenfolge ausführen. Die Aufzeichnung ist vom
+	// Grafik-API unabhängig, ihre Kosten erscheinen im Profiler getrennt von der Ausführung.
+	m_renderBackend->BeginFrame();
+
+	// Die Kamera wird einmal je Frame hochgeladen und gilt für alle Durchgänge.
+	DX::UploadRing& uploads = m_renderBackend->GetUploadRing();
+	m_viewConstants = uploads.Upload(m_sceneRenderer->GetViewConstants());
+	if (m_viewConstants.IsValid())
+	{
+		m_renderPasses.Record(uploads, m_threadPool.get());
+		m_renderPasses.Submit(*m_renderBackend, m_threadPool.get());
+	}
+	m_renderBackend->EndFrame();
 
 	return true;
 }
 
+void Open_Glider_SimulatorMain::BindViewConstants(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads) const
+{
+	commands.SetConstantBufferRange(DX::ShaderStageVertex | DX::ShaderStagePixel, ViewConstantsSlot,
+		uploads.GetBuffer(), m_viewConstants.offset, m_viewConstants.size);
+}
+
+// Zeigt den gerenderten Frame an. Die Wartezeit auf die VSync wird als eigener Abschnitt erfasst.
+void Open_Glider_SimulatorMain::Present()
+{
+	DX::FrameStatistics::ScopedStage stage(m_frameStatistics, DX::FrameStage::Present, *m_timer.GetClock());
+	DX_PROFILE_ZONE("Open_Glider_SimulatorMain::Present");
+	m_deviceResources->Present();
+}
+
 // Weist Renderer darauf hin, dass die Geräteressourcen freigegeben werden müssen.
 void Open_Glider_SimulatorMain::OnDeviceLost()
 {
+	// Vorab erstellte Pipelines benutzen das Gerät auf den Arbeitsthreads; sie müssen vor seiner Freigabe enden.
+	for (DX::ResourceId id : m_prewarmResources)
+	{
+		m_resourceLoader->ReleaseAndWait(id);
+	}
+	m_prewarmResources.clear();
+
+	m_renderBackend->ReleaseDeviceDependentResources();
 	m_sceneRenderer->ReleaseDeviceDependentResources();
+	m_terrainRenderer->ReleaseDeviceDependentResources();
 	m_fpsTextRenderer->ReleaseDeviceDependentResources();
+	m_pipelines->ReleaseDeviceDependentResources();
 }
 
 // Weist Renderer darauf hin, dass die Geräteressourcen jetzt erstellt werden können.
 void Open_Glider_SimulatorMain::OnDeviceRestored()
 {
+	m_renderBackend->CreateDeviceDependentResources();
 	m_sceneRenderer->CreateDeviceDependentResources();
+	m_terrainRenderer->CreateDeviceDependentResources();
 	m_fpsTextRenderer->CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
 }
@@ -1,9 +1,25 @@
 ﻿#pragma once
 
 #include "Common\StepTimer.h"
+#include "Common\FrameStatistics.h"
+#include "Common\ThreadPool.h"
+#include "Common\ResourceLoader.h"
+#include "Common\OcclusionBuffer.h"
 #include "Common\DeviceResources.h"
+#include "Common\D3D11RenderBackend.h"
+#include "Common\D3D11PipelineFactory.h"
+#include "Common\RenderPassRecorder.h"
 #include "Content\Sample3DSceneRenderer.h"
 #include "Content\SampleFpsTextRenderer.h"
+#include "Content\TerrainRenderer.h"
+#include "Simulation\SimulationWorker.h"
+#include "Simulation\ThermalField.h"
+#include "Simulation\WindField.h"
+#include "Simulation\LiftMap.h"
+#include "Simulation\Turbulence.h"
+#include "Terrain\ProceduralTerrain.h"
+#include "Terrain\TerrainHeightField.h"
+#include "Terrain\TerrainStreamer.h"
 
 // Rendert Direct2D- und 3D-Inhalt auf dem Bildschirm.
 namespace Open_Glider_Simulator
@@ -16,20 +32,91 @@ namespace Open_Glider_Simulator
 		void CreateWindowSizeDependentResources();
 		void Update();
 		bool Render();
+		void Present();
+
+		// Ersetzt die Zeitquelle der Simulation, z. B. durch eine DX::ManualClock für Läufe schneller als Echtzeit.
+		void SetClock(const std::shared_ptr<DX::IClock>& clock);
+
+		// Speichert das Verzeichnis der verwendeten Pipelines, falls neue hinzugekommen sind.
+		void SavePipelineManifest();
+
 
 		// IDeviceNotify
 		virtual void OnDeviceLost();
 		virtual void OnDeviceRestored();
 
 	private:
+		// Läuft auf dem Simulationsthread: schreibt den Simulationszustand um einen festen Zeitschritt fort.
+		void StepSimulation(DX::StepTimer const& timer, SimulationState& state);
+
+		// Bindet die Kamera des Frames am Anfang eines Durchgangs.
+		void BindViewConstants(DX::RenderCommandBuffer& commands, DX::UploadRing& uploads) const;
+
+		// Simulationsrate und Aufholbudget des festen Zeitschritts.
+		static const uint32 SimulationStepsPerSecond = 120;
+		static const uint32 MaxSimulationStepsPerFrame = 8;
+
+		// Auflösung des Verdeckungspuffers; grob genug für einige Zehntel Millisekunden auf den Arbeitsthreads.
+		static const uint32 OcclusionBufferWidth = 256;
+		static const uint32 OcclusionBufferHeight = 128;
+
+		// Gleichzeitige Lese- und Aufbereitungsstufen des Laders; Streaming-Anforderungen verfallen nach so vielen
+		// Frames ohne Erneuerung.
+		static const uint32 MaxResourceReads = 4;
+		static const uint32 MaxResourceDecodes = 2;
+		static const uint32 ResourceStaleFrames = 30;
+
 		// Zeiger in den Geräteressourcen zwischengespeichert.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
+		// Asset-Archiv des App-Pakets oder nullptr, wenn die Dateien einzeln vorliegen.
+		std::shared_ptr<const DX::AssetPack> m_assets;
+
+		// Pipeline-Cache aller Renderer. Pipelines aus dem Verzeichnis des letzten Laufs werden beim Start
+		// auf den Arbeitsthreads vorab erstellt.
+		std::unique_ptr<DX::D3D11PipelineFactory> m_pipelines;
+		std::wstring m_pipelineManifestPath;
+
 		// TODO: Mit Ihren eigenen Inhaltsrenderern ersetzen.
 		std::unique_ptr<Sample3DSceneRenderer> m_sceneRenderer;
 		std::unique_ptr<SampleFpsTextRenderer> m_fpsTextRenderer;
 
+		// Die 3D-Renderer zeichnen ihre Befehle je Durchgang auf, das Backend führt sie auf dem Gerätekontext aus.
+		// Daten für nur einen Frame legen sie im UploadRing des Backends ab.
+		DX::RenderPassRecorder m_renderPasses;
+		DX::UploadAllocation m_viewConstants;
+		std::unique_ptr<DX::D3D11RenderBackend> m_renderBackend;
+
+		// Arbeitsthreads für parallelisierbare Aufgaben aller Subsysteme.
+		std::unique_ptr<DX::ThreadPool> m_threadPool;
+
+		// Lädt Shader und Gerätepuffer der Renderer auf den Arbeitsthreads und wird daher vor ihnen abgebaut.
+		std::unique_ptr<DX::ResourceLoader> m_resourceLoader;
+		std::vector<DX::ResourceId> m_prewarmResources;
+
+		// Gelände als Kachelpyramide. Der Streamer lädt auf den Arbeitsthreads nach und wird daher vor ihnen abgebaut.
+		std::unique_ptr<TerrainStreamer> m_terrainStreamer;
+		std::unique_ptr<TerrainRenderer> m_terrainRenderer;
+		std::vector<std::shared_ptr<const TerrainTile>> m_terrainSelection;
+
+		// Tiefenpuffer der CPU, in den das Gelände im Sichtkegel gerastert wird, um verdeckte Kacheln und Objekte zu verwerfen.
+		DX::OcclusionBuffer m_occlusionBuffer;
+
+		// Simulation mit festen Zeitschritten in einem eigenen Thread. Die Flugdynamik gehört dem Simulationsthread.
+		std::unique_ptr<ProceduralTerrain> m_terrain;
+		std::unique_ptr<TerrainHeightField> m_heightField;
+		std::unique_ptr<GliderFleet> m_gliders;
+		std::unique_ptr<WindField> m_wind;
+		std::unique_ptr<ThermalField> m_thermals;
+		std::unique_ptr<LiftMapBaker> m_liftMaps;
+		std::unique_ptr<Turbulence> m_turbulence;
+		std::unique_ptr<SimulationWorker> m_simulation;
+
 		// Schleifentimer wird gerendert.
 		DX::StepTimer m_timer;
+
+		// Zeiten der Frameabschnitte für die Anzeige.
+		DX::FrameStatistics m_frameStatistics;
+		uint64_t m_lastFrameStartTicks;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,283 @@
+﻿#include "AeroTable.h"
+
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include "FlightDynamics.h"
+#include "../Common/SimdMath.h"
+
+using namespace Open_Glider_Simulator;
+using namespace DX::Simd;
+
+namespace
+{
+	const uint32_t FileMagic = 0x5441474f;	// "OGAT"
+	const uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		uint32_t		magic;
+		uint32_t		version;
+		AeroTableAxis	axes[3];
+	};
+
+	bool IsValidAxis(const AeroTableAxis& axis)
+	{
+		return axis.count >= 2 && std::isfinite(axis.minimum) && std::isfinite(axis.maximum) && axis.maximum > axis.minimum;
+	}
+
+	// Anzahl der Stützpunkte über alle Achsen oder 0, wenn eine Achse ungültig ist oder es zu viele werden.
+	// Gerechnet wird in 64 Bit, damit das Produkt der Anzahlen nicht überläuft.
+	size_t GetNodeCount(const AeroTableAxis* axes, uint32_t maxNodeCount)
+	{
+		uint64_t nodeCount = 1;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			if (!IsValidAxis(axes[axis]))
+			{
+				return 0;
+			}
+
+			nodeCount *= axes[axis].count;
+			if (nodeCount > maxNodeCount)
+			{
+				return 0;
+			}
+		}
+		return static_cast<size_t>(nodeCount);
+	}
+
+	inline float AxisValue(const AeroTableAxis& axis, uint32_t index)
+	{
+		return axis.count > 1 ? axis.minimum + (axis.maximum - axis.minimum) * index / (axis.count - 1) : axis.minimum;
+	}
+
+	inline float Clamp(float value, float low, float high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+}
+
+AeroTable::AeroTable()
+{
+	for (auto& axis : m_axes)
+	{
+		axis.minimum = 0.0f;
+		axis.maximum = 0.0f;
+		axis.count = 0;
+	}
+}
+
+AeroTable AeroTable::Bake(const AeroTableAxis& alpha, const AeroTableAxis& beta, const AeroTableAxis& flap, const PolarFunction& polar)
+{
+	AeroTable table;
+	table.m_axes[0] = alpha;
+	table.m_axes[1] = beta;
+	table.m_axes[2] = flap;
+
+	size_t nodeCount = GetNodeCount(table.m_axes, MaxNodeCount);
+	if (nodeCount == 0)
+	{
+		throw std::invalid_argument("AeroTable: jede Achse benötigt endliche, aufsteigende Grenzen und mindestens zwei Stützpunkte.");
+	}
+	table.m_nodes.resize(nodeCount * NodeFloats, 0.0f);
+
+	float* node = table.m_nodes.data();
+	for (uint32_t k = 0; k < flap.count; k++)
+	{
+		for (uint32_t j = 0; j < beta.count; j++)
+		{
+			for (uint32_t i = 0; i < alpha.count; i++)
+			{
+				AeroCoefficients coefficients = polar(AxisValue(alpha, i), AxisValue(beta, j), AxisValue(flap, k));
+				node[0] = coefficients.lift;
+				node[1] = coefficients.drag;
+				node[2] = coefficients.pitch;
+				node += NodeFloats;
+			}
+		}
+	}
+
+	return table;
+}
+
+// Unterhalb des Strömungsabrisses gelten die linearen Derivative, darüber geht die Polare in die einer
+// angeströmten ebenen Platte über. Schiebewinkel verringern den wirksamen Auftrieb und erhöhen den Widerstand.
+AeroCoefficients AeroTable::EvaluatePolar(const GliderParameters& p, float alpha, float beta, float flap)
+{
+	const float flapLift = 0.3f;
+	const float flapDrag = 0.006f;
+	const float flapPitch = -0.04f;
+	const float stallWidth = 0.12f;
+
+	float linearLift = p.liftZero + flapLift * flap + p.liftPerAlpha * alpha;
+	float stallAlpha = (p.liftMax - p.liftZero - flapLift * flap) / p.liftPerAlpha;
+	float negativeStallAlpha = (-p.liftMax - p.liftZero - flapLift * flap) / p.liftPerAlpha;
+
+	// Übergangsgewicht 0 (anliegende Strömung) bis 1 (abgerissen).
+	float beyond = alpha > stallAlpha ? alpha - stallAlpha : (alpha < negativeStallAlpha ? negativeStallAlpha - alpha : 0.0f);
+	float stalled = Clamp(beyond / stallWidth, 0.0f, 1.0f);
+
+	float attachedLift = Clamp(linearLift, -p.liftMax, p.liftMax);
+	float plateLift = 2.0f * std::sin(alpha) * std::cos(alpha);
+	float lift = attachedLift + (plateLift - attachedLift) * stalled;
+
+	float attachedDrag = p.dragZero + flapDrag * flap * flap + p.dragInduced * attachedLift * attachedLift;
+	float plateDrag = 2.0f * std::sin(alpha) * std::sin(alpha) + p.dragZero;
+	float drag = attachedDrag + (plateDrag - attachedDrag) * stalled;
+
+	float sideslip = std::cos(beta);
+	AeroCoefficients coefficients;
+	coefficients.lift = lift * sideslip * sideslip;
+	coefficients.drag = drag + 0.1f * beta * beta;
+	coefficients.pitch = p.pitchZero + flapPitch * flap + p.pitchPerAlpha * alpha;
+	return coefficients;
+}
+
+AeroTable AeroTable::BakeFromParameters(const GliderParameters& parameters)
+{
+	const float degree = 3.14159265f / 180.0f;
+
+	AeroTableAxis alpha = { -45.0f * degree, 45.0f * degree, 91 };
+	AeroTableAxis beta = { -30.0f * degree, 30.0f * degree, 13 };
+	AeroTableAxis flap = { -1.0f, 1.0f, 5 };
+
+	return Bake(alpha, beta, flap, [&](float a, float b, float f)
+	{
+		return EvaluatePolar(parameters, a, b, f);
+	});
+}
+
+void AeroTable::Write(std::ostream& stream) const
+{
+	FileHeader header;
+	header.magic = FileMagic;
+	header.version = FileVersion;
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		header.axes[axis] = m_axes[axis];
+	}
+
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char*>(m_nodes.data()), m_nodes.size() * sizeof(float));
+}
+
+AeroTable AeroTable::Read(std::istream& stream)
+{
+	FileHeader header;
+	if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != FileMagic || header.version != FileVersion)
+	{
+		throw std::runtime_error("AeroTable: unbekanntes Dateiformat.");
+	}
+
+	size_t nodeCount = GetNodeCount(header.axes, MaxNodeCount);
+	if (nodeCount == 0)
+	{
+		throw std::runtime_error("AeroTable: ungültige Achse.");
+	}
+
+	AeroTable table;
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		table.m_axes[axis] = header.axes[axis];
+	}
+
+	table.m_nodes.resize(nodeCount * NodeFloats);
+	if (!stream.read(reinterpret_cast<char*>(table.m_nodes.data()), table.m_nodes.size() * sizeof(float)))
+	{
+		throw std::runtime_error("AeroTable: Datei ist unvollständig.");
+	}
+
+	return table;
+}
+
+AeroTable AeroTable::LoadFromFile(const std::string& path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+	{
+		throw std::runtime_error("AeroTable: Datei kann nicht geöffnet werden: " + path);
+	}
+
+	return Read(stream);
+}
+
+void AeroTable::Sample(const float* alpha, const float* beta, const float* flap, uint32_t count, float* lift, float* drag, float* pitch) const
+{
+	const AeroTableAxis& a = m_axes[0];
+	const AeroTableAxis& b = m_axes[1];
+	const AeroTableAxis& f = m_axes[2];
+
+	// Eingaben in Stützpunktkoordinaten umrechnen; die Zelle wird so begrenzt, dass Index + 1 gültig bleibt.
+	const Vec4 scaleA = Set((a.count - 1) / (a.maximum - a.minimum));
+	const Vec4 scaleB = Set((b.count - 1) / (b.maximum - b.minimum));
+	const Vec4 scaleF = Set((f.count - 1) / (f.maximum - f.minimum));
+	const Vec4 maxA = Set(static_cast<float>(a.count - 1));
+	const Vec4 maxB = Set(static_cast<float>(b.count - 1));
+	const Vec4 maxF = Set(static_cast<float>(f.count - 1));
+	const Vec4 maxCellA = Set(static_cast<float>(a.count - 2));
+	const Vec4 maxCellB = Set(static_cast<float>(b.count - 2));
+	const Vec4 maxCellF = Set(static_cast<float>(f.count - 2));
+	const Vec4 zero = Zero();
+
+	const size_t strideB = static_cast<size_t>(a.count) * NodeFloats;
+	const size_t strideF = strideB * b.count;
+	const Vec4 nodeStride = Set(static_cast<float>(NodeFloats));
+	const Vec4 strideBVector = Set(static_cast<float>(strideB));
+	const Vec4 strideFVector = Set(static_cast<float>(strideF));
+	const float* nodes = m_nodes.data();
+
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		Vec4 x = Clamp((Load(alpha + i) - Set(a.minimum)) * scaleA, zero, maxA);
+		Vec4 y = Clamp((Load(beta + i) - Set(b.minimum)) * scaleB, zero, maxB);
+		Vec4 z = Clamp((Load(flap + i) - Set(f.minimum)) * scaleF, zero, maxF);
+
+		Vec4 cellX = Min(Floor(x), maxCellA);
+		Vec4 cellY = Min(Floor(y), maxCellB);
+		Vec4 cellZ = Min(Floor(z), maxCellF);
+
+		// Der Versatz des ersten Eckpunkts bleibt nach MaxNodeCount unter 2^24 und ist als Gleitkommazahl exakt.
+		alignas(16) int32_t offset[4];
+		alignas(16) float weightX[4], weightY[4], weightZ[4];
+		StoreInt(offset, cellZ * strideFVector + cellY * strideBVector + cellX * nodeStride);
+		Store(weightX, x - cellX);
+		Store(weightY, y - cellY);
+		Store(weightZ, z - cellZ);
+
+		// Je Flugzeug die acht Eckpunkte laden; jeder enthält alle drei Beiwerte in einem Vektor.
+		alignas(16) float results[4][4];
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			const float* corner = nodes + offset[lane];
+			Vec4 tx = Set(weightX[lane]);
+			Vec4 ty = Set(weightY[lane]);
+			Vec4 tz = Set(weightZ[lane]);
+
+			Vec4 c00 = Lerp(Load(corner), Load(corner + NodeFloats), tx);
+			Vec4 c10 = Lerp(Load(corner + strideB), Load(corner + strideB + NodeFloats), tx);
+			Vec4 c01 = Lerp(Load(corner + strideF), Load(corner + strideF + NodeFloats), tx);
+			Vec4 c11 = Lerp(Load(corner + strideF + strideB), Load(corner + strideF + strideB + NodeFloats), tx);
+
+			Store(results[lane], Lerp(Lerp(c00, c10, ty), Lerp(c01, c11, ty), tz));
+		}
+
+		Store(lift + i, Set(results[0][0], results[1][0], results[2][0], results[3][0]));
+		Store(drag + i, Set(results[0][1], results[1][1], results[2][1], results[3][1]));
+		Store(pitch + i, Set(results[0][2], results[1][2], results[2][2], results[3][2]));
+	}
+}
+
+AeroCoefficients AeroTable::Sample(float alpha, float beta, float flap) const
+{
+	alignas(16) float a[4] = { alpha, alpha, alpha, alpha };
+	alignas(16) float b[4] = { beta, beta, beta, beta };
+	alignas(16) float f[4] = { flap, flap, flap, flap };
+	alignas(16) float lift[4], drag[4], pitch[4];
+
+	Sample(a, b, f, 4, lift, drag, pitch);
+
+	AeroCoefficients coefficients = { lift[0], drag[0], pitch[0] };
+	return coefficients;
+}
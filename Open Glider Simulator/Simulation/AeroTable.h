@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include "../Common/AlignedAllocator.h"
+
+namespace Open_Glider_Simulator
+{
+	struct GliderParameters;
+
+	// Gleichmäßig geteilte Tabellenachse. Werte außerhalb des Bereichs werden auf den Rand begrenzt.
+	struct AeroTableAxis
+	{
+		float		minimum;
+		float		maximum;
+		uint32_t	count;
+	};
+
+	// Statische Beiwerte an einem Stützpunkt: Auftrieb, Widerstand, Nickmoment.
+	struct AeroCoefficients
+	{
+		float lift;
+		float drag;
+		float pitch;
+	};
+
+	// Vorberechnete Polare eines Musters über Anstellwinkel, Schiebewinkel und Wölbklappenstellung.
+	// Jeder Stützpunkt belegt 16 Byte (CL, CD, Cm, frei), sodass er mit einem SIMD-Ladebefehl gelesen wird;
+	// die Daten liegen auf Cachezeilen ausgerichtet mit dem Anstellwinkel als schnellster Achse.
+	// Die Zuladung (Wasserballast) verändert Masse und Trägheit in GliderParameters, nicht die Beiwerte.
+	class AeroTable
+	{
+	public:
+		typedef std::function<AeroCoefficients(float alpha, float beta, float flap)> PolarFunction;
+
+		// Sample rechnet Stützpunktversätze als Gleitkommazahlen; bis 2^24 Floats sind sie exakt.
+		static const uint32_t MaxNodeCount = (1 << 24) / 4;
+
+		AeroTable();
+
+		// Die Polare an allen Stützpunkten auswerten. Jede Achse braucht endliche Grenzen mit maximum > minimum
+		// und mindestens zwei Stützpunkte, alle Achsen zusammen höchstens MaxNodeCount.
+		static AeroTable Bake(const AeroTableAxis& alpha, const AeroTableAxis& beta, const AeroTableAxis& flap, const PolarFunction& polar);
+
+		// Polare aus den Derivativen eines Musters mit Strömungsabriss und Wölbklappeneinfluss.
+		static AeroTable BakeFromParameters(const GliderParameters& parameters);
+		static AeroCoefficients EvaluatePolar(const GliderParameters& parameters, float alpha, float beta, float flap);
+
+		// Binärformat: Kopf mit Achsen, danach die Stützpunkte unverändert. Beim Laden wird nichts geparst.
+		void Write(std::ostream& stream) const;
+		static AeroTable Read(std::istream& stream);
+		static AeroTable LoadFromFile(const std::string& path);
+
+		// Trilineare Interpolation für count Flugzeuge (Vielfaches von vier), jeweils vier gleichzeitig.
+		void Sample(const float* alpha, const float* beta, const float* flap, uint32_t count, float* lift, float* drag, float* pitch) const;
+
+		// Einzelnen Punkt abfragen, z. B. für Anzeigen.
+		AeroCoefficients Sample(float alpha, float beta, float flap) const;
+
+		bool IsEmpty() const								{ return m_nodes.empty(); }
+		const AeroTableAxis& GetAxis(uint32_t axis) const	{ return m_axes[axis]; }
+
+	private:
+		static const uint32_t NodeFloats = 4;
+		static_assert(MaxNodeCount * NodeFloats <= (1 << 24), "Stützpunktversätze müssen als float exakt bleiben.");
+
+		AeroTableAxis				m_axes[3];
+		DX::AlignedVector<float>	m_nodes;
+	};
+}
@@ -0,0 +1,369 @@
+﻿#include "FlightDynamics.h"
+
+#include <cmath>
+#include "AeroTable.h"
+#include "../Common/SimdMath.h"
+
+using namespace Open_Glider_Simulator;
+using namespace DX::Simd;
+
+// Standardwerte eines doppelsitzigen Schulflugzeugs der 17-m-Klasse.
+GliderParameters::GliderParameters() :
+	mass(500.0f),
+	wingArea(17.95f),
+	wingSpan(17.0f),
+	meanChord(1.06f),
+	inertiaX(4000.0f),
+	inertiaY(1000.0f),
+	inertiaZ(5000.0f),
+	liftZero(0.35f),
+	liftPerAlpha(5.3f),
+	liftPerPitchRate(4.0f),
+	liftPerElevator(0.4f),
+	liftMax(1.4f),
+	dragZero(0.012f),
+	dragInduced(0.022f),
+	sidePerBeta(-0.3f),
+	rollPerBeta(-0.05f),
+	rollPerRollRate(-0.6f),
+	rollPerYawRate(0.15f),
+	rollPerAileron(0.2f),
+	pitchZero(0.03f),
+	pitchPerAlpha(-0.8f),
+	pitchPerPitchRate(-12.0f),
+	pitchPerElevator(-1.2f),
+	yawPerBeta(0.06f),
+	yawPerRollRate(-0.05f),
+	yawPerYawRate(-0.08f),
+	yawPerRudder(-0.06f)
+{
+}
+
+GliderInitialState GliderInitialState::Level(float north, float east, float altitude, float heading, float pitch, float speed)
+{
+	// Lage aus Kurs (um die Hochachse) und Längsneigung (um die Querachse).
+	float cy = std::cos(heading * 0.5f);
+	float sy = std::sin(heading * 0.5f);
+	float cp = std::cos(pitch * 0.5f);
+	float sp = std::sin(pitch * 0.5f);
+
+	GliderInitialState state;
+	state.pose.position[0] = north;
+	state.pose.position[1] = east;
+	state.pose.position[2] = -altitude;
+	state.pose.orientation[0] = cy * cp;
+	state.pose.orientation[1] = -sy * sp;
+	state.pose.orientation[2] = cy * sp;
+	state.pose.orientation[3] = sy * cp;
+	state.velocity[0] = speed * std::cos(heading);
+	state.velocity[1] = speed * std::sin(heading);
+	state.velocity[2] = 0.0f;
+	return state;
+}
+
+GliderFleet::GliderFleet(const GliderParameters& parameters) :
+	m_parameters(parameters),
+	m_aeroTable(std::make_shared<AeroTable>(AeroTable::BakeFromParameters(parameters))),
+	m_count(0)
+{
+}
+
+GliderFleet::~GliderFleet()
+{
+}
+
+void GliderFleet::SetAeroTable(const std::shared_ptr<const AeroTable>& table)
+{
+	m_aeroTable = table;
+}
+
+uint32_t GliderFleet::Add(const GliderInitialState& initialState)
+{
+	uint32_t index = m_count++;
+
+	// Auf ein Vielfaches von vier auffüllen. Die Füllplätze erhalten einen gültigen Zustand,
+	// damit die SIMD-Berechnung dort keine ungültigen Werte erzeugt.
+	if (index >= GetPaddedCount())
+	{
+		for (uint32_t field = 0; field < FieldCount; field++)
+		{
+			m_fields[field].resize(index + 4, 0.0f);
+		}
+
+		for (uint32_t lane = index; lane < index + 4; lane++)
+		{
+			SetLane(lane, initialState);
+		}
+	}
+
+	SetLane(index, initialState);
+	return index;
+}
+
+void GliderFleet::SetLane(uint32_t index, const GliderInitialState& state)
+{
+	m_fields[PositionN][index] = state.pose.position[0];
+	m_fields[PositionE][index] = state.pose.position[1];
+	m_fields[PositionD][index] = state.pose.position[2];
+	m_fields[VelocityN][index] = state.velocity[0];
+	m_fields[VelocityE][index] = state.velocity[1];
+	m_fields[VelocityD][index] = state.velocity[2];
+	m_fields[AttitudeW][index] = state.pose.orientation[0];
+	m_fields[AttitudeX][index] = state.pose.orientation[1];
+	m_fields[AttitudeY][index] = state.pose.orientation[2];
+	m_fields[AttitudeZ][index] = state.pose.orientation[3];
+	m_fields[RollRate][index] = 0.0f;
+	m_fields[PitchRate][index] = 0.0f;
+	m_fields[YawRate][index] = 0.0f;
+	m_fields[Elevator][index] = 0.0f;
+	m_fields[Aileron][index] = 0.0f;
+	m_fields[Rudder][index] = 0.0f;
+	m_fields[Flap][index] = 0.0f;
+	m_fields[AirVelocityN][index] = 0.0f;
+	m_fields[AirVelocityE][index] = 0.0f;
+	m_fields[AirVelocityD][index] = 0.0f;
+	m_fields[GroundHeight][index] = 0.0f;
+}
+
+void GliderFleet::SetControls(uint32_t index, const GliderControls& controls)
+{
+	m_fields[Elevator][index] = controls.elevator;
+	m_fields[Aileron][index] = controls.aileron;
+	m_fields[Rudder][index] = controls.rudder;
+	m_fields[Flap][index] = controls.flap;
+}
+
+GliderPose GliderFleet::GetPose(uint32_t index) const
+{
+	GliderPose pose;
+	pose.position[0] = m_fields[PositionN][index];
+	pose.position[1] = m_fields[PositionE][index];
+	pose.position[2] = m_fields[PositionD][index];
+	pose.orientation[0] = m_fields[AttitudeW][index];
+	pose.orientation[1] = m_fields[AttitudeX][index];
+	pose.orientation[2] = m_fields[AttitudeY][index];
+	pose.orientation[3] = m_fields[AttitudeZ][index];
+	return pose;
+}
+
+void GliderFleet::GetPoses(std::vector<GliderPose>& poses) const
+{
+	poses.resize(m_count);
+	for (uint32_t index = 0; index < m_count; index++)
+	{
+		poses[index] = GetPose(index);
+	}
+}
+
+void GliderFleet::Step(float deltaSeconds)
+{
+	FlushDenormals flushDenormals;
+
+	ComputeAirData();
+	ComputeCoefficients();
+	Integrate(deltaSeconds);
+}
+
+namespace
+{
+	// Rotationsmatrix (Körper zu Welt) aus einem Einheitsquaternion.
+	struct Rotation
+	{
+		Vec4 m[3][3];
+
+		Rotation(Vec4 w, Vec4 x, Vec4 y, Vec4 z)
+		{
+			Vec4 one = Set(1.0f);
+			Vec4 two = Set(2.0f);
+			m[0][0] = one - two * (y * y + z * z);
+			m[0][1] = two * (x * y - w * z);
+			m[0][2] = two * (x * z + w * y);
+			m[1][0] = two * (x * y + w * z);
+			m[1][1] = one - two * (x * x + z * z);
+			m[1][2] = two * (y * z - w * x);
+			m[2][0] = two * (x * z - w * y);
+			m[2][1] = two * (y * z + w * x);
+			m[2][2] = one - two * (x * x + y * y);
+		}
+	};
+
+	// Luftdichte der Standardatmosphäre, quadratisch angenähert (besser als 1 % bis 5000 m).
+	inline Vec4 StandardAirDensity(Vec4 altitude)
+	{
+		Vec4 h = Clamp(altitude, Set(0.0f), Set(6000.0f));
+		return MultiplyAdd(MultiplyAdd(Set(3.76e-9f), h, Set(-1.166e-4f)), h, Set(1.225f));
+	}
+}
+
+// Anströmung in Körperachsen, Anstell- und Schiebewinkel, Staudruck und normierte Drehraten.
+void GliderFleet::ComputeAirData()
+{
+	const Vec4 half = Set(0.5f);
+	const Vec4 minimumAirspeed = Set(1.0f);
+	const Vec4 halfSpan = Set(0.5f * m_parameters.wingSpan);
+	const Vec4 halfChord = Set(0.5f * m_parameters.meanChord);
+
+	uint32_t count = GetPaddedCount();
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		Rotation rotation(Load(&m_fields[AttitudeW][i]), Load(&m_fields[AttitudeX][i]), Load(&m_fields[AttitudeY][i]), Load(&m_fields[AttitudeZ][i]));
+
+		// Geschwindigkeit gegenüber der Luftmasse, in Körperachsen gedreht (transponierte Rotation).
+		Vec4 relativeN = Load(&m_fields[VelocityN][i]) - Load(&m_fields[AirVelocityN][i]);
+		Vec4 relativeE = Load(&m_fields[VelocityE][i]) - Load(&m_fields[AirVelocityE][i]);
+		Vec4 relativeD = Load(&m_fields[VelocityD][i]) - Load(&m_fields[AirVelocityD][i]);
+
+		Vec4 u = rotation.m[0][0] * relativeN + rotation.m[1][0] * relativeE + rotation.m[2][0] * relativeD;
+		Vec4 v = rotation.m[0][1] * relativeN + rotation.m[1][1] * relativeE + rotation.m[2][1] * relativeD;
+		Vec4 w = rotation.m[0][2] * relativeN + rotation.m[1][2] * relativeE + rotation.m[2][2] * relativeD;
+
+		Vec4 airspeed = Max(Sqrt(u * u + v * v + w * w), minimumAirspeed);
+		Vec4 density = StandardAirDensity(-Load(&m_fields[PositionD][i]));
+
+		Vec4 symmetricSpeed = Max(Sqrt(u * u + w * w), Set(1e-3f));
+		Store(&m_fields[Alpha][i], Atan2(w, u));
+		Store(&m_fields[CosAlpha][i], u / symmetricSpeed);
+		Store(&m_fields[SinAlpha][i], w / symmetricSpeed);
+		Store(&m_fields[Beta][i], Atan2(v, symmetricSpeed));
+		Store(&m_fields[Airspeed][i], airspeed);
+		Store(&m_fields[AirDensity][i], density);
+		Store(&m_fields[DynamicPressure][i], half * density * airspeed * airspeed);
+
+		Vec4 inverseAirspeed = Set(1.0f) / airspeed;
+		Store(&m_fields[NormalizedRollRate][i], Load(&m_fields[RollRate][i]) * halfSpan * inverseAirspeed);
+		Store(&m_fields[NormalizedPitchRate][i], Load(&m_fields[PitchRate][i]) * halfChord * inverseAirspeed);
+		Store(&m_fields[NormalizedYawRate][i], Load(&m_fields[YawRate][i]) * halfSpan * inverseAirspeed);
+	}
+}
+
+// Statische Beiwerte aus der Polarentabelle, darauf die linearen Anteile von Drehraten und Rudern.
+// Der Zusatzauftrieb durch das Höhenruder erhöht den induzierten Widerstand entsprechend.
+void GliderFleet::ComputeCoefficients()
+{
+	const GliderParameters& p = m_parameters;
+
+	uint32_t count = GetPaddedCount();
+	m_aeroTable->Sample(&m_fields[Alpha][0], &m_fields[Beta][0], &m_fields[Flap][0], count,
+		&m_fields[LiftCoefficient][0], &m_fields[DragCoefficient][0], &m_fields[PitchCoefficient][0]);
+
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		Vec4 beta = Load(&m_fields[Beta][i]);
+		Vec4 rollRate = Load(&m_fields[NormalizedRollRate][i]);
+		Vec4 pitchRate = Load(&m_fields[NormalizedPitchRate][i]);
+		Vec4 yawRate = Load(&m_fields[NormalizedYawRate][i]);
+		Vec4 elevator = Load(&m_fields[Elevator][i]);
+		Vec4 aileron = Load(&m_fields[Aileron][i]);
+		Vec4 rudder = Load(&m_fields[Rudder][i]);
+
+		Vec4 staticLift = Load(&m_fields[LiftCoefficient][i]);
+		Vec4 lift = staticLift + Set(p.liftPerPitchRate) * pitchRate + Set(p.liftPerElevator) * elevator;
+
+		Store(&m_fields[LiftCoefficient][i], lift);
+		Store(&m_fields[DragCoefficient][i], Load(&m_fields[DragCoefficient][i]) + Set(p.dragInduced) * (lift * lift - staticLift * staticLift));
+		Store(&m_fields[SideCoefficient][i], Set(p.sidePerBeta) * beta);
+		Store(&m_fields[RollCoefficient][i], Set(p.rollPerBeta) * beta + Set(p.rollPerRollRate) * rollRate + Set(p.rollPerYawRate) * yawRate + Set(p.rollPerAileron) * aileron);
+		Store(&m_fields[PitchCoefficient][i], Load(&m_fields[PitchCoefficient][i]) + Set(p.pitchPerPitchRate) * pitchRate + Set(p.pitchPerElevator) * elevator);
+		Store(&m_fields[YawCoefficient][i], Set(p.yawPerBeta) * beta + Set(p.yawPerRollRate) * rollRate + Set(p.yawPerYawRate) * yawRate + Set(p.yawPerRudder) * rudder);
+	}
+}
+
+// Kräfte und Momente aus den Beiwerten, anschließend semi-implizites Euler-Verfahren:
+// zuerst Geschwindigkeiten und Drehraten, dann Position und Lage mit den neuen Werten.
+void GliderFleet::Integrate(float deltaSeconds)
+{
+	const GliderParameters& p = m_parameters;
+	const Vec4 dt = Set(deltaSeconds);
+	const Vec4 zero = Zero();
+	const Vec4 half = Set(0.5f);
+	const Vec4 gravity = Set(9.80665f);
+	const Vec4 inverseMass = Set(1.0f / p.mass);
+	const Vec4 area = Set(p.wingArea);
+	const Vec4 areaSpan = Set(p.wingArea * p.wingSpan);
+	const Vec4 areaChord = Set(p.wingArea * p.meanChord);
+	const Vec4 inertiaX = Set(p.inertiaX);
+	const Vec4 inertiaY = Set(p.inertiaY);
+	const Vec4 inertiaZ = Set(p.inertiaZ);
+	const Vec4 groundFriction = Set(1.0f - 0.8f * deltaSeconds);
+
+	uint32_t count = GetPaddedCount();
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		Vec4 qw = Load(&m_fields[AttitudeW][i]);
+		Vec4 qx = Load(&m_fields[AttitudeX][i]);
+		Vec4 qy = Load(&m_fields[AttitudeY][i]);
+		Vec4 qz = Load(&m_fields[AttitudeZ][i]);
+		Rotation rotation(qw, qx, qy, qz);
+
+		// Auftrieb und Widerstand wirken senkrecht bzw. parallel zur Anströmung in der Symmetrieebene.
+		Vec4 dynamicPressure = Load(&m_fields[DynamicPressure][i]);
+		Vec4 lift = Load(&m_fields[LiftCoefficient][i]);
+		Vec4 drag = Load(&m_fields[DragCoefficient][i]);
+		Vec4 cosAlpha = Load(&m_fields[CosAlpha][i]);
+		Vec4 sinAlpha = Load(&m_fields[SinAlpha][i]);
+
+		Vec4 force = dynamicPressure * area;
+		Vec4 forceX = force * (lift * sinAlpha - drag * cosAlpha);
+		Vec4 forceY = force * Load(&m_fields[SideCoefficient][i]);
+		Vec4 forceZ = force * (zero - drag * sinAlpha - lift * cosAlpha);
+
+		// Beschleunigung in Weltachsen einschließlich Schwerkraft.
+		Vec4 accelerationN = (rotation.m[0][0] * forceX + rotation.m[0][1] * forceY + rotation.m[0][2] * forceZ) * inverseMass;
+		Vec4 accelerationE = (rotation.m[1][0] * forceX + rotation.m[1][1] * forceY + rotation.m[1][2] * forceZ) * inverseMass;
+		Vec4 accelerationD = (rotation.m[2][0] * forceX + rotation.m[2][1] * forceY + rotation.m[2][2] * forceZ) * inverseMass + gravity;
+
+		Vec4 velocityN = Load(&m_fields[VelocityN][i]) + accelerationN * dt;
+		Vec4 velocityE = Load(&m_fields[VelocityE][i]) + accelerationE * dt;
+		Vec4 velocityD = Load(&m_fields[VelocityD][i]) + accelerationD * dt;
+
+		Vec4 positionN = Load(&m_fields[PositionN][i]) + velocityN * dt;
+		Vec4 positionE = Load(&m_fields[PositionE][i]) + velocityE * dt;
+		Vec4 positionD = Load(&m_fields[PositionD][i]) + velocityD * dt;
+
+		// Eulersche Kreiselgleichungen für einen Körper mit Hauptträgheitsachsen.
+		Vec4 rollMoment = dynamicPressure * areaSpan * Load(&m_fields[RollCoefficient][i]);
+		Vec4 pitchMoment = dynamicPressure * areaChord * Load(&m_fields[PitchCoefficient][i]);
+		Vec4 yawMoment = dynamicPressure * areaSpan * Load(&m_fields[YawCoefficient][i]);
+
+		Vec4 rollRate = Load(&m_fields[RollRate][i]);
+		Vec4 pitchRate = Load(&m_fields[PitchRate][i]);
+		Vec4 yawRate = Load(&m_fields[YawRate][i]);
+
+		Vec4 newRollRate = rollRate + (rollMoment - (inertiaZ - inertiaY) * pitchRate * yawRate) / inertiaX * dt;
+		Vec4 newPitchRate = pitchRate + (pitchMoment - (inertiaX - inertiaZ) * rollRate * yawRate) / inertiaY * dt;
+		Vec4 newYawRate = yawRate + (yawMoment - (inertiaY - inertiaX) * rollRate * pitchRate) / inertiaZ * dt;
+
+		// Lage: q' = 0,5 · q ⊗ (0, p, q, r), danach normieren.
+		Vec4 halfDt = half * dt;
+		Vec4 nextW = qw - halfDt * (qx * newRollRate + qy * newPitchRate + qz * newYawRate);
+		Vec4 nextX = qx + halfDt * (qw * newRollRate + qy * newYawRate - qz * newPitchRate);
+		Vec4 nextY = qy + halfDt * (qw * newPitchRate + qz * newRollRate - qx * newYawRate);
+		Vec4 nextZ = qz + halfDt * (qw * newYawRate + qx * newPitchRate - qy * newRollRate);
+		Vec4 inverseLength = Set(1.0f) / Sqrt(nextW * nextW + nextX * nextX + nextY * nextY + nextZ * nextZ);
+
+		// Einfacher Bodenkontakt: nicht unter das Gelände sinken, am Boden ausrollen und Drehungen stoppen.
+		Vec4 groundD = -Load(&m_fields[GroundHeight][i]);
+		Vec4 onGround = GreaterEqual(positionD, groundD);
+		positionD = Select(onGround, groundD, positionD);
+		velocityD = Select(onGround, Min(velocityD, zero), velocityD);
+		velocityN = Select(onGround, velocityN * groundFriction, velocityN);
+		velocityE = Select(onGround, velocityE * groundFriction, velocityE);
+		newRollRate = Select(onGround, zero, newRollRate);
+		newPitchRate = Select(onGround, zero, newPitchRate);
+		newYawRate = Select(onGround, zero, newYawRate);
+
+		Store(&m_fields[PositionN][i], positionN);
+		Store(&m_fields[PositionE][i], positionE);
+		Store(&m_fields[PositionD][i], positionD);
+		Store(&m_fields[VelocityN][i], velocityN);
+		Store(&m_fields[VelocityE][i], velocityE);
+		Store(&m_fields[VelocityD][i], velocityD);
+		Store(&m_fields[RollRate][i], newRollRate);
+		Store(&m_fields[PitchRate][i], newPitchRate);
+		Store(&m_fields[YawRate][i], newYawRate);
+		Store(&m_fields[AttitudeW][i], nextW * inverseLength);
+		Store(&m_fields[AttitudeX][i], nextX * inverseLength);
+		Store(&m_fields[AttitudeY][i], nextY * inverseLength);
+		Store(&m_fields[AttitudeZ][i], nextZ * inverseLength);
+	}
+}
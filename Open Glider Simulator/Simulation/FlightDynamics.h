@@ -0,0 +1,149 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../Common/AlignedAllocator.h"
+
+namespace Open_Glider_Simulator
+{
+	class AeroTable;
+
+	// Masse, Geometrie und aerodynamische Beiwerte eines Segelflugzeugmusters.
+	// Beiwerte beziehen sich auf die körperfesten Achsen (x vorne, y rechts, z unten); Winkel in Bogenmaß.
+	struct GliderParameters
+	{
+		GliderParameters();
+
+		float mass;				// kg
+		float wingArea;			// m²
+		float wingSpan;			// m
+		float meanChord;		// m
+		float inertiaX;			// kg·m² (Rollen)
+		float inertiaY;			// kg·m² (Nicken)
+		float inertiaZ;			// kg·m² (Gieren)
+
+		// Auftrieb und Widerstand.
+		float liftZero;
+		float liftPerAlpha;
+		float liftPerPitchRate;
+		float liftPerElevator;
+		float liftMax;
+		float dragZero;
+		float dragInduced;
+
+		// Seitenkraft.
+		float sidePerBeta;
+
+		// Rollmoment.
+		float rollPerBeta;
+		float rollPerRollRate;
+		float rollPerYawRate;
+		float rollPerAileron;
+
+		// Nickmoment.
+		float pitchZero;
+		float pitchPerAlpha;
+		float pitchPerPitchRate;
+		float pitchPerElevator;
+
+		// Giermoment.
+		float yawPerBeta;
+		float yawPerRollRate;
+		float yawPerYawRate;
+		float yawPerRudder;
+	};
+
+	// Ruderausschläge und Wölbklappenstellung, normiert auf -1 bis 1.
+	struct GliderControls
+	{
+		float elevator;
+		float aileron;
+		float rudder;
+		float flap;
+	};
+
+	// Position (Nord, Ost, Unten in m) und Lage als Quaternion (w, x, y, z) von Körper- zu Weltachsen.
+	struct GliderPose
+	{
+		float position[3];
+		float orientation[4];
+	};
+
+	struct GliderInitialState
+	{
+		GliderPose	pose;
+		float		velocity[3];		// m/s in Weltachsen (Nord, Ost, Unten)
+
+		// Geradeausflug in der angegebenen Höhe mit Kurs und Fluggeschwindigkeit.
+		static GliderInitialState Level(float north, float east, float altitude, float heading, float pitch, float speed);
+	};
+
+	// Starrkörperdynamik mit sechs Freiheitsgraden für viele Segelflugzeuge desselben Musters.
+	// Der Zustand liegt als Structure of Arrays vor; ein Step-Aufruf rechnet jeweils vier Flugzeuge
+	// gleichzeitig mit SIMD. Die Anzahl der Einträge wird intern auf ein Vielfaches von vier aufgefüllt.
+	class GliderFleet
+	{
+	public:
+		// Felder des Zustands, jeweils ein Array über alle Flugzeuge.
+		enum Field
+		{
+			PositionN, PositionE, PositionD,
+			VelocityN, VelocityE, VelocityD,
+			AttitudeW, AttitudeX, AttitudeY, AttitudeZ,
+			RollRate, PitchRate, YawRate,
+			Elevator, Aileron, Rudder, Flap,
+
+			// Bewegung der Luftmasse (Wind, Thermik, Turbulenz) in Weltachsen, vom Aufrufer vor Step gesetzt.
+			AirVelocityN, AirVelocityE, AirVelocityD,
+
+			// Geländehöhe unter dem Flugzeug in m über Meeresniveau.
+			GroundHeight,
+
+			// Zwischenergebnisse eines Schritts: Luftdaten und Beiwerte.
+			Alpha, Beta, CosAlpha, SinAlpha, Airspeed, DynamicPressure, AirDensity,
+			NormalizedRollRate, NormalizedPitchRate, NormalizedYawRate,
+			LiftCoefficient, DragCoefficient, SideCoefficient,
+			RollCoefficient, PitchCoefficient, YawCoefficient,
+
+			FieldCount
+		};
+
+		explicit GliderFleet(const GliderParameters& parameters);
+		~GliderFleet();
+
+		uint32_t Add(const GliderInitialState& initialState);
+		uint32_t GetCount() const							{ return m_count; }
+		const GliderParameters& GetParameters() const		{ return m_parameters; }
+
+		// Statische Beiwerte kommen aus einer vorberechneten Tabelle. Standardmäßig wird sie beim Erzeugen
+		// aus den Parametern gebacken; eine geladene Tabelle kann sie ersetzen und von mehreren Flotten geteilt werden.
+		void SetAeroTable(const std::shared_ptr<const AeroTable>& table);
+		const std::shared_ptr<const AeroTable>& GetAeroTable() const	{ return m_aeroTable; }
+
+		void SetControls(uint32_t index, const GliderControls& controls);
+		GliderPose GetPose(uint32_t index) const;
+		void GetPoses(std::vector<GliderPose>& poses) const;
+
+		// Direkter Zugriff auf ein Feld für gebündelte Verarbeitung durch andere Subsysteme.
+		// Die Arrays sind auf 64 Byte ausgerichtet und GetPaddedCount() Einträge lang.
+		float* GetField(Field field)						{ return m_fields[field].data(); }
+		const float* GetField(Field field) const			{ return m_fields[field].data(); }
+		uint32_t GetPaddedCount() const						{ return static_cast<uint32_t>(m_fields[0].size()); }
+
+		// Schreibt alle Flugzeuge um einen festen Zeitschritt in Sekunden fort.
+		void Step(float deltaSeconds);
+
+	private:
+		void ComputeAirData();
+		void ComputeCoefficients();
+		void Integrate(float deltaSeconds);
+
+		void SetLane(uint32_t index, const GliderInitialState& state);
+
+		GliderParameters		m_parameters;
+		std::shared_ptr<const AeroTable> m_aeroTable;
+		uint32_t				m_count;
+		DX::AlignedVector<float> m_fields[FieldCount];
+	};
+}
@@ -0,0 +1,293 @@
+﻿#include "LiftMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "../Common/Profiler.h"
+#include "../Common/SimdMath.h"
+
+using namespace Open_Glider_Simulator;
+using namespace DX::Simd;
+
+namespace
+{
+	const float Pi = 3.14159265f;
+
+	// Hangaufwind nimmt mit der Höhe über Grund exponentiell ab; im Lee wird das Absinken gedämpft.
+	const float RidgeDepth = 500.0f;
+	const float LeeFactor = 0.5f;
+
+	// Leewellen: Wellenlänge 2πU/N bei stabiler Schichtung (Brunt-Väisälä-Frequenz N), wirksam ab
+	// WaveOnset über Grund und voll ausgebildet WaveOnset + WaveRamp darüber.
+	const float BruntVaisala = 0.01f;
+	const float WaveGain = 3.0f;
+	const float WaveDecayWavelengths = 2.0f;
+	const float WaveReachWavelengths = 4.0f;
+	const float WaveOnset = 200.0f;
+	const float WaveRamp = 800.0f;
+	const uint32_t MaxWaveSteps = 512;
+}
+
+LiftMap::LiftMap(const LiftMapRegion& region, float windN, float windE) :
+	m_region(region),
+	m_windN(windN),
+	m_windE(windE),
+	m_cells(static_cast<size_t>(region.countN) * region.countE * ChannelCount, 0.0f)
+{
+}
+
+float LiftMap::Sample(float north, float east, float down) const
+{
+	float x = std::min(std::max((north - m_region.originN) / m_region.spacing, 0.0f), static_cast<float>(m_region.countN - 1));
+	float y = std::min(std::max((east - m_region.originE) / m_region.spacing, 0.0f), static_cast<float>(m_region.countE - 1));
+	uint32_t n = std::min(static_cast<uint32_t>(x), m_region.countN - 2);
+	uint32_t e = std::min(static_cast<uint32_t>(y), m_region.countE - 2);
+
+	const float* cell = &m_cells[(static_cast<size_t>(n) * m_region.countE + e) * ChannelCount];
+	const size_t row = static_cast<size_t>(m_region.countE) * ChannelCount;
+
+	Vec4 te = Set(y - e);
+	Vec4 lower = Lerp(Load(cell), Load(cell + ChannelCount), te);
+	Vec4 upper = Lerp(Load(cell + row), Load(cell + row + ChannelCount), te);
+
+	float values[4];
+	StoreUnaligned(values, Lerp(lower, upper, Set(x - n)));
+
+	float aboveGround = std::max(-down - values[Height], 0.0f);
+	float wave = std::min(std::max((aboveGround - WaveOnset) / WaveRamp, 0.0f), 1.0f);
+	return values[Ridge] * std::exp(-aboveGround / RidgeDepth) + values[Wave] * wave;
+}
+
+void LiftMap::Sample(const float* north, const float* east, const float* down, uint32_t count, float* airVelocityD) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		airVelocityD[i] -= Sample(north[i], east[i], down[i]);
+	}
+}
+
+LiftMapBaker::LiftMapBaker(DX::ThreadPool& threadPool, const LiftMapRegion& region, const HeightFunction& heights, float directionStepDegrees, float speedStep) :
+	m_threadPool(threadPool),
+	m_region(region),
+	m_tilesN((region.countN + TileSize - 1) / TileSize),
+	m_tilesE((region.countE + TileSize - 1) / TileSize),
+	m_directionStep(directionStepDegrees * Pi / 180.0f),
+	m_speedStep(speedStep),
+	m_heights(static_cast<size_t>(region.countN) * region.countE)
+{
+	DX_PROFILE_ZONE("LiftMapBaker::Heights");
+
+	// Die Geländehöhen hängen nicht vom Wind ab und werden einmal kachelweise abgefragt.
+	m_threadPool.ParallelFor(m_tilesN * m_tilesE, [this, &heights](uint32_t tile)
+	{
+		uint32_t startN = tile / m_tilesE * TileSize;
+		uint32_t startE = tile % m_tilesE * TileSize;
+		uint32_t countN = std::min(TileSize, m_region.countN - startN);
+		uint32_t countE = std::min(TileSize, m_region.countE - startE);
+
+		std::vector<float> tileHeights(countN * countE);
+		heights(m_region.originN + startN * m_region.spacing, m_region.originE + startE * m_region.spacing, m_region.spacing, countN, countE, tileHeights.data());
+
+		for (uint32_t n = 0; n < countN; n++)
+		{
+			std::copy(&tileHeights[n * countE], &tileHeights[n * countE] + countE, &m_heights[static_cast<size_t>(startN + n) * m_region.countE + startE]);
+		}
+	});
+
+	m_currentBucket.direction = -1;
+	m_currentBucket.speed = -1;
+	m_pendingBucket = m_currentBucket;
+}
+
+LiftMapBaker::~LiftMapBaker()
+{
+	if (m_pending.valid())
+	{
+		m_pending.wait();
+	}
+}
+
+// Richtung, in die der Wind weht, und Stärke jeweils auf die nächste Stufe gerundet.
+// Unterhalb einer halben Stufe gilt der Wind als still.
+LiftMapBaker::Bucket LiftMapBaker::GetBucket(float windN, float windE) const
+{
+	Bucket bucket;
+	bucket.speed = static_cast<int32_t>(std::floor(std::sqrt(windN * windN + windE * windE) / m_speedStep + 0.5f));
+	bucket.direction = 0;
+
+	if (bucket.speed > 0)
+	{
+		int32_t steps = static_cast<int32_t>(std::floor(2.0f * Pi / m_directionStep + 0.5f));
+		bucket.direction = static_cast<int32_t>(std::floor(std::atan2(windE, windN) / m_directionStep + 0.5f));
+		bucket.direction = (bucket.direction % steps + steps) % steps;
+	}
+
+	return bucket;
+}
+
+std::shared_ptr<const LiftMap> LiftMapBaker::Bake(float windN, float windE)
+{
+	Bucket bucket = GetBucket(windN, windE);
+	for (const auto& entry : m_cache)
+	{
+		if (entry.first == bucket)
+		{
+			m_current = entry.second;
+			m_currentBucket = bucket;
+			return m_current;
+		}
+	}
+
+	std::shared_ptr<const LiftMap> map = BakeBucket(bucket);
+	Remember(bucket, map);
+	m_current = map;
+	m_currentBucket = bucket;
+	return map;
+}
+
+void LiftMapBaker::Update(float windN, float windE)
+{
+	if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		m_pending.get();
+		Remember(m_pendingBucket, m_pendingMap);
+		m_current = m_pendingMap;
+		m_currentBucket = m_pendingBucket;
+		m_pendingMap.reset();
+	}
+
+	Bucket bucket = GetBucket(windN, windE);
+	if (bucket == m_currentBucket || m_pending.valid())
+	{
+		return;
+	}
+
+	for (const auto& entry : m_cache)
+	{
+		if (entry.first == bucket)
+		{
+			m_current = entry.second;
+			m_currentBucket = bucket;
+			return;
+		}
+	}
+
+	m_pendingBucket = bucket;
+	m_pending = m_threadPool.Submit([this, bucket]()
+	{
+		m_pendingMap = BakeBucket(bucket);
+	});
+}
+
+void LiftMapBaker::Remember(const Bucket& bucket, const std::shared_ptr<const LiftMap>& map)
+{
+	m_cache.insert(m_cache.begin(), std::make_pair(bucket, map));
+	if (m_cache.size() > CacheSize)
+	{
+		m_cache.pop_back();
+	}
+}
+
+// Zwei Durchgänge über alle Kacheln: zuerst der Hangaufwind aus den Gradienten, danach die Wellen,
+// die den Hangaufwind stromauf benötigen.
+std::shared_ptr<LiftMap> LiftMapBaker::BakeBucket(const Bucket& bucket) const
+{
+	DX_PROFILE_ZONE("LiftMapBaker::Bake");
+
+	float speed = bucket.speed * m_speedStep;
+	float direction = bucket.direction * m_directionStep;
+	auto map = std::make_shared<LiftMap>(m_region, speed * std::cos(direction), speed * std::sin(direction));
+
+	uint32_t tileCount = m_tilesN * m_tilesE;
+	m_threadPool.ParallelFor(tileCount, [this, &map](uint32_t tile)
+	{
+		BakeRidgeTile(*map, tile);
+	});
+
+	if (speed <= 0.0f)
+	{
+		return map;
+	}
+
+	// Stromauf liegende Gitterpunkte und ihre Gewichte, für alle Punkte gleich.
+	float wavelength = 2.0f * Pi * speed / BruntVaisala;
+	uint32_t steps = std::min(static_cast<uint32_t>(WaveReachWavelengths * wavelength / m_region.spacing), MaxWaveSteps);
+	std::vector<int32_t> upwindOffsets;
+	std::vector<float> waveWeights;
+	for (uint32_t step = 1; step <= steps; step++)
+	{
+		float distance = step * m_region.spacing;
+		upwindOffsets.push_back(static_cast<int32_t>(std::floor(-distance * std::cos(direction) / m_region.spacing + 0.5f)));
+		upwindOffsets.push_back(static_cast<int32_t>(std::floor(-distance * std::sin(direction) / m_region.spacing + 0.5f)));
+		waveWeights.push_back(WaveGain * m_region.spacing / wavelength * std::sin(2.0f * Pi * distance / wavelength) * std::exp(-distance / (WaveDecayWavelengths * wavelength)));
+	}
+
+	m_threadPool.ParallelFor(tileCount, [this, &map, &upwindOffsets, &waveWeights](uint32_t tile)
+	{
+		BakeWaveTile(*map, tile, upwindOffsets, waveWeights);
+	});
+
+	return map;
+}
+
+// Hangaufwind am Boden: Windkomponente entlang des Geländegradienten (zentrale Differenzen).
+void LiftMapBaker::BakeRidgeTile(LiftMap& map, uint32_t tile) const
+{
+	uint32_t startN = tile / m_tilesE * TileSize;
+	uint32_t startE = tile % m_tilesE * TileSize;
+	uint32_t endN = std::min(startN + TileSize, m_region.countN);
+	uint32_t endE = std::min(startE + TileSize, m_region.countE);
+	size_t stride = m_region.countE;
+
+	for (uint32_t n = startN; n < endN; n++)
+	{
+		uint32_t south = n > 0 ? n - 1 : n;
+		uint32_t north = n + 1 < m_region.countN ? n + 1 : n;
+		for (uint32_t e = startE; e < endE; e++)
+		{
+			uint32_t west = e > 0 ? e - 1 : e;
+			uint32_t east = e + 1 < m_region.countE ? e + 1 : e;
+
+			float slopeN = (m_heights[north * stride + e] - m_heights[south * stride + e]) / ((north - south) * m_region.spacing);
+			float slopeE = (m_heights[n * stride + east] - m_heights[n * stride + west]) / ((east - west) * m_region.spacing);
+			float ridge = map.m_windN * slopeN + map.m_windE * slopeE;
+
+			float* cell = map.GetCell(n, e);
+			cell[LiftMap::Height] = m_heights[n * stride + e];
+			cell[LiftMap::Ridge] = ridge > 0.0f ? ridge : ridge * LeeFactor;
+		}
+	}
+}
+
+// Wellenaufwind: gedämpfte Sinusantwort auf den luvseitigen Hangaufwind stromauf.
+void LiftMapBaker::BakeWaveTile(LiftMap& map, uint32_t tile, const std::vector<int32_t>& upwindOffsets, const std::vector<float>& waveWeights) const
+{
+	uint32_t startN = tile / m_tilesE * TileSize;
+	uint32_t startE = tile % m_tilesE * TileSize;
+	uint32_t endN = std::min(startN + TileSize, m_region.countN);
+	uint32_t endE = std::min(startE + TileSize, m_region.countE);
+	int32_t countN = static_cast<int32_t>(m_region.countN);
+	int32_t countE = static_cast<int32_t>(m_region.countE);
+
+	for (uint32_t n = startN; n < endN; n++)
+	{
+		for (uint32_t e = startE; e < endE; e++)
+		{
+			float wave = 0.0f;
+			for (size_t step = 0; step < waveWeights.size(); step++)
+			{
+				int32_t upwindN = static_cast<int32_t>(n) + upwindOffsets[2 * step];
+				int32_t upwindE = static_cast<int32_t>(e) + upwindOffsets[2 * step + 1];
+				if (upwindN < 0 || upwindN >= countN || upwindE < 0 || upwindE >= countE)
+				{
+					break;
+				}
+
+				float ridge = map.GetCell(upwindN, upwindE)[LiftMap::Ridge];
+				wave += std::max(ridge, 0.0f) * waveWeights[step];
+			}
+
+			map.GetCell(n, e)[LiftMap::Wave] = wave;
+		}
+	}
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include "../Common/AlignedAllocator.h"
+#include "../Common/ThreadPool.h"
+
+namespace Open_Glider_Simulator
+{
+	// Gleichmäßiges Gitter über dem Aufgabengebiet. Längen in m.
+	struct LiftMapRegion
+	{
+		float		originN;
+		float		originE;
+		float		spacing;
+		uint32_t	countN;
+		uint32_t	countE;
+	};
+
+	// Vorberechneter Hang- und Wellenaufwind für eine Windrichtung und -stärke.
+	// Je Gitterpunkt liegen Geländehöhe, Hangaufwind am Boden und Wellenaufwind in 16 Byte beieinander,
+	// sodass eine bilineare Abfrage vier Vektorladebefehle benötigt.
+	class LiftMap
+	{
+	public:
+		LiftMap(const LiftMapRegion& region, float windN, float windE);
+
+		// Vertikale Luftbewegung in m/s, positiv nach oben. Position in Nord, Ost, Unten.
+		float Sample(float north, float east, float down) const;
+
+		// Gebündelte Abfrage. Addiert die Bewegung nach unten (NED) auf airVelocityD.
+		void Sample(const float* north, const float* east, const float* down, uint32_t count, float* airVelocityD) const;
+
+		const LiftMapRegion& GetRegion() const				{ return m_region; }
+		float GetWindN() const								{ return m_windN; }
+		float GetWindE() const								{ return m_windE; }
+
+	private:
+		friend class LiftMapBaker;
+
+		enum Channel
+		{
+			Height, Ridge, Wave, ChannelCount = 4
+		};
+
+		float* GetCell(uint32_t n, uint32_t e)				{ return &m_cells[(static_cast<size_t>(n) * m_region.countE + e) * ChannelCount]; }
+
+		LiftMapRegion				m_region;
+		float						m_windN;
+		float						m_windE;
+		DX::AlignedVector<float>	m_cells;
+	};
+
+	// Berechnet Lift Maps aus den Geländegradienten, parallel über Kacheln auf allen Kernen.
+	// Der Wind wird nach Richtung und Stärke in Stufen eingeteilt; neu berechnet wird nur, wenn der Wind
+	// in eine andere Stufe wechselt. Die zuletzt benutzten Stufen bleiben zwischengespeichert.
+	class LiftMapBaker
+	{
+	public:
+		// Füllt die Höhen eines Gitterausschnitts, zeilenweise nach Nord: heights[n * countE + e].
+		typedef std::function<void(float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* heights)> HeightFunction;
+
+		static const uint32_t TileSize = 64;
+		static const uint32_t CacheSize = 4;
+
+		LiftMapBaker(DX::ThreadPool& threadPool, const LiftMapRegion& region, const HeightFunction& heights, float directionStepDegrees = 10.0f, float speedStep = 2.0f);
+		~LiftMapBaker();
+
+		// Berechnet die Karte für den Wind sofort auf dem aufrufenden Thread und den Arbeitsthreads.
+		std::shared_ptr<const LiftMap> Bake(float windN, float windE);
+
+		// Einmal je Simulationsschritt aufrufen: übernimmt fertige Hintergrundberechnungen und startet
+		// eine neue, wenn der Wind die Stufe gewechselt hat. Bis dahin bleibt die bisherige Karte gültig.
+		void Update(float windN, float windE);
+
+		const std::shared_ptr<const LiftMap>& GetCurrent() const	{ return m_current; }
+
+	private:
+		struct Bucket
+		{
+			int32_t direction;
+			int32_t speed;
+
+			bool operator==(const Bucket& other) const		{ return direction == other.direction && speed == other.speed; }
+			bool operator!=(const Bucket& other) const		{ return !(*this == other); }
+		};
+
+		Bucket GetBucket(float windN, float windE) const;
+		std::shared_ptr<LiftMap> BakeBucket(const Bucket& bucket) const;
+		void BakeRidgeTile(LiftMap& map, uint32_t tile) const;
+		void BakeWaveTile(LiftMap& map, uint32_t tile, const std::vector<int32_t>& upwindOffsets, const std::vector<float>& waveWeights) const;
+		void Remember(const Bucket& bucket, const std::shared_ptr<const LiftMap>& map);
+
+		DX::ThreadPool&				m_threadPool;
+		LiftMapRegion				m_region;
+		uint32_t					m_tilesN;
+		uint32_t					m_tilesE;
+		float						m_directionStep;
+		float						m_speedStep;
+		std::vector<float>			m_heights;
+
+		std::shared_ptr<const LiftMap>	m_current;
+		Bucket							m_currentBucket;
+		std::vector<std::pair<Bucket, std::shared_ptr<const LiftMap>>> m_cache;
+
+		std::future<void>				m_pending;
+		Bucket							m_pendingBucket;
+		std::shared_ptr<LiftMap>		m_pendingMap;
+	};
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "FlightDynamics.h"
+
+namespace Open_Glider_Simulator
+{
+	// Zustand der Simulation nach einem festen Zeitschritt.
+	struct SimulationState
+	{
+		SimulationState() :
+			stepCount(0),
+			totalTicks(0)
+		{
+		}
+
+		uint64_t					stepCount;
+		uint64_t					totalTicks;
+		std::vector<GliderPose>		gliders;
+	};
+
+	// Unveränderlicher Schnappschuss, den der Simulationsthread an den Renderer übergibt.
+	// Enthält die letzten beiden Zustände, damit der Renderer zwischen ihnen interpolieren kann.
+	struct SimulationSnapshot
+	{
+		SimulationSnapshot() :
+			publishedTicks(0),
+			stepTicks(0)
+		{
+		}
+
+		SimulationState	previous;
+		SimulationState	current;
+
+		// Uhrzeit der Veröffentlichung und Länge eines Simulationsschritts im kanonischen Taktformat.
+		uint64_t		publishedTicks;
+		uint64_t		stepTicks;
+	};
+}
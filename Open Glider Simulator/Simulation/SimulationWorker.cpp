@@ -0,0 +1,141 @@
+﻿#include "SimulationWorker.h"
+#include "../Common/Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace Open_Glider_Simulator;
+
+SimulationWorker::SimulationWorker(const StepFunction& step, uint32_t stepsPerSecond, uint32_t maxStepsPerTick) :
+	m_step(step),
+	m_running(false),
+	m_failed(false),
+	m_droppedTicks(0)
+{
+	m_timer.SetFixedTimeStep(true);
+	m_timer.SetTargetElapsedTicks(DX::StepTimer::TicksPerSecond / stepsPerSecond);
+	m_timer.SetMaxUpdatesPerTick(maxStepsPerTick);
+}
+
+SimulationWorker::~SimulationWorker()
+{
+	Stop();
+}
+
+void SimulationWorker::Start()
+{
+	if (IsRunning())
+	{
+		return;
+	}
+
+	// Ein nach einer Ausnahme beendeter Thread muss noch eingesammelt werden.
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+	m_timer.ResetElapsedTime();
+	m_running.store(true, std::memory_order_release);
+	m_thread = std::thread(&SimulationWorker::Run, this);
+}
+
+void SimulationWorker::Stop()
+{
+	m_running.store(false, std::memory_order_release);
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+void SimulationWorker::SetClock(const std::shared_ptr<DX::IClock>& clock)
+{
+	Stop();
+	m_timer.SetClock(clock);
+}
+
+// Schreibt die Simulation um die seit dem letzten Aufruf vergangene Zeit fort und veröffentlicht das Ergebnis.
+void SimulationWorker::Tick()
+{
+	DX_PROFILE_ZONE("SimulationWorker::Tick");
+
+	m_timer.Tick([&]()
+	{
+		m_previousState = m_state;
+		m_step(m_timer, m_state);
+		m_state.stepCount = m_timer.GetFrameCount();
+		m_state.totalTicks = m_timer.GetTotalTicks();
+	});
+
+	m_droppedTicks.store(m_timer.GetDroppedTicks(), std::memory_order_relaxed);
+
+	if (m_timer.GetUpdatesThisTick() == 0)
+	{
+		return;
+	}
+
+	SimulationSnapshot& snapshot = m_snapshots.GetWriteBuffer();
+	snapshot.previous = m_previousState;
+	snapshot.current = m_state;
+	snapshot.publishedTicks = m_timer.GetClock()->GetTicks();
+	snapshot.stepTicks = m_timer.GetTargetElapsedTicks();
+	m_snapshots.Publish();
+}
+
+const SimulationSnapshot& SimulationWorker::AcquireLatestSnapshot()
+{
+	if (m_failed.load(std::memory_order_acquire))
+	{
+		m_failed.store(false, std::memory_order_relaxed);
+		std::rethrow_exception(m_failure);
+	}
+
+	m_snapshots.Acquire();
+	return m_snapshots.GetReadBuffer();
+}
+
+float SimulationWorker::GetInterpolationAlpha(const SimulationSnapshot& snapshot) const
+{
+	// Synchron betrieben liegt der Zeitüberhang direkt im Timer vor.
+	if (!IsRunning())
+	{
+		return static_cast<float>(m_timer.GetInterpolationAlpha());
+	}
+
+	if (snapshot.stepTicks == 0)
+	{
+		return 1.0f;
+	}
+
+	// Die Anzeige läuft einen Schritt hinter der Simulation und blendet über die Dauer eines Schritts
+	// vom vorherigen zum aktuellen Zustand über.
+	uint64_t now = m_timer.GetClock()->GetTicks();
+	uint64_t sincePublish = now > snapshot.publishedTicks ? now - snapshot.publishedTicks : 0;
+	double alpha = static_cast<double>(sincePublish) / snapshot.stepTicks;
+	return static_cast<float>(std::min(alpha, 1.0));
+}
+
+void SimulationWorker::Run()
+{
+	DX_PROFILE_THREAD("Simulation");
+
+	try
+	{
+		while (m_running.load(std::memory_order_acquire))
+		{
+			Tick();
+
+			// Bis zum nächsten fälligen Schritt schlafen, statt den Kern zu belegen.
+			double remaining = (1.0 - m_timer.GetInterpolationAlpha()) * m_timer.GetTargetElapsedTicks();
+			std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(remaining / 10.0)));
+		}
+	}
+	catch (...)
+	{
+		m_failure = std::current_exception();
+		m_failed.store(true, std::memory_order_release);
+		m_running.store(false, std::memory_order_release);
+	}
+}
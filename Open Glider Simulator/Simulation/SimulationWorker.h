@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "../Common/Clock.h"
+#include "../Common/StepTimer.h"
+#include "../Common/TripleBuffer.h"
+#include "SimulationState.h"
+
+namespace Open_Glider_Simulator
+{
+	// Führt die Simulation mit festen Zeitschritten in einem eigenen Thread aus und veröffentlicht
+	// nach jedem Tick einen Schnappschuss über einen sperrfreien Dreifachpuffer.
+	// Ohne gestarteten Thread kann die Simulation auch synchron über Tick fortgeschrieben werden.
+	class SimulationWorker
+	{
+	public:
+		typedef std::function<void(DX::StepTimer const& timer, SimulationState& state)> StepFunction;
+
+		SimulationWorker(const StepFunction& step, uint32_t stepsPerSecond, uint32_t maxStepsPerTick);
+		~SimulationWorker();
+
+		void Start();
+		void Stop();
+		bool IsRunning() const								{ return m_running.load(std::memory_order_acquire); }
+
+		// Die Zeitquelle austauschen. Nur erlaubt, solange der Thread nicht läuft.
+		void SetClock(const std::shared_ptr<DX::IClock>& clock);
+
+		// Die Simulation synchron auf dem aufrufenden Thread fortschreiben.
+		void Tick();
+
+		// Vom Renderthread aufgerufen: den neuesten Schnappschuss ohne Sperre abrufen.
+		const SimulationSnapshot& AcquireLatestSnapshot();
+
+		// Anteil eines Schritts, um den die Anzeige hinter dem Schnappschuss liegt (0 bis 1).
+		float GetInterpolationAlpha(const SimulationSnapshot& snapshot) const;
+
+		// Zeit, die wegen des Aufholbudgets verworfen wurde.
+		uint64_t GetDroppedTicks() const					{ return m_droppedTicks.load(std::memory_order_relaxed); }
+
+	private:
+		void Run();
+
+		StepFunction							m_step;
+		DX::StepTimer							m_timer;
+		SimulationState							m_state;
+		SimulationState							m_previousState;
+		DX::TripleBuffer<SimulationSnapshot>	m_snapshots;
+
+		// Threadsteuerung. Ausnahmen des Simulationsthreads werden auf dem Renderthread erneut ausgelöst.
+		std::thread								m_thread;
+		std::atomic<bool>						m_running;
+		std::atomic<bool>						m_failed;
+		std::exception_ptr						m_failure;
+		std::atomic<uint64_t>					m_droppedTicks;
+	};
+}
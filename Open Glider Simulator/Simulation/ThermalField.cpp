@@ -0,0 +1,222 @@
+﻿#include "ThermalField.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	// Einflussweite als Vielfaches des Kernradius, einschließlich des Abwindsaums.
+	const float InfluenceRadii = 2.5f;
+
+	// Anteil der Schicht zwischen Gelände und Wolkenbasis, in dem das Steigen über dem Boden und unter der
+	// Basis ein- und ausläuft.
+	const float VerticalFade = 0.1f;
+}
+
+// Mittlere Bedingungen eines mitteleuropäischen Sommertags.
+ThermalClimate::ThermalClimate() :
+	cloudBase(1800.0f),
+	strengthMin(1.0f),
+	strengthMax(4.0f),
+	radiusMin(80.0f),
+	radiusMax(250.0f),
+	lifetimeMin(600.0f),
+	lifetimeMax(1800.0f)
+{
+}
+
+ThermalField::ThermalField() :
+	m_centerN(0.0f),
+	m_centerE(0.0f),
+	m_halfExtent(0.0f),
+	m_windN(0.0f),
+	m_windE(0.0f),
+	m_cellSize(1.0f),
+	m_inverseCellSize(1.0f),
+	m_bucketStart(2, 0)
+{
+}
+
+void ThermalField::Populate(float centerN, float centerE, float halfExtent, uint32_t count, const ThermalClimate& climate, uint32_t seed)
+{
+	m_climate = climate;
+	m_random.seed(seed);
+	m_centerN = centerN;
+	m_centerE = centerE;
+	m_halfExtent = halfExtent;
+	m_cellSize = InfluenceRadii * climate.radiusMax;
+	m_inverseCellSize = 1.0f / m_cellSize;
+
+	m_thermals.resize(count);
+	for (auto& thermal : m_thermals)
+	{
+		Spawn(thermal, true);
+	}
+
+	// Etwa zwei Fächer je Thermik, als Zweierpotenz für die Maskierung.
+	uint32_t buckets = 16;
+	while (buckets < 2 * count)
+	{
+		buckets *= 2;
+	}
+
+	m_bucketStart.assign(buckets + 1, 0);
+	m_entries.resize(count);
+	Rebuild();
+}
+
+void ThermalField::Spawn(Thermal& thermal, bool randomAge)
+{
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	thermal.north = m_centerN + (2.0f * unit(m_random) - 1.0f) * m_halfExtent;
+	thermal.east = m_centerE + (2.0f * unit(m_random) - 1.0f) * m_halfExtent;
+	thermal.radius = m_climate.radiusMin + unit(m_random) * (m_climate.radiusMax - m_climate.radiusMin);
+	thermal.strength = m_climate.strengthMin + unit(m_random) * (m_climate.strengthMax - m_climate.strengthMin);
+	thermal.lifetime = m_climate.lifetimeMin + unit(m_random) * (m_climate.lifetimeMax - m_climate.lifetimeMin);
+
+	// Beim ersten Befüllen über den Lebenszyklus verteilen, damit nicht alle gleichzeitig vergehen.
+	thermal.age = randomAge ? unit(m_random) * thermal.lifetime : 0.0f;
+}
+
+void ThermalField::Update(float deltaSeconds)
+{
+	for (auto& thermal : m_thermals)
+	{
+		thermal.age += deltaSeconds;
+		if (thermal.age >= thermal.lifetime)
+		{
+			Spawn(thermal, false);
+			continue;
+		}
+
+		thermal.north += m_windN * deltaSeconds;
+		thermal.east += m_windE * deltaSeconds;
+	}
+
+	Rebuild();
+}
+
+// Zählsortierung der Thermiken nach Hashfach: zählen, Präfixsumme, einsortieren.
+void ThermalField::Rebuild()
+{
+	uint32_t bucketCount = static_cast<uint32_t>(m_bucketStart.size()) - 1;
+	std::fill(m_bucketStart.begin(), m_bucketStart.end(), 0);
+
+	for (const auto& thermal : m_thermals)
+	{
+		m_bucketStart[Bucket(CellCoordinate(thermal.north), CellCoordinate(thermal.east)) + 1]++;
+	}
+
+	for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+	{
+		m_bucketStart[bucket + 1] += m_bucketStart[bucket];
+	}
+
+	m_bucketCursor.assign(m_bucketStart.begin(), m_bucketStart.end() - 1);
+	for (const auto& thermal : m_thermals)
+	{
+		int32_t cellX = CellCoordinate(thermal.north);
+		int32_t cellY = CellCoordinate(thermal.east);
+		float influence = InfluenceRadii * thermal.radius;
+
+		Entry& entry = m_entries[m_bucketCursor[Bucket(cellX, cellY)]++];
+		entry.north = thermal.north;
+		entry.east = thermal.east;
+		entry.inverseRadius = 1.0f / thermal.radius;
+		entry.influence = influence * influence;
+		entry.strength = thermal.strength * Lifecycle(thermal);
+		entry.top = m_climate.cloudBase;
+		entry.cellX = cellX;
+		entry.cellY = cellY;
+	}
+}
+
+int32_t ThermalField::CellCoordinate(float value) const
+{
+	return static_cast<int32_t>(std::floor(value * m_inverseCellSize));
+}
+
+uint32_t ThermalField::Bucket(int32_t cellX, int32_t cellY) const
+{
+	uint32_t hash = static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellY) * 19349663u;
+	return hash & (static_cast<uint32_t>(m_bucketStart.size()) - 2);
+}
+
+// Aufbau im ersten Fünftel, Zerfall im letzten Drittel der Lebensdauer.
+float ThermalField::Lifecycle(const Thermal& thermal)
+{
+	float growing = thermal.age / (0.2f * thermal.lifetime);
+	float decaying = (thermal.lifetime - thermal.age) / (0.3f * thermal.lifetime);
+	return std::min(1.0f, std::min(growing, decaying));
+}
+
+// Glockenförmiger Kern mit einem schwachen Abwindring bei etwa dem 1,8-fachen Kernradius.
+// Vertikal läuft das Steigen über Grund und unter der Wolkenbasis linear ein und aus; über hohem Gelände ist
+// die Schicht bis zur Basis flacher und der Übergang entsprechend kürzer.
+float ThermalField::Contribution(const Entry& entry, float north, float east, float altitude, float groundHeight)
+{
+	float dn = north - entry.north;
+	float de = east - entry.east;
+	float distanceSquared = dn * dn + de * de;
+	float height = altitude - groundHeight;
+	if (distanceSquared >= entry.influence || height <= 0.0f || altitude >= entry.top)
+	{
+		return 0.0f;
+	}
+
+	float x = std::sqrt(distanceSquared) * entry.inverseRadius;
+	float ring = 2.0f * (x - 1.8f);
+	float profile = std::exp(-x * x) - 0.25f * std::exp(-ring * ring);
+
+	float fade = VerticalFade * (entry.top - groundHeight);
+	float vertical = std::min(1.0f, std::min(height, entry.top - altitude) / fade);
+	return entry.strength * profile * vertical;
+}
+
+float ThermalField::Sample(float north, float east, float down, float groundHeight) const
+{
+	int32_t cellX = CellCoordinate(north);
+	int32_t cellY = CellCoordinate(east);
+	float altitude = -down;
+	float lift = 0.0f;
+
+	for (int32_t y = cellY - 1; y <= cellY + 1; y++)
+	{
+		for (int32_t x = cellX - 1; x <= cellX + 1; x++)
+		{
+			// Verschiedene Zellen können im selben Fach liegen; nur Einträge der gesuchten Zelle zählen.
+			uint32_t bucket = Bucket(x, y);
+			for (uint32_t index = m_bucketStart[bucket]; index < m_bucketStart[bucket + 1]; index++)
+			{
+				const Entry& entry = m_entries[index];
+				if (entry.cellX == x && entry.cellY == y)
+				{
+					lift += Contribution(entry, north, east, altitude, groundHeight);
+				}
+			}
+		}
+	}
+
+	return lift;
+}
+
+void ThermalField::Sample(const float* north, const float* east, const float* down, const float* groundHeight, uint32_t count, float* airVelocityD) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		airVelocityD[i] -= Sample(north[i], east[i], down[i], groundHeight[i]);
+	}
+}
+
+float ThermalField::SampleBruteForce(float north, float east, float down, float groundHeight) const
+{
+	float lift = 0.0f;
+	for (const auto& entry : m_entries)
+	{
+		lift += Contribution(entry, north, east, -down, groundHeight);
+	}
+
+	return lift;
+}
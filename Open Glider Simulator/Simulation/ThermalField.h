@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "../Common/AlignedAllocator.h"
+
+namespace Open_Glider_Simulator
+{
+	// Wertebereiche, aus denen neue Thermiken zufällig erzeugt werden. Längen in m, Zeiten in s.
+	struct ThermalClimate
+	{
+		ThermalClimate();
+
+		float cloudBase;		// Obergrenze der Aufwinde über Meeresniveau
+		float strengthMin;		// Steigen im Kern in m/s
+		float strengthMax;
+		float radiusMin;		// Kernradius
+		float radiusMax;
+		float lifetimeMin;
+		float lifetimeMax;
+	};
+
+	// Viele Thermiken über einem Aufgabengebiet mit Lebenszyklus, Windversatz und Kern-/Saumprofil.
+	// Abfragen laufen über ein gleichmäßiges Raster, dessen Zellen über eine Hashtabelle gefunden werden.
+	// Die Zellgröße entspricht der größten Einflussweite, daher genügen je Abfrage die 3×3 Nachbarzellen.
+	class ThermalField
+	{
+	public:
+		ThermalField();
+
+		// Erzeugt count Thermiken in einem Quadrat um den Mittelpunkt. Abgelaufene Thermiken
+		// entstehen im selben Gebiet neu, sodass ihre Anzahl erhalten bleibt.
+		void Populate(float centerN, float centerE, float halfExtent, uint32_t count, const ThermalClimate& climate, uint32_t seed);
+
+		// Windversatz der Thermiken in m/s (Nord, Ost).
+		void SetWind(float windN, float windE)				{ m_windN = windN; m_windE = windE; }
+
+		// Altern, versetzen, neu erzeugen und anschließend das Raster neu aufbauen.
+		void Update(float deltaSeconds);
+
+		// Vertikale Luftbewegung in m/s, positiv nach oben. Position in Nord, Ost, Unten; groundHeight ist die
+		// Geländehöhe unter der Position, über ihr setzen die Aufwinde ein.
+		float Sample(float north, float east, float down, float groundHeight) const;
+
+		// Gebündelte Abfrage für viele Flugzeuge. Addiert die Bewegung nach unten (NED) auf airVelocityD.
+		void Sample(const float* north, const float* east, const float* down, const float* groundHeight, uint32_t count, float* airVelocityD) const;
+
+		// Vergleichswert ohne Raster: prüft jede Thermik.
+		float SampleBruteForce(float north, float east, float down, float groundHeight) const;
+
+		uint32_t GetCount() const							{ return static_cast<uint32_t>(m_thermals.size()); }
+		float GetCellSize() const							{ return m_cellSize; }
+
+	private:
+		struct Thermal
+		{
+			float north;
+			float east;
+			float radius;
+			float strength;
+			float age;
+			float lifetime;
+		};
+
+		// Kopie der für Abfragen nötigen Werte in Rasterreihenfolge, eine halbe Cachezeile je Eintrag.
+		struct Entry
+		{
+			float	north;
+			float	east;
+			float	inverseRadius;
+			float	influence;		// Einflussweite im Quadrat
+			float	strength;		// bereits mit dem Lebenszyklus gewichtet
+			float	top;
+			int32_t	cellX;
+			int32_t	cellY;
+		};
+
+		void Spawn(Thermal& thermal, bool randomAge);
+		void Rebuild();
+
+		int32_t CellCoordinate(float value) const;
+		uint32_t Bucket(int32_t cellX, int32_t cellY) const;
+
+		static float Lifecycle(const Thermal& thermal);
+		static float Contribution(const Entry& entry, float north, float east, float altitude, float groundHeight);
+
+		ThermalClimate				m_climate;
+		std::mt19937				m_random;
+		float						m_centerN;
+		float						m_centerE;
+		float						m_halfExtent;
+		float						m_windN;
+		float						m_windE;
+		float						m_cellSize;
+		float						m_inverseCellSize;
+
+		std::vector<Thermal>		m_thermals;
+		std::vector<uint32_t>		m_bucketStart;	// Beginn jedes Hashfachs in m_entries, ein Eintrag mehr als Fächer
+		std::vector<uint32_t>		m_bucketCursor;
+		DX::AlignedVector<Entry>	m_entries;
+	};
+}
@@ -0,0 +1,212 @@
+﻿#include "Turbulence.h"
+
+#include <algorithm>
+#include <cmath>
+#include "FlightDynamics.h"
+#include "../Common/SimdMath.h"
+
+using namespace Open_Glider_Simulator;
+using namespace DX::Simd;
+
+namespace
+{
+	const float FeetToMeters = 0.3048f;
+	const float HeightBandSize = 25.0f;
+	const float AirspeedBandMin = 10.0f;
+	const float AirspeedBandSize = 5.0f;
+
+	// Übergang vom bodennahen Modell (unter 1000 ft) zum Modell für große Höhen (über 2000 ft).
+	const float LowAltitudeLimit = 1000.0f * FeetToMeters;
+	const float HighAltitudeLimit = 2000.0f * FeetToMeters;
+	const float HighAltitudeScale = 1750.0f * FeetToMeters;
+	const float MinimumHeight = 10.0f * FeetToMeters;
+
+	// Zählerbasierter Zufallsgenerator: SplitMix64-Finalisierer über den Schlüssel.
+	inline uint64_t Hash(uint64_t key)
+	{
+		key += 0x9e3779b97f4a7c15ull;
+		key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+		key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+		return key ^ (key >> 31);
+	}
+
+	// Näherungsweise normalverteilt: Summe von vier gleichverteilten 16-Bit-Werten (Irwin-Hall),
+	// auf Mittelwert 0 und Varianz 1 skaliert.
+	inline float Gaussian(uint32_t seed, uint32_t aircraft, uint64_t step, uint32_t axis)
+	{
+		uint64_t bits = Hash(step * 0x9e3779b97f4a7c15ull ^ (static_cast<uint64_t>(seed) << 32 | (aircraft * 3 + axis)));
+		float sum = static_cast<float>((bits & 0xffff) + (bits >> 16 & 0xffff) + (bits >> 32 & 0xffff) + (bits >> 48));
+		return (sum * (1.0f / 65535.0f) - 2.0f) * 1.7320508f;
+	}
+
+	// Ausgangsverstärkung, mit der ein diskreter Tiefpass erster Ordnung x' = a x + (1 - a) n bei
+	// Rauschen der Varianz 1 die gewünschte Standardabweichung erreicht.
+	inline float FirstOrderGain(float pole, float sigma)
+	{
+		return sigma / std::sqrt((1.0f - pole) / (1.0f + pole));
+	}
+
+	// Wie oben für das Dryden-Filter zweiter Ordnung (1 + √3 T s) / (1 + T s)² als Kaskade zweier
+	// Tiefpässe p, q mit dem Ausgang q + √3 (p - q). Die stationären Varianzen folgen aus der
+	// diskreten Ljapunow-Gleichung.
+	inline float SecondOrderGain(float pole, float sigma)
+	{
+		const float sqrt3 = 1.7320508f;
+		float a = pole;
+		float varianceP = (1.0f - a) / (1.0f + a);
+		float covariance = a * varianceP / (1.0f + a);
+		float varianceQ = (2.0f * a * covariance + (1.0f - a) * varianceP) / (1.0f + a);
+		float variance = 3.0f * varianceP + (1.0f - sqrt3) * (1.0f - sqrt3) * varianceQ + 2.0f * sqrt3 * (1.0f - sqrt3) * covariance;
+		return sigma / std::sqrt(variance);
+	}
+}
+
+Turbulence::Turbulence(uint32_t seed, float windAt6m, float highAltitudeSigma) :
+	m_seed(seed),
+	m_windAt6m(windAt6m),
+	m_highAltitudeSigma(highAltitudeSigma),
+	m_deltaSeconds(0.0f),
+	m_stepCount(0)
+{
+}
+
+// Bodennah: σw = 0,1 W20, σu = σv = σw / (0,177 + 0,000823 h)^0,4, Lu = Lv = h / (0,177 + 0,000823 h)^1,2,
+// Lw = h (h in ft). In großer Höhe Lu = Lv = Lw = 1750 ft mit gleicher Intensität auf allen Achsen.
+// Dazwischen wird linear übergeblendet.
+void Turbulence::GetModel(float height, float airspeed, float sigma[3], float timeConstant[3]) const
+{
+	float h = std::max(height, MinimumHeight);
+	float lowH = std::min(h, LowAltitudeLimit) / FeetToMeters;
+	float factor = 0.177f + 0.000823f * lowH;
+
+	float lowSigmaW = 0.1f * m_windAt6m;
+	float lowSigmaU = lowSigmaW / std::pow(factor, 0.4f);
+	float lowScaleU = lowH / std::pow(factor, 1.2f) * FeetToMeters;
+	float lowScaleW = lowH * FeetToMeters;
+
+	float blend = std::min(std::max((h - LowAltitudeLimit) / (HighAltitudeLimit - LowAltitudeLimit), 0.0f), 1.0f);
+	float speed = std::max(airspeed, 1.0f);
+
+	sigma[0] = lowSigmaU + (m_highAltitudeSigma - lowSigmaU) * blend;
+	sigma[1] = sigma[0];
+	sigma[2] = lowSigmaW + (m_highAltitudeSigma - lowSigmaW) * blend;
+
+	timeConstant[0] = (lowScaleU + (HighAltitudeScale - lowScaleU) * blend) / speed;
+	timeConstant[1] = timeConstant[0];
+	timeConstant[2] = (lowScaleW + (HighAltitudeScale - lowScaleW) * blend) / speed;
+}
+
+void Turbulence::BuildCoefficients(float deltaSeconds)
+{
+	m_deltaSeconds = deltaSeconds;
+	m_coefficients.resize(HeightBands * AirspeedBands);
+
+	for (uint32_t heightBand = 0; heightBand < HeightBands; heightBand++)
+	{
+		for (uint32_t airspeedBand = 0; airspeedBand < AirspeedBands; airspeedBand++)
+		{
+			float sigma[3], timeConstant[3];
+			GetModel(heightBand * HeightBandSize, AirspeedBandMin + airspeedBand * AirspeedBandSize, sigma, timeConstant);
+
+			Coefficients& c = m_coefficients[heightBand * AirspeedBands + airspeedBand];
+			c.poleU = std::exp(-deltaSeconds / timeConstant[0]);
+			c.poleV = std::exp(-deltaSeconds / timeConstant[1]);
+			c.poleW = std::exp(-deltaSeconds / timeConstant[2]);
+			c.gainU = FirstOrderGain(c.poleU, sigma[0]);
+			c.gainV = SecondOrderGain(c.poleV, sigma[1]);
+			c.gainW = SecondOrderGain(c.poleW, sigma[2]);
+			c.padding[0] = 0.0f;
+			c.padding[1] = 0.0f;
+		}
+	}
+}
+
+void Turbulence::Resize(uint32_t count)
+{
+	m_stateU.resize(count, 0.0f);
+	m_stateV1.resize(count, 0.0f);
+	m_stateV2.resize(count, 0.0f);
+	m_stateW1.resize(count, 0.0f);
+	m_stateW2.resize(count, 0.0f);
+}
+
+void Turbulence::Step(float deltaSeconds, GliderFleet& fleet)
+{
+	if (deltaSeconds != m_deltaSeconds)
+	{
+		BuildCoefficients(deltaSeconds);
+	}
+
+	uint32_t count = fleet.GetPaddedCount();
+	Resize(count);
+
+	const float* down = fleet.GetField(GliderFleet::PositionD);
+	const float* groundHeight = fleet.GetField(GliderFleet::GroundHeight);
+	const float* airspeed = fleet.GetField(GliderFleet::Airspeed);
+	const float* velocityN = fleet.GetField(GliderFleet::VelocityN);
+	const float* velocityE = fleet.GetField(GliderFleet::VelocityE);
+	float* airVelocityN = fleet.GetField(GliderFleet::AirVelocityN);
+	float* airVelocityE = fleet.GetField(GliderFleet::AirVelocityE);
+	float* airVelocityD = fleet.GetField(GliderFleet::AirVelocityD);
+
+	const Vec4 one = Set(1.0f);
+	const Vec4 sqrt3 = Set(1.7320508f);
+	const Vec4 minimumSpeed = Set(0.1f);
+
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		// Stufe und Rauschen je Flugzeug; die Filter selbst laufen für alle vier gemeinsam.
+		alignas(16) float lane[9][4];
+		for (uint32_t l = 0; l < 4; l++)
+		{
+			float height = -down[i + l] - groundHeight[i + l];
+			uint32_t heightBand = std::min(static_cast<uint32_t>(std::max(height, 0.0f) / HeightBandSize + 0.5f), HeightBands - 1);
+			uint32_t airspeedBand = std::min(static_cast<uint32_t>(std::max(airspeed[i + l] - AirspeedBandMin, 0.0f) / AirspeedBandSize + 0.5f), AirspeedBands - 1);
+			const Coefficients& c = m_coefficients[heightBand * AirspeedBands + airspeedBand];
+
+			lane[0][l] = c.poleU;
+			lane[1][l] = c.gainU;
+			lane[2][l] = c.poleV;
+			lane[3][l] = c.gainV;
+			lane[4][l] = c.poleW;
+			lane[5][l] = c.gainW;
+			lane[6][l] = Gaussian(m_seed, i + l, m_stepCount, 0);
+			lane[7][l] = Gaussian(m_seed, i + l, m_stepCount, 1);
+			lane[8][l] = Gaussian(m_seed, i + l, m_stepCount, 2);
+		}
+
+		Vec4 poleU = Load(lane[0]);
+		Vec4 poleV = Load(lane[2]);
+		Vec4 poleW = Load(lane[4]);
+
+		Vec4 u = poleU * Load(&m_stateU[i]) + (one - poleU) * Load(lane[6]);
+		Vec4 v1 = poleV * Load(&m_stateV1[i]) + (one - poleV) * Load(lane[7]);
+		Vec4 v2 = poleV * Load(&m_stateV2[i]) + (one - poleV) * Load(&m_stateV1[i]);
+		Vec4 w1 = poleW * Load(&m_stateW1[i]) + (one - poleW) * Load(lane[8]);
+		Vec4 w2 = poleW * Load(&m_stateW2[i]) + (one - poleW) * Load(&m_stateW1[i]);
+		Store(&m_stateU[i], u);
+		Store(&m_stateV1[i], v1);
+		Store(&m_stateV2[i], v2);
+		Store(&m_stateW1[i], w1);
+		Store(&m_stateW2[i], w2);
+
+		Vec4 gustU = Load(lane[1]) * u;
+		Vec4 gustV = Load(lane[3]) * (v2 + sqrt3 * (v1 - v2));
+		Vec4 gustW = Load(lane[5]) * (w2 + sqrt3 * (w1 - w2));
+
+		// Horizontale Flugrichtung gegenüber der Luftmasse; im Stillstand nach Norden.
+		Vec4 trackN = Load(&velocityN[i]) - Load(&airVelocityN[i]);
+		Vec4 trackE = Load(&velocityE[i]) - Load(&airVelocityE[i]);
+		Vec4 length = Sqrt(trackN * trackN + trackE * trackE);
+		Vec4 moving = Greater(length, minimumSpeed);
+		Vec4 inverse = one / Max(length, minimumSpeed);
+		trackN = Select(moving, trackN * inverse, one);
+		trackE = Select(moving, trackE * inverse, Zero());
+
+		Store(&airVelocityN[i], Load(&airVelocityN[i]) + gustU * trackN - gustV * trackE);
+		Store(&airVelocityE[i], Load(&airVelocityE[i]) + gustU * trackE + gustV * trackN);
+		Store(&airVelocityD[i], Load(&airVelocityD[i]) + gustW);
+	}
+
+	m_stepCount++;
+}
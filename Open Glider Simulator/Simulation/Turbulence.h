@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "../Common/AlignedAllocator.h"
+
+namespace Open_Glider_Simulator
+{
+	class GliderFleet;
+
+	// Böen nach dem Dryden-Modell (MIL-F-8785C) für alle Flugzeuge einer Flotte.
+	// Die Formfilter werden je Höhen- und Geschwindigkeitsstufe einmal für den festen Zeitschritt
+	// diskretisiert; ein Schritt rechnet dann vier Flugzeuge gleichzeitig. Das Rauschen stammt aus einem
+	// zählerbasierten Generator über (Startwert, Flugzeug, Schritt, Achse), sodass derselbe Startwert
+	// unabhängig von Threads und Aufrufreihenfolge dieselben Böen ergibt.
+	class Turbulence
+	{
+	public:
+		// windAt6m: mittlerer Wind in 6 m Höhe (7,7 m/s entspricht leichter Turbulenz), highAltitudeSigma:
+		// Standardabweichung der Böen oberhalb von 600 m, jeweils in m/s.
+		explicit Turbulence(uint32_t seed, float windAt6m = 7.7f, float highAltitudeSigma = 1.5f);
+
+		// Schreibt die Böenfilter aller Flugzeuge um einen Zeitschritt fort und addiert die Böen auf die
+		// Luftbewegung der Flotte. Die Längsbö wirkt entlang der horizontalen Flugrichtung gegenüber der Luft.
+		void Step(float deltaSeconds, GliderFleet& fleet);
+
+		uint64_t GetStepCount() const						{ return m_stepCount; }
+
+		// Standardabweichung der Längs-, Quer- und Vertikalbö sowie die Zeitkonstanten der Filter
+		// (Skalenlänge durch Fluggeschwindigkeit) in einer Höhe über Grund.
+		void GetModel(float height, float airspeed, float sigma[3], float timeConstant[3]) const;
+
+	private:
+		static const uint32_t HeightBands = 41;
+		static const uint32_t AirspeedBands = 13;
+
+		// Diskrete Filterkoeffizienten einer Stufe: Pol a und Ausgangsverstärkung je Achse.
+		struct Coefficients
+		{
+			float poleU;
+			float gainU;
+			float poleV;
+			float gainV;
+			float poleW;
+			float gainW;
+			float padding[2];
+		};
+
+		void BuildCoefficients(float deltaSeconds);
+		void Resize(uint32_t count);
+
+		uint32_t						m_seed;
+		float							m_windAt6m;
+		float							m_highAltitudeSigma;
+		float							m_deltaSeconds;
+		uint64_t						m_stepCount;
+		std::vector<Coefficients>		m_coefficients;
+
+		// Filterzustände: erste Ordnung längs, zweite Ordnung quer und vertikal.
+		DX::AlignedVector<float>		m_stateU;
+		DX::AlignedVector<float>		m_stateV1;
+		DX::AlignedVector<float>		m_stateV2;
+		DX::AlignedVector<float>		m_stateW1;
+		DX::AlignedVector<float>		m_stateW2;
+	};
+}
@@ -0,0 +1,308 @@
+﻿#include "WindField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "../Common/SimdMath.h"
+
+using namespace Open_Glider_Simulator;
+using namespace DX::Simd;
+
+namespace
+{
+	const uint32_t FileMagic = 0x46574f47;	// "GOWF"
+	const uint32_t FileVersion = 1;
+	const uint64_t HeaderSize = 64;
+	const uint32_t NodeComponents = 4;
+	const float VelocityScale = 0.01f;		// m/s je Einheit
+	const uint32_t NoSlice = std::numeric_limits<uint32_t>::max();
+
+	struct FileHeader
+	{
+		uint32_t			magic;
+		uint32_t			version;
+		WindGridDescription	description;
+	};
+
+	static_assert(sizeof(FileHeader) <= HeaderSize, "Der Dateikopf muss in den reservierten Bereich passen.");
+
+	// value *= factor, falls das Ergebnis in 64 Bit passt.
+	inline bool MultiplyChecked(uint64_t& value, uint64_t factor)
+	{
+		if (factor != 0 && value > std::numeric_limits<uint64_t>::max() / factor)
+		{
+			return false;
+		}
+		value *= factor;
+		return true;
+	}
+
+	inline bool IsFinite(float north, float east, float down)
+	{
+		return std::isfinite(north) && std::isfinite(east) && std::isfinite(down);
+	}
+
+	// Gitterkoordinate auf [0, count - 1] begrenzen und in Zelle und Gewicht zerlegen.
+	inline void Locate(float coordinate, uint32_t count, uint32_t& cell, float& weight)
+	{
+		float clamped = std::min(std::max(coordinate, 0.0f), static_cast<float>(count - 1));
+		cell = std::min(static_cast<uint32_t>(clamped), count - 2);
+		weight = clamped - cell;
+	}
+}
+
+WindField::WindField() :
+	m_tilesN(0),
+	m_tilesE(0),
+	m_sliceSize(0),
+	m_timeFraction(0.0f)
+{
+	m_description = WindGridDescription();
+	m_slices[0].index = NoSlice;
+	m_slices[1].index = NoSlice;
+	SetUniform(0.0f, 0.0f, 0.0f);
+}
+
+void WindField::SetUniform(float north, float east, float down)
+{
+	m_uniform[0] = north;
+	m_uniform[1] = east;
+	m_uniform[2] = down;
+}
+
+void WindField::Open(const std::wstring& path)
+{
+	Close();
+	m_file.Open(path);
+
+	FileHeader header;
+	{
+		DX::MemoryMappedView view = m_file.Map(0, sizeof(header));
+		std::copy(view.GetData(), view.GetData() + sizeof(header), reinterpret_cast<uint8_t*>(&header));
+	}
+
+	const WindGridDescription& d = header.description;
+	if (header.magic != FileMagic || header.version != FileVersion ||
+		d.countN < 2 || d.countE < 2 || d.levelCount < 2 || d.sliceCount < 1 ||
+		d.countN > MaxAxisCount || d.countE > MaxAxisCount || d.levelCount > MaxLevelCount || d.sliceCount > MaxSliceCount ||
+		!(d.spacing > 0.0f) || !(d.levelSpacing > 0.0f) || !(d.sliceSeconds > 0.0f) ||
+		!std::isfinite(d.spacing) || !std::isfinite(d.levelSpacing) || !std::isfinite(d.sliceSeconds) ||
+		!std::isfinite(d.originN) || !std::isfinite(d.originE) || !std::isfinite(d.baseAltitude) || !std::isfinite(d.startTime))
+	{
+		Close();
+		throw std::runtime_error("WindField: unbekanntes Dateiformat.");
+	}
+
+	// Die Größen in 64 Bit rechnen und jeden Schritt prüfen; size_t hat auf 32-Bit-Systemen nur 4 GB Umfang,
+	// eine Zeitscheibe wird aber als Ganzes eingeblendet.
+	uint64_t tilesN = (d.countN + TileSize - 1) / TileSize;
+	uint64_t tilesE = (d.countE + TileSize - 1) / TileSize;
+	uint64_t sliceSize = tilesN * tilesE;
+	bool valid = MultiplyChecked(sliceSize, TileSize * TileSize) && MultiplyChecked(sliceSize, d.levelCount) &&
+		MultiplyChecked(sliceSize, NodeComponents * sizeof(int16_t)) && sliceSize <= std::numeric_limits<size_t>::max();
+	uint64_t dataSize = sliceSize;
+	if (!valid || !MultiplyChecked(dataSize, d.sliceCount) || dataSize > std::numeric_limits<uint64_t>::max() - HeaderSize)
+	{
+		Close();
+		throw std::runtime_error("WindField: Gitter ist zu groß.");
+	}
+
+	if (m_file.GetSize() < HeaderSize + dataSize)
+	{
+		Close();
+		throw std::runtime_error("WindField: Datei ist unvollständig.");
+	}
+
+	m_description = d;
+	m_tilesN = static_cast<uint32_t>(tilesN);
+	m_tilesE = static_cast<uint32_t>(tilesE);
+	m_sliceSize = static_cast<size_t>(sliceSize);
+
+	SetTime(d.startTime);
+}
+
+void WindField::Close()
+{
+	m_slices[0].view.Reset();
+	m_slices[1].view.Reset();
+	m_slices[0].index = NoSlice;
+	m_slices[1].index = NoSlice;
+	m_file.Close();
+	m_tilesN = 0;
+	m_tilesE = 0;
+	m_sliceSize = 0;
+}
+
+// Open hat geprüft, dass das Ende der letzten Zeitscheibe in 64 Bit darstellbar ist.
+uint64_t WindField::GetSliceOffset(uint32_t index) const
+{
+	return HeaderSize + static_cast<uint64_t>(index) * m_sliceSize;
+}
+
+void WindField::MapSlice(Slice& slice, uint32_t index) const
+{
+	slice.view = m_file.Map(GetSliceOffset(index), m_sliceSize);
+	slice.index = index;
+}
+
+// Beim Fortschreiten der Zeit wird die bisherige zweite Scheibe zur ersten; nur die neue wird eingeblendet.
+// Ausgeblendete Scheiben geben ihre Seiten frei, der Speicherbedarf bleibt so unabhängig von der Dateigröße.
+void WindField::SetTime(float seconds)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	if (!std::isfinite(seconds))
+	{
+		throw std::invalid_argument("WindField: Zeit ist keine endliche Zahl.");
+	}
+
+	const WindGridDescription& d = m_description;
+	float position = std::min(std::max((seconds - d.startTime) / d.sliceSeconds, 0.0f), static_cast<float>(d.sliceCount - 1));
+	uint32_t first = d.sliceCount > 1 ? std::min(static_cast<uint32_t>(position), d.sliceCount - 2) : 0;
+	uint32_t second = std::min(first + 1, d.sliceCount - 1);
+	m_timeFraction = d.sliceCount > 1 ? position - first : 0.0f;
+
+	if (m_slices[0].index != first)
+	{
+		if (m_slices[1].index == first)
+		{
+			std::swap(m_slices[0], m_slices[1]);
+		}
+		else
+		{
+			MapSlice(m_slices[0], first);
+		}
+	}
+
+	if (m_slices[1].index != second)
+	{
+		MapSlice(m_slices[1], second);
+	}
+}
+
+const int16_t* WindField::GetNode(const Slice& slice, uint32_t n, uint32_t e, uint32_t level) const
+{
+	size_t tile = static_cast<size_t>(n / TileSize) * m_tilesE + e / TileSize;
+	size_t node = ((tile * m_description.levelCount + level) * TileSize + n % TileSize) * TileSize + e % TileSize;
+	return reinterpret_cast<const int16_t*>(slice.view.GetData()) + node * NodeComponents;
+}
+
+void WindField::Sample(float north, float east, float down, float velocity[3]) const
+{
+	if (!IsOpen())
+	{
+		velocity[0] = m_uniform[0];
+		velocity[1] = m_uniform[1];
+		velocity[2] = m_uniform[2];
+		return;
+	}
+	if (!IsFinite(north, east, down))
+	{
+		throw std::invalid_argument("WindField: Position ist keine endliche Zahl.");
+	}
+
+	const WindGridDescription& d = m_description;
+	uint32_t n, e, level;
+	float weightN, weightE, weightLevel;
+	Locate((north - d.originN) / d.spacing, d.countN, n, weightN);
+	Locate((east - d.originE) / d.spacing, d.countE, e, weightE);
+	Locate((-down - d.baseAltitude) / d.levelSpacing, d.levelCount, level, weightLevel);
+
+	// Jeder Gitterpunkt wird als ein Vektor geladen; interpoliert werden alle drei Komponenten zugleich.
+	Vec4 tn = Set(weightN);
+	Vec4 te = Set(weightE);
+	Vec4 tl = Set(weightLevel);
+	Vec4 result[2];
+	for (uint32_t s = 0; s < 2; s++)
+	{
+		const Slice& slice = m_slices[s];
+		Vec4 corners[2];
+		for (uint32_t l = 0; l < 2; l++)
+		{
+			Vec4 lower = Lerp(LoadInt16(GetNode(slice, n, e, level + l)), LoadInt16(GetNode(slice, n, e + 1, level + l)), te);
+			Vec4 upper = Lerp(LoadInt16(GetNode(slice, n + 1, e, level + l)), LoadInt16(GetNode(slice, n + 1, e + 1, level + l)), te);
+			corners[l] = Lerp(lower, upper, tn);
+		}
+		result[s] = Lerp(corners[0], corners[1], tl);
+	}
+
+	float values[4];
+	StoreUnaligned(values, Lerp(result[0], result[1], Set(m_timeFraction)) * Set(VelocityScale));
+	velocity[0] = values[0];
+	velocity[1] = values[1];
+	velocity[2] = values[2];
+}
+
+void WindField::Sample(const float* north, const float* east, const float* down, uint32_t count, float* airVelocityN, float* airVelocityE, float* airVelocityD) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float velocity[3];
+		Sample(north[i], east[i], down[i], velocity);
+		airVelocityN[i] = velocity[0];
+		airVelocityE[i] = velocity[1];
+		airVelocityD[i] = velocity[2];
+	}
+}
+
+void WindField::Write(std::ostream& stream, const WindGridDescription& description, const WindFunction& wind)
+{
+	const WindGridDescription& d = description;
+	if (d.countN < 2 || d.countE < 2 || d.levelCount < 2 || d.sliceCount < 1)
+	{
+		throw std::invalid_argument("WindField: jede Gitterachse benötigt mindestens zwei Punkte.");
+	}
+	if (d.countN > MaxAxisCount || d.countE > MaxAxisCount || d.levelCount > MaxLevelCount || d.sliceCount > MaxSliceCount)
+	{
+		throw std::invalid_argument("WindField: Gitter ist zu groß.");
+	}
+
+	uint8_t header[HeaderSize] = {};
+	FileHeader fileHeader = { FileMagic, FileVersion, d };
+	std::copy(reinterpret_cast<const uint8_t*>(&fileHeader), reinterpret_cast<const uint8_t*>(&fileHeader) + sizeof(fileHeader), header);
+	stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	// Kachelweise schreiben; Randkacheln werden mit den Werten des letzten Gitterpunkts aufgefüllt.
+	uint32_t tilesN = (d.countN + TileSize - 1) / TileSize;
+	uint32_t tilesE = (d.countE + TileSize - 1) / TileSize;
+	std::vector<int16_t> tile(TileSize * TileSize * d.levelCount * NodeComponents);
+
+	for (uint32_t slice = 0; slice < d.sliceCount; slice++)
+	{
+		float time = d.startTime + slice * d.sliceSeconds;
+		for (uint32_t tileN = 0; tileN < tilesN; tileN++)
+		{
+			for (uint32_t tileE = 0; tileE < tilesE; tileE++)
+			{
+				int16_t* node = tile.data();
+				for (uint32_t level = 0; level < d.levelCount; level++)
+				{
+					for (uint32_t localN = 0; localN < TileSize; localN++)
+					{
+						for (uint32_t localE = 0; localE < TileSize; localE++)
+						{
+							uint32_t n = std::min(tileN * TileSize + localN, d.countN - 1);
+							uint32_t e = std::min(tileE * TileSize + localE, d.countE - 1);
+
+							float velocity[3];
+							wind(d.originN + n * d.spacing, d.originE + e * d.spacing, d.baseAltitude + level * d.levelSpacing, time, velocity);
+							for (uint32_t component = 0; component < 3; component++)
+							{
+								float quantized = std::round(velocity[component] / VelocityScale);
+								node[component] = static_cast<int16_t>(std::min(std::max(quantized, -32767.0f), 32767.0f));
+							}
+							node[3] = 0;
+							node += NodeComponents;
+						}
+					}
+				}
+
+				stream.write(reinterpret_cast<const char*>(tile.data()), tile.size() * sizeof(int16_t));
+			}
+		}
+	}
+}
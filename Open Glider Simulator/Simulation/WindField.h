@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include "../Common/MemoryMappedFile.h"
+
+namespace Open_Glider_Simulator
+{
+	// Aufbau eines Windgitters. Horizontal gleichmäßig in Nord/Ost, vertikal gleichmäßige Höhenstufen,
+	// zeitlich gleichmäßige Zeitscheiben. Längen in m, Zeiten in s.
+	struct WindGridDescription
+	{
+		uint32_t	countN;
+		uint32_t	countE;
+		uint32_t	levelCount;
+		uint32_t	sliceCount;
+		float		originN;
+		float		originE;
+		float		spacing;
+		float		baseAltitude;
+		float		levelSpacing;
+		float		startTime;
+		float		sliceSeconds;
+	};
+
+	// Windfeld aus Vorhersagedaten in einem kompakten Binärformat, das per Speichereinblendung gelesen wird.
+	// Jede Zeitscheibe ist in Kacheln von TileSize × TileSize Gitterpunkten über alle Höhenstufen gegliedert;
+	// ein Gitterpunkt belegt 8 Byte (Nord, Ost, Unten als 16-Bit-Werte in cm/s, frei). Eingeblendet sind nur die
+	// beiden Zeitscheiben um die aktuelle Zeit, und davon lädt das System nur die Seiten der Kacheln,
+	// die tatsächlich abgefragt werden. Ohne Datei liefert das Feld einen gleichförmigen Wind.
+	class WindField
+	{
+	public:
+		static const uint32_t TileSize = 16;
+
+		// Obergrenzen für die Angaben im Dateikopf, damit ein beschädigter Kopf keine unsinnigen Größen ergibt.
+		static const uint32_t MaxAxisCount = 65536;
+		static const uint32_t MaxLevelCount = 1024;
+		static const uint32_t MaxSliceCount = 65536;
+
+		typedef std::function<void(float north, float east, float altitude, float time, float velocity[3])> WindFunction;
+
+		WindField();
+
+		void Open(const std::wstring& path);
+		void Close();
+		bool IsOpen() const									{ return m_file.IsOpen(); }
+
+		// Gleichförmiger Wind in m/s (Nord, Ost, Unten), solange keine Datei geöffnet ist.
+		void SetUniform(float north, float east, float down);
+
+		// Wählt die beiden Zeitscheiben um die Simulationszeit und blendet sie bei Bedarf ein.
+		void SetTime(float seconds);
+
+		// Trilinear im Raum, linear in der Zeit. Position in Nord, Ost, Unten; Ergebnis in m/s (Nord, Ost, Unten).
+		// Außerhalb des Gitters gilt der Randwert; eine nicht endliche Position löst invalid_argument aus.
+		void Sample(float north, float east, float down, float velocity[3]) const;
+
+		// Gebündelte Abfrage, überschreibt die Luftbewegung aller Flugzeuge.
+		void Sample(const float* north, const float* east, const float* down, uint32_t count, float* airVelocityN, float* airVelocityE, float* airVelocityD) const;
+
+		// Ein Gitter aus einer Funktion erzeugen, z. B. beim Umwandeln von Vorhersagedaten.
+		static void Write(std::ostream& stream, const WindGridDescription& description, const WindFunction& wind);
+
+	private:
+		struct Slice
+		{
+			uint32_t				index;
+			DX::MemoryMappedView	view;
+		};
+
+		void MapSlice(Slice& slice, uint32_t index) const;
+		uint64_t GetSliceOffset(uint32_t index) const;
+		const int16_t* GetNode(const Slice& slice, uint32_t n, uint32_t e, uint32_t level) const;
+
+		DX::MemoryMappedFile	m_file;
+		WindGridDescription		m_description;
+		uint32_t				m_tilesN;
+		uint32_t				m_tilesE;
+		size_t					m_sliceSize;
+		Slice					m_slices[2];
+		float					m_timeFraction;
+		float					m_uniform[3];
+	};
+}
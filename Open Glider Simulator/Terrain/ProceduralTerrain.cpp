@@ -0,0 +1,78 @@
+﻿#include "ProceduralTerrain.h"
+
+#include <cmath>
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	const uint32_t OctaveCount = 5;
+}
+
+ProceduralTerrain::ProceduralTerrain(uint32_t seed) :
+	m_seed(seed),
+	m_baseHeight(200.0f),
+	m_relief(900.0f),
+	m_featureSize(12000.0f)
+{
+}
+
+// Ganzzahliger Hash eines Gitterpunkts, auf [0, 1] abgebildet.
+float ProceduralTerrain::Lattice(int32_t x, int32_t y) const
+{
+	uint32_t hash = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(y) * 0xd8163841u ^ m_seed * 0xcb1ab31fu;
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+	return (hash & 0xffffff) * (1.0f / 0xffffff);
+}
+
+// Wertrauschen mit C1-stetiger Interpolation zwischen den Gitterpunkten.
+float ProceduralTerrain::Noise(float x, float y) const
+{
+	float cellX = std::floor(x);
+	float cellY = std::floor(y);
+	float fx = x - cellX;
+	float fy = y - cellY;
+	float sx = fx * fx * (3.0f - 2.0f * fx);
+	float sy = fy * fy * (3.0f - 2.0f * fy);
+
+	int32_t ix = static_cast<int32_t>(cellX);
+	int32_t iy = static_cast<int32_t>(cellY);
+	float a = Lattice(ix, iy);
+	float b = Lattice(ix + 1, iy);
+	float c = Lattice(ix, iy + 1);
+	float d = Lattice(ix + 1, iy + 1);
+	return (a + (b - a) * sx) + ((c + (d - c) * sx) - (a + (b - a) * sx)) * sy;
+}
+
+// Die Grundform wird zu Graten gefaltet (1 - |2n - 1|), feinere Oktaven fügen Hangstrukturen hinzu.
+float ProceduralTerrain::GetHeight(float north, float east) const
+{
+	float x = east / m_featureSize;
+	float y = north / m_featureSize;
+
+	float ridge = 1.0f - std::fabs(2.0f * Noise(x, y) - 1.0f);
+	float height = ridge * ridge * 0.6f;
+	float amplitude = 0.2f;
+	for (uint32_t octave = 1; octave < OctaveCount; octave++)
+	{
+		x *= 2.03f;
+		y *= 2.03f;
+		height += Noise(x, y) * amplitude;
+		amplitude *= 0.5f;
+	}
+
+	return m_baseHeight + m_relief * height;
+}
+
+void ProceduralTerrain::GetHeights(float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* heights) const
+{
+	for (uint32_t n = 0; n < countN; n++)
+	{
+		for (uint32_t e = 0; e < countE; e++)
+		{
+			heights[n * countE + e] = GetHeight(originN + n * spacing, originE + e * spacing);
+		}
+	}
+}
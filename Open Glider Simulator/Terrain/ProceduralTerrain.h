@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace Open_Glider_Simulator
+{
+	// Prozedurales Mittelgebirge aus mehreren Oktaven Wertrauschen mit geschärften Graten.
+	// Dient als Höhenquelle, solange keine Geländedaten geladen sind. Koordinaten in m (Nord, Ost).
+	class ProceduralTerrain
+	{
+	public:
+		explicit ProceduralTerrain(uint32_t seed = 1);
+
+		float GetHeight(float north, float east) const;
+
+		// Höhen eines gleichmäßigen Gitters, zeilenweise nach Nord: heights[n * countE + e].
+		void GetHeights(float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* heights) const;
+
+		float GetBaseHeight() const							{ return m_baseHeight; }
+		float GetRelief() const								{ return m_relief; }
+
+	private:
+		float Noise(float x, float y) const;
+		float Lattice(int32_t x, int32_t y) const;
+
+		uint32_t	m_seed;
+		float		m_baseHeight;
+		float		m_relief;
+		float		m_featureSize;
+	};
+}
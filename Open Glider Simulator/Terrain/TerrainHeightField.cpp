@@ -0,0 +1,342 @@
+﻿#include "TerrainHeightField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "../Common/Profiler.h"
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	const float Infinity = std::numeric_limits<float>::infinity();
+
+	// Versatz in Zellen, um den Knoten in Strahlrichtung hinter einer Knotengrenze zu wählen. In großen
+	// Gittern wächst er mit der Auflösung von float an den Zellkoordinaten, sonst ginge er dort verloren.
+	const float BoundaryNudge = 1e-4f;
+	const float BoundaryNudgeUlps = 8.0f;
+
+	// Austrittsparameter eines Strahls aus dem Intervall [lower, upper) einer Achse.
+	inline float GetExit(float origin, float direction, float lower, float upper)
+	{
+		if (direction > 0.0f)
+		{
+			return (upper - origin) / direction;
+		}
+		if (direction < 0.0f)
+		{
+			return (lower - origin) / direction;
+		}
+		return Infinity;
+	}
+
+	// Begrenzt [tMin, tMax] auf den Abschnitt, in dem origin + t * direction in [lower, upper] liegt.
+	inline void ClipSlab(float origin, float direction, float lower, float upper, float& tMin, float& tMax)
+	{
+		if (direction == 0.0f)
+		{
+			if (origin < lower || origin > upper)
+			{
+				tMax = -1.0f;
+			}
+			return;
+		}
+
+		float t0 = (lower - origin) / direction;
+		float t1 = (upper - origin) / direction;
+		tMin = std::max(tMin, std::min(t0, t1));
+		tMax = std::min(tMax, std::max(t0, t1));
+	}
+}
+
+TerrainHeightField::TerrainHeightField(DX::ThreadPool& threadPool, const HeightFieldRegion& region, const HeightFunction& heights) :
+	m_region(region),
+	m_heights(static_cast<size_t>(region.countN) * region.countE)
+{
+	if (region.countN < 2 || region.countE < 2 || !(region.spacing > 0.0f))
+	{
+		throw std::invalid_argument("TerrainHeightField: das Gitter benötigt mindestens 2 × 2 Punkte.");
+	}
+	m_inverseSpacing = 1.0f / region.spacing;
+
+	DX_PROFILE_ZONE("TerrainHeightField::Build");
+
+	uint32_t tilesN = (region.countN + TileSize - 1) / TileSize;
+	uint32_t tilesE = (region.countE + TileSize - 1) / TileSize;
+	threadPool.ParallelFor(tilesN * tilesE, [this, &heights, tilesE](uint32_t tile)
+	{
+		uint32_t startN = tile / tilesE * TileSize;
+		uint32_t startE = tile % tilesE * TileSize;
+		uint32_t countN = std::min(TileSize, m_region.countN - startN);
+		uint32_t countE = std::min(TileSize, m_region.countE - startE);
+
+		std::vector<float> tileHeights(countN * countE);
+		heights(m_region.originN + startN * m_region.spacing, m_region.originE + startE * m_region.spacing, m_region.spacing, countN, countE, tileHeights.data());
+
+		for (uint32_t n = 0; n < countN; n++)
+		{
+			std::copy(&tileHeights[n * countE], &tileHeights[n * countE] + countE, &m_heights[static_cast<size_t>(startN + n) * m_region.countE + startE]);
+		}
+	});
+
+	BuildPyramid();
+}
+
+// Eine bilineare Fläche liegt innerhalb einer Zelle zwischen der kleinsten und der größten Eckhöhe.
+void TerrainHeightField::BuildPyramid()
+{
+	Level base;
+	base.countN = m_region.countN - 1;
+	base.countE = m_region.countE - 1;
+	base.bounds.resize(static_cast<size_t>(base.countN) * base.countE * 2);
+	for (uint32_t n = 0; n < base.countN; n++)
+	{
+		for (uint32_t e = 0; e < base.countE; e++)
+		{
+			float h00 = GetGridHeight(n, e), h01 = GetGridHeight(n, e + 1);
+			float h10 = GetGridHeight(n + 1, e), h11 = GetGridHeight(n + 1, e + 1);
+			float* bounds = &base.bounds[(static_cast<size_t>(n) * base.countE + e) * 2];
+			bounds[0] = std::min(std::min(h00, h01), std::min(h10, h11));
+			bounds[1] = std::max(std::max(h00, h01), std::max(h10, h11));
+		}
+	}
+	m_levels.clear();
+	m_levels.push_back(std::move(base));
+
+	while (m_levels.back().countN > 1 || m_levels.back().countE > 1)
+	{
+		const Level& fine = m_levels.back();
+		Level coarse;
+		coarse.countN = (fine.countN + 1) / 2;
+		coarse.countE = (fine.countE + 1) / 2;
+		coarse.bounds.resize(static_cast<size_t>(coarse.countN) * coarse.countE * 2);
+
+		for (uint32_t n = 0; n < coarse.countN; n++)
+		{
+			for (uint32_t e = 0; e < coarse.countE; e++)
+			{
+				float minHeight = Infinity, maxHeight = -Infinity;
+				for (uint32_t fn = 2 * n; fn < std::min(2 * n + 2, fine.countN); fn++)
+				{
+					for (uint32_t fe = 2 * e; fe < std::min(2 * e + 2, fine.countE); fe++)
+					{
+						const float* bounds = &fine.bounds[(static_cast<size_t>(fn) * fine.countE + fe) * 2];
+						minHeight = std::min(minHeight, bounds[0]);
+						maxHeight = std::max(maxHeight, bounds[1]);
+					}
+				}
+				coarse.bounds[(static_cast<size_t>(n) * coarse.countE + e) * 2] = minHeight;
+				coarse.bounds[(static_cast<size_t>(n) * coarse.countE + e) * 2 + 1] = maxHeight;
+			}
+		}
+		m_levels.push_back(std::move(coarse));
+	}
+}
+
+// v und u sind Gitterkoordinaten nach Nord und Ost.
+float TerrainHeightField::Interpolate(float v, float u) const
+{
+	v = std::min(std::max(v, 0.0f), static_cast<float>(m_region.countN - 1));
+	u = std::min(std::max(u, 0.0f), static_cast<float>(m_region.countE - 1));
+	uint32_t n = std::min(static_cast<uint32_t>(v), m_region.countN - 2);
+	uint32_t e = std::min(static_cast<uint32_t>(u), m_region.countE - 2);
+	float tn = v - n, te = u - e;
+
+	const float* lower = &m_heights[static_cast<size_t>(n) * m_region.countE + e];
+	const float* upper = lower + m_region.countE;
+	float south = lower[0] + (lower[1] - lower[0]) * te;
+	float north = upper[0] + (upper[1] - upper[0]) * te;
+	return south + (north - south) * tn;
+}
+
+float TerrainHeightField::GetHeight(float north, float east) const
+{
+	return Interpolate((north - m_region.originN) * m_inverseSpacing, (east - m_region.originE) * m_inverseSpacing);
+}
+
+void TerrainHeightField::GetHeights(const float* north, const float* east, uint32_t count, float* heights) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		heights[i] = GetHeight(north[i], east[i]);
+	}
+}
+
+// Gewählt wird die feinste Stufe, deren Knoten mindestens so groß sind wie das Quadrat; es überdeckt
+// dann höchstens 2 × 2 Knoten.
+void TerrainHeightField::GetHeightBounds(float north, float east, float radius, float& minHeight, float& maxHeight) const
+{
+	float extent = 2.0f * std::max(radius, 0.0f) * m_inverseSpacing;
+	uint32_t level = 0;
+	while (level + 1 < m_levels.size() && static_cast<float>(1u << level) < extent)
+	{
+		level++;
+	}
+
+	const Level& nodes = m_levels[level];
+	float size = static_cast<float>(1u << level);
+	float v = (north - m_region.originN) * m_inverseSpacing;
+	float u = (east - m_region.originE) * m_inverseSpacing;
+	float halfExtent = 0.5f * extent;
+
+	auto clampNode = [size](float coordinate, uint32_t count)
+	{
+		return std::min(static_cast<uint32_t>(std::max(coordinate / size, 0.0f)), count - 1);
+	};
+	uint32_t n0 = clampNode(v - halfExtent, nodes.countN), n1 = clampNode(v + halfExtent, nodes.countN);
+	uint32_t e0 = clampNode(u - halfExtent, nodes.countE), e1 = clampNode(u + halfExtent, nodes.countE);
+
+	minHeight = Infinity;
+	maxHeight = -Infinity;
+	for (uint32_t n = n0; n <= n1; n++)
+	{
+		for (uint32_t e = e0; e <= e1; e++)
+		{
+			const float* bounds = &nodes.bounds[(static_cast<size_t>(n) * nodes.countE + e) * 2];
+			minHeight = std::min(minHeight, bounds[0]);
+			maxHeight = std::max(maxHeight, bounds[1]);
+		}
+	}
+}
+
+// Hierarchischer Abstieg: Liegt der Strahl über dem ganzen Abschnitt eines Knotens über dessen Maximum,
+// wird der Knoten übersprungen und eine Stufe höher weitergesucht, sonst eine Stufe tiefer. In einer Zelle
+// der Stufe 0 wird der Schnitt mit der bilinearen Fläche exakt bestimmt.
+bool TerrainHeightField::Raycast(const TerrainRay& ray, float& distance) const
+{
+	float length = std::sqrt(ray.directionN * ray.directionN + ray.directionE * ray.directionE + ray.directionHeight * ray.directionHeight);
+	float v0 = (ray.originN - m_region.originN) * m_inverseSpacing;
+	float u0 = (ray.originE - m_region.originE) * m_inverseSpacing;
+
+	if (ray.originHeight <= Interpolate(v0, u0))
+	{
+		distance = 0.0f;
+		return true;
+	}
+	if (!(length > 0.0f))
+	{
+		return false;
+	}
+
+	// Richtung je m Strahllänge, waagerecht in Zellen.
+	float dv = ray.directionN / length * m_inverseSpacing;
+	float du = ray.directionE / length * m_inverseSpacing;
+	float dh = ray.directionHeight / length;
+
+	float t = 0.0f;
+	float tEnd = ray.maxDistance;
+	ClipSlab(v0, dv, 0.0f, static_cast<float>(m_region.countN - 1), t, tEnd);
+	ClipSlab(u0, du, 0.0f, static_cast<float>(m_region.countE - 1), t, tEnd);
+
+	uint32_t top = static_cast<uint32_t>(m_levels.size()) - 1;
+	uint32_t level = top;
+	float nudge = std::max(BoundaryNudge, BoundaryNudgeUlps * std::numeric_limits<float>::epsilon() *
+		static_cast<float>(std::max(m_region.countN, m_region.countE)));
+	float nudgeV = dv > 0.0f ? nudge : (dv < 0.0f ? -nudge : 0.0f);
+	float nudgeU = du > 0.0f ? nudge : (du < 0.0f ? -nudge : 0.0f);
+
+	while (t < tEnd)
+	{
+		const Level& nodes = m_levels[level];
+		float size = static_cast<float>(1u << level);
+		float v = v0 + dv * t + nudgeV;
+		float u = u0 + du * t + nudgeU;
+		uint32_t n = std::min(static_cast<uint32_t>(std::max(v / size, 0.0f)), nodes.countN - 1);
+		uint32_t e = std::min(static_cast<uint32_t>(std::max(u / size, 0.0f)), nodes.countE - 1);
+
+		float tExit = std::min(GetExit(v0, dv, n * size, (n + 1) * size), GetExit(u0, du, e * size, (e + 1) * size));
+		tExit = std::min(std::max(tExit, t), tEnd);
+
+		float rayMin = ray.originHeight + dh * (dh < 0.0f ? tExit : t);
+		float nodeMax = nodes.bounds[(static_cast<size_t>(n) * nodes.countE + e) * 2 + 1];
+
+		if (rayMin <= nodeMax)
+		{
+			if (level > 0)
+			{
+				level--;
+				continue;
+			}
+
+			float hit;
+			if (IntersectCell(n, e, v0 + dv * t, u0 + du * t, ray.originHeight + dh * t, dv, du, dh, tExit - t, hit))
+			{
+				distance = t + hit;
+				return true;
+			}
+		}
+
+		// Eine Zelle der Stufe 0 ist mindestens nudge breit; so kommt der Strahl immer voran, und weit vom
+		// Ursprung notfalls um die kleinste darstellbare Strecke.
+		float next = std::max(tExit, t + nudge / std::max(std::max(std::abs(dv), std::abs(du)), nudge));
+		t = next > t ? next : std::nextafter(t, Infinity);
+		level = std::min(level + 1, top);
+	}
+	return false;
+}
+
+// Entlang des Strahls ist die bilineare Fläche quadratisch im Strahlparameter; gesucht ist die kleinste
+// Nullstelle von Strahlhöhe minus Geländehöhe im Abschnitt [0, length].
+bool TerrainHeightField::IntersectCell(uint32_t n, uint32_t e, float v, float u, float height, float dv, float du, float dh, float length, float& hit) const
+{
+	float h00 = GetGridHeight(n, e), h01 = GetGridHeight(n, e + 1);
+	float h10 = GetGridHeight(n + 1, e), h11 = GetGridHeight(n + 1, e + 1);
+	float kE = h01 - h00, kN = h10 - h00, kNE = h00 - h01 - h10 + h11;
+	float x = u - e, y = v - n;
+
+	float a = height - (h00 + kE * x + kN * y + kNE * x * y);
+	float b = dh - (kE * du + kN * dv + kNE * (x * dv + y * du));
+	float c = -kNE * du * dv;
+
+	if (a <= 0.0f)
+	{
+		hit = 0.0f;
+		return true;
+	}
+
+	float root = Infinity;
+	if (std::abs(c) < 1e-12f)
+	{
+		if (b < 0.0f)
+		{
+			root = -a / b;
+		}
+	}
+	else
+	{
+		float discriminant = b * b - 4.0f * a * c;
+		if (discriminant >= 0.0f)
+		{
+			float q = -0.5f * (b + std::copysign(std::sqrt(discriminant), b));
+			float r0 = q / c;
+			float r1 = q != 0.0f ? a / q : Infinity;
+			if (r0 >= 0.0f)
+			{
+				root = std::min(root, r0);
+			}
+			if (r1 >= 0.0f)
+			{
+				root = std::min(root, r1);
+			}
+		}
+	}
+
+	if (root <= length)
+	{
+		hit = root;
+		return true;
+	}
+	return false;
+}
+
+void TerrainHeightField::Raycast(const TerrainRay* rays, uint32_t count, float* distances) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!Raycast(rays[i], distances[i]))
+		{
+			distances[i] = Infinity;
+		}
+	}
+}
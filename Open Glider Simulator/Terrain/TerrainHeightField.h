@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "../Common/ThreadPool.h"
+
+namespace Open_Glider_Simulator
+{
+	// Gleichmäßiges Höhengitter. Längen in m.
+	struct HeightFieldRegion
+	{
+		float		originN;
+		float		originE;
+		float		spacing;
+		uint32_t	countN;
+		uint32_t	countE;
+	};
+
+	// Strahl für Sichtlinien- und Kollisionsabfragen. Position in m (Nord, Ost, Höhe); die Richtung muss
+	// nicht normiert sein, Entfernungen werden stets in m entlang des Strahls angegeben.
+	struct TerrainRay
+	{
+		float	originN;
+		float	originE;
+		float	originHeight;
+		float	directionN;
+		float	directionE;
+		float	directionHeight;
+		float	maxDistance;
+	};
+
+	// Höhenabfragen über einem Gitter mit einer Minimum-/Maximum-Pyramide darüber. Stufe 0 enthält je
+	// Gitterzelle die kleinste und größte Eckhöhe, jede weitere Stufe fasst 2 × 2 Knoten zusammen.
+	// Punktabfragen kosten eine bilineare Interpolation; Strahlen überspringen ganze Knoten, unter deren
+	// Maximum sie nicht eintauchen. Außerhalb des Gitters gilt die Höhe des nächsten Randpunkts, Strahlen
+	// enden am Rand. Nach dem Aufbau nur lesend und daher von beliebig vielen Threads gleichzeitig nutzbar.
+	class TerrainHeightField
+	{
+	public:
+		// Füllt die Höhen eines Gitterausschnitts, zeilenweise nach Nord: heights[n * countE + e].
+		typedef std::function<void(float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* heights)> HeightFunction;
+
+		static const uint32_t TileSize = 64;
+
+		// Fragt die Höhen kachelweise auf den Arbeitsthreads ab und baut die Pyramide auf.
+		TerrainHeightField(DX::ThreadPool& threadPool, const HeightFieldRegion& region, const HeightFunction& heights);
+
+		float GetHeight(float north, float east) const;
+		void GetHeights(const float* north, const float* east, uint32_t count, float* heights) const;
+
+		// Sichere Schranken der Höhe in einem Quadrat mit halber Kantenlänge radius um den Punkt.
+		// Das Intervall kann größer sein als das tatsächliche, aber nie kleiner.
+		void GetHeightBounds(float north, float east, float radius, float& minHeight, float& maxHeight) const;
+
+		// Entfernung bis zum ersten Geländetreffer oder false, wenn der Strahl bis maxDistance frei bleibt.
+		// Beginnt der Strahl unter dem Gelände, ist die Entfernung 0.
+		bool Raycast(const TerrainRay& ray, float& distance) const;
+		// Gebündelte Abfrage; ohne Treffer wird die Entfernung unendlich.
+		void Raycast(const TerrainRay* rays, uint32_t count, float* distances) const;
+
+		const HeightFieldRegion& GetRegion() const			{ return m_region; }
+		uint32_t GetLevelCount() const						{ return static_cast<uint32_t>(m_levels.size()); }
+
+	private:
+		struct Level
+		{
+			uint32_t			countN;
+			uint32_t			countE;
+			std::vector<float>	bounds;		// je Knoten Minimum und Maximum
+		};
+
+		float GetGridHeight(uint32_t n, uint32_t e) const	{ return m_heights[static_cast<size_t>(n) * m_region.countE + e]; }
+		float Interpolate(float v, float u) const;
+		bool IntersectCell(uint32_t n, uint32_t e, float v, float u, float height, float dv, float du, float dh, float length, float& hit) const;
+		void BuildPyramid();
+
+		HeightFieldRegion	m_region;
+		float				m_inverseSpacing;
+		std::vector<float>	m_heights;
+		std::vector<Level>	m_levels;
+	};
+}
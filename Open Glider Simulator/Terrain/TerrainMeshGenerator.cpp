@@ -0,0 +1,244 @@
+﻿#include "TerrainMeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	// Farbe nach Höhe: Wiesen im Tal, Fels darüber, Schnee auf den Gipfeln.
+	void GetHeightColor(float normalizedHeight, uint8_t* color)
+	{
+		static const float low[3] = { 0.25f, 0.45f, 0.2f };
+		static const float middle[3] = { 0.45f, 0.4f, 0.3f };
+		static const float high[3] = { 0.95f, 0.95f, 0.95f };
+
+		float t = std::min(std::max(normalizedHeight, 0.0f), 1.0f);
+		const float* from = t < 0.6f ? low : middle;
+		const float* to = t < 0.6f ? middle : high;
+		float s = t < 0.6f ? t / 0.6f : (t - 0.6f) / 0.4f;
+		for (int i = 0; i < 3; i++)
+		{
+			color[i] = DX::Mesh::QuantizeUnorm8(from[i] + (to[i] - from[i]) * s);
+		}
+		color[3] = 255;
+	}
+}
+
+TerrainMeshGenerator::TerrainMeshGenerator(const TerrainPyramidDescription& description) :
+	m_description(description)
+{
+	// Die Überblendung halbiert das Gitter.
+	if (description.resolution < 3 || description.resolution % 2 == 0)
+	{
+		throw std::invalid_argument("TerrainMeshGenerator: die Kachelauflösung muss ungerade sein.");
+	}
+}
+
+// Die gröbere Stufe verwendet jeden zweiten Gitterpunkt und dieselbe Diagonale wie GenerateIndices.
+// Zwischenpunkte werden daher auf das Mittel ihrer groben Nachbarn entlang der Kante bzw. der Diagonale
+// von Nordwest nach Südost überblendet, was genau der Fläche der gröberen Kachel entspricht.
+// Quantisiert wird über die Kachel samt Schürzen; Randpunkte liegen exakt auf 0 bzw. 65535 und stimmen
+// daher mit denen der Nachbarkacheln überein.
+void TerrainMeshGenerator::Generate(const TerrainTile& tile, TerrainMeshBlock& block) const
+{
+	uint32_t r = tile.resolution;
+	if (r != m_description.resolution)
+	{
+		throw std::invalid_argument("TerrainMeshGenerator: Kachel passt nicht zur Pyramide.");
+	}
+
+	float heightRange = std::max(m_description.maxHeight - m_description.minHeight, 1.0f);
+	float skirtDepth = m_description.geometricError[tile.key.level] + tile.spacing;
+	auto height = [&tile, r](uint32_t row, uint32_t column)
+	{
+		return tile.heights[row * r + column];
+	};
+
+	// Szenenachsen x = Ost, y = oben, z = Süd; die Kachel reicht in z von -(originN + size) bis -originN.
+	float size = tile.spacing * (r - 1);
+	float bottom = tile.minHeight - skirtDepth;
+	block.positionOffset[0] = tile.originE;
+	block.positionOffset[1] = bottom;
+	block.positionOffset[2] = -(tile.originN + size);
+	block.positionScale[0] = size;
+	block.positionScale[1] = std::max(tile.maxHeight - bottom, 1.0f);
+	block.positionScale[2] = size;
+
+	float inverseHeightScale = 1.0f / block.positionScale[1];
+	auto quantizeHeight = [&block, inverseHeightScale](float h)
+	{
+		return DX::Mesh::QuantizeUnorm16(h, block.positionOffset[1], inverseHeightScale);
+	};
+
+	// Waagerechte Lage und Steigungen hängen nur von Zeile bzw. Spalte ab.
+	std::vector<uint16_t> gridPositions(r);
+	for (uint32_t i = 0; i < r; i++)
+	{
+		gridPositions[i] = DX::Mesh::QuantizeUnorm16(static_cast<float>(i), 0.0f, 1.0f / (r - 1));
+	}
+	float inverseSpacing = 1.0f / tile.spacing;
+
+	block.vertices.resize(GetVertexCount());
+	TerrainVertex* vertex = block.vertices.data();
+	for (uint32_t row = 0; row < r; row++)
+	{
+		for (uint32_t column = 0; column < r; column++, vertex++)
+		{
+			float h = height(row, column);
+			float morphHeight = h;
+			bool oddRow = (row & 1) != 0, oddColumn = (column & 1) != 0;
+			if (oddRow && oddColumn)
+			{
+				morphHeight = 0.5f * (height(row + 1, column - 1) + height(row - 1, column + 1));
+			}
+			else if (oddRow)
+			{
+				morphHeight = 0.5f * (height(row - 1, column) + height(row + 1, column));
+			}
+			else if (oddColumn)
+			{
+				morphHeight = 0.5f * (height(row, column - 1) + height(row, column + 1));
+			}
+
+			vertex->position[0] = gridPositions[column];
+			vertex->position[1] = quantizeHeight(h);
+			vertex->position[2] = gridPositions[r - 1 - row];
+			vertex->position[3] = quantizeHeight(morphHeight);
+
+			// Normale der Fläche y = h(x, z) aus zentralen Differenzen, am Rand einseitig.
+			uint32_t west = column > 0 ? column - 1 : column, east = column + 1 < r ? column + 1 : column;
+			uint32_t south = row > 0 ? row - 1 : row, north = row + 1 < r ? row + 1 : row;
+			float slopeEast = (height(row, east) - height(row, west)) * inverseSpacing * (east - west == 2 ? 0.5f : 1.0f);
+			float slopeNorth = (height(north, column) - height(south, column)) * inverseSpacing * (north - south == 2 ? 0.5f : 1.0f);
+			float inverseLength = 1.0f / std::sqrt(slopeEast * slopeEast + slopeNorth * slopeNorth + 1.0f);
+			DX::Mesh::EncodeOctahedral(-slopeEast * inverseLength, inverseLength, slopeNorth * inverseLength, vertex->normal);
+			vertex->normal[2] = 0;
+			vertex->normal[3] = 0;
+
+			GetHeightColor((h - m_description.minHeight) / heightRange, vertex->color);
+		}
+	}
+
+	// Ränder in der Reihenfolge Süd, Nord, West, Ost, um die Schürzentiefe abgesenkt.
+	for (uint32_t edge = 0; edge < 4; edge++)
+	{
+		for (uint32_t i = 0; i < r; i++, vertex++)
+		{
+			uint32_t row = edge < 2 ? (edge == 0 ? 0 : r - 1) : i;
+			uint32_t column = edge < 2 ? i : (edge == 2 ? 0 : r - 1);
+			float h = height(row, column);
+			*vertex = block.vertices[row * r + column];
+			vertex->position[1] = quantizeHeight(h - skirtDepth);
+			vertex->position[3] = vertex->position[1];
+		}
+	}
+
+	GenerateOccluder(tile, block);
+}
+
+// Jeder grobe Punkt liegt auf der kleinsten Höhe der feinen Punkte in seinen angrenzenden groben Zellen.
+// Damit liegt jedes grobe Dreieck unter dem feinen Gelände derselben Zelle und unter der Fläche der
+// nächstgröberen Stufe, zu der überblendet wird; das Gitter verdeckt also nie etwas Sichtbares.
+void TerrainMeshGenerator::GenerateOccluder(const TerrainTile& tile, TerrainMeshBlock& block) const
+{
+	uint32_t r = tile.resolution;
+	uint32_t points = OccluderCells + 1;
+	std::vector<uint32_t> fine(points);
+	for (uint32_t i = 0; i < points; i++)
+	{
+		fine[i] = i * (r - 1) / OccluderCells;
+	}
+
+	block.occluderPositions.resize(3 * points * points);
+	float* position = block.occluderPositions.data();
+	for (uint32_t row = 0; row < points; row++)
+	{
+		uint32_t rowBegin = fine[row > 0 ? row - 1 : 0], rowEnd = fine[std::min(row + 1, OccluderCells)];
+		for (uint32_t column = 0; column < points; column++, position += 3)
+		{
+			uint32_t columnBegin = fine[column > 0 ? column - 1 : 0], columnEnd = fine[std::min(column + 1, OccluderCells)];
+			float h = tile.maxHeight;
+			for (uint32_t fineRow = rowBegin; fineRow <= rowEnd; fineRow++)
+			{
+				const float* heights = &tile.heights[fineRow * r];
+				for (uint32_t fineColumn = columnBegin; fineColumn <= columnEnd; fineColumn++)
+				{
+					h = std::min(h, heights[fineColumn]);
+				}
+			}
+
+			position[0] = tile.originE + fine[column] * tile.spacing;
+			position[1] = h;
+			position[2] = -(tile.originN + fine[row] * tile.spacing);
+		}
+	}
+}
+
+void TerrainMeshGenerator::GenerateOccluderIndices(std::vector<uint32_t>& indices) const
+{
+	uint32_t points = OccluderCells + 1;
+	indices.clear();
+	indices.reserve(6 * OccluderCells * OccluderCells);
+	for (uint32_t row = 0; row < OccluderCells; row++)
+	{
+		for (uint32_t column = 0; column < OccluderCells; column++)
+		{
+			uint32_t i00 = row * points + column;
+			uint32_t i01 = i00 + 1;
+			uint32_t i10 = i00 + points;
+			uint32_t i11 = i10 + 1;
+			uint32_t cell[] = { i00, i10, i01, i01, i10, i11 };
+			indices.insert(indices.end(), cell, cell + 6);
+		}
+	}
+}
+
+void TerrainMeshGenerator::GenerateIndices(DX::Mesh::PackedIndices& packed) const
+{
+	std::vector<uint32_t> indices;
+	GenerateTriangles(indices);
+	DX::Mesh::OptimizeVertexCache(indices.data(), indices.size(), GetVertexCount());
+	DX::Mesh::PackIndices(indices.data(), indices.size(), GetVertexCount(), packed);
+}
+
+// Zwei Dreiecke je Gitterzelle im Uhrzeigersinn von oben gesehen, dazu die Schürzen in beiden
+// Umlaufrichtungen, damit sie von jeder Seite sichtbar sind.
+void TerrainMeshGenerator::GenerateTriangles(std::vector<uint32_t>& indices) const
+{
+	uint32_t r = m_description.resolution;
+	indices.clear();
+	indices.reserve(6 * (r - 1) * (r - 1) + 4 * 12 * (r - 1));
+
+	for (uint32_t row = 0; row + 1 < r; row++)
+	{
+		for (uint32_t column = 0; column + 1 < r; column++)
+		{
+			uint32_t i00 = row * r + column;
+			uint32_t i01 = i00 + 1;
+			uint32_t i10 = i00 + r;
+			uint32_t i11 = i10 + 1;
+			uint32_t cell[] = { i00, i10, i01, i01, i10, i11 };
+			indices.insert(indices.end(), cell, cell + 6);
+		}
+	}
+
+	for (uint32_t edge = 0; edge < 4; edge++)
+	{
+		for (uint32_t i = 0; i + 1 < r; i++)
+		{
+			uint32_t row = edge < 2 ? (edge == 0 ? 0 : r - 1) : i;
+			uint32_t column = edge < 2 ? i : (edge == 2 ? 0 : r - 1);
+			uint32_t step = edge < 2 ? 1 : r;
+
+			uint32_t a = row * r + column;
+			uint32_t b = a + step;
+			uint32_t c = r * r + edge * r + i;
+			uint32_t d = c + 1;
+			uint32_t skirt[] = { a, b, c, c, b, d, a, c, b, b, c, d };
+			indices.insert(indices.end(), skirt, skirt + 12);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "TerrainTile.h"
+#include "../Common/MeshProcessing.h"
+
+namespace Open_Glider_Simulator
+{
+	// Erzeugt aus den Höhen einer Kachel das Netz für den CDLOD-Renderer: quantisierte Gitterpunkte mit
+	// Normale, Farbe und Überblendhöhe, dazu Schürzen an den Rändern. Ohne Zustand außer der
+	// Pyramidenbeschreibung und daher auf beliebig vielen Arbeitsthreads gleichzeitig nutzbar.
+	class TerrainMeshGenerator
+	{
+	public:
+		// Zellen je Kante des Verdeckergitters.
+		static const uint32_t OccluderCells = 8;
+
+		explicit TerrainMeshGenerator(const TerrainPyramidDescription& description);
+
+		void Generate(const TerrainTile& tile, TerrainMeshBlock& block) const;
+
+		// Gemeinsamer Indexpuffer für alle Kacheln als Dreiecksliste, für den Cache der Vertex-Shader-Ergebnisse
+		// umsortiert und in der kleinsten passenden Indexbreite.
+		void GenerateIndices(DX::Mesh::PackedIndices& indices) const;
+
+		// Dieselben Dreiecke in der Reihenfolge des Gitters, vor dem Umsortieren; für Auswertungen.
+		void GenerateTriangles(std::vector<uint32_t>& indices) const;
+
+		// Indizes des Verdeckergitters als Dreiecksliste, gleich für alle Kacheln.
+		void GenerateOccluderIndices(std::vector<uint32_t>& indices) const;
+
+		uint32_t GetVertexCount() const						{ return m_description.resolution * (m_description.resolution + 4); }
+		uint32_t GetOccluderVertexCount() const				{ return (OccluderCells + 1) * (OccluderCells + 1); }
+
+	private:
+		void GenerateOccluder(const TerrainTile& tile, TerrainMeshBlock& block) const;
+
+		TerrainPyramidDescription	m_description;
+	};
+}
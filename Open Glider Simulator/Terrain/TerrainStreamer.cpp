@@ -0,0 +1,226 @@
+﻿#include "TerrainStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include "../Common/Profiler.h"
+
+using namespace Open_Glider_Simulator;
+
+TerrainStreamer::TerrainStreamer(DX::ThreadPool& threadPool, std::shared_ptr<const ITerrainTileSource> source, size_t memoryBudget, uint32_t maxLoadsInFlight,
+	std::shared_ptr<const TerrainMeshGenerator> meshGenerator) :
+	m_threadPool(threadPool),
+	m_source(std::move(source)),
+	m_meshGenerator(std::move(meshGenerator)),
+	m_cache(memoryBudget),
+	m_maxLoadsInFlight(std::max(maxLoadsInFlight, 1u))
+{
+	m_statistics = TerrainStreamingStatistics();
+}
+
+// Laufende Ladevorgänge schreiben in m_loads und müssen daher vor dem Abbau beendet sein.
+TerrainStreamer::~TerrainStreamer()
+{
+	for (auto& load : m_loads)
+	{
+		load.done.wait();
+	}
+}
+
+void TerrainStreamer::Update(const TerrainView& view, std::vector<std::shared_ptr<const TerrainTile>>& selection)
+{
+	DX_PROFILE_ZONE("TerrainStreamer::Update");
+
+	CollectLoads();
+
+	selection.clear();
+	m_requests.clear();
+	m_statistics.fallbackTiles = 0;
+
+	TerrainTileKey rootKey = { 0, 0, 0 };
+	std::shared_ptr<const TerrainTile> root = m_cache.Find(rootKey);
+	if (root)
+	{
+		Visit(view, root, selection);
+	}
+	else
+	{
+		RequestLoad(rootKey, std::numeric_limits<float>::max());
+	}
+
+	m_statistics.selectedTiles = static_cast<uint32_t>(selection.size());
+	m_statistics.stallsPrevented += m_statistics.fallbackTiles;
+
+	StartLoads();
+}
+
+void TerrainStreamer::CollectLoads()
+{
+	for (auto load = m_loads.begin(); load != m_loads.end();)
+	{
+		if (load->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++load;
+			continue;
+		}
+
+		TerrainTileKey key = load->key;
+		m_loading.erase(key.Pack());
+		std::future<void> done = std::move(load->done);
+		std::shared_ptr<TerrainTile> tile = std::move(load->tile);
+		load = m_loads.erase(load);
+
+		// Eine defekte Kachel darf das Streaming nicht anhalten.
+		try
+		{
+			done.get();
+		}
+		catch (const std::exception& exception)
+		{
+			ReportFailure(key, exception.what());
+			continue;
+		}
+		catch (...)
+		{
+			ReportFailure(key, "unknown error");
+			continue;
+		}
+		m_cache.Insert(std::move(tile));
+		m_statistics.loadsCompleted++;
+	}
+	m_statistics.loadsInFlight = static_cast<uint32_t>(m_loads.size());
+}
+
+void TerrainStreamer::ReportFailure(const TerrainTileKey& key, const char* message)
+{
+	m_failed.insert(key.Pack());
+	m_statistics.loadsFailed++;
+	if (m_loadErrorHandler)
+	{
+		m_loadErrorHandler(key, message);
+	}
+}
+
+// Verfeinert wird nur, wenn alle vier Kinder vorhanden sind; andernfalls deckt die Kachel selbst ihre
+// Fläche ab, bis die fehlenden Kinder geladen sind.
+void TerrainStreamer::Visit(const TerrainView& view, const std::shared_ptr<const TerrainTile>& tile, std::vector<std::shared_ptr<const TerrainTile>>& selection)
+{
+	const TerrainTileKey& key = tile->key;
+	float error = GetScreenError(view, *tile);
+	if (key.level + 1 >= m_source->GetDescription().levelCount || error <= view.maxScreenError)
+	{
+		selection.push_back(tile);
+		return;
+	}
+
+	std::shared_ptr<const TerrainTile> children[4];
+	bool complete = true;
+	for (uint32_t index = 0; index < 4; index++)
+	{
+		children[index] = m_cache.Find(key.GetChild(index));
+		if (!children[index])
+		{
+			RequestLoad(key.GetChild(index), error);
+			complete = false;
+		}
+	}
+
+	if (!complete)
+	{
+		selection.push_back(tile);
+		m_statistics.fallbackTiles++;
+		return;
+	}
+
+	for (uint32_t index = 0; index < 4; index++)
+	{
+		Visit(view, children[index], selection);
+	}
+}
+
+// Projizierter geometrischer Fehler der Kachel im Abstand ihres nächsten Punkts zur Kamera.
+float TerrainStreamer::GetScreenError(const TerrainView& view, const TerrainTile& tile) const
+{
+	const TerrainPyramidDescription& description = m_source->GetDescription();
+	float size = description.GetTileSize(tile.key.level);
+
+	float dn = std::max(std::max(tile.originN - view.north, view.north - (tile.originN + size)), 0.0f);
+	float de = std::max(std::max(tile.originE - view.east, view.east - (tile.originE + size)), 0.0f);
+	float dh = std::max(std::max(tile.minHeight - view.altitude, view.altitude - tile.maxHeight), 0.0f);
+	float distance = std::max(std::sqrt(dn * dn + de * de + dh * dh), 1.0f);
+
+	float projection = view.viewportHeight / (2.0f * std::tan(0.5f * view.verticalFieldOfView));
+	return description.geometricError[tile.key.level] * projection / distance;
+}
+
+// Die Elternkachel genügt, sobald ihr Bildschirmfehler unter die Schwelle fällt.
+float TerrainStreamer::GetMorphDistance(const TerrainView& view, uint32_t level) const
+{
+	if (level == 0)
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	float projection = view.viewportHeight / (2.0f * std::tan(0.5f * view.verticalFieldOfView));
+	return m_source->GetDescription().geometricError[level - 1] * projection / view.maxScreenError;
+}
+
+void TerrainStreamer::RequestLoad(const TerrainTileKey& key, float priority)
+{
+	if (m_failed.count(key.Pack()) != 0)
+	{
+		return;
+	}
+
+	Request request = { key, priority };
+	m_requests.push_back(request);
+}
+
+void TerrainStreamer::StartLoads()
+{
+	if (m_loads.size() >= m_maxLoadsInFlight || m_requests.empty())
+	{
+		return;
+	}
+
+	std::sort(m_requests.begin(), m_requests.end(), [](const Request& a, const Request& b)
+	{
+		return a.priority > b.priority;
+	});
+
+	for (const Request& request : m_requests)
+	{
+		if (m_loads.size() >= m_maxLoadsInFlight)
+		{
+			break;
+		}
+		if (!m_loading.insert(request.key.Pack()).second)
+		{
+			continue;
+		}
+
+		m_loads.push_back(Load());
+		Load& load = m_loads.back();
+		load.key = request.key;
+
+		const ITerrainTileSource* source = m_source.get();
+		const TerrainMeshGenerator* meshGenerator = m_meshGenerator.get();
+		TerrainTileKey key = request.key;
+		load.done = m_threadPool.Submit([source, meshGenerator, key, &load]()
+		{
+			DX_PROFILE_ZONE("Terrain::LoadTile");
+			std::shared_ptr<TerrainTile> tile = source->LoadTile(key);
+			if (meshGenerator)
+			{
+				DX_PROFILE_ZONE("Terrain::GenerateMesh");
+				auto mesh = std::make_shared<TerrainMeshBlock>();
+				meshGenerator->Generate(*tile, *mesh);
+				tile->mesh = mesh;
+			}
+			load.tile = tile;
+		});
+	}
+	m_statistics.loadsInFlight = static_cast<uint32_t>(m_loads.size());
+}
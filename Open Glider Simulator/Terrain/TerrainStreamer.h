@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "TerrainTile.h"
+#include "TerrainTileCache.h"
+#include "TerrainMeshGenerator.h"
+#include "../Common/ThreadPool.h"
+
+namespace Open_Glider_Simulator
+{
+	// Kamera für die Detailauswahl. Position in m (Nord, Ost, Höhe), Winkel in rad.
+	struct TerrainView
+	{
+		float	north;
+		float	east;
+		float	altitude;
+		float	verticalFieldOfView;
+		float	viewportHeight;		// Pixel
+		float	maxScreenError;		// erlaubter Höhenfehler auf dem Bildschirm in Pixeln
+	};
+
+	struct TerrainStreamingStatistics
+	{
+		uint32_t	selectedTiles;		// im letzten Frame
+		uint32_t	fallbackTiles;		// im letzten Frame gröber gezeichnet, weil die feineren Kacheln fehlten
+		uint32_t	loadsInFlight;
+		uint64_t	loadsCompleted;
+		uint64_t	stallsPrevented;	// Summe von fallbackTiles über alle Frames
+		uint64_t	loadsFailed;
+	};
+
+	// Meldet eine Kachel, deren Laden oder Netzerzeugung eine Ausnahme geworfen hat.
+	typedef std::function<void(const TerrainTileKey& key, const char* message)> TerrainLoadErrorHandler;
+
+	// Wählt je Frame die Kacheln eines Quadtrees nach Bildschirmfehler aus und lädt fehlende Kacheln im
+	// Hintergrund nach. Ist eine feinere Stufe noch nicht geladen, wird die nächstgröbere vorhandene gezeichnet,
+	// sodass der Renderthread nie auf das Laden wartet. Mit einem Netzgenerator wird das Netz jeder Kachel
+	// gleich nach dem Laden auf demselben Arbeitsthread erzeugt; ausgewählte Kacheln sind dann fertig zum
+	// Hochladen. Schlägt das Laden einer Kachel fehl, wird sie gemeldet und nicht erneut angefordert; ihre
+	// Fläche deckt weiter die Elternkachel ab. Nur vom Renderthread aus benutzen.
+	class TerrainStreamer
+	{
+	public:
+		TerrainStreamer(DX::ThreadPool& threadPool, std::shared_ptr<const ITerrainTileSource> source, size_t memoryBudget, uint32_t maxLoadsInFlight = 8,
+			std::shared_ptr<const TerrainMeshGenerator> meshGenerator = nullptr);
+		~TerrainStreamer();
+
+		// Übernimmt fertig geladene Kacheln, füllt selection mit den zu zeichnenden Kacheln und
+		// startet die dringendsten der dabei fehlenden Ladevorgänge. Anforderungen, die im nächsten Frame
+		// nicht erneut gestellt werden, verfallen.
+		void Update(const TerrainView& view, std::vector<std::shared_ptr<const TerrainTile>>& selection);
+
+		// Entfernung, ab der eine Kachel der Stufe durch ihre Elternkachel ersetzt wird; bis dahin ist ihr Netz
+		// vollständig auf die gröbere Fläche überblendet. Für Stufe 0 unendlich.
+		float GetMorphDistance(const TerrainView& view, uint32_t level) const;
+
+		// Wird aus Update auf dem Renderthread aufgerufen.
+		void SetLoadErrorHandler(TerrainLoadErrorHandler handler)	{ m_loadErrorHandler = std::move(handler); }
+
+		const ITerrainTileSource& GetSource() const					{ return *m_source; }
+		const TerrainTileCache& GetCache() const					{ return m_cache; }
+		const TerrainStreamingStatistics& GetStatistics() const		{ return m_statistics; }
+
+	private:
+		struct Request
+		{
+			TerrainTileKey	key;
+			float			priority;
+		};
+
+		struct Load
+		{
+			TerrainTileKey					key;
+			std::shared_ptr<TerrainTile>	tile;
+			std::future<void>				done;
+		};
+
+		void CollectLoads();
+		void ReportFailure(const TerrainTileKey& key, const char* message);
+		void Visit(const TerrainView& view, const std::shared_ptr<const TerrainTile>& tile, std::vector<std::shared_ptr<const TerrainTile>>& selection);
+		float GetScreenError(const TerrainView& view, const TerrainTile& tile) const;
+		void RequestLoad(const TerrainTileKey& key, float priority);
+		void StartLoads();
+
+		DX::ThreadPool&								m_threadPool;
+		std::shared_ptr<const ITerrainTileSource>	m_source;
+		std::shared_ptr<const TerrainMeshGenerator>	m_meshGenerator;
+		TerrainTileCache							m_cache;
+		uint32_t									m_maxLoadsInFlight;
+		std::vector<Request>						m_requests;
+		std::list<Load>								m_loads;		// Listenelemente behalten ihre Adresse, solange der Arbeitsthread schreibt
+		std::unordered_set<uint64_t>				m_loading;
+		std::unordered_set<uint64_t>				m_failed;
+		TerrainLoadErrorHandler						m_loadErrorHandler;
+		TerrainStreamingStatistics					m_statistics;
+	};
+}
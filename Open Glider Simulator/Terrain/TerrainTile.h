@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Open_Glider_Simulator
+{
+	// Kachel einer Quadtree-Pyramide: Stufe 0 ist eine Kachel über das ganze Gebiet, Stufe l hat 2^l × 2^l Kacheln.
+	// x zählt nach Osten, y nach Norden.
+	struct TerrainTileKey
+	{
+		uint32_t level;
+		uint32_t x;
+		uint32_t y;
+
+		uint64_t Pack() const								{ return static_cast<uint64_t>(level) << 58 | static_cast<uint64_t>(x) << 29 | y; }
+		TerrainTileKey GetParent() const					{ TerrainTileKey parent = { level - 1, x / 2, y / 2 }; return parent; }
+		TerrainTileKey GetChild(uint32_t index) const		{ TerrainTileKey child = { level + 1, 2 * x + (index & 1), 2 * y + (index >> 1) }; return child; }
+
+		bool operator==(const TerrainTileKey& other) const	{ return level == other.level && x == other.x && y == other.y; }
+	};
+
+	// Aufbau einer Pyramide. Alle Kacheln haben resolution × resolution Höhenwerte, die Randwerte
+	// benachbarter Kacheln fallen zusammen. Längen und Höhen in m.
+	struct TerrainPyramidDescription
+	{
+		float				originN;			// Südwestecke
+		float				originE;
+		float				size;				// Kantenlänge des quadratischen Gebiets
+		uint32_t			levelCount;
+		uint32_t			resolution;
+		float				minHeight;
+		float				maxHeight;
+		std::vector<float>	geometricError;		// größte Höhenabweichung einer Stufe gegenüber der feinsten
+
+		float GetTileSize(uint32_t level) const				{ return size / static_cast<float>(1u << level); }
+		float GetSpacing(uint32_t level) const				{ return GetTileSize(level) / (resolution - 1); }
+		float GetTileOriginN(const TerrainTileKey& key) const	{ return originN + key.y * GetTileSize(key.level); }
+		float GetTileOriginE(const TerrainTileKey& key) const	{ return originE + key.x * GetTileSize(key.level); }
+	};
+
+	// Scheitelpunkt des Geländenetzes, 16 Byte. position enthält Lage in Szenenachsen (x = Ost, y = oben, z = Süd)
+	// und als w die Höhe auf der Fläche der nächstgröberen Stufe, zu der der Vertex-Shader mit wachsender
+	// Entfernung überblendet, jeweils auf 16 Bit relativ zu den Grenzen der Kachel. Die Normale ist
+	// oktaedrisch in zwei Komponenten mit 8 Bit abgelegt, die Farbe als RGBA mit 8 Bit.
+	struct TerrainVertex
+	{
+		uint16_t	position[4];
+		int8_t		normal[4];
+		uint8_t		color[4];
+	};
+
+	// Fertig zum Hochladen: resolution × resolution Gitterpunkte, danach je Rand resolution Schürzenpunkte.
+	// Szenenlage = positionOffset + position / 65535 * positionScale; die Überblendhöhe verwendet die y-Werte.
+	// Dazu ein grobes Gitter für die Verdeckungsrechnung mit x, y, z je Punkt in Szenenachsen.
+	struct TerrainMeshBlock
+	{
+		float						positionOffset[3];
+		float						positionScale[3];
+		std::vector<TerrainVertex>	vertices;
+		std::vector<float>			occluderPositions;
+	};
+
+	// Höhenwerte einer Kachel, zeilenweise nach Nord: heights[row * resolution + column].
+	// Das Netz wird, sofern gewünscht, gleich beim Laden auf dem Arbeitsthread erzeugt.
+	struct TerrainTile
+	{
+		TerrainTileKey		key;
+		float				originN;
+		float				originE;
+		float				spacing;
+		uint32_t			resolution;
+		float				minHeight;
+		float				maxHeight;
+		std::vector<float>	heights;
+		std::shared_ptr<const TerrainMeshBlock>	mesh;
+
+		size_t GetMemorySize() const
+		{
+			return sizeof(TerrainTile) + heights.capacity() * sizeof(float) + (mesh ? sizeof(TerrainMeshBlock) + mesh->vertices.capacity() * sizeof(TerrainVertex) + mesh->occluderPositions.capacity() * sizeof(float) : 0);
+		}
+	};
+
+	// Quelle für Kacheln, z. B. eine Pyramidendatei oder ein prozedurales Gelände.
+	// LoadTile wird gleichzeitig von mehreren Arbeitsthreads aufgerufen.
+	class ITerrainTileSource
+	{
+	public:
+		virtual ~ITerrainTileSource() {}
+
+		virtual const TerrainPyramidDescription& GetDescription() const = 0;
+		virtual std::shared_ptr<TerrainTile> LoadTile(const TerrainTileKey& key) const = 0;
+	};
+}
@@ -0,0 +1,67 @@
+﻿#include "TerrainTileCache.h"
+
+using namespace Open_Glider_Simulator;
+
+TerrainTileCache::TerrainTileCache(size_t memoryBudget) :
+	m_memoryBudget(memoryBudget),
+	m_memoryUsage(0)
+{
+	m_statistics = TerrainCacheStatistics();
+}
+
+std::shared_ptr<const TerrainTile> TerrainTileCache::Find(const TerrainTileKey& key)
+{
+	auto entry = m_entries.find(key.Pack());
+	if (entry == m_entries.end())
+	{
+		m_statistics.misses++;
+		return nullptr;
+	}
+
+	m_statistics.hits++;
+	m_tiles.splice(m_tiles.begin(), m_tiles, entry->second);
+	return *entry->second;
+}
+
+void TerrainTileCache::Insert(std::shared_ptr<const TerrainTile> tile)
+{
+	uint64_t packed = tile->key.Pack();
+	auto entry = m_entries.find(packed);
+	if (entry != m_entries.end())
+	{
+		m_memoryUsage -= (*entry->second)->GetMemorySize();
+		m_tiles.erase(entry->second);
+		m_entries.erase(entry);
+	}
+
+	m_memoryUsage += tile->GetMemorySize();
+	m_tiles.push_front(std::move(tile));
+	m_entries[packed] = m_tiles.begin();
+	Evict();
+}
+
+void TerrainTileCache::Clear()
+{
+	m_tiles.clear();
+	m_entries.clear();
+	m_memoryUsage = 0;
+}
+
+// Von hinten, also ab der am längsten unbenutzten Kachel, verdrängen. Die eben eingefügte Kachel bleibt
+// auch dann erhalten, wenn sie allein das Budget überschreitet.
+void TerrainTileCache::Evict()
+{
+	auto tile = m_tiles.end();
+	while (m_memoryUsage > m_memoryBudget && --tile != m_tiles.begin())
+	{
+		if ((*tile)->key.level == 0)
+		{
+			continue;
+		}
+
+		m_memoryUsage -= (*tile)->GetMemorySize();
+		m_entries.erase((*tile)->key.Pack());
+		tile = m_tiles.erase(tile);
+		m_statistics.evictions++;
+	}
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "TerrainTile.h"
+
+namespace Open_Glider_Simulator
+{
+	struct TerrainCacheStatistics
+	{
+		uint64_t	hits;
+		uint64_t	misses;
+		uint64_t	evictions;
+	};
+
+	// Zuletzt benutzte Kacheln bis zu einem Speicherbudget. Kacheln der Stufe 0 werden nie verdrängt,
+	// damit immer eine Rückfallstufe vorhanden ist. Nicht threadsicher; gehört dem Thread, der die Auswahl trifft.
+	class TerrainTileCache
+	{
+	public:
+		explicit TerrainTileCache(size_t memoryBudget);
+
+		// Liefert nullptr, wenn die Kachel nicht vorhanden ist. Zählt als Treffer oder Fehlgriff und
+		// markiert die Kachel als zuletzt benutzt.
+		std::shared_ptr<const TerrainTile> Find(const TerrainTileKey& key);
+		// Wie Find, aber ohne Statistik und ohne die Reihenfolge zu ändern.
+		bool Contains(const TerrainTileKey& key) const		{ return m_entries.count(key.Pack()) != 0; }
+
+		void Insert(std::shared_ptr<const TerrainTile> tile);
+		void Clear();
+
+		size_t GetMemoryUsage() const						{ return m_memoryUsage; }
+		size_t GetMemoryBudget() const						{ return m_memoryBudget; }
+		size_t GetTileCount() const							{ return m_entries.size(); }
+		const TerrainCacheStatistics& GetStatistics() const	{ return m_statistics; }
+
+	private:
+		typedef std::list<std::shared_ptr<const TerrainTile>> TileList;
+
+		void Evict();
+
+		size_t												m_memoryBudget;
+		size_t												m_memoryUsage;
+		TileList											m_tiles;		// vorne zuletzt benutzt
+		std::unordered_map<uint64_t, TileList::iterator>	m_entries;
+		TerrainCacheStatistics								m_statistics;
+	};
+}
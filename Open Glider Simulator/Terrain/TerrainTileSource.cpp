@@ -0,0 +1,256 @@
+﻿#include "TerrainTileSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	const uint32_t FileMagic = 0x50544f47;	// "GOTP"
+	const uint32_t FileVersion = 1;
+	const uint64_t HeaderSize = 256;
+	const uint32_t MaxLevelCount = 16;
+	const float QuantizationSteps = 65535.0f;
+
+	struct FileHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		float		originN;
+		float		originE;
+		float		size;
+		uint32_t	levelCount;
+		uint32_t	resolution;
+		float		minHeight;
+		float		maxHeight;
+		float		geometricError[MaxLevelCount];
+	};
+
+	static_assert(sizeof(FileHeader) <= HeaderSize, "Der Dateikopf muss in den reservierten Bereich passen.");
+
+	void CheckKey(const TerrainPyramidDescription& description, const TerrainTileKey& key)
+	{
+		if (key.level >= description.levelCount || key.x >= (1u << key.level) || key.y >= (1u << key.level))
+		{
+			throw std::invalid_argument("Terrain: Kachel liegt außerhalb der Pyramide.");
+		}
+	}
+
+	std::shared_ptr<TerrainTile> CreateTile(const TerrainPyramidDescription& description, const TerrainTileKey& key)
+	{
+		auto tile = std::make_shared<TerrainTile>();
+		tile->key = key;
+		tile->originN = description.GetTileOriginN(key);
+		tile->originE = description.GetTileOriginE(key);
+		tile->spacing = description.GetSpacing(key.level);
+		tile->resolution = description.resolution;
+		tile->heights.resize(description.resolution * description.resolution);
+		return tile;
+	}
+
+	void UpdateRange(TerrainTile& tile)
+	{
+		auto range = std::minmax_element(tile.heights.begin(), tile.heights.end());
+		tile.minHeight = *range.first;
+		tile.maxHeight = *range.second;
+	}
+}
+
+ProceduralTileSource::ProceduralTileSource(const ProceduralTerrain& terrain, float originN, float originE, float size, uint32_t levelCount, uint32_t resolution) :
+	m_terrain(terrain)
+{
+	if (levelCount < 1 || levelCount > MaxLevelCount || resolution < 2 || !(size > 0.0f))
+	{
+		throw std::invalid_argument("ProceduralTileSource: ungültiger Aufbau der Pyramide.");
+	}
+
+	m_description.originN = originN;
+	m_description.originE = originE;
+	m_description.size = size;
+	m_description.levelCount = levelCount;
+	m_description.resolution = resolution;
+	m_description.minHeight = terrain.GetBaseHeight();
+	m_description.maxHeight = terrain.GetBaseHeight() + terrain.GetRelief();
+	m_description.geometricError.assign(levelCount, 0.0f);
+	EstimateGeometricError(*this, m_description.geometricError);
+}
+
+std::shared_ptr<TerrainTile> ProceduralTileSource::LoadTile(const TerrainTileKey& key) const
+{
+	CheckKey(m_description, key);
+
+	auto tile = CreateTile(m_description, key);
+	m_terrain.GetHeights(tile->originN, tile->originE, tile->spacing, tile->resolution, tile->resolution, tile->heights.data());
+	UpdateRange(*tile);
+	return tile;
+}
+
+void TerrainTileFile::Open(const std::wstring& path)
+{
+	m_file.Close();
+	m_file.Open(path);
+
+	FileHeader header;
+	{
+		DX::MemoryMappedView view = m_file.Map(0, sizeof(header));
+		std::copy(view.GetData(), view.GetData() + sizeof(header), reinterpret_cast<uint8_t*>(&header));
+	}
+
+	if (header.magic != FileMagic || header.version != FileVersion ||
+		header.levelCount < 1 || header.levelCount > MaxLevelCount || header.resolution < 2 || !(header.size > 0.0f))
+	{
+		m_file.Close();
+		throw std::runtime_error("TerrainTileFile: unbekanntes Dateiformat.");
+	}
+
+	m_description.originN = header.originN;
+	m_description.originE = header.originE;
+	m_description.size = header.size;
+	m_description.levelCount = header.levelCount;
+	m_description.resolution = header.resolution;
+	m_description.minHeight = header.minHeight;
+	m_description.maxHeight = header.maxHeight;
+	m_description.geometricError.assign(header.geometricError, header.geometricError + header.levelCount);
+
+	uint32_t last = (1u << (header.levelCount - 1)) - 1;
+	TerrainTileKey lastKey = { header.levelCount - 1, last, last };
+	if (m_file.GetSize() < GetTileOffset(lastKey) + GetRecordSize())
+	{
+		m_file.Close();
+		throw std::runtime_error("TerrainTileFile: Datei ist unvollständig.");
+	}
+}
+
+// Stufe l beginnt nach den (4^l - 1) / 3 Kacheln der gröberen Stufen, innerhalb der Stufe zeilenweise nach Nord.
+uint64_t TerrainTileFile::GetTileOffset(const TerrainTileKey& key) const
+{
+	uint64_t levelStart = ((1ull << (2 * key.level)) - 1) / 3;
+	uint64_t index = levelStart + static_cast<uint64_t>(key.y) * (1u << key.level) + key.x;
+	return HeaderSize + index * GetRecordSize();
+}
+
+size_t TerrainTileFile::GetRecordSize() const
+{
+	return 2 * sizeof(float) + m_description.resolution * m_description.resolution * sizeof(uint16_t);
+}
+
+std::shared_ptr<TerrainTile> TerrainTileFile::LoadTile(const TerrainTileKey& key) const
+{
+	if (!m_file.IsOpen())
+	{
+		throw std::runtime_error("TerrainTileFile: keine Datei geöffnet.");
+	}
+	CheckKey(m_description, key);
+
+	auto tile = CreateTile(m_description, key);
+	DX::MemoryMappedView view = m_file.Map(GetTileOffset(key), GetRecordSize());
+	const uint8_t* data = view.GetData();
+
+	std::memcpy(&tile->minHeight, data, sizeof(float));
+	std::memcpy(&tile->maxHeight, data + sizeof(float), sizeof(float));
+	data += 2 * sizeof(float);
+
+	float scale = (tile->maxHeight - tile->minHeight) / QuantizationSteps;
+	for (size_t i = 0; i < tile->heights.size(); i++)
+	{
+		uint16_t quantized;
+		std::memcpy(&quantized, data + i * sizeof(uint16_t), sizeof(uint16_t));
+		tile->heights[i] = tile->minHeight + quantized * scale;
+	}
+	return tile;
+}
+
+void TerrainTileFile::Write(std::ostream& stream, const ITerrainTileSource& source)
+{
+	const TerrainPyramidDescription& d = source.GetDescription();
+	if (d.levelCount < 1 || d.levelCount > MaxLevelCount || d.resolution < 2)
+	{
+		throw std::invalid_argument("TerrainTileFile: ungültiger Aufbau der Pyramide.");
+	}
+
+	FileHeader fileHeader = { FileMagic, FileVersion, d.originN, d.originE, d.size, d.levelCount, d.resolution, d.minHeight, d.maxHeight, {} };
+	std::copy(d.geometricError.begin(), d.geometricError.begin() + std::min<size_t>(d.geometricError.size(), d.levelCount), fileHeader.geometricError);
+
+	uint8_t header[HeaderSize] = {};
+	std::copy(reinterpret_cast<const uint8_t*>(&fileHeader), reinterpret_cast<const uint8_t*>(&fileHeader) + sizeof(fileHeader), header);
+	stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	std::vector<uint16_t> quantized(d.resolution * d.resolution);
+	for (uint32_t level = 0; level < d.levelCount; level++)
+	{
+		for (uint32_t y = 0; y < (1u << level); y++)
+		{
+			for (uint32_t x = 0; x < (1u << level); x++)
+			{
+				TerrainTileKey key = { level, x, y };
+				std::shared_ptr<TerrainTile> tile = source.LoadTile(key);
+
+				float range = tile->maxHeight - tile->minHeight;
+				float scale = range > 0.0f ? QuantizationSteps / range : 0.0f;
+				for (size_t i = 0; i < quantized.size(); i++)
+				{
+					quantized[i] = static_cast<uint16_t>(std::round((tile->heights[i] - tile->minHeight) * scale));
+				}
+
+				stream.write(reinterpret_cast<const char*>(&tile->minHeight), sizeof(float));
+				stream.write(reinterpret_cast<const char*>(&tile->maxHeight), sizeof(float));
+				stream.write(reinterpret_cast<const char*>(quantized.data()), quantized.size() * sizeof(uint16_t));
+			}
+		}
+	}
+}
+
+// Die Zwischenpunkte einer Stufe sind die Stützstellen der nächstfeineren. Verglichen wird dort die bilineare
+// Interpolation der gröberen Kachel mit den feineren Höhen; die Fehler werden von fein nach grob aufsummiert,
+// damit jede Stufe den Abstand zur feinsten angibt. Stichprobe sind die Kacheln entlang der Diagonale.
+void Open_Glider_Simulator::EstimateGeometricError(const ITerrainTileSource& source, std::vector<float>& geometricError)
+{
+	const TerrainPyramidDescription& d = source.GetDescription();
+	const uint32_t SampleTiles = 4;
+	uint32_t r = d.resolution;
+
+	geometricError.assign(d.levelCount, 0.0f);
+	for (uint32_t level = 0; level + 1 < d.levelCount; level++)
+	{
+		uint32_t tileCount = 1u << level;
+		uint32_t step = std::max(tileCount / SampleTiles, 1u);
+		float error = 0.0f;
+
+		for (uint32_t index = 0; index < tileCount; index += step)
+		{
+			TerrainTileKey key = { level, index, index };
+			std::shared_ptr<TerrainTile> coarse = source.LoadTile(key);
+
+			for (uint32_t child = 0; child < 4; child++)
+			{
+				std::shared_ptr<TerrainTile> fine = source.LoadTile(key.GetChild(child));
+				uint32_t offsetColumn = (child & 1) * (r - 1);
+				uint32_t offsetRow = (child >> 1) * (r - 1);
+
+				for (uint32_t row = 0; row < r; row++)
+				{
+					for (uint32_t column = 0; column < r; column++)
+					{
+						// Position des feinen Punkts im Raster der groben Kachel, in halben Schritten.
+						uint32_t u = offsetColumn + column;
+						uint32_t v = offsetRow + row;
+						uint32_t c0 = u / 2, r0 = v / 2;
+						uint32_t c1 = c0 + (u & 1), r1 = r0 + (v & 1);
+						const float* h = coarse->heights.data();
+						float interpolated = 0.25f * (h[r0 * r + c0] + h[r0 * r + c1] + h[r1 * r + c0] + h[r1 * r + c1]);
+						error = std::max(error, std::abs(interpolated - fine->heights[row * r + column]));
+					}
+				}
+			}
+		}
+		geometricError[level] = error;
+	}
+
+	for (uint32_t level = d.levelCount - 1; level-- > 0;)
+	{
+		geometricError[level] += geometricError[level + 1];
+	}
+}
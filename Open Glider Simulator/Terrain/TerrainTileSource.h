@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <ostream>
+#include <string>
+#include "TerrainTile.h"
+#include "ProceduralTerrain.h"
+#include "../Common/MemoryMappedFile.h"
+
+namespace Open_Glider_Simulator
+{
+	// Erzeugt Kacheln bei Bedarf aus einem prozeduralen Gelände.
+	class ProceduralTileSource : public ITerrainTileSource
+	{
+	public:
+		ProceduralTileSource(const ProceduralTerrain& terrain, float originN, float originE, float size, uint32_t levelCount, uint32_t resolution = 65);
+
+		virtual const TerrainPyramidDescription& GetDescription() const	{ return m_description; }
+		virtual std::shared_ptr<TerrainTile> LoadTile(const TerrainTileKey& key) const;
+
+	private:
+		ProceduralTerrain			m_terrain;
+		TerrainPyramidDescription	m_description;
+	};
+
+	// Pyramide in einer Datei: Kopf mit Beschreibung, danach alle Kacheln stufenweise mit fester Satzlänge,
+	// sodass sich die Lage jeder Kachel berechnen lässt. Höhen sind je Kachel zwischen Minimum und Maximum
+	// auf 16 Bit quantisiert. Gelesen wird per Speichereinblendung nur die angeforderte Kachel.
+	class TerrainTileFile : public ITerrainTileSource
+	{
+	public:
+		void Open(const std::wstring& path);
+
+		virtual const TerrainPyramidDescription& GetDescription() const	{ return m_description; }
+		virtual std::shared_ptr<TerrainTile> LoadTile(const TerrainTileKey& key) const;
+
+		// Alle Kacheln einer anderen Quelle in eine Pyramidendatei schreiben.
+		static void Write(std::ostream& stream, const ITerrainTileSource& source);
+
+	private:
+		uint64_t GetTileOffset(const TerrainTileKey& key) const;
+		size_t GetRecordSize() const;
+
+		DX::MemoryMappedFile		m_file;
+		TerrainPyramidDescription	m_description;
+	};
+
+	// Größte Abweichung zwischen der bilinearen Interpolation einer Stufe und der nächstfeineren,
+	// geschätzt an einigen Kacheln der Quelle.
+	void EstimateGeometricError(const ITerrainTileSource& source, std::vector<float>& geometricError);
+}
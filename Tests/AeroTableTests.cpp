@@ -0,0 +1,134 @@
+﻿#include "Simulation/AeroTable.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	// Lage der Achsen im Dateikopf: nach Kennung und Version folgen drei Achsen zu je 12 Byte.
+	const size_t AxisOffset = 8;
+	const size_t AxisSize = 12;
+
+	// Linear in allen Achsen, damit die Interpolation exakt bleibt.
+	AeroCoefficients LinearPolar(float alpha, float beta, float flap)
+	{
+		AeroCoefficients coefficients = { 0.2f + 5.0f * alpha, 0.01f + beta * 0.1f, -0.05f * flap };
+		return coefficients;
+	}
+
+	AeroTable BakeLinear(uint32_t alphaCount, uint32_t betaCount, uint32_t flapCount)
+	{
+		AeroTableAxis alpha = { -0.5f, 0.5f, alphaCount };
+		AeroTableAxis beta = { -0.3f, 0.3f, betaCount };
+		AeroTableAxis flap = { -1.0f, 1.0f, flapCount };
+		return AeroTable::Bake(alpha, beta, flap, LinearPolar);
+	}
+
+	void PatchAxis(std::string& bytes, uint32_t axis, const AeroTableAxis& value)
+	{
+		std::memcpy(&bytes[AxisOffset + axis * AxisSize], &value, sizeof(value));
+	}
+
+	bool Near(float a, float b)
+	{
+		return std::fabs(a - b) < 1.0e-5f;
+	}
+
+	void TestSampling()
+	{
+		AeroTable table = BakeLinear(11, 7, 5);
+		AeroCoefficients inside = table.Sample(0.123f, -0.17f, 0.4f);
+		CHECK(Near(inside.lift, 0.2f + 5.0f * 0.123f));
+		CHECK(Near(inside.drag, 0.01f - 0.017f));
+		CHECK(Near(inside.pitch, -0.02f));
+
+		// Außerhalb der Tabelle gilt der Rand.
+		AeroCoefficients outside = table.Sample(2.0f, -1.0f, 3.0f);
+		CHECK(Near(outside.lift, 2.7f));
+		CHECK(Near(outside.drag, -0.02f));
+		CHECK(Near(outside.pitch, -0.05f));
+	}
+
+	void TestRoundTrip()
+	{
+		AeroTable table = BakeLinear(9, 3, 2);
+		std::stringstream stream;
+		table.Write(stream);
+
+		AeroTable loaded = AeroTable::Read(stream);
+		CHECK(loaded.GetAxis(0).count == 9 && loaded.GetAxis(1).count == 3 && loaded.GetAxis(2).count == 2);
+		AeroCoefficients expected = table.Sample(0.31f, 0.05f, -0.6f);
+		AeroCoefficients actual = loaded.Sample(0.31f, 0.05f, -0.6f);
+		CHECK(expected.lift == actual.lift && expected.drag == actual.drag && expected.pitch == actual.pitch);
+	}
+
+	void TestBakeRejectsInvalidAxes()
+	{
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		const float infinity = std::numeric_limits<float>::infinity();
+		AeroTableAxis valid = { -1.0f, 1.0f, 4 };
+		AeroTableAxis invalid[] = {
+			{ -1.0f, 1.0f, 1 },
+			{ 1.0f, 1.0f, 4 },
+			{ 1.0f, -1.0f, 4 },
+			{ nan, 1.0f, 4 },
+			{ -1.0f, infinity, 4 },
+		};
+
+		for (const AeroTableAxis& axis : invalid)
+		{
+			CHECK_THROWS(AeroTable::Bake(axis, valid, valid, LinearPolar), std::invalid_argument);
+			CHECK_THROWS(AeroTable::Bake(valid, axis, valid, LinearPolar), std::invalid_argument);
+			CHECK_THROWS(AeroTable::Bake(valid, valid, axis, LinearPolar), std::invalid_argument);
+		}
+
+		// Zu viele Stützpunkte, auch wenn das Produkt der Anzahlen in 32 Bit überliefe.
+		AeroTableAxis large = { -1.0f, 1.0f, 65536 };
+		CHECK_THROWS(AeroTable::Bake(large, large, valid, LinearPolar), std::invalid_argument);
+		AeroTableAxis limit = { -1.0f, 1.0f, AeroTable::MaxNodeCount / 4 };
+		CHECK(!AeroTable::Bake(limit, { -1.0f, 1.0f, 2 }, { -1.0f, 1.0f, 2 }, LinearPolar).IsEmpty());
+		CHECK_THROWS(AeroTable::Bake(limit, { -1.0f, 1.0f, 3 }, { -1.0f, 1.0f, 2 }, LinearPolar), std::invalid_argument);
+	}
+
+	void TestReadRejectsInvalidHeaders()
+	{
+		std::stringstream stream;
+		BakeLinear(4, 3, 2).Write(stream);
+		const std::string valid = stream.str();
+
+		const AeroTableAxis invalid[] = {
+			{ -1.0f, 1.0f, 0 },
+			{ 0.5f, -0.5f, 4 },
+			{ std::numeric_limits<float>::quiet_NaN(), 1.0f, 4 },
+			{ -1.0f, 1.0f, 0x80000000u },
+		};
+		for (const AeroTableAxis& axis : invalid)
+		{
+			std::string bytes = valid;
+			PatchAxis(bytes, 1, axis);
+			std::istringstream input(bytes);
+			CHECK_THROWS(AeroTable::Read(input), std::runtime_error);
+		}
+
+		// Gültiger Kopf, aber die Stützpunkte fehlen.
+		std::string bytes = valid;
+		PatchAxis(bytes, 0, { -1.0f, 1.0f, 4096 });
+		std::istringstream truncated(bytes);
+		CHECK_THROWS(AeroTable::Read(truncated), std::runtime_error);
+
+		std::istringstream garbage("not an aero table");
+		CHECK_THROWS(AeroTable::Read(garbage), std::runtime_error);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("AeroTableTests", TestSampling, TestRoundTrip, TestBakeRejectsInvalidAxes, TestReadRejectsInvalidHeaders);
+}
@@ -0,0 +1,178 @@
+﻿#include "Common/AssetPack.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+// Ohne Argumente prüft das Programm Schreiben und Lesen von Archiven. Mit "<Archiv> <Datei>..." prüft es
+// zusätzlich, ob ein von AssetPacker erzeugtes Archiv genau diese Dateien enthält.
+namespace
+{
+	std::vector<std::string> g_packerArguments;
+
+	const char* const TempPath = "AssetPackTests.ogp";
+
+	std::wstring Widen(const std::string& path)
+	{
+		return std::wstring(path.begin(), path.end());
+	}
+
+	std::string ReadFile(const std::string& path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	}
+
+	void WriteFile(const std::string& path, const std::string& bytes)
+	{
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	bool Equals(const AssetData& data, const std::vector<uint8_t>& expected)
+	{
+		return data.GetSize() == expected.size() && (expected.empty() || memcmp(data.GetData(), expected.data(), expected.size()) == 0);
+	}
+
+	// Shaderähnliche Daten packen sich gut, Zufallsdaten gar nicht.
+	std::vector<std::vector<uint8_t>> MakeAssets()
+	{
+		std::mt19937 random(5);
+		std::vector<std::vector<uint8_t>> assets;
+		for (size_t size : { 0, 1, 100, 5000, 70000 })
+		{
+			std::vector<uint8_t> text(size);
+			std::vector<uint8_t> noise(size);
+			for (size_t i = 0; i < size; i++)
+			{
+				text[i] = static_cast<uint8_t>("DXBC shader text "[i % 17]);
+				noise[i] = static_cast<uint8_t>(random());
+			}
+			assets.push_back(text);
+			assets.push_back(noise);
+		}
+		return assets;
+	}
+
+	std::string WritePack(const std::vector<std::vector<uint8_t>>& assets)
+	{
+		AssetPackWriter writer;
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			writer.Add("asset_" + std::to_string(i) + ".cso", assets[i].data(), assets[i].size(), i % 4 < 2 ? AssetCompression::Lz4 : AssetCompression::None);
+		}
+		CHECK(writer.GetAssetCount() == assets.size());
+		CHECK_THROWS(writer.Add("asset_0.cso", nullptr, 0, AssetCompression::None), std::invalid_argument);
+
+		std::ostringstream stream;
+		writer.Write(stream);
+		return stream.str();
+	}
+
+	void TestRoundTrip()
+	{
+		std::vector<std::vector<uint8_t>> assets = MakeAssets();
+		WriteFile(TempPath, WritePack(assets));
+
+		AssetPack pack;
+		pack.Open(Widen(TempPath));
+		CHECK(pack.GetAssetCount() == assets.size());
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			CHECK(Equals(pack.Load("asset_" + std::to_string(i) + ".cso"), assets[i]));
+		}
+
+		// Gut packbare Daten liegen gepackt im Archiv, Zufallsdaten bleiben ungepackt.
+		CHECK(pack.Find("asset_8.cso")->compression == AssetCompression::Lz4);
+		CHECK(pack.Find("asset_9.cso")->compression == AssetCompression::None);
+		CHECK(!pack.Contains("missing.cso"));
+		CHECK_THROWS(pack.Load("missing.cso"), std::out_of_range);
+	}
+
+	void ExpectRejected(const std::string& bytes)
+	{
+		WriteFile(TempPath, bytes);
+		AssetPack pack;
+		CHECK_THROWS(pack.Open(Widen(TempPath)), std::runtime_error);
+		CHECK(!pack.IsOpen());
+	}
+
+	template<typename T>
+	void Patch(std::string& bytes, uint64_t offset, T value)
+	{
+		memcpy(&bytes[static_cast<size_t>(offset)], &value, sizeof(value));
+	}
+
+	// Einträge, die aus dem Datenbereich zeigen, und unmögliche Längen werden schon beim Öffnen abgelehnt.
+	void TestDamagedPacks()
+	{
+		const std::string bytes = WritePack(MakeAssets());
+		uint64_t tocOffset;
+		memcpy(&tocOffset, bytes.data() + 16, sizeof(tocOffset));
+		const uint64_t entry = tocOffset + sizeof(AssetPackEntry);
+
+		for (size_t length : { size_t(0), size_t(10), size_t(63), static_cast<size_t>(tocOffset), bytes.size() - 1 })
+		{
+			ExpectRejected(bytes.substr(0, length));
+		}
+
+		std::string damaged = bytes;
+		damaged[0] = 'X';
+		ExpectRejected(damaged);
+
+		// Versatz hinter dem Inhaltsverzeichnis; die Differenz zu tocOffset liefe ohne eigene Prüfung über.
+		damaged = bytes;
+		Patch<uint64_t>(damaged, entry + offsetof(AssetPackEntry, offset), (tocOffset + 2 * AssetPack::BlobAlignment) / AssetPack::BlobAlignment * AssetPack::BlobAlignment);
+		ExpectRejected(damaged);
+
+		damaged = bytes;
+		Patch<uint32_t>(damaged, entry + offsetof(AssetPackEntry, storedSize), 0xffffffffu);
+		ExpectRejected(damaged);
+
+		damaged = bytes;
+		Patch<uint32_t>(damaged, entry + offsetof(AssetPackEntry, compression), static_cast<uint32_t>(AssetCompression::Lz4));
+		Patch<uint32_t>(damaged, entry + offsetof(AssetPackEntry, storedSize), 1);
+		Patch<uint32_t>(damaged, entry + offsetof(AssetPackEntry, size), 100000);
+		ExpectRejected(damaged);
+
+		std::remove(TempPath);
+	}
+
+	// Jede an AssetPacker übergebene Datei muss unter ihrem Namen mit unverändertem Inhalt im Archiv liegen.
+	void TestPackerOutput()
+	{
+		if (g_packerArguments.empty())
+		{
+			return;
+		}
+
+		AssetPack pack;
+		pack.Open(Widen(g_packerArguments[0]));
+		CHECK(pack.GetAssetCount() == g_packerArguments.size() - 1);
+		for (size_t i = 1; i < g_packerArguments.size(); i++)
+		{
+			const std::string& path = g_packerArguments[i];
+			std::string name = path.substr(path.find_last_of("/\\") + 1);
+			std::string expected = ReadFile(path);
+			AssetData data = pack.Load(name);
+			CHECK(data.GetSize() == expected.size() && memcmp(data.GetData(), expected.data(), expected.size()) == 0);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	g_packerArguments.assign(argv + 1, argv + argc);
+	return Test::RunTests("AssetPackTests",
+		TestRoundTrip,
+		TestDamagedPacks,
+		TestPackerOutput);
+}
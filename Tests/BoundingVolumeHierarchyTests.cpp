@@ -0,0 +1,202 @@
+﻿#include "Common/BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	typedef BoundingVolumeHierarchy::ObjectId ObjectId;
+
+	void Multiply(const float a[4][4], const float b[4][4], float result[4][4])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column] + a[row][3] * b[3][column];
+			}
+		}
+	}
+
+	// Kamera an eye mit Blick entlang yaw in der x-z-Ebene und leichtem Blick nach unten, linkshändig und in
+	// Zeilenvektorform wie XMMatrixLookToLH und XMMatrixPerspectiveFovLH.
+	Frustum MakeFrustum(float eyeX, float eyeY, float eyeZ, float yaw, float fovY, float farZ)
+	{
+		float pitch = -0.2f;
+		float forward[3] = { std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch) };
+		float right[3] = { std::cos(yaw), 0.0f, -std::sin(yaw) };
+		float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+		float eye[3] = { eyeX, eyeY, eyeZ };
+		float view[4][4] = {};
+		for (int i = 0; i < 3; i++)
+		{
+			view[i][0] = right[i];
+			view[i][1] = up[i];
+			view[i][2] = forward[i];
+			view[3][0] -= right[i] * eye[i];
+			view[3][1] -= up[i] * eye[i];
+			view[3][2] -= forward[i] * eye[i];
+		}
+		view[3][3] = 1.0f;
+
+		float nearZ = 1.0f;
+		float scaleY = 1.0f / std::tan(fovY / 2);
+		float projection[4][4] = {};
+		projection[0][0] = scaleY / (16.0f / 9.0f);
+		projection[1][1] = scaleY;
+		projection[2][2] = farZ / (farZ - nearZ);
+		projection[2][3] = 1.0f;
+		projection[3][2] = -nearZ * farZ / (farZ - nearZ);
+
+		float viewProjection[4][4];
+		Multiply(view, projection, viewProjection);
+		return Frustum::FromViewProjection(viewProjection);
+	}
+
+	Aabb RandomBox(std::mt19937& random, float extent)
+	{
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::uniform_real_distribution<float> size(0.5f, 40.0f);
+		float center[3] = { position(random), position(random) * 0.05f, position(random) };
+		float half = size(random);
+		Aabb bounds = { { center[0] - half, center[1] - half, center[2] - half }, { center[0] + half, center[1] + half, center[2] + half } };
+		return bounds;
+	}
+
+	// Die Hierarchie muss genau die Objekte liefern, die der Einzeltest jeder Box als sichtbar ansieht.
+	bool MatchesBruteForce(const BoundingVolumeHierarchy& bvh, const std::vector<ObjectId>& ids, const Frustum& frustum)
+	{
+		std::vector<ObjectId> visible;
+		bvh.Cull(frustum, visible);
+		std::sort(visible.begin(), visible.end());
+
+		std::vector<ObjectId> expected;
+		for (ObjectId id : ids)
+		{
+			if (frustum.Intersects(bvh.GetBounds(id)))
+			{
+				expected.push_back(id);
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+		return visible == expected;
+	}
+
+	std::vector<Frustum> MakeViews()
+	{
+		std::vector<Frustum> views;
+		for (int i = 0; i < 16; i++)
+		{
+			float yaw = i * 0.4f;
+			views.push_back(MakeFrustum(std::sin(yaw) * 300.0f, 50.0f, std::cos(yaw) * 300.0f, yaw, 1.2f, 2000.0f));
+		}
+		// Sehr weit und sehr eng, damit ganz innen und ganz außen liegende Teilbäume vorkommen.
+		views.push_back(MakeFrustum(0.0f, 2000.0f, -8000.0f, 0.0f, 1.5f, 50000.0f));
+		views.push_back(MakeFrustum(0.0f, 50.0f, 0.0f, 1.0f, 0.1f, 3000.0f));
+		return views;
+	}
+
+	void TestEmpty()
+	{
+		BoundingVolumeHierarchy bvh;
+		bvh.Commit();
+		std::vector<ObjectId> visible;
+		bvh.Cull(MakeFrustum(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 100.0f), visible);
+		CHECK(visible.empty());
+	}
+
+	void TestCullMatchesBruteForce()
+	{
+		std::mt19937 random(4);
+		BoundingVolumeHierarchy bvh;
+		std::vector<ObjectId> ids;
+		for (int i = 0; i < 5000; i++)
+		{
+			ids.push_back(bvh.Insert(RandomBox(random, 5000.0f)));
+		}
+		bvh.Commit();
+		CHECK(bvh.GetStatistics().objectCount == 5000);
+
+		for (const Frustum& frustum : MakeViews())
+		{
+			CHECK(MatchesBruteForce(bvh, ids, frustum));
+		}
+	}
+
+	// Nach Update passt Commit nur die Boxen an; das Ergebnis muss dennoch dem Einzeltest entsprechen.
+	void TestRefit()
+	{
+		std::mt19937 random(5);
+		BoundingVolumeHierarchy bvh;
+		std::vector<ObjectId> ids;
+		for (int i = 0; i < 3000; i++)
+		{
+			ids.push_back(bvh.Insert(RandomBox(random, 3000.0f)));
+		}
+		bvh.Commit();
+		uint32_t rebuilds = bvh.GetStatistics().rebuilds;
+
+		for (int round = 0; round < 5; round++)
+		{
+			for (int i = 0; i < 300; i++)
+			{
+				ObjectId id = ids[random() % ids.size()];
+				bvh.Update(id, RandomBox(random, 3000.0f));
+			}
+			bvh.Commit();
+			for (const Frustum& frustum : MakeViews())
+			{
+				CHECK(MatchesBruteForce(bvh, ids, frustum));
+			}
+		}
+		CHECK(bvh.GetStatistics().rebuilds == rebuilds);
+		CHECK(bvh.GetStatistics().refittedNodes > 0);
+	}
+
+	void TestInsertAndRemove()
+	{
+		std::mt19937 random(6);
+		BoundingVolumeHierarchy bvh;
+		std::vector<ObjectId> ids;
+		for (int i = 0; i < 2000; i++)
+		{
+			ids.push_back(bvh.Insert(RandomBox(random, 2000.0f)));
+		}
+		bvh.Commit();
+
+		// Jedes dritte Objekt entfernen; freie Kennungen werden wiederverwendet.
+		std::vector<ObjectId> kept;
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			if (i % 3 == 0)
+			{
+				bvh.Remove(ids[i]);
+			}
+			else
+			{
+				kept.push_back(ids[i]);
+			}
+		}
+		for (int i = 0; i < 100; i++)
+		{
+			kept.push_back(bvh.Insert(RandomBox(random, 2000.0f)));
+		}
+		bvh.Commit();
+		CHECK(bvh.GetStatistics().objectCount == kept.size());
+
+		for (const Frustum& frustum : MakeViews())
+		{
+			CHECK(MatchesBruteForce(bvh, kept, frustum));
+		}
+	}
+}
+
+int main()
+{
+	return Test::RunTests("BoundingVolumeHierarchyTests", TestEmpty, TestCullMatchesBruteForce, TestRefit, TestInsertAndRemove);
+}
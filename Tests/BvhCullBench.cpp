@@ -0,0 +1,207 @@
+﻿#include "Common/BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+// Frustum-Culling über 100000 Objekte einer Szene von 20 × 20 km: Aufbau der Hierarchie, Culling aus 64
+// Blickrichtungen gegen den Einzeltest jeder Box (skalar und mit CullBounds je vier Boxen) und Anpassen nach
+// dem Bewegen von 1000 Objekten. Aufruf: BvhCullBench [Objekte] [Blickrichtungen].
+namespace
+{
+	typedef BoundingVolumeHierarchy::ObjectId ObjectId;
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Multiply(const float a[4][4], const float b[4][4], float result[4][4])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column] + a[row][3] * b[3][column];
+			}
+		}
+	}
+
+	// Kamera an eye mit Blick entlang yaw in der x-z-Ebene und leichtem Blick nach unten, linkshändig und in
+	// Zeilenvektorform wie XMMatrixLookToLH und XMMatrixPerspectiveFovLH.
+	Frustum MakeFrustum(float eyeX, float eyeY, float eyeZ, float yaw, float fovY, float farZ)
+	{
+		float pitch = -0.2f;
+		float forward[3] = { std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch) };
+		float right[3] = { std::cos(yaw), 0.0f, -std::sin(yaw) };
+		float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+		float eye[3] = { eyeX, eyeY, eyeZ };
+		float view[4][4] = {};
+		for (int i = 0; i < 3; i++)
+		{
+			view[i][0] = right[i];
+			view[i][1] = up[i];
+			view[i][2] = forward[i];
+			view[3][0] -= right[i] * eye[i];
+			view[3][1] -= up[i] * eye[i];
+			view[3][2] -= forward[i] * eye[i];
+		}
+		view[3][3] = 1.0f;
+
+		float nearZ = 1.0f;
+		float scaleY = 1.0f / std::tan(fovY / 2);
+		float projection[4][4] = {};
+		projection[0][0] = scaleY / (16.0f / 9.0f);
+		projection[1][1] = scaleY;
+		projection[2][2] = farZ / (farZ - nearZ);
+		projection[2][3] = 1.0f;
+		projection[3][2] = -nearZ * farZ / (farZ - nearZ);
+
+		float viewProjection[4][4];
+		Multiply(view, projection, viewProjection);
+		return Frustum::FromViewProjection(viewProjection);
+	}
+
+	// Gebäude, Bäume und Flugzeuge: meist klein, vereinzelt bis 100 m.
+	Aabb RandomBox(std::mt19937& random, float extent)
+	{
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::exponential_distribution<float> size(0.1f);
+		float center[3] = { position(random), std::abs(position(random)) * 0.02f, position(random) };
+		float half = std::min(1.0f + size(random), 100.0f);
+		Aabb bounds = { { center[0] - half, center[1] - half, center[2] - half }, { center[0] + half, center[1] + half, center[2] + half } };
+		return bounds;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 100000;
+	uint32_t viewCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 64;
+	if (objectCount == 0 || viewCount == 0)
+	{
+		std::fprintf(stderr, "usage: BvhCullBench [objects] [views]\n");
+		return 2;
+	}
+
+	const float extent = 10000.0f;
+	std::mt19937 random(9);
+	std::vector<Aabb> bounds(objectCount);
+	for (Aabb& box : bounds)
+	{
+		box = RandomBox(random, extent);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	BoundingVolumeHierarchy bvh;
+	std::vector<ObjectId> ids(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		ids[i] = bvh.Insert(bounds[i]);
+	}
+	bvh.Commit();
+	double build = Milliseconds(start);
+
+	// Blick aus 300 m über dem Gebiet mit 70 Grad Öffnung und 8 km Sichtweite.
+	std::vector<Frustum> views;
+	for (uint32_t i = 0; i < viewCount; i++)
+	{
+		float yaw = 6.2831853f * i / viewCount;
+		views.push_back(MakeFrustum(-std::sin(yaw) * 2000.0f, 300.0f, -std::cos(yaw) * 2000.0f, yaw, 1.22f, 8000.0f));
+	}
+
+	std::vector<ObjectId> visible;
+	visible.reserve(objectCount);
+	BvhCullStatistics statistics = {};
+	uint64_t visibleTotal = 0;
+	start = std::chrono::steady_clock::now();
+	for (const Frustum& frustum : views)
+	{
+		visible.clear();
+		BvhCullStatistics viewStatistics = {};
+		bvh.Cull(frustum, visible, &viewStatistics);
+		visibleTotal += visible.size();
+		statistics.nodeTests += viewStatistics.nodeTests;
+		statistics.objectTests += viewStatistics.objectTests;
+	}
+	double hierarchy = Milliseconds(start) / viewCount;
+
+	std::vector<uint32_t> bruteVisible;
+	bruteVisible.reserve(objectCount);
+	uint64_t bruteTotal = 0;
+	start = std::chrono::steady_clock::now();
+	for (const Frustum& frustum : views)
+	{
+		bruteVisible.clear();
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			if (frustum.Intersects(bounds[i]))
+			{
+				bruteVisible.push_back(i);
+			}
+		}
+		bruteTotal += bruteVisible.size();
+	}
+	double scalar = Milliseconds(start) / viewCount;
+
+	start = std::chrono::steady_clock::now();
+	for (const Frustum& frustum : views)
+	{
+		bruteVisible.clear();
+		CullBounds(frustum, bounds.data(), bounds.size(), bruteVisible);
+	}
+	double simd = Milliseconds(start) / viewCount;
+
+	// Die Hierarchie muss für jede Blickrichtung genau die Objekte des Einzeltests liefern.
+	uint32_t mismatches = 0;
+	for (const Frustum& frustum : views)
+	{
+		visible.clear();
+		bvh.Cull(frustum, visible);
+		bruteVisible.clear();
+		CullBounds(frustum, bounds.data(), bounds.size(), bruteVisible);
+		std::sort(visible.begin(), visible.end());
+		mismatches += visible == std::vector<ObjectId>(bruteVisible.begin(), bruteVisible.end()) ? 0 : 1;
+	}
+	CHECK(mismatches == 0);
+	CHECK(visibleTotal == bruteTotal);
+
+	// 1000 Flugzeuge bewegen sich um bis zu 50 m; Commit passt nur ihre Pfade an.
+	std::uniform_int_distribution<uint32_t> pick(0, objectCount - 1);
+	std::uniform_real_distribution<float> move(-50.0f, 50.0f);
+	const uint32_t moved = std::min(1000u, objectCount);
+	start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < moved; i++)
+	{
+		uint32_t index = pick(random);
+		float offset[3] = { move(random), move(random), move(random) };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bounds[index].min[axis] += offset[axis];
+			bounds[index].max[axis] += offset[axis];
+		}
+		bvh.Update(ids[index], bounds[index]);
+	}
+	bvh.Commit();
+	double refit = Milliseconds(start);
+
+	visible.clear();
+	bvh.Cull(views[0], visible);
+	bruteVisible.clear();
+	CullBounds(views[0], bounds.data(), bounds.size(), bruteVisible);
+	CHECK(visible.size() == bruteVisible.size());
+
+	std::printf("%u objects: build %.1f ms, %u nodes\n", objectCount, build, bvh.GetStatistics().nodeCount);
+	std::printf("cull: BVH %.3f ms (%.0f node and %.0f leaf tests), brute force %.3f ms scalar, %.3f ms SIMD per view; %.1f%% visible\n",
+		hierarchy, static_cast<double>(statistics.nodeTests) / viewCount, static_cast<double>(statistics.objectTests) / viewCount,
+		scalar, simd, 100.0 * visibleTotal / (static_cast<double>(objectCount) * viewCount));
+	std::printf("refit after moving %u objects: %.3f ms, %u nodes\n", moved, refit, bvh.GetStatistics().refittedNodes);
+
+	return Test::RunTests("BvhCullBench");
+}
@@ -0,0 +1,221 @@
+﻿#include "Common/DrawQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+// Zeichnet 10000 Objekte aus 4 Pipelines, 8 Materialien und 50 Netzen je Frame einmal einzeln, wie ein
+// Renderer ohne Warteschlange, und einmal über die DrawQueue auf und führt beides auf dem Null-Backend aus.
+// Gemessen werden Schlüsselbildung, Einreichen, Flush (Radixsortierung, Zusammenfassen, Aufzeichnen) und
+// zum Vergleich std::stable_sort derselben Schlüssel. Aufruf: DrawQueueBench [Objekte] [Frames].
+namespace
+{
+	const uint32_t PipelineCount = 4;
+	const uint32_t MaterialCount = 8;
+	const uint32_t MeshCount = 50;
+	const uint32_t IndexCount = 1500;
+
+	// Platzhalter für Objekte des Backends; das Null-Backend vergleicht nur die Adressen.
+	int g_handles[256];
+	uint32_t g_nextHandle = 0;
+
+	RenderHandle MakeHandle()
+	{
+		return &g_handles[g_nextHandle++];
+	}
+
+	struct Object
+	{
+		uint32_t			pipeline;
+		uint32_t			material;
+		uint32_t			mesh;
+		float				depth;
+		InstanceTransform	transform;
+	};
+
+	struct Timing
+	{
+		double	record;
+		double	execute;
+	};
+
+	double Microseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void PrintStatistics(const char* name, const Timing& timing, const RenderCommandStatistics& statistics, uint32_t frames)
+	{
+		std::printf("%-6s record %7.1f us, null execute %6.1f us; per frame %6llu commands, %5llu draws, %6llu state changes\n",
+			name, timing.record / frames, timing.execute / frames, static_cast<unsigned long long>(statistics.commands / frames),
+			static_cast<unsigned long long>(statistics.draws / frames), static_cast<unsigned long long>(statistics.stateChanges / frames));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 10000;
+	uint32_t frames = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 200;
+	if (objectCount == 0 || frames == 0)
+	{
+		std::fprintf(stderr, "usage: DrawQueueBench [objects] [frames]\n");
+		return 2;
+	}
+
+	RenderPipeline pipelines[PipelineCount];
+	for (RenderPipeline& pipeline : pipelines)
+	{
+		pipeline = RenderPipeline();
+		pipeline.inputLayout = MakeHandle();
+		pipeline.vertexShader = MakeHandle();
+		pipeline.pixelShader = MakeHandle();
+		pipeline.topology = PrimitiveTopology::TriangleList;
+	}
+	RenderHandle materials[MaterialCount];
+	for (RenderHandle& material : materials)
+	{
+		material = MakeHandle();
+	}
+	DrawMesh meshes[MeshCount];
+	for (DrawMesh& mesh : meshes)
+	{
+		DrawMesh value = { MakeHandle(), 32, MakeHandle(), IndexFormat::UInt16, IndexCount, 0, 0 };
+		mesh = value;
+	}
+	RenderHandle objectConstants = MakeHandle();
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Object> objects(objectCount);
+	for (Object& object : objects)
+	{
+		object.pipeline = random() % PipelineCount;
+		object.material = random() % MaterialCount;
+		object.mesh = random() % MeshCount;
+		object.depth = unit(random);
+		object.transform = InstanceTransform();
+	}
+
+	// Ohne Warteschlange: jedes Objekt setzt seinen ganzen Zustand und lädt seine Konstanten hoch.
+	RenderCommandBuffer commands;
+	NullRenderBackend naiveBackend(4 * 1024 * 1024);
+	Timing naive = {};
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		commands.Reset();
+		for (const Object& object : objects)
+		{
+			const DrawMesh& mesh = meshes[object.mesh];
+			RenderHandle buffers[] = { objectConstants, materials[object.material] };
+			commands.SetPipeline(pipelines[object.pipeline]);
+			commands.SetVertexBuffer(0, mesh.vertexBuffer, mesh.vertexStride, 0);
+			commands.SetIndexBuffer(mesh.indexBuffer, mesh.indexFormat, 0);
+			commands.SetConstantBuffers(ShaderStageVertex, 0, 2, buffers);
+			commands.UpdateConstants(objectConstants, object.transform);
+			commands.DrawIndexed(mesh.indexCount, mesh.startIndex, mesh.baseVertex);
+		}
+		naive.record += Microseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		naiveBackend.Execute(commands);
+		naive.execute += Microseconds(start);
+	}
+
+	// Über die Warteschlange.
+	int instanceBuffer = 0;
+	int instanceView = 0;
+	DrawQueueResources resources = { &instanceBuffer, &instanceView, 16384 };
+	DrawQueue queue;
+	queue.SetResources(resources);
+	uint32_t pipelineIds[PipelineCount], materialIds[MaterialCount], meshIds[MeshCount];
+	for (uint32_t i = 0; i < PipelineCount; i++)
+	{
+		pipelineIds[i] = queue.RegisterPipeline(pipelines[i]);
+	}
+	for (uint32_t i = 0; i < MaterialCount; i++)
+	{
+		materialIds[i] = queue.RegisterMaterial(materials[i]);
+	}
+	for (uint32_t i = 0; i < MeshCount; i++)
+	{
+		meshIds[i] = queue.RegisterMesh(meshes[i]);
+	}
+
+	NullRenderBackend queueBackend(4 * 1024 * 1024);
+	Timing queued = {};
+	double submit = 0.0;
+	double flush = 0.0;
+	uint32_t droppedBatches = 0;
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		queueBackend.BeginFrame();
+		auto start = std::chrono::steady_clock::now();
+		commands.Reset();
+		for (const Object& object : objects)
+		{
+			queue.Submit(0, pipelineIds[object.pipeline], materialIds[object.material], meshIds[object.mesh], object.depth, object.transform);
+		}
+		submit += Microseconds(start);
+
+		auto flushStart = std::chrono::steady_clock::now();
+		queue.Flush(commands, queueBackend.GetUploadRing());
+		flush += Microseconds(flushStart);
+		queued.record += Microseconds(start);
+		droppedBatches += queue.GetStatistics().droppedBatches;
+
+		start = std::chrono::steady_clock::now();
+		queueBackend.Execute(commands);
+		queued.execute += Microseconds(start);
+		queueBackend.EndFrame();
+	}
+
+	// Schlüsselbildung allein und eine vergleichsbasierte Sortierung derselben Schlüssel.
+	std::vector<uint64_t> keys(objectCount);
+	std::vector<uint64_t> sorted(objectCount);
+	double keyTime = 0.0;
+	double stableSort = 0.0;
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			const Object& object = objects[i];
+			keys[i] = DrawQueue::MakeSortKey(0, pipelineIds[object.pipeline], materialIds[object.material], meshIds[object.mesh], object.depth);
+		}
+		keyTime += Microseconds(start);
+
+		sorted = keys;
+		start = std::chrono::steady_clock::now();
+		std::stable_sort(sorted.begin(), sorted.end());
+		stableSort += Microseconds(start);
+	}
+
+	const RenderCommandStatistics& naiveStatistics = naiveBackend.GetStatistics();
+	const RenderCommandStatistics& queueStatistics = queueBackend.GetStatistics();
+	const DrawQueueStatistics& last = queue.GetStatistics();
+	std::printf("%u objects, %u frames\n", objectCount, frames);
+	PrintStatistics("naive", naive, naiveStatistics, frames);
+	PrintStatistics("queue", queued, queueStatistics, frames);
+	std::printf("queue: %u batches, %u pipeline, %u material, %u mesh changes\n",
+		last.batches, last.pipelineChanges, last.materialChanges, last.meshChanges);
+	std::printf("sort keys %.1f us, submit %.1f us, flush (radix sort, merge, record) %.1f us, std::stable_sort %.1f us per frame\n",
+		keyTime / frames, submit / frames, flush / frames, stableSort / frames);
+
+	// Zusammengefasst wird nur bei gleichem Zustand; jede Instanz muss genau einmal gezeichnet werden.
+	CHECK(naiveStatistics.validationErrors == 0);
+	CHECK(queueStatistics.validationErrors == 0);
+	CHECK(droppedBatches == 0);
+	CHECK(queueStatistics.instances == static_cast<uint64_t>(objectCount) * frames);
+	CHECK(queueStatistics.primitives == naiveStatistics.primitives);
+	CHECK(queueStatistics.draws <= naiveStatistics.draws);
+	CHECK(last.batches <= PipelineCount * MaterialCount * MeshCount);
+	CHECK(std::is_sorted(sorted.begin(), sorted.end()));
+
+	return Test::RunTests("DrawQueueBench");
+}
@@ -0,0 +1,103 @@
+﻿#include "Simulation/FlightDynamics.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+// Flugzeugschritte je Sekunde von GliderFleet::Step mit 1, 64 und 1024 Segelflugzeugen bei 120 Schritten je
+// Sekunde und ruhender Luft. Je Flottengröße wird ungefähr dieselbe Zahl von Flugzeugschritten gerechnet.
+// Geprüft wird, dass alle Zustände endlich bleiben und das erste Flugzeug unabhängig von der Flottengröße
+// genau gleich fliegt. Aufruf: FlightDynamicsBench [Millionen Flugzeugschritte je Flottengröße].
+namespace
+{
+	const float StepSeconds = 1.0f / 120.0f;
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Auf einem Ring, 1500 m hoch und nach außen fliegend; das erste Flugzeug fliegt nach Norden.
+	void Populate(GliderFleet& fleet, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float heading = 6.2831853f * i / count;
+			fleet.Add(GliderInitialState::Level(2000.0f * std::cos(heading), 2000.0f * std::sin(heading), 1500.0f, heading, 0.01f, 30.0f));
+		}
+	}
+
+	bool IsFinite(const GliderPose& pose)
+	{
+		bool valid = true;
+		for (float value : pose.position)
+		{
+			valid = valid && std::isfinite(value);
+		}
+		for (float value : pose.orientation)
+		{
+			valid = valid && std::isfinite(value);
+		}
+		return valid;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double millions = argc > 1 ? std::atof(argv[1]) : 50.0;
+	if (!(millions > 0.0))
+	{
+		std::fprintf(stderr, "usage: FlightDynamicsBench [million aircraft-steps per fleet size]\n");
+		return 2;
+	}
+
+	static const uint32_t fleetSizes[] = { 1, 64, 1024 };
+	GliderPose reference = GliderPose();
+	for (uint32_t count : fleetSizes)
+	{
+		GliderFleet fleet((GliderParameters()));
+		Populate(fleet, count);
+
+		// Zwei Minuten Flug für den Vergleich des ersten Flugzeugs, danach die Messung.
+		for (uint32_t step = 0; step < 120 * 120; step++)
+		{
+			fleet.Step(StepSeconds);
+		}
+		GliderPose first = fleet.GetPose(0);
+		if (count == fleetSizes[0])
+		{
+			reference = first;
+		}
+		CHECK(std::memcmp(&first, &reference, sizeof(GliderPose)) == 0);
+
+		uint32_t steps = static_cast<uint32_t>(millions * 1.0e6 / count) + 1;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t step = 0; step < steps; step++)
+		{
+			fleet.Step(StepSeconds);
+		}
+		double elapsed = Seconds(start);
+
+		std::vector<GliderPose> poses;
+		fleet.GetPoses(poses);
+		uint32_t finite = 0;
+		for (const GliderPose& pose : poses)
+		{
+			finite += IsFinite(pose) ? 1 : 0;
+		}
+
+		std::printf("%4u gliders (%4u lanes): %u steps in %.2f s, %.1fM aircraft-steps/s, %.1f ns per aircraft-step\n",
+			count, fleet.GetPaddedCount(), steps, elapsed, static_cast<double>(steps) * count / elapsed / 1.0e6,
+			elapsed * 1.0e9 / (static_cast<double>(steps) * count));
+
+		CHECK(poses.size() == count);
+		CHECK(finite == count);
+	}
+
+	return Test::RunTests("FlightDynamicsBench");
+}
@@ -0,0 +1,141 @@
+﻿#include "Common/FrameStatistics.h"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	const uint64_t TicksPerMillisecond = IClock::TicksPerSecond / 1000;
+
+	bool Near(double value, double expected, double relative)
+	{
+		return std::abs(value - expected) <= expected * relative;
+	}
+
+	// Gleichverteilte Werte von 1 bis 10.000 µs: die Perzentile liegen innerhalb der Fachbreite.
+	void TestHistogramPercentiles()
+	{
+		FrameTimeHistogram histogram;
+		for (uint64_t microseconds = 1; microseconds <= 10000; microseconds++)
+		{
+			histogram.Record(microseconds);
+		}
+
+		const double tolerance = 1.0 / FrameTimeHistogram::SubBucketCount;
+		CHECK(histogram.GetCount() == 10000);
+		CHECK(histogram.GetMax() == 10000);
+		CHECK(Near(histogram.GetMean(), 5000.5, 1.0e-9));
+		CHECK(Near(histogram.GetPercentile(0.50), 5000.0, tolerance));
+		CHECK(Near(histogram.GetPercentile(0.95), 9500.0, tolerance));
+		CHECK(Near(histogram.GetPercentile(0.99), 9900.0, tolerance));
+		CHECK(histogram.GetPercentile(1.0) <= 10000);
+
+		// Kleine Werte haben je ein eigenes Fach, zu große werden begrenzt.
+		FrameTimeHistogram small;
+		small.Record(7);
+		CHECK(small.GetPercentile(0.5) == 7);
+		small.Record(0x1ffffffffull);
+		CHECK(small.GetMax() == 0xffffffffu);
+		CHECK(FrameTimeHistogram().GetPercentile(0.5) == 0);
+	}
+
+	// Ein Fenster endet, sobald die Frameabstände seine Länge erreichen; Ruckler zählen je Fenster und insgesamt.
+	void TestWindowAndHitches()
+	{
+		FrameStatistics statistics;
+		statistics.SetWindowTicks(IClock::TicksPerSecond);
+		statistics.SetHitchThresholdTicks(IClock::TicksPerSecond / 30);
+
+		const uint64_t frame = IClock::TicksPerSecond / 60;
+		for (int i = 0; i < 59; i++)
+		{
+			statistics.Record(FrameStage::Update, 2 * TicksPerMillisecond);
+			statistics.Record(FrameStage::Frame, frame);
+		}
+		CHECK(!statistics.ConsumeWindowCompleted());
+		CHECK(statistics.GetWindowSummary(FrameStage::Frame).count == 0);
+		CHECK(statistics.GetTotalHitchCount() == 0);
+
+		statistics.Record(FrameStage::Frame, 50 * TicksPerMillisecond);
+		CHECK(statistics.ConsumeWindowCompleted());
+		CHECK(!statistics.ConsumeWindowCompleted());
+
+		FrameStageSummary summary = statistics.GetWindowSummary(FrameStage::Frame);
+		CHECK(summary.count == 60);
+		CHECK(Near(summary.p50, 16.666, 1.0 / 32));
+		CHECK(summary.max == 50.0);
+		CHECK(statistics.GetWindowHitchCount() == 1);
+		CHECK(statistics.GetWindowSummary(FrameStage::Update).count == 59);
+
+		// Das nächste Fenster beginnt leer, die Gesamtwerte laufen weiter.
+		statistics.Record(FrameStage::Frame, frame);
+		CHECK(statistics.GetWindowSummary(FrameStage::Frame).count == 60);
+		CHECK(statistics.GetTotalSummary(FrameStage::Frame).count == 61);
+
+		statistics.Reset();
+		CHECK(statistics.GetTotalSummary(FrameStage::Frame).count == 0);
+		CHECK(statistics.GetTotalHitchCount() == 0);
+	}
+
+	// ScopedStage misst mit der übergebenen Zeitquelle.
+	void TestScopedStage()
+	{
+		ManualClock clock;
+		FrameStatistics statistics;
+		{
+			FrameStatistics::ScopedStage stage(statistics, FrameStage::Render, clock);
+			clock.AdvanceTicks(3 * TicksPerMillisecond);
+		}
+
+		FrameStageSummary summary = statistics.GetTotalSummary(FrameStage::Render);
+		CHECK(summary.count == 1);
+		CHECK(summary.max == 3.0);
+		CHECK(statistics.GetTotalSummary(FrameStage::Update).count == 0);
+	}
+
+	// Der Bericht enthält eine Zeile je Abschnitt und die Zahl der Ruckler.
+	void TestReport()
+	{
+		FrameStatistics statistics;
+		for (int i = 0; i < 100; i++)
+		{
+			statistics.Record(FrameStage::Update, 1 * TicksPerMillisecond);
+			statistics.Record(FrameStage::Render, 4 * TicksPerMillisecond);
+			statistics.Record(FrameStage::Present, 10 * TicksPerMillisecond);
+			statistics.Record(FrameStage::Frame, (i % 50 == 0 ? 40 : 16) * TicksPerMillisecond);
+		}
+
+		std::ostringstream stream;
+		statistics.WriteReport(stream);
+		std::string report = stream.str();
+
+		std::istringstream lines(report);
+		std::string line;
+		std::getline(lines, line);
+		CHECK(line.find("p99 ms") != std::string::npos);
+
+		static const char* const stages[] = { "Update", "Render", "Present", "Frame" };
+		for (const char* stage : stages)
+		{
+			std::string name;
+			uint64_t count = 0;
+			double p50 = 0.0;
+			CHECK(static_cast<bool>(std::getline(lines, line)));
+			std::istringstream(line) >> name >> count >> p50;
+			CHECK(name == stage);
+			CHECK(count == 100);
+			CHECK(p50 > 0.0);
+		}
+
+		CHECK(std::getline(lines, line) && line == "hitches 2");
+	}
+}
+
+int main()
+{
+	return Test::RunTests("FrameStatisticsTests", TestHistogramPercentiles, TestWindowAndHitches, TestScopedStage, TestReport);
+}
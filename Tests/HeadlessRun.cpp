@@ -0,0 +1,204 @@
+﻿#include "Common/Clock.h"
+#include "Common/FrameStatistics.h"
+#include "Common/ThreadPool.h"
+#include "Simulation/FlightDynamics.h"
+#include "Simulation/LiftMap.h"
+#include "Simulation/SimulationWorker.h"
+#include "Simulation/ThermalField.h"
+#include "Simulation/Turbulence.h"
+#include "Simulation/WindField.h"
+#include "Terrain/ProceduralTerrain.h"
+#include "Terrain/TerrainHeightField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+// Der Simulationsteil von Open_Glider_SimulatorMain ohne Fenster und Grafik: dieselben Subsysteme wie in
+// StepSimulation, getrieben von einer DX::ManualClock, die je Frame um einen festen Betrag vorrückt. Der
+// Lauf ist damit reproduzierbar und so schnell, wie die CPU es erlaubt. Gemeldet wird das Verhältnis von
+// simulierter Zeit zu Rechenzeit; geprüft wird, dass alle Zustände endlich bleiben und kein Schritt verloren
+// geht. Die Rechenzeit je Frame erfasst DX::FrameStatistics als Update; der Bericht geht auf die Konsole und,
+// falls angegeben, in eine Datei. Aufruf: HeadlessRun [Segelflugzeuge] [simulierte Minuten] [Frames je Sekunde]
+// [Statistikdatei].
+namespace
+{
+	const uint32_t StepsPerSecond = 120;
+	const uint32_t MaxStepsPerFrame = 8;
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Die Subsysteme wie im Konstruktor von Open_Glider_SimulatorMain, Wind ohne Gitterdatei.
+	struct World
+	{
+		explicit World(DX::ThreadPool& threadPool) :
+			gliders(GliderParameters()),
+			turbulence(1)
+		{
+			wind.SetUniform(0.0f, 3.0f, 0.0f);
+			thermals.Populate(0.0f, 0.0f, 20000.0f, 2000, ThermalClimate(), 1);
+
+			const ProceduralTerrain& source = terrain;
+			auto heights = [&source](float originN, float originE, float spacing, uint32_t countN, uint32_t countE, float* values)
+			{
+				source.GetHeights(originN, originE, spacing, countN, countE, values);
+			};
+
+			LiftMapRegion liftRegion = { -20000.0f, -20000.0f, 100.0f, 401, 401 };
+			liftMaps.reset(new LiftMapBaker(threadPool, liftRegion, heights));
+			HeightFieldRegion heightRegion = { -20000.0f, -20000.0f, 20.0f, 2001, 2001 };
+			heightField.reset(new TerrainHeightField(threadPool, heightRegion, heights));
+
+			float velocity[3];
+			wind.Sample(0.0f, 0.0f, -1000.0f, velocity);
+			liftMaps->Bake(velocity[0], velocity[1]);
+		}
+
+		// Wie Open_Glider_SimulatorMain::StepSimulation.
+		void Step(DX::StepTimer const& timer, SimulationState& state)
+		{
+			float deltaSeconds = static_cast<float>(timer.GetElapsedSeconds());
+			uint32_t count = gliders.GetPaddedCount();
+			const float* north = gliders.GetField(GliderFleet::PositionN);
+			const float* east = gliders.GetField(GliderFleet::PositionE);
+			const float* down = gliders.GetField(GliderFleet::PositionD);
+			float* airVelocityD = gliders.GetField(GliderFleet::AirVelocityD);
+			float* groundHeight = gliders.GetField(GliderFleet::GroundHeight);
+
+			heightField->GetHeights(north, east, count, groundHeight);
+
+			wind.SetTime(static_cast<float>(timer.GetTotalSeconds()));
+			wind.Sample(north, east, down, count, gliders.GetField(GliderFleet::AirVelocityN), gliders.GetField(GliderFleet::AirVelocityE), airVelocityD);
+
+			float drift[3];
+			wind.Sample(0.0f, 0.0f, -1000.0f, drift);
+			thermals.SetWind(drift[0], drift[1]);
+			thermals.Update(deltaSeconds);
+			thermals.Sample(north, east, down, groundHeight, count, airVelocityD);
+
+			liftMaps->Update(drift[0], drift[1]);
+			liftMaps->GetCurrent()->Sample(north, east, down, count, airVelocityD);
+			turbulence.Step(deltaSeconds, gliders);
+
+			gliders.Step(deltaSeconds);
+			gliders.GetPoses(state.gliders);
+		}
+
+		GliderFleet							gliders;
+		WindField							wind;
+		ThermalField						thermals;
+		ProceduralTerrain					terrain;
+		std::unique_ptr<LiftMapBaker>		liftMaps;
+		std::unique_ptr<TerrainHeightField>	heightField;
+		Turbulence							turbulence;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t gliderCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 64;
+	uint32_t minutes = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 60;
+	uint32_t framesPerSecond = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 60;
+	const char* statisticsPath = argc > 4 ? argv[4] : nullptr;
+	if (gliderCount == 0 || minutes == 0 || framesPerSecond == 0 || framesPerSecond > StepsPerSecond || argc > 5)
+	{
+		std::fprintf(stderr, "usage: HeadlessRun [gliders] [simulated minutes] [frames per second] [statistics file]\n");
+		return 2;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	DX::ThreadPool threadPool;
+	World world(threadPool);
+
+	// Auf einem Ring um die Mitte des Aufgabengebiets, 800 m über Grund und nach außen fliegend.
+	for (uint32_t i = 0; i < gliderCount; i++)
+	{
+		float heading = 6.2831853f * i / gliderCount;
+		float north = 3000.0f * std::cos(heading);
+		float east = 3000.0f * std::sin(heading);
+		world.gliders.Add(GliderInitialState::Level(north, east, world.heightField->GetHeight(north, east) + 800.0f, heading, 0.01f, 30.0f));
+	}
+	double setup = Seconds(start);
+
+	SimulationWorker worker([&world](DX::StepTimer const& timer, SimulationState& state) { world.Step(timer, state); },
+		StepsPerSecond, MaxStepsPerFrame);
+	auto clock = std::make_shared<DX::ManualClock>();
+	worker.SetClock(clock);
+
+	// Wie Update ohne Simulationsthread: vorrücken, einen Tick rechnen, den Schnappschuss abholen. Gemessen wird
+	// mit der Uhr des Rechners; ein Ruckler ist hier ein Frame, dessen Rechenzeit den Frameabstand überschreitet.
+	const uint64_t frameTicks = DX::IClock::TicksPerSecond / framesPerSecond;
+	const uint64_t frames = static_cast<uint64_t>(minutes) * 60 * framesPerSecond;
+	DX::SteadyClock wallClock;
+	DX::FrameStatistics statistics;
+	statistics.SetHitchThresholdTicks(frameTicks);
+	start = std::chrono::steady_clock::now();
+	for (uint64_t frame = 0; frame < frames; frame++)
+	{
+		uint64_t frameStart = wallClock.GetTicks();
+		{
+			DX::FrameStatistics::ScopedStage stage(statistics, DX::FrameStage::Update, wallClock);
+			clock->AdvanceTicks(frameTicks);
+			worker.Tick();
+			worker.AcquireLatestSnapshot();
+		}
+		statistics.Record(DX::FrameStage::Frame, wallClock.GetTicks() - frameStart);
+	}
+	double elapsed = Seconds(start);
+
+	const SimulationSnapshot& snapshot = worker.AcquireLatestSnapshot();
+	double simulated = static_cast<double>(snapshot.current.totalTicks) / DX::IClock::TicksPerSecond;
+
+	uint32_t finite = 0;
+	uint32_t airborne = 0;
+	double lowest = 1.0e9;
+	for (const GliderPose& pose : snapshot.current.gliders)
+	{
+		bool valid = true;
+		for (float value : pose.position)
+		{
+			valid = valid && std::isfinite(value);
+		}
+		for (float value : pose.orientation)
+		{
+			valid = valid && std::isfinite(value);
+		}
+		finite += valid ? 1 : 0;
+
+		float height = -pose.position[2] - world.heightField->GetHeight(pose.position[0], pose.position[1]);
+		airborne += height > 5.0f ? 1 : 0;
+		lowest = std::min(lowest, static_cast<double>(height));
+	}
+
+	std::printf("%u gliders, setup %.2f s: %.0f s simulated in %.2f s (%.0fx real time), %llu steps, %.0f aircraft-steps/s\n",
+		gliderCount, setup, simulated, elapsed, simulated / elapsed, static_cast<unsigned long long>(snapshot.current.stepCount),
+		static_cast<double>(snapshot.current.stepCount) * gliderCount / elapsed);
+	std::printf("%u of %u still airborne, lowest %.0f m above ground\n", airborne, gliderCount, lowest);
+	std::fflush(stdout);
+	statistics.WriteReport(std::cout);
+
+	if (statisticsPath)
+	{
+		std::ofstream file(statisticsPath);
+		statistics.WriteReport(file);
+		CHECK(file.good());
+	}
+
+	CHECK(finite == gliderCount);
+	CHECK(snapshot.current.gliders.size() == gliderCount);
+	CHECK(snapshot.current.stepCount == frames * frameTicks / (DX::IClock::TicksPerSecond / StepsPerSecond));
+	CHECK(worker.GetDroppedTicks() == 0);
+	CHECK(statistics.GetTotalSummary(DX::FrameStage::Update).count == frames);
+
+	return Test::RunTests("HeadlessRun");
+}
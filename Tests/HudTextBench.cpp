@@ -0,0 +1,141 @@
+﻿#include "Common/HudText.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cwchar>
+#include <memory>
+#include <string>
+#include "TestSupport.h"
+
+using namespace DX;
+
+// Die Anzeigeelemente der Bildrate und der Frame-Statistik mit etwa 200 Glyphen, je Frame alle Felder gesetzt:
+// einmal mit gleichbleibenden Werten, einmal mit sich ändernden Perzentilen und einmal mit lauter neuen
+// Werten. Zum Vergleich nur das Formatieren der Statistikzeilen mit swprintf, wie es vor dem Atlas je Frame
+// geschah. Aufruf: HudTextBench [Frames].
+namespace
+{
+	const uint32_t StageCount = 4;
+	const uint32_t PercentileCount = 4;
+
+	double Nanoseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	struct Overlay
+	{
+		HudText			text;
+		HudWidgetId		fps;
+		HudWidgetId		stages;
+		HudWidgetId		counters;
+	};
+
+	// Setzt alle Felder eines Frames; percentiles und counters geben an, ob sich die Werte ändern.
+	void SetFrame(Overlay& overlay, uint32_t frame, bool percentiles, bool counters)
+	{
+		overlay.text.SetField(overlay.fps, 0, counters ? frame % 300 : 60.0);
+		for (uint32_t field = 0; field < StageCount * PercentileCount; field++)
+		{
+			overlay.text.SetField(overlay.stages, field, 1.5 + field + (percentiles ? (frame % 97) * 0.01 : 0.0));
+		}
+		overlay.text.SetField(overlay.counters, 0, counters ? frame % 7 : 3.0);
+		overlay.text.SetField(overlay.counters, 1, counters ? frame : 17.0);
+		overlay.text.SetField(overlay.counters, 2, counters ? (frame % 1000) * 0.1 : 12.5);
+		overlay.text.SetField(overlay.counters, 3, counters ? frame % 100 : 100.0);
+		overlay.text.SetField(overlay.counters, 4, counters ? frame % 900 : 900.0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t frames = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 200000;
+	if (frames == 0)
+	{
+		std::fprintf(stderr, "usage: HudTextBench [frames]\n");
+		return 2;
+	}
+
+	auto atlas = std::make_shared<GlyphAtlas>(128, 128, 16);
+	for (uint32_t codepoint = 32; codepoint < 127; codepoint++)
+	{
+		CHECK(atlas->Add(codepoint, 8, 8.0f, 0.0f));
+	}
+	atlas->SetFallback(L'?');
+
+	Overlay overlay;
+	overlay.text.SetAtlas(atlas);
+	overlay.text.SetScreenSize(1920.0f, 1080.0f);
+	overlay.fps = overlay.text.AddWidget(HudCorner::BottomRight, 4.0f, 6, L"{3} FPS");
+	overlay.stages = overlay.text.AddWidget(HudCorner::BottomRight, 4.0f, 2,
+		L"Frame   p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms\n"
+		L"Update  p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms\n"
+		L"Render  p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms\n"
+		L"Present p50 {5.2}  p95 {5.2}  p99 {5.2}  max {6.2} ms");
+	overlay.counters = overlay.text.AddWidget(HudCorner::BottomRight, 4.0f, 0, L"Ruckler {0} (gesamt {0})\nVerdeckt {4.1} % ({0} von {0})");
+	SetFrame(overlay, 0, false, false);
+	overlay.text.Update();
+	HudTextStatistics initial = overlay.text.GetStatistics();
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t changedFrames = 0;
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		SetFrame(overlay, frame, false, false);
+		changedFrames += overlay.text.Update() ? 1 : 0;
+	}
+	double unchanged = Nanoseconds(start) / frames;
+	HudTextStatistics afterUnchanged = overlay.text.GetStatistics();
+	CHECK(changedFrames == 0);
+	CHECK(afterUnchanged.widgetRebuilds == initial.widgetRebuilds);
+
+	start = std::chrono::steady_clock::now();
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		SetFrame(overlay, frame + 1, true, false);
+		overlay.text.Update();
+	}
+	double percentiles = Nanoseconds(start) / frames;
+	HudTextStatistics afterPercentiles = overlay.text.GetStatistics();
+
+	start = std::chrono::steady_clock::now();
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		SetFrame(overlay, frame + 1, true, true);
+		overlay.text.Update();
+	}
+	double everything = Nanoseconds(start) / frames;
+
+	// Nur das Formatieren der vier Statistikzeilen, ohne jedes Layout.
+	wchar_t line[128];
+	std::wstring formatted;
+	size_t characters = 0;
+	start = std::chrono::steady_clock::now();
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		formatted.clear();
+		for (uint32_t stage = 0; stage < StageCount; stage++)
+		{
+			std::swprintf(line, 128, L"%-7ls p50 %5.2f  p95 %5.2f  p99 %5.2f  max %6.2f ms\n", L"Frame",
+				1.5 + (frame % 97) * 0.01, 2.5 + stage, 3.5 + stage, 4.5 + stage);
+			formatted += line;
+		}
+		characters += formatted.size();
+	}
+	double swprintfTime = Nanoseconds(start) / frames;
+
+	HudTextStatistics statistics = overlay.text.GetStatistics();
+	std::printf("%u widgets, %u glyphs, %u frames\n", statistics.widgets, statistics.glyphs, frames);
+	std::printf("unchanged values %.2f us, changing percentiles %.2f us, all values changing %.2f us per frame\n",
+		unchanged / 1000.0, percentiles / 1000.0, everything / 1000.0);
+	std::printf("swprintf of the statistics lines alone %.2f us per frame (%zu characters)\n", swprintfTime / 1000.0, characters / frames);
+	std::printf("%llu field updates, %llu unchanged, %llu widget rebuilds, %llu batch rebuilds\n",
+		static_cast<unsigned long long>(statistics.fieldUpdates), static_cast<unsigned long long>(statistics.unchangedFieldUpdates),
+		static_cast<unsigned long long>(statistics.widgetRebuilds), static_cast<unsigned long long>(statistics.batchRebuilds));
+
+	// Mit sich ändernden Perzentilen wird nur die Statistik neu aufgebaut, nie die Bildrate oder die Zähler.
+	CHECK(statistics.glyphs > 150);
+	CHECK(afterPercentiles.widgetRebuilds - afterUnchanged.widgetRebuilds == frames);
+
+	return Test::RunTests("HudTextBench");
+}
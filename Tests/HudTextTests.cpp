@@ -0,0 +1,259 @@
+﻿#include "Common/HudText.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	const float Advance = 8.0f;
+	const float LineHeight = 16.0f;
+	const uint32_t Degree = 0xb0;
+
+	// Druckbare ASCII-Zeichen in Zellen von einem Pixel; die Zelle eines Zeichens liegt bei (Zeichen - 32) * 2.
+	// Das Gradzeichen liegt außerhalb der direkt gefundenen Zeichen und hat einen Überhang nach links.
+	std::shared_ptr<GlyphAtlas> MakeAtlas()
+	{
+		auto atlas = std::make_shared<GlyphAtlas>(256, 16, 16);
+		for (uint32_t codepoint = 32; codepoint < 127; codepoint++)
+		{
+			CHECK(atlas->Add(codepoint, 1, Advance, 0.0f));
+		}
+		CHECK(atlas->Add(Degree, 3, 5.0f, -1.0f));
+		atlas->SetFallback(L'?');
+		return atlas;
+	}
+
+	wchar_t GetCharacter(const HudGlyph& glyph)
+	{
+		return glyph.texelX == 190.0f ? static_cast<wchar_t>(Degree) : static_cast<wchar_t>(32 + static_cast<uint32_t>(glyph.texelX) / 2);
+	}
+
+	// Setzt den Text aus den Glyphen wieder zusammen. Jedes Zeichen muss auf ganzen Spalten und Zeilen ab
+	// (left, top) liegen; Leerzeichen erzeugen keine Glyphe und werden aus den Lücken ergänzt.
+	std::wstring GetText(const HudText& text, float left, float top)
+	{
+		std::vector<std::wstring> lines;
+		for (const HudGlyph& glyph : text.GetGlyphs())
+		{
+			float column = (glyph.x - left) / Advance;
+			float row = (glyph.y - top) / LineHeight;
+			CHECK(column >= 0.0f && column == std::floor(column));
+			CHECK(row >= 0.0f && row == std::floor(row));
+			CHECK(glyph.width == 1.0f && glyph.height == LineHeight && glyph.texelY == 0.0f);
+
+			size_t line = static_cast<size_t>(row);
+			size_t position = static_cast<size_t>(column);
+			if (line >= lines.size())
+			{
+				lines.resize(line + 1);
+			}
+			if (position >= lines[line].size())
+			{
+				lines[line].resize(position + 1, L' ');
+			}
+			lines[line][position] = GetCharacter(glyph);
+		}
+
+		std::wstring result;
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			result += (i > 0 ? L"\n" : L"") + lines[i];
+		}
+		return result;
+	}
+
+	// Ein Anzeigeelement oben links ohne Rand; gibt den angezeigten Text zurück.
+	std::wstring Format(const std::wstring& pattern, const std::vector<double>& values)
+	{
+		HudText text;
+		text.SetAtlas(MakeAtlas());
+		text.SetScreenSize(640.0f, 480.0f);
+		HudWidgetId widget = text.AddWidget(HudCorner::TopLeft, 0.0f, 0, pattern);
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			text.SetField(widget, static_cast<uint32_t>(i), values[i]);
+		}
+		text.Update();
+		return GetText(text, 0.0f, 0.0f);
+	}
+
+	void TestAtlas()
+	{
+		GlyphAtlas atlas(16, 10, 4);
+		CHECK(atlas.Find(L'a') == nullptr);
+		CHECK(atlas.Add(L'a', 7, 7.0f, 0.0f));
+		CHECK(atlas.Add(L'b', 7, 7.0f, 0.0f));
+		CHECK(atlas.Add(0x20ac, 10, 10.0f, -1.0f));		// passt erst in die nächste Zeile
+		CHECK(!atlas.Add(L'c', 7, 7.0f, 0.0f));			// voll
+		CHECK(atlas.GetGlyphCount() == 3);
+
+		const AtlasGlyph* euro = atlas.Find(0x20ac);
+		CHECK(euro != nullptr && euro->x == 0 && euro->y == 5 && euro->offsetX == -1.0f);
+		CHECK(atlas.Find(L'b')->x == 8);
+		CHECK(atlas.Find(L'c') == nullptr);
+
+		atlas.SetFallback(L'a');
+		CHECK(atlas.Find(L'c') == atlas.Find(L'a'));
+		CHECK_THROWS(atlas.SetFallback(L'z'), std::invalid_argument);
+		CHECK_THROWS(atlas.Add(L'a', 1, 1.0f, 0.0f), std::invalid_argument);
+		CHECK_THROWS(atlas.Add(L'd', 0, 1.0f, 0.0f), std::invalid_argument);
+		CHECK_THROWS(GlyphAtlas(16, 4, 8), std::invalid_argument);
+		CHECK_THROWS(GlyphAtlas(0x10000, 16, 8), std::invalid_argument);
+	}
+
+	void TestPatternParsing()
+	{
+		CHECK(Format(L"a{{b}", {}) == L"a{b}");
+		CHECK(Format(L"{{{2}}", { 7.0 }) == L"{ 7}");
+		CHECK(Format(L"x{}y", { 42.0 }) == L"x42y");
+		CHECK(Format(L"{3}|{5.2}|{.1}", { 7.0, 1.5, 2.25 }) == L"  7| 1.50|2.3");
+		CHECK(Format(L"{2}\n{2}", { 1.0, 23.0 }) == L" 1\n23");
+
+		// Felder werden in der Reihenfolge des Musters gezählt.
+		CHECK(Format(L"{0} {0} {0}", { 1.0, 2.0, 3.0 }) == L"1 2 3");
+
+		HudText text;
+		CHECK_THROWS(text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{3"), std::invalid_argument);
+		CHECK_THROWS(text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{a}"), std::invalid_argument);
+		CHECK_THROWS(text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{-3}"), std::invalid_argument);
+		CHECK_THROWS(text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{1.2.3}"), std::invalid_argument);
+		CHECK_THROWS(text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{0.10}"), std::invalid_argument);
+		CHECK_THROWS(text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{ 3}"), std::invalid_argument);
+		CHECK(text.GetStatistics().widgets == 0);
+
+		HudWidgetId widget = text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{0.9}");
+		CHECK(widget == 0);
+		CHECK_THROWS(text.SetField(widget, 1, 0.0), std::invalid_argument);
+		CHECK_THROWS(text.SetField(1, 0, 0.0), std::invalid_argument);
+	}
+
+	void TestFieldFormatting()
+	{
+		// Gerundet wird kaufmännisch auf die angezeigten Stellen, auch bei negativen Werten.
+		CHECK(Format(L"{0.2}|{0.2}|{0}|{0}", { 0.125, -0.125, 2.5, -2.5 }) == L"0.13|-0.13|3|-3");
+		CHECK(Format(L"{6.2}|{0.1}|{0.1}", { -1.5, -0.04, -0.05 }) == L" -1.50|0.0|-0.1");
+		CHECK(Format(L"{0.3}|{0.3}", { 0.0005, -0.0004 }) == L"0.001|0.000");
+
+		// Die Breite ist eine Mindestbreite; zu lange Zahlen werden nicht abgeschnitten.
+		CHECK(Format(L"{3}|{2.1}", { 1234567.0, -12.5 }) == L"1234567|-12.5");
+		CHECK(Format(L"{0}", { -9.0e17 }) == L"-900000000000000000");
+
+		// Ungültige Werte erscheinen als -, aufgefüllt wie eine Zahl.
+		const double infinity = std::numeric_limits<double>::infinity();
+		CHECK(Format(L"{3}|{0}|{0}|{0.2}|{0}", { std::nan(""), infinity, -infinity, 1.0e17, -1.0e30 }) == L"  -|-|-|-|-");
+
+		// Ein noch nie gesetztes Feld gilt ebenfalls als ungültig.
+		CHECK(Format(L"[{2}]", {}) == L"[ -]");
+	}
+
+	void TestUnchangedValuesKeepLayout()
+	{
+		HudText text;
+		text.SetAtlas(MakeAtlas());
+		text.SetScreenSize(640.0f, 480.0f);
+		HudWidgetId first = text.AddWidget(HudCorner::TopLeft, 0.0f, 0, L"{0.2} ms");
+		HudWidgetId second = text.AddWidget(HudCorner::TopLeft, 0.0f, 2, L"{0} FPS");
+		text.SetField(first, 0, 1.234);
+		text.SetField(second, 0, 60.0);
+		CHECK(text.Update());
+		CHECK(!text.Update());
+		uint64_t version = text.GetVersion();
+		HudTextStatistics statistics = text.GetStatistics();
+		CHECK(statistics.widgets == 2 && statistics.glyphs == 11);
+		CHECK(statistics.widgetRebuilds == 2 && statistics.batchRebuilds == 1);
+		CHECK(GetText(text, 0.0f, 0.0f) == L"1.23 ms\n\n60 FPS");
+
+		// Werte, die gerundet gleich bleiben, bauen nichts neu auf.
+		text.SetField(first, 0, 1.2341);
+		text.SetField(second, 0, 60.2);
+		CHECK(!text.Update());
+		CHECK(text.GetVersion() == version);
+		CHECK(text.GetStatistics().unchangedFieldUpdates == 2);
+
+		// Nur das geänderte Anzeigeelement wird neu aufgebaut.
+		text.SetField(first, 0, 1.236);
+		CHECK(text.Update());
+		CHECK(text.GetVersion() == version + 1);
+		CHECK(text.GetStatistics().widgetRebuilds == 3);
+		CHECK(GetText(text, 0.0f, 0.0f) == L"1.24 ms\n\n60 FPS");
+
+		// Neue Bildschirmgröße oder neuer Atlas bauen alles neu auf; ohne Atlas gibt es keine Glyphen.
+		text.SetScreenSize(800.0f, 600.0f);
+		CHECK(text.Update());
+		CHECK(text.GetStatistics().widgetRebuilds == 5);
+		text.SetAtlas(nullptr);
+		CHECK(text.Update());
+		CHECK(text.GetGlyphs().empty());
+		CHECK(text.GetStatistics().fieldUpdates == 5);
+	}
+
+	void TestCornerAlignment()
+	{
+		const float width = 640.0f;
+		const float height = 480.0f;
+		const float margin = 4.5f;
+		HudText text;
+		text.SetAtlas(MakeAtlas());
+		text.SetScreenSize(width, height);
+		HudWidgetId widget = text.AddWidget(HudCorner::BottomRight, margin, 1, L"ab\n{4.1} x");
+		text.SetField(widget, 0, 3.0);
+		text.Update();
+
+		// Zeilen rechtsbündig: Die Zeile endet mit ihrem Vorschub am Rand, auf ganze Pixel gerundet.
+		const std::vector<HudGlyph>& glyphs = text.GetGlyphs();
+		CHECK(glyphs.size() == 6);
+		float lastTop = height - margin - 3 * LineHeight;
+		float right = std::floor(width - margin + 0.5f);
+		CHECK(GetCharacter(glyphs[1]) == L'b' && glyphs[1].x + Advance == right);
+		CHECK(GetCharacter(glyphs[5]) == L'x' && glyphs[5].x + Advance == right);
+		CHECK(glyphs[0].y == std::floor(lastTop + 0.5f) && glyphs[5].y == std::floor(lastTop + LineHeight + 0.5f));
+		CHECK(GetText(text, right - 7 * Advance, std::floor(lastTop + 0.5f)) == L"     ab\n  3.0 x");
+
+		// Oben rechts ab dem oberen Rand; die Ecken links beginnen am Rand mit der ersten Glyphe.
+		HudText corners;
+		corners.SetAtlas(MakeAtlas());
+		corners.SetScreenSize(width, height);
+		corners.AddWidget(HudCorner::TopRight, 10.0f, 2, L"abc");
+		corners.AddWidget(HudCorner::TopLeft, 10.0f, 1, L"d");
+		corners.AddWidget(HudCorner::BottomLeft, 10.0f, 0, L"e\nf");
+		corners.Update();
+		const std::vector<HudGlyph>& placed = corners.GetGlyphs();
+		CHECK(placed.size() == 6);
+		CHECK(placed[0].x == width - 10.0f - 3 * Advance && placed[0].y == 10.0f + 2 * LineHeight);
+		CHECK(placed[3].x == 10.0f && placed[3].y == 10.0f + LineHeight);
+		CHECK(placed[4].x == 10.0f && placed[4].y == height - 10.0f - 2 * LineHeight);
+		CHECK(placed[5].x == 10.0f && placed[5].y == height - 10.0f - LineHeight);
+	}
+
+	// Der Überhang einer Glyphe verschiebt nur ihre Zelle, nicht den Stift; unbekannte Zeichen zeigen die Ersatzglyphe.
+	void TestGlyphOffsetAndFallback()
+	{
+		HudText text;
+		text.SetAtlas(MakeAtlas());
+		text.SetScreenSize(640.0f, 480.0f);
+		std::wstring pattern = L"1";
+		pattern += static_cast<wchar_t>(Degree);
+		pattern += L"2\x263a";
+		text.AddWidget(HudCorner::TopLeft, 2.0f, 0, pattern);
+		text.Update();
+
+		const std::vector<HudGlyph>& glyphs = text.GetGlyphs();
+		CHECK(glyphs.size() == 4);
+		CHECK(glyphs[1].x == 2.0f + Advance - 1.0f && glyphs[1].width == 3.0f);
+		CHECK(glyphs[2].x == 2.0f + Advance + 5.0f);
+		CHECK(GetCharacter(glyphs[3]) == L'?');
+	}
+}
+
+int main()
+{
+	return Test::RunTests("HudTextTests", TestAtlas, TestPatternParsing, TestFieldFormatting, TestUnchangedValuesKeepLayout,
+		TestCornerAlignment, TestGlyphOffsetAndFallback);
+}
@@ -0,0 +1,273 @@
+﻿#include "Common/OcclusionBuffer.h"
+#include "Common/ThreadPool.h"
+#include "Terrain/ProceduralTerrain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+using namespace Open_Glider_Simulator;
+
+// Verdeckungsrechnung für Blicke knapp über dem Gelände: Das prozedurale Gelände über 24 × 24 km wird als
+// Gitter im 100-m-Abstand zum Verdecker, geprüft werden Flugzeuge und Gebäude im Sichtkegel. Gemeldet
+// werden Zeichnen, Prüfen und der Anteil verworfener Boxen. Jeder verworfene Punkt wird zusätzlich mit einem
+// Strahl gegen dasselbe Gitter geprüft; er darf von der Kamera aus nicht sichtbar sein.
+// Aufruf: OcclusionBench [Blickrichtungen] [Objekte].
+namespace
+{
+	const float Extent = 12000.0f;
+	const float Spacing = 100.0f;
+	const uint32_t Points = static_cast<uint32_t>(2 * Extent / Spacing) + 1;
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Multiply(const float a[4][4], const float b[4][4], float result[4][4])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column] + a[row][3] * b[3][column];
+			}
+		}
+	}
+
+	// Szenenachsen wie im Gelände: x = Ost, y = oben, z = Süd. Linkshändig in Zeilenvektorform wie
+	// XMMatrixLookToLH mal XMMatrixPerspectiveFovLH mit 70 Grad vertikaler Öffnung im Seitenverhältnis 2:1.
+	void MakeViewProjection(const float eye[3], float yaw, float pitch, float viewProjection[4][4])
+	{
+		float forward[3] = { std::sin(yaw) * std::cos(pitch), std::sin(pitch), -std::cos(yaw) * std::cos(pitch) };
+		float right[3] = { forward[2], 0.0f, -forward[0] };
+		float length = std::sqrt(right[0] * right[0] + right[2] * right[2]);
+		right[0] /= length;
+		right[2] /= length;
+		float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+
+		float view[4][4] = {};
+		for (int i = 0; i < 3; i++)
+		{
+			view[i][0] = right[i];
+			view[i][1] = up[i];
+			view[i][2] = forward[i];
+			view[3][0] -= right[i] * eye[i];
+			view[3][1] -= up[i] * eye[i];
+			view[3][2] -= forward[i] * eye[i];
+		}
+		view[3][3] = 1.0f;
+
+		const float nearZ = 1.0f;
+		const float farZ = 30000.0f;
+		float scaleY = 1.0f / std::tan(0.61f);
+		float projection[4][4] = {};
+		projection[0][0] = scaleY / 2.0f;
+		projection[1][1] = scaleY;
+		projection[2][2] = farZ / (farZ - nearZ);
+		projection[2][3] = 1.0f;
+		projection[3][2] = -nearZ * farZ / (farZ - nearZ);
+		Multiply(view, projection, viewProjection);
+	}
+
+	// Verdeckergitter, zeilenweise nach Nord wie die Verdecker der Geländekacheln.
+	struct OccluderGrid
+	{
+		std::vector<float>		heights;
+		std::vector<float>		positions;
+		std::vector<uint32_t>	indices;
+
+		// Höhe der Dreiecke des Gitters, nicht des Geländes, damit der Strahltest dieselbe Fläche sieht.
+		float GetHeight(float north, float east) const
+		{
+			float row = (north + Extent) / Spacing;
+			float column = (east + Extent) / Spacing;
+			if (!(row >= 0.0f && column >= 0.0f && row < Points - 1 && column < Points - 1))
+			{
+				return -1.0e9f;
+			}
+
+			uint32_t r = static_cast<uint32_t>(row);
+			uint32_t c = static_cast<uint32_t>(column);
+			float v = row - r;
+			float u = column - c;
+			float h00 = heights[r * Points + c], h01 = heights[r * Points + c + 1];
+			float h10 = heights[(r + 1) * Points + c], h11 = heights[(r + 1) * Points + c + 1];
+			return u + v <= 1.0f ? h00 + u * (h01 - h00) + v * (h10 - h00) : h11 + (1.0f - u) * (h10 - h11) + (1.0f - v) * (h01 - h11);
+		}
+	};
+
+	OccluderGrid BuildGrid(const ProceduralTerrain& terrain)
+	{
+		OccluderGrid grid;
+		grid.heights.resize(Points * Points);
+		terrain.GetHeights(-Extent, -Extent, Spacing, Points, Points, grid.heights.data());
+
+		for (uint32_t row = 0; row < Points; row++)
+		{
+			for (uint32_t column = 0; column < Points; column++)
+			{
+				grid.positions.push_back(-Extent + column * Spacing);
+				grid.positions.push_back(grid.heights[row * Points + column]);
+				grid.positions.push_back(-(-Extent + row * Spacing));
+			}
+		}
+		for (uint32_t row = 0; row + 1 < Points; row++)
+		{
+			for (uint32_t column = 0; column + 1 < Points; column++)
+			{
+				uint32_t i00 = row * Points + column;
+				uint32_t i01 = i00 + 1;
+				uint32_t i10 = i00 + Points;
+				uint32_t i11 = i10 + 1;
+				uint32_t cell[] = { i00, i10, i01, i01, i10, i11 };
+				grid.indices.insert(grid.indices.end(), cell, cell + 6);
+			}
+		}
+		return grid;
+	}
+
+	// Wahr, wenn der Strahl von eye zu point überall mindestens einen halben Meter über dem Gitter bleibt.
+	bool IsVisible(const OccluderGrid& grid, const float eye[3], const float point[3])
+	{
+		float delta[3] = { point[0] - eye[0], point[1] - eye[1], point[2] - eye[2] };
+		float length = std::sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+		uint32_t steps = static_cast<uint32_t>(length / 5.0f) + 1;
+		for (uint32_t step = 1; step < steps; step++)
+		{
+			float t = static_cast<float>(step) / steps;
+			float x = eye[0] + delta[0] * t;
+			float y = eye[1] + delta[1] * t;
+			float z = eye[2] + delta[2] * t;
+			if (y < grid.GetHeight(-z, x) + 0.5f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t viewCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 16;
+	uint32_t objectCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 20000;
+	if (viewCount == 0 || objectCount == 0)
+	{
+		std::fprintf(stderr, "usage: OcclusionBench [views] [objects]\n");
+		return 2;
+	}
+
+	ProceduralTerrain terrain(1);
+	OccluderGrid grid = BuildGrid(terrain);
+
+	// Segelflugzeuge bis 600 m über Grund und Gebäude am Boden.
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> position(-Extent * 0.9f, Extent * 0.9f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Aabb> bounds(objectCount);
+	for (Aabb& box : bounds)
+	{
+		float north = position(random);
+		float east = position(random);
+		bool glider = unit(random) < 0.3f;
+		float half = glider ? 9.0f : 6.0f;
+		float bottom = terrain.GetHeight(north, east) + (glider ? 20.0f + 580.0f * unit(random) : 0.0f);
+		Aabb value = { { east - half, bottom, -north - half }, { east + half, bottom + (glider ? 2.0f * half : 10.0f), -north + half } };
+		box = value;
+	}
+
+	ThreadPool pool;
+	OcclusionBuffer buffer(256, 128);
+	double rasterize = 0.0;
+	double test = 0.0;
+	uint64_t inFrustum = 0;
+	uint64_t rejected = 0;
+	uint32_t falseRejections = 0;
+	std::vector<uint32_t> visible;
+	std::vector<uint32_t> remaining;
+
+	// Aus Tälern 30 bis 150 m über Grund, flach oder leicht nach unten blickend, wie beim Kreisen am Hang.
+	for (uint32_t view = 0; view < viewCount; view++)
+	{
+		float eye[3];
+		float lowest = 1.0e9f;
+		for (int attempt = 0; attempt < 16; attempt++)
+		{
+			float north = position(random) * 0.7f;
+			float east = position(random) * 0.7f;
+			float height = terrain.GetHeight(north, east);
+			if (height < lowest)
+			{
+				lowest = height;
+				eye[0] = east;
+				eye[2] = -north;
+			}
+		}
+		eye[1] = std::max(lowest, grid.GetHeight(-eye[2], eye[0])) + 30.0f + 120.0f * unit(random);
+
+		float viewProjection[4][4];
+		MakeViewProjection(eye, 6.2831853f * view / viewCount, -0.1f * unit(random), viewProjection);
+		Frustum frustum = Frustum::FromViewProjection(viewProjection);
+
+		visible.clear();
+		CullBounds(frustum, bounds.data(), bounds.size(), visible);
+		inFrustum += visible.size();
+
+		auto start = std::chrono::steady_clock::now();
+		buffer.Begin(viewProjection);
+		buffer.AddOccluder(grid.positions.data(), static_cast<uint32_t>(grid.positions.size() / 3), grid.indices.data(), static_cast<uint32_t>(grid.indices.size()));
+		buffer.Rasterize(&pool);
+		rasterize += Milliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		remaining = visible;
+		buffer.RemoveOccluded(bounds.data(), remaining);
+		test += Milliseconds(start);
+		rejected += visible.size() - remaining.size();
+
+		// Ecken und Mitte jeder verworfenen Box.
+		std::vector<uint8_t> kept(objectCount, 0);
+		for (uint32_t index : remaining)
+		{
+			kept[index] = 1;
+		}
+		for (uint32_t index : visible)
+		{
+			if (kept[index])
+			{
+				continue;
+			}
+
+			const Aabb& box = bounds[index];
+			for (int corner = 0; corner < 9; corner++)
+			{
+				float point[3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					point[axis] = corner == 8 ? 0.5f * (box.min[axis] + box.max[axis]) : ((corner >> axis) & 1 ? box.max[axis] : box.min[axis]);
+				}
+				if (IsVisible(grid, eye, point))
+				{
+					falseRejections++;
+					break;
+				}
+			}
+		}
+	}
+
+	std::printf("%u views, %u objects, %u occluder triangles: rasterize %.2f ms, test %.3f ms per view\n",
+		viewCount, objectCount, static_cast<uint32_t>(grid.indices.size() / 3), rasterize / viewCount, test / viewCount);
+	std::printf("%.0f objects in the frustum per view, %.1f%% rejected as occluded\n",
+		static_cast<double>(inFrustum) / viewCount, inFrustum ? 100.0 * rejected / inFrustum : 0.0);
+
+	CHECK(falseRejections == 0);
+	CHECK(rejected > 0);
+
+	return Test::RunTests("OcclusionBench");
+}
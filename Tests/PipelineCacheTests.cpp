@@ -0,0 +1,255 @@
+﻿#include "Common/PipelineCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	std::shared_ptr<void> MakeObject(int value)
+	{
+		return std::shared_ptr<void>(std::make_shared<int>(value));
+	}
+
+	std::vector<VertexElement> MakeLayout()
+	{
+		std::vector<VertexElement> layout =
+		{
+			{ "POSITION", 0, 6, 0, 0, false, 0 },
+			{ "COLOR", 0, 6, 0, 12, false, 0 },
+		};
+		return layout;
+	}
+
+	// Gleiche Eingaben ergeben gleiche Schlüssel; Art, Layout und Zustände trennen sie.
+	void TestKeys()
+	{
+		std::vector<uint8_t> a(5000, 7);
+		std::vector<uint8_t> b = a;
+		b.back() = 8;
+
+		PipelineKey vertexA = PipelineCache::HashShader(PipelineObjectKind::VertexShader, a.data(), a.size());
+		PipelineKey pixelA = PipelineCache::HashShader(PipelineObjectKind::PixelShader, a.data(), a.size());
+		PipelineKey vertexB = PipelineCache::HashShader(PipelineObjectKind::VertexShader, b.data(), b.size());
+		CHECK(vertexA == PipelineCache::HashShader(PipelineObjectKind::VertexShader, a.data(), a.size()));
+		CHECK(vertexA != pixelA);
+		CHECK(vertexA != vertexB);
+
+		std::vector<VertexElement> layout = MakeLayout();
+		std::vector<VertexElement> moved = layout;
+		moved[1].offset = 16;
+		std::vector<VertexElement> renamed = layout;
+		renamed[0].semantic = "POSITIO";
+		renamed[1].semantic = "NCOLOR";
+
+		PipelineKey layoutKey = PipelineCache::HashInputLayout(layout, vertexA);
+		CHECK(layoutKey == PipelineCache::HashInputLayout(MakeLayout(), vertexA));
+		CHECK(layoutKey != PipelineCache::HashInputLayout(moved, vertexA));
+		CHECK(layoutKey != PipelineCache::HashInputLayout(renamed, vertexA));
+		CHECK(layoutKey != PipelineCache::HashInputLayout(layout, vertexB));
+
+		PipelineKey pipeline = PipelineCache::HashPipeline(vertexA, pixelA, layoutKey, PrimitiveTopology::TriangleList, BlendMode::Opaque, DepthMode::TestAndWrite);
+		CHECK(pipeline == PipelineCache::HashPipeline(vertexA, pixelA, layoutKey, PrimitiveTopology::TriangleList, BlendMode::Opaque, DepthMode::TestAndWrite));
+		CHECK(pipeline != PipelineCache::HashPipeline(vertexA, pixelA, layoutKey, PrimitiveTopology::LineList, BlendMode::Opaque, DepthMode::TestAndWrite));
+		CHECK(pipeline != PipelineCache::HashPipeline(vertexA, pixelA, layoutKey, PrimitiveTopology::TriangleList, BlendMode::PremultipliedAlpha, DepthMode::TestAndWrite));
+		CHECK(pipeline != PipelineCache::HashPipeline(vertexA, pixelA, layoutKey, PrimitiveTopology::TriangleList, BlendMode::Opaque, DepthMode::Disabled));
+		CHECK(pipeline != PipelineCache::HashPipeline(vertexB, pixelA, layoutKey, PrimitiveTopology::TriangleList, BlendMode::Opaque, DepthMode::TestAndWrite));
+		CHECK(PipelineCache::HashState(BlendMode::Opaque) != PipelineCache::HashState(DepthMode::TestAndWrite));
+	}
+
+	// Gleichzeitige Anforderungen erstellen jedes Objekt genau einmal.
+	void TestConcurrentDeduplication()
+	{
+		PipelineCache cache;
+		uint64_t generation = cache.GetGeneration();
+		std::atomic<int> created(0);
+		std::atomic<int> mismatches(0);
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 8; i++)
+		{
+			threads.emplace_back([&]()
+			{
+				for (int key = 0; key < 16; key++)
+				{
+					std::shared_ptr<void> object = cache.GetOrCreate(key, generation, [&created, key]()
+					{
+						created++;
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+						return MakeObject(key);
+					});
+					if (*static_cast<int*>(object.get()) != key)
+					{
+						mismatches++;
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		PipelineCacheStatistics statistics = cache.GetStatistics();
+		CHECK(created == 16);
+		CHECK(mismatches == 0);
+		CHECK(statistics.objects == 16 && statistics.creations == 16);
+		CHECK(statistics.requests == 8 * 16 && statistics.hits + statistics.creations <= statistics.requests);
+	}
+
+	// Nach einem Fehler versucht der nächste Aufrufer es erneut.
+	void TestRetryAfterFailure()
+	{
+		PipelineCache cache;
+		uint64_t generation = cache.GetGeneration();
+
+		CHECK_THROWS(cache.GetOrCreate(100, generation, []() -> std::shared_ptr<void> { throw std::runtime_error("create failed"); }), std::runtime_error);
+		CHECK(!cache.Find(100));
+		CHECK_THROWS(cache.GetOrCreate(100, generation, []() { return std::shared_ptr<void>(); }), std::logic_error);
+		CHECK(!cache.Find(100));
+
+		cache.GetOrCreate(100, generation, []() { return MakeObject(1); });
+		CHECK(cache.Find(100));
+		CHECK(cache.GetStatistics().failures == 2);
+	}
+
+	// Ein Objekt, dessen Erstellung vor einem Clear begann, wird verworfen und nicht eingetragen.
+	void TestClearDiscardsInFlightCreation()
+	{
+		PipelineCache cache;
+		uint64_t oldGeneration = cache.GetGeneration();
+		cache.GetOrCreate(1, oldGeneration, []() { return MakeObject(1); });
+
+		std::atomic<bool> started(false);
+		std::atomic<bool> release(false);
+		bool creatorThrew = false;
+		bool waiterThrew = false;
+
+		std::thread creator([&]()
+		{
+			try
+			{
+				cache.GetOrCreate(2, oldGeneration, [&]()
+				{
+					started = true;
+					while (!release)
+					{
+						std::this_thread::yield();
+					}
+					return MakeObject(-2);
+				});
+			}
+			catch (const std::runtime_error&)
+			{
+				creatorThrew = true;
+			}
+		});
+		while (!started)
+		{
+			std::this_thread::yield();
+		}
+
+		std::thread waiter([&]()
+		{
+			try
+			{
+				cache.GetOrCreate(2, oldGeneration, []() { return MakeObject(-3); });
+			}
+			catch (const std::runtime_error&)
+			{
+				waiterThrew = true;
+			}
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		cache.Clear();
+		uint64_t newGeneration = cache.GetGeneration();
+		CHECK(newGeneration != oldGeneration);
+		CHECK(!cache.Find(1));
+		waiter.join();
+
+		// Die neue Generation erstellt den Schlüssel selbst, während der alte Ersteller noch läuft.
+		std::shared_ptr<void> fresh = cache.GetOrCreate(2, newGeneration, []() { return MakeObject(2); });
+		release = true;
+		creator.join();
+
+		CHECK(creatorThrew);
+		CHECK(waiterThrew);
+		CHECK(*static_cast<int*>(cache.Find(2).get()) == 2);
+		CHECK(fresh == cache.Find(2));
+		CHECK(cache.GetStatistics().discarded == 1);
+		CHECK_THROWS(cache.GetOrCreate(3, oldGeneration, []() { return MakeObject(3); }), std::runtime_error);
+		CHECK(!cache.Find(3));
+	}
+
+	void TestManifestRoundTrip()
+	{
+		PipelineCache cache;
+		std::vector<VertexElement> moved = MakeLayout();
+		moved[1].offset = 16;
+		PipelineDescription first = { "A.cso", "P.cso", MakeLayout(), PrimitiveTopology::TriangleList, BlendMode::Opaque, DepthMode::TestAndWrite };
+		PipelineDescription second = { "T.cso", "P.cso", moved, PrimitiveTopology::LineList, BlendMode::PremultipliedAlpha, DepthMode::Disabled };
+
+		CHECK(cache.AddToManifest(first, 1));
+		CHECK(cache.AddToManifest(second, 2));
+		CHECK(!cache.AddToManifest(first, 1));
+		CHECK(cache.AddToManifest(first, 3));
+		CHECK(cache.GetManifest().size() == 2 && cache.IsManifestModified());
+
+		std::stringstream stream;
+		cache.WriteManifest(stream);
+		CHECK(!cache.IsManifestModified());
+
+		PipelineCache other;
+		other.ReadManifest(stream);
+		std::vector<PipelineManifestEntry> manifest = other.GetManifest();
+		CHECK(manifest.size() == 2);
+		CHECK(manifest[0].key == 3 && manifest[0].description.inputLayout[0].semantic == "POSITION");
+		CHECK(manifest[1].key == 2 && manifest[1].description.vertexShader == "T.cso" && manifest[1].description.inputLayout[1].offset == 16);
+		CHECK(manifest[1].description.topology == PrimitiveTopology::LineList);
+		CHECK(manifest[1].description.blend == BlendMode::PremultipliedAlpha && manifest[1].description.depth == DepthMode::Disabled);
+		CHECK(!other.AddToManifest(second, 2));
+		CHECK(!other.IsManifestModified());
+	}
+
+	// Jede abgeschnittene oder beschädigte Datei wird abgelehnt und lässt das Verzeichnis unverändert.
+	void TestManifestRejectsDamagedFiles()
+	{
+		PipelineCache cache;
+		PipelineDescription description = { "A.cso", "P.cso", MakeLayout(), PrimitiveTopology::TriangleList, BlendMode::Opaque, DepthMode::TestAndWrite };
+		cache.AddToManifest(description, 1);
+
+		std::stringstream stream;
+		cache.WriteManifest(stream);
+		std::string bytes = stream.str();
+
+		for (size_t length = 0; length < bytes.size(); length++)
+		{
+			std::istringstream truncated(bytes.substr(0, length));
+			CHECK_THROWS(cache.ReadManifest(truncated), std::runtime_error);
+		}
+
+		std::string damaged = bytes;
+		damaged[0] = 'X';
+		std::istringstream badMagic(damaged);
+		CHECK_THROWS(cache.ReadManifest(badMagic), std::runtime_error);
+		CHECK(cache.GetManifest().size() == 1);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("PipelineCacheTests",
+		TestKeys,
+		TestConcurrentDeduplication,
+		TestRetryAfterFailure,
+		TestClearDiscardsInFlightCreation,
+		TestManifestRoundTrip,
+		TestManifestRejectsDamagedFiles);
+}
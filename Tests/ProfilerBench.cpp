@@ -0,0 +1,103 @@
+﻿#include "Common/Profiler.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include "TestSupport.h"
+
+// Kosten einer Profilerzone je Aufruf: eine leere Schleife, zwei Zeitstempel von steady_clock allein und
+// DX_PROFILE_ZONE samt Eintrag in den Puffer des Threads. Die Puffer werden zwischen den Messblöcken
+// außerhalb der Zeitmessung geleert; danach wird geprüft, dass der Export jede Zone enthält und ein voller
+// Puffer Zonen verwirft und zählt. Das Ziel übersetzt mit DX_PROFILER_ENABLED=1.
+// Aufruf: ProfilerBench [Zonen].
+namespace
+{
+	const uint32_t BatchSize = DX::ProfilerThreadBuffer::Capacity / 2;
+
+	volatile uint64_t g_sink;
+
+	double Nanoseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	size_t CountZones(const std::string& trace, const char* name)
+	{
+		std::string pattern = std::string("{\"ph\":\"X\",\"name\":\"") + name + "\"";
+		size_t count = 0;
+		for (size_t position = trace.find(pattern); position != std::string::npos; position = trace.find(pattern, position + 1))
+		{
+			count++;
+		}
+		return count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t zones = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 10000000;
+	if (zones < BatchSize)
+	{
+		std::fprintf(stderr, "usage: ProfilerBench [zones, at least %u]\n", BatchSize);
+		return 2;
+	}
+
+	const uint32_t batches = zones / BatchSize;
+	zones = batches * BatchSize;
+	DX::Profiler& profiler = DX::Profiler::Get();
+	DX_PROFILE_THREAD("ProfilerBench");
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < zones; i++)
+	{
+		g_sink = g_sink + i;
+	}
+	double empty = Nanoseconds(start) / zones;
+
+	start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < zones; i++)
+	{
+		int64_t begin = DX::Profiler::Now();
+		g_sink = g_sink + i;
+		g_sink = g_sink + static_cast<uint64_t>(DX::Profiler::Now() - begin);
+	}
+	double clock = Nanoseconds(start) / zones;
+
+	double zone = 0.0;
+	size_t exported = 0;
+	for (uint32_t batch = 0; batch < batches; batch++)
+	{
+		start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < BatchSize; i++)
+		{
+			DX_PROFILE_ZONE("Bench");
+			g_sink = g_sink + i;
+		}
+		zone += Nanoseconds(start);
+
+		std::ostringstream trace;
+		profiler.WriteChromeTrace(trace);
+		exported += CountZones(trace.str(), "Bench");
+	}
+	zone /= zones;
+
+	// Ohne Leeren nimmt der Puffer genau Capacity Zonen auf; alle weiteren werden verworfen und gezählt.
+	for (uint32_t i = 0; i < DX::ProfilerThreadBuffer::Capacity + 100; i++)
+	{
+		DX_PROFILE_ZONE("Overflow");
+	}
+	std::ostringstream trace;
+	profiler.WriteChromeTrace(trace);
+	std::string overflow = trace.str();
+
+	std::printf("%u zones: empty loop %.1f ns, two steady_clock reads %.1f ns, DX_PROFILE_ZONE %.1f ns (%.1f ns over the loop)\n",
+		zones, empty, clock, zone, zone - empty);
+
+	CHECK(exported == zones);
+	CHECK(CountZones(overflow, "Overflow") == DX::ProfilerThreadBuffer::Capacity);
+	CHECK(profiler.GetDroppedEventCount() == 100);
+	CHECK(overflow.find("\"args\":{\"name\":\"ProfilerBench\"}") != std::string::npos);
+
+	return Test::RunTests("ProfilerBench");
+}
@@ -0,0 +1,183 @@
+﻿#include "Common/RenderCommands.h"
+#include "Common/UploadRing.h"
+
+#include <cstdint>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	// Platzhalter für Objekte des Backends; das Null-Backend vergleicht nur die Adressen.
+	int inputLayout, vertexShader, pixelShader, vertexBuffer, indexBuffer, constantBuffer, texture;
+
+	RenderPipeline GetPipeline()
+	{
+		RenderPipeline pipeline = {};
+		pipeline.inputLayout = &inputLayout;
+		pipeline.vertexShader = &vertexShader;
+		pipeline.pixelShader = &pixelShader;
+		pipeline.topology = PrimitiveTopology::TriangleList;
+		return pipeline;
+	}
+
+	struct Constants
+	{
+		float	values[16];
+	};
+
+	// Zeichnet einen Frame wie der Würfel-Durchgang auf: einmal Zustand, dann objectCount Objekte mit
+	// eigenen Konstanten.
+	void RecordFrame(RenderCommandBuffer& commands, uint32_t objectCount)
+	{
+		RenderHandle buffers[] = { &constantBuffer };
+		RenderHandle views[] = { &texture };
+		commands.SetPipeline(GetPipeline());
+		commands.SetVertexBuffer(0, &vertexBuffer, 24, 0);
+		commands.SetIndexBuffer(&indexBuffer, IndexFormat::UInt16, 0);
+		commands.SetConstantBuffers(ShaderStageVertex, 0, 1, buffers);
+		commands.SetShaderResources(ShaderStagePixel, 0, 1, views);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			Constants constants = {};
+			constants.values[0] = static_cast<float>(i);
+			commands.UpdateConstants(&constantBuffer, constants);
+			commands.DrawIndexed(36, 0, 0);
+		}
+	}
+
+	void TestRecording()
+	{
+		RenderCommandBuffer commands;
+		CHECK(commands.IsEmpty());
+		RecordFrame(commands, 3);
+		CHECK(commands.GetCommandCount() == 11);
+		CHECK(commands.GetSize() % RenderCommandAlignment == 0);
+
+		// Die Konstanten folgen dem Befehl; Änderungen nach der Aufzeichnung wirken nicht mehr.
+		uint32_t updates = 0;
+		commands.ForEach([&](const RenderCommandHeader& header) {
+			CHECK(header.size % RenderCommandAlignment == 0);
+			if (header.type == RenderCommandType::UpdateConstants)
+			{
+				const UpdateConstantsCommand& command = reinterpret_cast<const UpdateConstantsCommand&>(header);
+				CHECK(command.dataSize == sizeof(Constants));
+				CHECK(static_cast<const Constants*>(command.GetData())->values[0] == static_cast<float>(updates));
+				updates++;
+			}
+		});
+		CHECK(updates == 3);
+
+		commands.Reset();
+		CHECK(commands.IsEmpty() && commands.GetSize() == 0);
+	}
+
+	void TestFrameStatistics()
+	{
+		NullRenderBackend backend;
+		RenderCommandBuffer commands;
+		RecordFrame(commands, 100);
+
+		backend.BeginFrame();
+		backend.Execute(commands);
+		backend.EndFrame();
+
+		const RenderCommandStatistics& statistics = backend.GetStatistics();
+		CHECK(statistics.commands == 205);
+		CHECK(statistics.draws == 100);
+		CHECK(statistics.instances == 100);
+		CHECK(statistics.primitives == 1200);
+		CHECK(statistics.stateChanges == 5);
+		CHECK(statistics.redundantStateChanges == 0);
+		CHECK(statistics.constantUploads == 100);
+		CHECK(statistics.constantBytes == 100 * sizeof(Constants));
+		CHECK(statistics.validationErrors == 0);
+	}
+
+	// Das Backend behält den Zustand zwischen Execute-Aufrufen; erneut gesetzter Zustand zählt als überflüssig.
+	void TestRedundantStateChanges()
+	{
+		NullRenderBackend backend;
+		RenderCommandBuffer commands;
+		RecordFrame(commands, 1);
+
+		backend.BeginFrame();
+		backend.Execute(commands);
+		backend.Execute(commands);
+		backend.EndFrame();
+
+		CHECK(backend.GetStatistics().stateChanges == 10);
+		CHECK(backend.GetStatistics().redundantStateChanges == 5);
+		CHECK(backend.GetStatistics().draws == 2);
+
+		backend.ResetStatistics();
+		backend.ResetState();
+		backend.Execute(commands);
+		CHECK(backend.GetStatistics().redundantStateChanges == 0);
+	}
+
+	void TestValidation()
+	{
+		NullRenderBackend backend;
+		RenderCommandBuffer commands;
+		commands.DrawIndexed(36, 0, 0);
+		commands.SetPipeline(GetPipeline());
+		commands.Draw(4, 0);
+		commands.UpdateConstants(&constantBuffer, "abc", 4);
+		commands.SetConstantBufferRange(ShaderStageVertex, 0, &constantBuffer, 100, 64);
+		backend.Execute(commands);
+
+		// Ohne Pipeline; ohne Vertexpuffer und mit unvollständigem Dreieck; Größe; Ausrichtung.
+		CHECK(backend.GetStatistics().validationErrors == 5);
+		CHECK(backend.GetValidationErrors().size() == 5);
+		CHECK(backend.GetStatistics().draws == 2);
+	}
+
+	// Jeder Puffer in ExecuteInOrder beginnt ohne Zustand; ein Durchgang, der sich auf den vorigen verlässt,
+	// fällt auf, auch wenn er nacheinander ausgeführt funktionieren würde.
+	void TestExecuteInOrderResetsState()
+	{
+		NullRenderBackend backend;
+		RenderCommandBuffer first;
+		RenderCommandBuffer second;
+		RecordFrame(first, 1);
+		second.DrawIndexed(36, 0, 0);
+
+		backend.Execute(first);
+		backend.Execute(second);
+		CHECK(backend.GetStatistics().validationErrors == 0);
+
+		const RenderCommandBuffer* passes[] = { &first, &second };
+		backend.ResetStatistics();
+		backend.ExecuteInOrder(passes, 2, nullptr);
+		CHECK(backend.GetStatistics().validationErrors == 1);
+		CHECK(backend.GetStatistics().draws == 2);
+	}
+
+	// Der UploadRing des Null-Backends gibt Daten erst FramesInFlight Frames nach ihrem Ende frei.
+	void TestUploadRingRetire()
+	{
+		NullRenderBackend backend(4096);
+		UploadRing& ring = backend.GetUploadRing();
+
+		for (uint32_t frame = 0; frame < 8; frame++)
+		{
+			backend.BeginFrame();
+			CHECK(ring.Allocate(1024).IsValid());
+			backend.EndFrame();
+		}
+		CHECK(ring.GetStatistics().failedAllocations == 0);
+
+		backend.BeginFrame();
+		CHECK(ring.Allocate(1024).IsValid());
+		CHECK(ring.Allocate(1024).IsValid());
+		CHECK(!ring.Allocate(1024).IsValid());
+		backend.EndFrame();
+	}
+}
+
+int main()
+{
+	return Test::RunTests("RenderCommandTests", TestRecording, TestFrameStatistics, TestRedundantStateChanges,
+		TestValidation, TestExecuteInOrderResetsState, TestUploadRingRetire);
+}
@@ -0,0 +1,155 @@
+﻿#include "Common/DrawQueue.h"
+#include "Common/RenderPassRecorder.h"
+#include "Common/ThreadPool.h"
+#include "Common/UploadRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+// Zeichnet mehrere Durchgänge aus je einer DrawQueue auf, zuerst nacheinander auf dem aufrufenden Thread,
+// dann mit 1, 2, 4, ... Arbeitsthreads bis zur Zahl der Kerne, und reicht sie beim Null-Backend ein. Gemeldet
+// werden Aufzeichnen und Einreichen je Frame und die Beschleunigung gegenüber dem Aufzeichnen nacheinander.
+// Aufruf: RenderPassRecorderBench [Durchgänge] [Objekte je Durchgang] [Frames].
+namespace
+{
+	const uint32_t StateCount = 8;
+
+	// Platzhalter für Objekte des Backends; das Null-Backend vergleicht nur die Adressen.
+	int g_handles[64];
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	struct Scene
+	{
+		std::vector<std::unique_ptr<DrawQueue>>	queues;
+		RenderPassRecorder						recorder;
+		UploadAllocation						view;
+	};
+
+	// Jeder Durchgang bindet die Sichtkonstanten selbst und zeichnet seine Objekte über die eigene DrawQueue.
+	void CreatePasses(Scene& scene, uint32_t passCount, uint32_t objectCount)
+	{
+		static const char* const names[] = { "Terrain", "Scenery", "Aircraft", "Shadows", "Clouds", "Water", "Trees", "Buildings" };
+		for (uint32_t pass = 0; pass < passCount; pass++)
+		{
+			scene.queues.emplace_back(new DrawQueue());
+			DrawQueue& queue = *scene.queues.back();
+			DrawQueueResources resources = { &g_handles[0], &g_handles[1], 16384 };
+			queue.SetResources(resources);
+
+			RenderPipeline pipeline = RenderPipeline();
+			pipeline.inputLayout = &g_handles[2];
+			pipeline.vertexShader = &g_handles[3];
+			pipeline.pixelShader = &g_handles[4];
+			pipeline.topology = PrimitiveTopology::TriangleList;
+			for (uint32_t i = 0; i < StateCount; i++)
+			{
+				queue.RegisterPipeline(pipeline);
+				queue.RegisterMaterial(&g_handles[8 + i]);
+				DrawMesh mesh = { &g_handles[24 + i], 32, &g_handles[40 + i], IndexFormat::UInt16, 36, 0, 0 };
+				queue.RegisterMesh(mesh);
+			}
+
+			UploadAllocation& view = scene.view;
+			scene.recorder.AddPass(names[pass % 8], [&queue, &view, objectCount](RenderCommandBuffer& commands, UploadRing& uploads)
+			{
+				commands.SetConstantBufferRange(ShaderStageVertex, 0, uploads.GetBuffer(), view.offset, view.size);
+				InstanceTransform transform = InstanceTransform();
+				for (uint32_t i = 0; i < objectCount; i++)
+				{
+					queue.Submit(0, i % StateCount, (i / StateCount) % StateCount, (i * 7) % StateCount, (i % 1000) / 1000.0f, transform);
+				}
+				queue.Flush(commands, uploads);
+			});
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t passCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 4;
+	uint32_t objectCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 20000;
+	uint32_t frames = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 50;
+	if (passCount == 0 || objectCount == 0 || frames == 0)
+	{
+		std::fprintf(stderr, "usage: RenderPassRecorderBench [passes] [objects per pass] [frames]\n");
+		return 2;
+	}
+
+	// 0 steht für Aufzeichnen ohne Pool.
+	std::vector<uint32_t> workerCounts(1, 0);
+	uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+	for (uint32_t workers = 1; workers <= cores; workers *= 2)
+	{
+		workerCounts.push_back(workers);
+	}
+
+	std::printf("%u passes x %u objects, %u frames, %u cores\n", passCount, objectCount, frames, cores);
+	double sequential = 0.0;
+	uint64_t expectedDraws = 0;
+	for (uint32_t workers : workerCounts)
+	{
+		NullRenderBackend backend(32 * 1024 * 1024);
+		std::unique_ptr<ThreadPool> pool(workers > 0 ? new ThreadPool(workers) : nullptr);
+		Scene scene;
+		CreatePasses(scene, passCount, objectCount);
+
+		double record = 0.0;
+		double submit = 0.0;
+		uint32_t droppedBatches = 0;
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			backend.BeginFrame();
+			scene.view = backend.GetUploadRing().Upload(InstanceTransform());
+
+			auto start = std::chrono::steady_clock::now();
+			scene.recorder.Record(backend.GetUploadRing(), pool.get());
+			record += Milliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			scene.recorder.Submit(backend, pool.get());
+			submit += Milliseconds(start);
+			backend.EndFrame();
+
+			for (const auto& queue : scene.queues)
+			{
+				droppedBatches += queue->GetStatistics().droppedBatches;
+			}
+		}
+
+		record /= frames;
+		submit /= frames;
+		if (workers == 0)
+		{
+			sequential = record;
+		}
+
+		const RenderCommandStatistics& statistics = backend.GetStatistics();
+		std::printf("%2u workers: record %7.3f ms (%.2fx), null submit %6.3f ms per frame, %llu draws, %llu instances\n",
+			workers, record, sequential / record, submit, static_cast<unsigned long long>(statistics.draws / frames),
+			static_cast<unsigned long long>(statistics.instances / frames));
+
+		// Jeder Durchgang bindet seinen Zustand selbst; das Null-Backend meldet sonst Fehler beim Einreichen.
+		CHECK(statistics.validationErrors == 0);
+		CHECK(backend.GetUploadRing().GetStatistics().failedAllocations == 0);
+		CHECK(droppedBatches == 0);
+		CHECK(statistics.instances == static_cast<uint64_t>(passCount) * objectCount * frames);
+		if (workers == 0)
+		{
+			expectedDraws = statistics.draws;
+		}
+		CHECK(statistics.draws == expectedDraws);
+	}
+
+	return Test::RunTests("RenderPassRecorderBench");
+}
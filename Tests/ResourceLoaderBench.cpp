@@ -0,0 +1,121 @@
+﻿#include "Common/ResourceLoader.h"
+#include "Common/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+// Lädt viele Ressourcen in Gruppen zu einem Material und mehreren abhängigen Netzen, wie beim Betreten eines
+// neuen Geländeabschnitts, einmal nacheinander auf dem aufrufenden Thread und einmal über den ResourceLoader
+// auf allen Kernen. read erzeugt die Daten, decode prüft sie und rechnet darüber; gemeldet werden Ressourcen
+// und MB je Sekunde. Aufruf: ResourceLoaderBench [Ressourcen] [KB je Ressource].
+namespace
+{
+	const uint32_t GroupSize = 8;
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	AssetData Read(uint32_t index, uint32_t size)
+	{
+		std::vector<uint8_t> data(size);
+		uint32_t state = index * 2654435761u + 1;
+		for (uint8_t& value : data)
+		{
+			state = state * 1664525u + 1013904223u;
+			value = static_cast<uint8_t>(state >> 24);
+		}
+		return AssetData(std::move(data));
+	}
+
+	// Einige Durchläufe über die Daten, wie beim Umrechnen von Vertizes oder Entpacken von Texturen.
+	uint64_t Decode(const AssetData& data)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (int pass = 0; pass < 4; pass++)
+		{
+			for (size_t i = 0; i < data.GetSize(); i++)
+			{
+				hash = (hash ^ data.GetData()[i]) * 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t count = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 4096;
+	uint32_t kilobytes = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 256;
+	if (count == 0 || kilobytes == 0)
+	{
+		std::fprintf(stderr, "usage: ResourceLoaderBench [resources] [KB per resource]\n");
+		return 2;
+	}
+
+	const uint32_t size = kilobytes * 1024;
+	const double megabytes = static_cast<double>(count) * size / (1024.0 * 1024.0);
+
+	auto start = std::chrono::steady_clock::now();
+	uint64_t expected = 0;
+	for (uint32_t index = 0; index < count; index++)
+	{
+		expected += Decode(Read(index, size));
+	}
+	double sequential = Milliseconds(start);
+
+	ThreadPool pool;
+	const uint32_t workers = pool.GetThreadCount() + 1;
+	std::atomic<uint64_t> checksum(0);
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> priority(0.0f, 100.0f);
+	ResourceLoaderStatistics statistics;
+	double loaded;
+	{
+		ResourceLoader loader(pool, workers, workers, 60);
+		start = std::chrono::steady_clock::now();
+		ResourceId material = 0;
+		for (uint32_t index = 0; index < count; index++)
+		{
+			ResourceRequest request = {};
+			request.priority = priority(random);
+			request.read = [index, size]() { return Read(index, size); };
+			request.decode = [&checksum](const AssetData& data) { checksum += Decode(data); };
+			if (index % GroupSize != 0)
+			{
+				request.dependencies.push_back(material);
+			}
+
+			ResourceId id = loader.Request(request);
+			if (index % GroupSize == 0)
+			{
+				material = id;
+			}
+		}
+		loader.WaitIdle();
+		loaded = Milliseconds(start);
+		statistics = loader.GetStatistics();
+	}
+
+	std::printf("%u resources of %u KB (%.0f MB), groups of %u\n", count, kilobytes, megabytes, GroupSize);
+	std::printf("sequential: %7.1f ms, %8.0f resources/s, %7.1f MB/s\n", sequential, count * 1000.0 / sequential, megabytes * 1000.0 / sequential);
+	std::printf("loader:     %7.1f ms, %8.0f resources/s, %7.1f MB/s on %u threads (%.2fx); peak %u reads, %u decodes in flight\n",
+		loaded, count * 1000.0 / loaded, megabytes * 1000.0 / loaded, workers, sequential / loaded,
+		statistics.peakReadsInFlight, statistics.peakDecodesInFlight);
+
+	CHECK(checksum == expected);
+	CHECK(statistics.completed == count);
+	CHECK(statistics.failed == 0);
+	CHECK(statistics.bytesRead == static_cast<uint64_t>(count) * size);
+	CHECK(statistics.peakReadsInFlight <= workers);
+	CHECK(statistics.peakDecodesInFlight <= workers);
+
+	return Test::RunTests("ResourceLoaderBench");
+}
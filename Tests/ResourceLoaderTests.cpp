@@ -0,0 +1,404 @@
+﻿#include "Common/ResourceLoader.h"
+#include "Common/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	// Belegt den einzigen Leseplatz, bis Open aufgerufen wird; alles danach Angeforderte bleibt in der Schlange.
+	class Gate
+	{
+	public:
+		Gate() :
+			m_opened(m_open.get_future().share())
+		{
+		}
+
+		ResourceRequest MakeRequest() const
+		{
+			std::shared_future<void> opened = m_opened;
+			ResourceRequest request = {};
+			request.read = [opened]() { opened.wait(); return AssetData(); };
+			return request;
+		}
+
+		void Open()											{ m_open.set_value(); }
+
+	private:
+		std::promise<void>			m_open;
+		std::shared_future<void>	m_opened;
+	};
+
+	// Schreibt die Reihenfolge mit, in der die Stufen beginnen.
+	class Journal
+	{
+	public:
+		std::function<AssetData()> Read(int name)
+		{
+			return [this, name]() { Append(name); return AssetData(); };
+		}
+
+		std::function<void(const AssetData&)> Decode(int name)
+		{
+			return [this, name](const AssetData&) { Append(name); };
+		}
+
+		std::vector<int> Get()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_names;
+		}
+
+	private:
+		void Append(int name)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_names.push_back(name);
+		}
+
+		std::mutex			m_mutex;
+		std::vector<int>	m_names;
+	};
+
+	ResourceRequest MakeRequest(float priority, const std::function<AssetData()>& read)
+	{
+		ResourceRequest request = {};
+		request.priority = priority;
+		request.read = read;
+		return request;
+	}
+
+	void TestReadsFollowPriority()
+	{
+		ThreadPool pool(1);
+		ResourceLoader loader(pool, 1, 1, 10);
+		Journal journal;
+		Gate gate;
+		loader.Request(gate.MakeRequest());
+
+		loader.Request(MakeRequest(1.0f, journal.Read(1)));
+		loader.Request(MakeRequest(3.0f, journal.Read(3)));
+		loader.Request(MakeRequest(2.0f, journal.Read(2)));
+		loader.Request(MakeRequest(2.0f, journal.Read(4)));
+
+		// Die Abhängigkeit erbt die Priorität 5 der wartenden Anforderung und wird als ältere vor ihr gelesen.
+		ResourceId low = loader.Request(MakeRequest(0.0f, journal.Read(0)));
+		ResourceRequest dependent = MakeRequest(5.0f, journal.Read(5));
+		dependent.dependencies.push_back(low);
+		loader.Request(dependent);
+
+		// Touch hebt eine wartende Anforderung nachträglich an.
+		ResourceId raised = loader.Request(MakeRequest(0.5f, journal.Read(6)));
+		loader.Touch(raised, 4.0f);
+
+		gate.Open();
+		loader.WaitIdle();
+
+		std::vector<int> expected = { 0, 5, 6, 3, 2, 4, 1 };
+		CHECK(journal.Get() == expected);
+		CHECK(loader.GetStatistics().completed == 8);
+		CHECK(loader.GetStatistics().peakReadsInFlight == 1);
+	}
+
+	void TestDecodesFollowPriority()
+	{
+		ThreadPool pool(1);
+		ResourceLoader loader(pool, 4, 1, 10);
+		Journal journal;
+		std::promise<void> open;
+		std::shared_future<void> opened = open.get_future().share();
+
+		ResourceRequest blocker = {};
+		blocker.decode = [opened](const AssetData&) { opened.wait(); };
+		loader.Request(blocker);
+
+		for (int name = 1; name <= 4; name++)
+		{
+			ResourceRequest request = {};
+			request.priority = static_cast<float>(name % 3);
+			request.decode = journal.Decode(name);
+			loader.Request(request);
+		}
+
+		open.set_value();
+		loader.WaitIdle();
+
+		std::vector<int> expected = { 2, 1, 4, 3 };
+		CHECK(journal.Get() == expected);
+		CHECK(loader.GetStatistics().peakDecodesInFlight == 1);
+	}
+
+	void TestDependencyFailurePropagates()
+	{
+		ThreadPool pool(2);
+		ResourceLoader loader(pool, 2, 2, 10);
+		std::atomic<int> decoded(0);
+
+		ResourceRequest broken = MakeRequest(1.0f, []() -> AssetData { throw std::runtime_error("read failed"); });
+		ResourceId root = loader.Request(broken);
+
+		ResourceRequest middle = {};
+		middle.dependencies.push_back(root);
+		middle.decode = [&decoded](const AssetData&) { decoded++; };
+		ResourceId child = loader.Request(middle);
+
+		ResourceRequest leaf = middle;
+		leaf.dependencies.assign(1, child);
+		ResourceId grandchild = loader.Request(leaf);
+
+		// Eine unabhängige Anforderung wird davon nicht berührt.
+		ResourceRequest healthy = {};
+		healthy.decode = [&decoded](const AssetData&) { decoded++; };
+		ResourceId other = loader.Request(healthy);
+
+		loader.WaitIdle();
+		CHECK(loader.GetState(root) == ResourceState::Failed);
+		CHECK(loader.GetState(child) == ResourceState::Failed);
+		CHECK(loader.GetState(grandchild) == ResourceState::Failed);
+		CHECK(loader.GetState(other) == ResourceState::Ready);
+		CHECK(decoded == 1);
+
+		// Der Fehler der Wurzel ist die ursprüngliche Ausnahme, die der abhängigen ein eigener.
+		CHECK_THROWS(std::rethrow_exception(loader.GetError(root)), std::runtime_error);
+		CHECK(loader.GetError(child) != nullptr);
+		CHECK(loader.GetError(other) == nullptr);
+
+		// Wer nach dem Fehler anfordert, scheitert sofort.
+		ResourceId late = loader.Request(middle);
+		CHECK(loader.GetState(late) == ResourceState::Failed);
+
+		ResourceLoaderStatistics statistics = loader.GetStatistics();
+		CHECK(statistics.failed == 4);
+		CHECK(statistics.completed == 1);
+		CHECK(statistics.pending == 0);
+
+		// Eine freigegebene Abhängigkeit ist unbekannt.
+		loader.Release(other);
+		ResourceRequest orphan = {};
+		orphan.dependencies.push_back(other);
+		CHECK_THROWS(loader.Request(orphan), std::invalid_argument);
+		CHECK_THROWS(loader.GetState(other), std::invalid_argument);
+	}
+
+	// Abbruch oder Freigabe einer wartenden Abhängigkeit lässt die abhängige Anforderung scheitern.
+	void TestCancelledDependencyFailsDependent()
+	{
+		ThreadPool pool(1);
+		ResourceLoader loader(pool, 1, 1, 10);
+		Gate gate;
+		Journal journal;
+		loader.Request(gate.MakeRequest());
+
+		ResourceId cancelled = loader.Request(MakeRequest(1.0f, journal.Read(1)));
+		ResourceRequest first = MakeRequest(1.0f, journal.Read(2));
+		first.dependencies.push_back(cancelled);
+		ResourceId firstDependent = loader.Request(first);
+
+		ResourceId released = loader.Request(MakeRequest(1.0f, journal.Read(3)));
+		ResourceRequest second = MakeRequest(1.0f, journal.Read(4));
+		second.dependencies.push_back(released);
+		ResourceId secondDependent = loader.Request(second);
+
+		loader.Cancel(cancelled);
+		loader.Release(released);
+		CHECK(loader.GetState(cancelled) == ResourceState::Cancelled);
+		CHECK(loader.GetState(firstDependent) == ResourceState::Failed);
+		CHECK(loader.GetState(secondDependent) == ResourceState::Failed);
+
+		gate.Open();
+		loader.WaitIdle();
+		CHECK(journal.Get().empty());
+	}
+
+	void TestStaleStreamingRequestsAreCancelled()
+	{
+		ThreadPool pool(1);
+		const uint32_t staleFrames = 3;
+		ResourceLoader loader(pool, 1, 1, staleFrames);
+		Journal journal;
+		Gate gate;
+		loader.Request(gate.MakeRequest());
+
+		ResourceRequest streaming = MakeRequest(1.0f, journal.Read(1));
+		streaming.streaming = true;
+		ResourceId forgotten = loader.Request(streaming);
+
+		streaming.read = journal.Read(2);
+		ResourceId touched = loader.Request(streaming);
+
+		// Eine nicht verfallende Anforderung hält ihre Streaming-Abhängigkeit am Leben.
+		streaming.read = journal.Read(3);
+		ResourceId needed = loader.Request(streaming);
+		ResourceRequest owner = MakeRequest(1.0f, journal.Read(4));
+		owner.dependencies.push_back(needed);
+		ResourceId holder = loader.Request(owner);
+
+		// Eine Streaming-Abhängigkeit wird über Touch der abhängigen Anforderung erneuert.
+		streaming.read = journal.Read(5);
+		ResourceId renewed = loader.Request(streaming);
+		ResourceRequest renewer = streaming;
+		renewer.read = journal.Read(6);
+		renewer.dependencies.push_back(renewed);
+		ResourceId renewing = loader.Request(renewer);
+
+		for (uint32_t frame = 0; frame < staleFrames; frame++)
+		{
+			loader.Touch(touched, 1.0f);
+			loader.Touch(renewing, 1.0f);
+			loader.Update();
+			CHECK(loader.GetState(forgotten) == ResourceState::Queued);
+		}
+
+		loader.Touch(touched, 1.0f);
+		loader.Touch(renewing, 1.0f);
+		loader.Update();
+		CHECK(loader.GetState(forgotten) == ResourceState::Cancelled);
+		CHECK(loader.GetState(touched) == ResourceState::Queued);
+		CHECK(loader.GetState(needed) == ResourceState::Queued);
+		CHECK(loader.GetState(renewed) == ResourceState::Queued);
+		CHECK(loader.GetStatistics().cancelled == 1);
+
+		gate.Open();
+		loader.WaitIdle();
+		CHECK(loader.IsReady(touched));
+		CHECK(loader.IsReady(holder));
+		CHECK(loader.IsReady(renewing));
+
+		std::vector<int> reads = journal.Get();
+		CHECK(reads.size() == 5);
+		for (int name : reads)
+		{
+			CHECK(name != 1);
+		}
+	}
+
+	// Eine laufende Stufe wird nicht verworfen, solange sie läuft; verfallen kann nur, was noch wartet.
+	void TestRunningStreamingRequestIsNotCancelled()
+	{
+		ThreadPool pool(1);
+		ResourceLoader loader(pool, 1, 1, 1);
+		Gate gate;
+		ResourceRequest streaming = gate.MakeRequest();
+		streaming.streaming = true;
+		ResourceId running = loader.Request(streaming);
+
+		for (int frame = 0; frame < 4; frame++)
+		{
+			loader.Update();
+		}
+		CHECK(loader.GetState(running) == ResourceState::Loading);
+
+		gate.Open();
+		loader.WaitIdle();
+		CHECK(loader.IsReady(running));
+	}
+
+	void TestReleaseAndWaitBlocksForRunningDecode()
+	{
+		ThreadPool pool(2);
+		ResourceLoader loader(pool, 2, 2, 10);
+
+		for (int round = 0; round < 20; round++)
+		{
+			std::promise<void> started;
+			std::future<void> startedFuture = started.get_future();
+			std::atomic<bool> writing(false);
+			std::atomic<bool> finished(false);
+
+			ResourceRequest request = {};
+			request.decode = [&](const AssetData&)
+			{
+				writing = true;
+				started.set_value();
+				std::this_thread::sleep_for(std::chrono::milliseconds(5 + round % 4));
+				writing = false;
+				finished = true;
+			};
+			ResourceId id = loader.Request(request);
+
+			startedFuture.wait();
+			loader.ReleaseAndWait(id);
+			CHECK(!writing);
+			CHECK(finished);
+			CHECK_THROWS(loader.GetState(id), std::invalid_argument);
+		}
+
+		// Die laufende Stufe wurde nach der Freigabe verworfen und zählt als abgebrochen.
+		ResourceLoaderStatistics statistics = loader.GetStatistics();
+		CHECK(statistics.cancelled == 20);
+		CHECK(statistics.completed == 0);
+		CHECK(statistics.pending == 0);
+
+		// Wartende, fertige und unbekannte Ressourcen geben sofort frei.
+		ResourceRequest ready = {};
+		ResourceId readyId = loader.Request(ready);
+		loader.WaitIdle();
+		loader.ReleaseAndWait(readyId);
+		loader.ReleaseAndWait(readyId);
+		loader.ReleaseAndWait(12345);
+		CHECK_THROWS(loader.GetState(readyId), std::invalid_argument);
+	}
+
+	// Gibt eine abhängige Anforderung vor ihrer Abhängigkeit frei, wie der Renderer beim Zurücksetzen.
+	void TestReleaseAndWaitDependencyChain()
+	{
+		ThreadPool pool(2);
+		ResourceLoader loader(pool, 2, 2, 10);
+		bool overlapped = false;
+
+		for (int round = 0; round < 50; round++)
+		{
+			std::atomic<bool> writing(false);
+			ResourceRequest base = {};
+			base.decode = [](const AssetData&) { std::this_thread::sleep_for(std::chrono::microseconds(300)); };
+			ResourceId baseId = loader.Request(base);
+
+			ResourceRequest dependent = {};
+			dependent.dependencies.push_back(baseId);
+			dependent.decode = [&writing](const AssetData&)
+			{
+				writing = true;
+				std::this_thread::sleep_for(std::chrono::microseconds(300));
+				writing = false;
+			};
+			ResourceId dependentId = loader.Request(dependent);
+
+			std::this_thread::sleep_for(std::chrono::microseconds(round % 8 * 100));
+			loader.ReleaseAndWait(dependentId);
+			loader.ReleaseAndWait(baseId);
+			overlapped = overlapped || writing;
+		}
+
+		CHECK(!overlapped);
+		CHECK(loader.GetStatistics().pending == 0);
+	}
+
+	void TestInvalidArguments()
+	{
+		ThreadPool pool(1);
+		CHECK_THROWS(ResourceLoader(pool, 0, 1, 1), std::invalid_argument);
+		CHECK_THROWS(ResourceLoader(pool, 1, 0, 1), std::invalid_argument);
+
+		ResourceLoader loader(pool, 1, 1, 1);
+		CHECK_THROWS(loader.GetState(1), std::invalid_argument);
+		ResourceRequest request = {};
+		request.dependencies.push_back(99);
+		CHECK_THROWS(loader.Request(request), std::invalid_argument);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("ResourceLoaderTests", TestReadsFollowPriority, TestDecodesFollowPriority, TestDependencyFailurePropagates,
+		TestCancelledDependencyFailsDependent, TestStaleStreamingRequestsAreCancelled, TestRunningStreamingRequestIsNotCancelled,
+		TestReleaseAndWaitBlocksForRunningDecode, TestReleaseAndWaitDependencyChain, TestInvalidArguments);
+}
@@ -0,0 +1,129 @@
+﻿#include "Common/StepTimer.h"
+
+#include <chrono>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	const uint64_t Step = StepTimer::TicksPerSecond / 120;
+
+	// Gleichmäßige Frames im Takt der Simulation ergeben genau einen Schritt je Frame.
+	void TestFixedStepMatchesFrames()
+	{
+		auto clock = std::make_shared<ManualClock>();
+		StepTimer timer(clock);
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedTicks(Step);
+
+		uint32_t updates = 0;
+		for (int frame = 0; frame < 1200; frame++)
+		{
+			clock->AdvanceTicks(Step);
+			timer.Tick([&]() { updates++; });
+			CHECK(timer.GetUpdatesThisTick() == 1);
+		}
+
+		CHECK(updates == 1200);
+		CHECK(timer.GetTotalTicks() == 1200 * Step);
+		CHECK(timer.GetFramesPerSecond() == 120);
+		CHECK(timer.GetDroppedTicks() == 0);
+	}
+
+	// Bei 144 Hz Anzeige und 120 Hz Simulation läuft alpha den Bruchteil eines Schritts ab.
+	void TestInterpolationAlpha()
+	{
+		StepTimer timer(std::make_shared<ManualClock>());
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedTicks(Step);
+
+		const uint64_t frame = StepTimer::TicksPerSecond / 144;
+		uint64_t simulated = 0;
+		uint64_t elapsed = 0;
+		for (int i = 0; i < 1440; i++)
+		{
+			timer.Advance(frame, [&]() { simulated += Step; });
+			elapsed += frame;
+
+			double alpha = timer.GetInterpolationAlpha();
+			CHECK(alpha >= 0.0 && alpha < 1.0);
+			CHECK(simulated + static_cast<uint64_t>(alpha * Step + 0.5) == elapsed);
+		}
+	}
+
+	// Ein langer Frame löst höchstens das Aufholbudget aus; der Rest wird verworfen und gezählt.
+	void TestCatchUpBudget()
+	{
+		StepTimer timer(std::make_shared<ManualClock>());
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedTicks(Step);
+		timer.SetMaxUpdatesPerTick(8);
+
+		uint32_t updates = 0;
+		timer.Advance(50 * Step + Step / 2, [&]() { updates++; });
+		CHECK(updates == 8);
+		CHECK(timer.GetUpdatesThisTick() == 8);
+		CHECK(timer.GetDroppedTicks() == 42 * Step);
+		CHECK(timer.GetInterpolationAlpha() > 0.49 && timer.GetInterpolationAlpha() < 0.51);
+
+		// Danach läuft die Simulation ohne Aufholschritte weiter.
+		updates = 0;
+		timer.Advance(Step, [&]() { updates++; });
+		CHECK(updates == 1);
+		CHECK(timer.GetDroppedTicks() == 42 * Step);
+	}
+
+	// Tick bindet den Abstand der Uhr an die maximale Differenz.
+	void TestMaxDelta()
+	{
+		auto clock = std::make_shared<ManualClock>();
+		StepTimer timer(clock);
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedTicks(Step);
+
+		uint32_t updates = 0;
+		clock->AdvanceSeconds(10.0);
+		timer.Tick([&]() { updates++; });
+		CHECK(updates == 12);
+	}
+
+	void TestVariableStep()
+	{
+		StepTimer timer(std::make_shared<ManualClock>());
+
+		uint32_t updates = 0;
+		timer.Advance(12345, [&]() { updates++; });
+		CHECK(updates == 1);
+		CHECK(timer.GetElapsedTicks() == 12345);
+		CHECK(timer.GetInterpolationAlpha() == 1.0);
+	}
+
+	// Kosten eines Ticks mit synthetischer Uhr; nur zur Information, kein Grenzwert.
+	void MeasureTickCost()
+	{
+		auto clock = std::make_shared<ManualClock>();
+		StepTimer timer(clock);
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedTicks(StepTimer::TicksPerSecond / 500);
+		timer.SetMaxUpdatesPerTick(8);
+
+		const int frames = 1000000;
+		uint64_t updates = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			clock->AdvanceTicks(StepTimer::TicksPerSecond / 144);
+			timer.Tick([&]() { updates++; });
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::printf("StepTimer: %.1f ns per tick, %llu updates\n", seconds * 1e9 / frames, static_cast<unsigned long long>(updates));
+	}
+}
+
+int main()
+{
+	return Test::RunTests("StepTimerTests", TestFixedStepMatchesFrames, TestInterpolationAlpha, TestCatchUpBudget, TestMaxDelta,
+		TestVariableStep, MeasureTickCost);
+}
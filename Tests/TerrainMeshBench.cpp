@@ -0,0 +1,101 @@
+﻿#include "Common/ThreadPool.h"
+#include "Terrain/ProceduralTerrain.h"
+#include "Terrain/TerrainMeshGenerator.h"
+#include "Terrain/TerrainTileSource.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+// Netze von Geländekacheln je Sekunde mit TerrainMeshGenerator::Generate, wie sie der TerrainStreamer nach dem
+// Laden auf den Arbeitsthreads erzeugt: jedes Netz in einem neuen Block. Zuerst nacheinander auf dem aufrufenden
+// Thread, dann mit ParallelFor auf 2, 3, 5, ... Threads bis zur Zahl der Kerne. Die Höhen von 64 Kacheln der
+// Stufe 6 werden vorher geladen. Aufruf: TerrainMeshBench [Kacheln] [Kachelauflösung].
+namespace
+{
+	const uint32_t TileLevel = 6;
+	const uint32_t TileSpan = 8;
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Erzeugt ein Netz und prüft seinen Aufbau.
+	bool Generate(const TerrainMeshGenerator& generator, const TerrainTile& tile)
+	{
+		auto mesh = std::make_shared<TerrainMeshBlock>();
+		generator.Generate(tile, *mesh);
+		return mesh->vertices.size() == generator.GetVertexCount() && mesh->occluderPositions.size() == 3 * generator.GetOccluderVertexCount();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t patches = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 20000;
+	uint32_t resolution = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 65;
+	if (patches == 0 || resolution < 2 || argc > 3)
+	{
+		std::fprintf(stderr, "usage: TerrainMeshBench [patches] [tile resolution]\n");
+		return 2;
+	}
+
+	ProceduralTerrain terrain;
+	ProceduralTileSource source(terrain, -204800.0f, -204800.0f, 409600.0f, 9, resolution);
+	TerrainMeshGenerator generator(source.GetDescription());
+
+	// Ein Block aus Kacheln um die Mitte des Gebiets.
+	std::vector<std::shared_ptr<TerrainTile>> tiles;
+	uint32_t first = (1u << TileLevel) / 2 - TileSpan / 2;
+	for (uint32_t y = 0; y < TileSpan; y++)
+	{
+		for (uint32_t x = 0; x < TileSpan; x++)
+		{
+			TerrainTileKey key = { TileLevel, first + x, first + y };
+			tiles.push_back(source.LoadTile(key));
+		}
+	}
+
+	uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+	std::printf("%u patches of %u x %u (%u vertices), %u cores\n", patches, resolution, resolution, generator.GetVertexCount(), cores);
+
+	uint32_t valid = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t patch = 0; patch < patches; patch++)
+	{
+		valid += Generate(generator, *tiles[patch % tiles.size()]) ? 1 : 0;
+	}
+	double elapsed = Seconds(start);
+	double sequential = patches / elapsed;
+	std::printf(" 1 thread:  %8.0f patches/s, %.1f us per patch\n", sequential, elapsed * 1.0e6 / patches);
+	CHECK(valid == patches);
+
+	// ParallelFor rechnet auf dem aufrufenden Thread mit; ein Pool mit n Arbeitsthreads belegt n + 1 Kerne.
+	for (uint32_t workers = 1; workers + 1 <= cores; workers *= 2)
+	{
+		DX::ThreadPool threadPool(workers);
+		std::atomic<uint32_t> parallelValid(0);
+		start = std::chrono::steady_clock::now();
+		threadPool.ParallelFor(patches, [&](uint32_t patch)
+		{
+			if (Generate(generator, *tiles[patch % tiles.size()]))
+			{
+				parallelValid.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+		elapsed = Seconds(start);
+
+		double rate = patches / elapsed;
+		std::printf("%2u threads: %8.0f patches/s (%.2fx), %.0f per thread\n", workers + 1, rate, rate / sequential, rate / (workers + 1));
+		CHECK(parallelValid.load() == patches);
+	}
+
+	return Test::RunTests("TerrainMeshBench");
+}
@@ -0,0 +1,120 @@
+﻿#include "Common/FrameTimeHistogram.h"
+#include "Terrain/ProceduralTerrain.h"
+#include "Terrain/TerrainMeshGenerator.h"
+#include "Terrain/TerrainStreamer.h"
+#include "Terrain/TerrainTileSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+// Ein Flug über das prozedurale Gelände der App (409,6 km, neun Stufen, Netze beim Laden) in 500 m über Grund,
+// im Takt von 60 Frames je Sekunde in Echtzeit, damit die Arbeitsthreads so viel Zeit zum Laden haben wie in der
+// App. Gemeldet werden die Trefferquote des Kachelspeichers, Frames mit gröberen Ersatzkacheln, vermiedene
+// Wartezeiten und die Dauer von Update. Danach bleibt die Kamera stehen, bis alle Kacheln geladen sind oder
+// höchstens 30 Sekunden lang.
+// Aufruf: TerrainStreamerBench [Geschwindigkeit in m/s] [Sekunden] [Speicherbudget in MB].
+namespace
+{
+	const uint32_t FramesPerSecond = 60;
+	const uint32_t SettleFrames = 30 * FramesPerSecond;
+
+	double Microseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	float speed = argc > 1 ? static_cast<float>(std::atof(argv[1])) : 250.0f;
+	uint32_t seconds = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 60;
+	uint32_t budget = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 128;
+	if (!(speed >= 0.0f) || seconds == 0 || budget == 0 || argc > 4)
+	{
+		std::fprintf(stderr, "usage: TerrainStreamerBench [speed m/s] [seconds] [memory budget MB]\n");
+		return 2;
+	}
+
+	DX::ThreadPool threadPool;
+	ProceduralTerrain terrain;
+	auto source = std::make_shared<ProceduralTileSource>(terrain, -204800.0f, -204800.0f, 409600.0f, 9);
+	auto meshGenerator = std::make_shared<TerrainMeshGenerator>(source->GetDescription());
+	TerrainStreamer streamer(threadPool, source, static_cast<size_t>(budget) * 1024 * 1024, 8, meshGenerator);
+
+	// Nach Nordosten über die Mitte des Gebiets, Bildschirm und Fehlerschwelle wie in der App bei 1080 Zeilen.
+	TerrainView view = { 0.0f, 0.0f, 0.0f, 70.0f * 3.14159265f / 180.0f, 1080.0f, 2.0f };
+	const float direction = 0.70710678f;
+	const uint32_t frames = seconds * FramesPerSecond;
+
+	std::vector<std::shared_ptr<const TerrainTile>> selection;
+	DX::FrameTimeHistogram updateTimes;
+	uint32_t fallbackFrames = 0;
+	uint64_t selectedTiles = 0;
+	uint64_t flightEvictions = 0;
+	uint32_t frame = 0;
+	auto next = std::chrono::steady_clock::now();
+	for (; frame < frames + SettleFrames; frame++)
+	{
+		// Nach dem Flug schwebt die Kamera am letzten Punkt, bis nichts mehr fehlt.
+		float distance = speed * std::min(frame, frames) / FramesPerSecond;
+		view.north = -20000.0f + direction * distance;
+		view.east = -20000.0f + direction * distance;
+		view.altitude = terrain.GetHeight(view.north, view.east) + 500.0f;
+
+		auto start = std::chrono::steady_clock::now();
+		streamer.Update(view, selection);
+		updateTimes.Record(static_cast<uint64_t>(Microseconds(start)));
+
+		const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+		if (frame < frames)
+		{
+			fallbackFrames += statistics.fallbackTiles > 0 ? 1 : 0;
+			selectedTiles += statistics.selectedTiles;
+			flightEvictions = streamer.GetCache().GetStatistics().evictions;
+		}
+		else if (statistics.fallbackTiles == 0 && statistics.loadsInFlight == 0)
+		{
+			break;
+		}
+
+		next += std::chrono::microseconds(1000000 / FramesPerSecond);
+		std::this_thread::sleep_until(next);
+	}
+
+	const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+	const TerrainCacheStatistics& cache = streamer.GetCache().GetStatistics();
+	double lookups = static_cast<double>(cache.hits + cache.misses);
+	std::printf("%.0f m/s for %u s (%.1f km), %u worker threads, budget %u MB\n", speed, seconds, speed * seconds / 1000.0f,
+		threadPool.GetThreadCount(), budget);
+	std::printf("%.1f tiles per frame, %u of %u frames with coarser fallback tiles, %llu stalls prevented\n",
+		static_cast<double>(selectedTiles) / frames, fallbackFrames, frames, static_cast<unsigned long long>(statistics.stallsPrevented));
+	std::printf("cache: %.1f %% hits, %llu misses, %llu evictions, %zu tiles in %.1f MB; %llu loads\n",
+		lookups > 0.0 ? 100.0 * cache.hits / lookups : 0.0, static_cast<unsigned long long>(cache.misses),
+		static_cast<unsigned long long>(cache.evictions), streamer.GetCache().GetTileCount(),
+		streamer.GetCache().GetMemoryUsage() / (1024.0 * 1024.0), static_cast<unsigned long long>(statistics.loadsCompleted));
+	std::printf("Update p50 %u us, p99 %u us, max %u us; complete %u frames after the flight\n", updateTimes.GetPercentile(0.5),
+		updateTimes.GetPercentile(0.99), updateTimes.GetMax(), frame - std::min(frame, frames));
+
+	// Verdrängt der Speicher auch bei stehender Kamera noch Kacheln, passt die Auswahl nicht ins Budget und
+	// die Ladevorgänge kommen nie zur Ruhe; sonst muss alles innerhalb der Wartezeit geladen sein.
+	bool settled = frame < frames + SettleFrames;
+	bool thrashing = cache.evictions > flightEvictions;
+	if (!settled && thrashing)
+	{
+		std::printf("the selection does not fit into %u MB; the cache keeps evicting tiles it needs\n", budget);
+	}
+
+	CHECK(statistics.loadsFailed == 0);
+	CHECK(settled || thrashing);
+	CHECK(!selection.empty());
+	CHECK(streamer.GetCache().GetMemoryUsage() <= streamer.GetCache().GetMemoryBudget());
+
+	return Test::RunTests("TerrainStreamerBench");
+}
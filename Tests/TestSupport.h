@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <exception>
+
+// Kleinste Testunterstützung ohne Abhängigkeiten: CHECK meldet Fehler und zählt sie, RunTests gibt
+// die Zahl der Fehler als Rückgabewert des Programms zurück.
+namespace Test
+{
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void Fail(const char* file, int line, const char* expression)
+	{
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+		Failures()++;
+	}
+
+	// Führt die Testfunktionen nacheinander aus; eine unerwartete Ausnahme zählt als Fehler.
+	template<typename... TTests>
+	int RunTests(const char* name, TTests... tests)
+	{
+		void (*list[])() = { tests... };
+		for (auto test : list)
+		{
+			try
+			{
+				test();
+			}
+			catch (const std::exception& exception)
+			{
+				std::fprintf(stderr, "%s: unexpected exception: %s\n", name, exception.what());
+				Failures()++;
+			}
+		}
+
+		std::printf("%s: %s (%d failures)\n", name, Failures() == 0 ? "passed" : "FAILED", Failures());
+		return Failures() == 0 ? 0 : 1;
+	}
+}
+
+#define CHECK(expression) \
+	do { if (!(expression)) { ::Test::Fail(__FILE__, __LINE__, #expression); } } while (0)
+
+#define CHECK_THROWS(expression, exceptionType) \
+	do { \
+		bool thrown = false; \
+		try { expression; } catch (const exceptionType&) { thrown = true; } \
+		if (!thrown) { ::Test::Fail(__FILE__, __LINE__, #expression " throws " #exceptionType); } \
+	} while (0)
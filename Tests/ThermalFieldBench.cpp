@@ -0,0 +1,89 @@
+﻿#include "Simulation/ThermalField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+// Vergleicht die Abfrage über das Hashraster mit dem Durchsuchen aller Thermiken und prüft, dass beide
+// dasselbe Steigen liefern. Aufruf: ThermalFieldBench [Thermiken] [Abfragen]; ohne Angaben 10000 Thermiken
+// über 100 × 100 km.
+namespace
+{
+	double Nanoseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t thermalCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 10000;
+	uint32_t queryCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 1 << 20;
+	if (thermalCount == 0 || queryCount == 0)
+	{
+		std::fprintf(stderr, "usage: ThermalFieldBench [thermals] [queries]\n");
+		return 2;
+	}
+
+	const float halfExtent = 50000.0f;
+	ThermalField field;
+	field.Populate(0.0f, 0.0f, halfExtent, thermalCount, ThermalClimate(), 7);
+	field.SetWind(2.0f, 4.0f);
+	field.Update(1.0f);
+
+	// Flugzeuge zwischen 200 und 1600 m über welligem Gelände.
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+	std::uniform_real_distribution<float> height(200.0f, 1600.0f);
+	std::vector<float> north(queryCount), east(queryCount), down(queryCount), ground(queryCount), velocity(queryCount, 0.0f);
+	for (uint32_t i = 0; i < queryCount; i++)
+	{
+		north[i] = position(random);
+		east[i] = position(random);
+		ground[i] = 300.0f + 200.0f * std::sin(north[i] * 1.0e-3f) * std::cos(east[i] * 1.0e-3f);
+		down[i] = -(ground[i] + height(random));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	field.Sample(north.data(), east.data(), down.data(), ground.data(), queryCount, velocity.data());
+	double grid = Nanoseconds(start) / queryCount;
+
+	// Das Durchsuchen aller Thermiken ist um Größenordnungen langsamer; ein Teil der Abfragen genügt.
+	uint32_t bruteCount = std::min(queryCount, std::max(1u, 20000000u / thermalCount));
+	std::vector<float> bruteLift(bruteCount);
+	start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < bruteCount; i++)
+	{
+		bruteLift[i] = field.SampleBruteForce(north[i], east[i], down[i], ground[i]);
+	}
+	double brute = Nanoseconds(start) / bruteCount;
+
+	uint32_t mismatches = 0;
+	uint32_t lifting = 0;
+	for (uint32_t i = 0; i < bruteCount; i++)
+	{
+		mismatches += std::fabs(-velocity[i] - bruteLift[i]) > 1.0e-4f ? 1 : 0;
+		lifting += bruteLift[i] > 0.1f ? 1 : 0;
+	}
+	CHECK(mismatches == 0);
+	CHECK(lifting > 0);
+
+	std::printf("%u thermals, cell %.0f m: grid %.1f ns, brute force %.1f ns per query (%.0fx), %u of %u checked queries in lift\n",
+		field.GetCount(), field.GetCellSize(), grid, brute, brute / grid, lifting, bruteCount);
+
+	start = std::chrono::steady_clock::now();
+	const uint32_t updates = 100;
+	for (uint32_t i = 0; i < updates; i++)
+	{
+		field.Update(0.02f);
+	}
+	std::printf("update: %.1f us per step\n", Nanoseconds(start) / updates / 1000.0);
+
+	return Test::RunTests("ThermalFieldBench");
+}
@@ -0,0 +1,185 @@
+﻿#include "Common/TripleBuffer.h"
+#include "Simulation/SimulationWorker.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "TestSupport.h"
+
+using namespace DX;
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	// Groß genug, dass ein zerrissener Puffer auffällt.
+	struct Payload
+	{
+		uint64_t sequence;
+		uint64_t values[31];
+	};
+
+	void Fill(Payload& payload, uint64_t sequence)
+	{
+		payload.sequence = sequence;
+		for (uint64_t& value : payload.values)
+		{
+			value = sequence;
+		}
+	}
+
+	bool IsConsistent(const Payload& payload)
+	{
+		for (uint64_t value : payload.values)
+		{
+			if (value != payload.sequence)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void TestPublishAndAcquire()
+	{
+		TripleBuffer<Payload> buffer;
+		CHECK(!buffer.Acquire());
+
+		Fill(buffer.GetWriteBuffer(), 1);
+		buffer.Publish();
+		CHECK(buffer.Acquire());
+		CHECK(buffer.GetReadBuffer().sequence == 1);
+		CHECK(!buffer.Acquire());
+
+		// Der Leser erhält nur den neuesten von mehreren Ständen.
+		Fill(buffer.GetWriteBuffer(), 2);
+		buffer.Publish();
+		Fill(buffer.GetWriteBuffer(), 3);
+		buffer.Publish();
+		CHECK(buffer.Acquire());
+		CHECK(buffer.GetReadBuffer().sequence == 3);
+		CHECK(IsConsistent(buffer.GetReadBuffer()));
+	}
+
+	// Schreiber und Leser laufen gleichzeitig; der Leser sieht nur vollständige Stände in steigender Folge.
+	void TestConcurrentReaderSeesCompleteStates()
+	{
+		TripleBuffer<Payload> buffer;
+		std::atomic<bool> done(false);
+		const uint64_t publishes = 2000000;
+
+		std::thread writer([&]()
+		{
+			for (uint64_t sequence = 1; sequence <= publishes; sequence++)
+			{
+				Fill(buffer.GetWriteBuffer(), sequence);
+				buffer.Publish();
+			}
+			done.store(true, std::memory_order_release);
+		});
+
+		uint64_t last = 0;
+		uint64_t acquired = 0;
+		bool consistent = true;
+		bool ordered = true;
+		while (!done.load(std::memory_order_acquire) || last < publishes)
+		{
+			if (buffer.Acquire())
+			{
+				const Payload& payload = buffer.GetReadBuffer();
+				consistent = consistent && IsConsistent(payload);
+				ordered = ordered && payload.sequence > last;
+				last = payload.sequence;
+				acquired++;
+			}
+		}
+		writer.join();
+
+		CHECK(consistent);
+		CHECK(ordered);
+		CHECK(last == publishes);
+		std::printf("TripleBuffer: reader acquired %llu of %llu states\n", static_cast<unsigned long long>(acquired),
+			static_cast<unsigned long long>(publishes));
+	}
+
+	// Hält der Leser seinen Puffer lange fest, veröffentlicht der Schreiber trotzdem ungebremst weiter.
+	void TestWriterNeverWaitsForReader()
+	{
+		TripleBuffer<Payload> buffer;
+		Fill(buffer.GetWriteBuffer(), 1);
+		buffer.Publish();
+		CHECK(buffer.Acquire());
+
+		std::atomic<uint64_t> published(1);
+		std::atomic<bool> stop(false);
+		std::thread writer([&]()
+		{
+			for (uint64_t sequence = 2; !stop.load(std::memory_order_relaxed); sequence++)
+			{
+				Fill(buffer.GetWriteBuffer(), sequence);
+				buffer.Publish();
+				published.store(sequence, std::memory_order_relaxed);
+			}
+		});
+
+		// Der Leser ruft Acquire während der Pause nicht auf; sein Puffer muss unverändert bleiben.
+		uint64_t before = published.load();
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		uint64_t during = published.load() - before;
+		CHECK(during > 1000);
+		CHECK(buffer.GetReadBuffer().sequence == 1);
+		CHECK(IsConsistent(buffer.GetReadBuffer()));
+
+		stop.store(true);
+		writer.join();
+
+		CHECK(buffer.Acquire());
+		CHECK(buffer.GetReadBuffer().sequence == published.load());
+		std::printf("TripleBuffer: %llu publishes while the reader held its buffer\n", static_cast<unsigned long long>(during));
+	}
+
+	// Mit einer synthetischen Uhr: jeder Schnappschuss enthält zwei aufeinanderfolgende Schritte.
+	void TestSimulationWorkerSnapshots()
+	{
+		SimulationWorker worker([](const StepTimer&, SimulationState&) {}, 500, 8);
+		auto clock = std::make_shared<ManualClock>();
+		worker.SetClock(clock);
+
+		for (int frame = 0; frame < 1000; frame++)
+		{
+			clock->AdvanceTicks(StepTimer::TicksPerSecond / 500);
+			worker.Tick();
+
+			const SimulationSnapshot& snapshot = worker.AcquireLatestSnapshot();
+			CHECK(snapshot.current.stepCount == static_cast<uint64_t>(frame + 1));
+			CHECK(snapshot.current.stepCount == snapshot.previous.stepCount + 1);
+		}
+	}
+
+	// Der eigene Thread der Simulation läuft, während der Leser ständig Schnappschüsse übernimmt.
+	void TestSimulationWorkerThread()
+	{
+		SimulationWorker worker([](const StepTimer&, SimulationState&) {}, 1000, 8);
+		worker.Start();
+
+		uint64_t last = 0;
+		bool ordered = true;
+		auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+		while (std::chrono::steady_clock::now() < end)
+		{
+			const SimulationSnapshot& snapshot = worker.AcquireLatestSnapshot();
+			ordered = ordered && snapshot.current.stepCount >= last &&
+				(snapshot.current.stepCount == 0 || snapshot.current.stepCount == snapshot.previous.stepCount + 1);
+			last = snapshot.current.stepCount;
+		}
+		worker.Stop();
+
+		CHECK(ordered);
+		CHECK(last > 0);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("TripleBufferTests", TestPublishAndAcquire, TestConcurrentReaderSeesCompleteStates, TestWriterNeverWaitsForReader,
+		TestSimulationWorkerSnapshots, TestSimulationWorkerThread);
+}
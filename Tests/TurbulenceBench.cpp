@@ -0,0 +1,69 @@
+﻿#include "Simulation/FlightDynamics.h"
+#include "Simulation/Turbulence.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+// Böenschritte je Sekunde von Turbulence::Step für 1, 64 und 1024 Segelflugzeuge bei 120 Schritten je
+// Sekunde, verteilt über verschiedene Höhen und damit Filterstufen. Die Flotte wird nicht fortgeschrieben;
+// gemessen wird nur das Fortschreiben der Böenfilter samt Zufallszahlen. Aufruf: TurbulenceBench
+// [Millionen Böenschritte je Flottengröße].
+namespace
+{
+	const float StepSeconds = 1.0f / 120.0f;
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double millions = argc > 1 ? std::atof(argv[1]) : 50.0;
+	if (!(millions > 0.0))
+	{
+		std::fprintf(stderr, "usage: TurbulenceBench [million gust-steps per fleet size]\n");
+		return 2;
+	}
+
+	static const uint32_t fleetSizes[] = { 1, 64, 1024 };
+	for (uint32_t count : fleetSizes)
+	{
+		GliderFleet fleet((GliderParameters()));
+		for (uint32_t i = 0; i < count; i++)
+		{
+			fleet.Add(GliderInitialState::Level(0.0f, 100.0f * i, 50.0f + (i * 37) % 1000, 0.0f, 0.0f, 25.0f + i % 20));
+		}
+		fleet.Step(StepSeconds);
+
+		Turbulence turbulence(1);
+		uint32_t steps = static_cast<uint32_t>(millions * 1.0e6 / count) + 1;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t step = 0; step < steps; step++)
+		{
+			turbulence.Step(StepSeconds, fleet);
+		}
+		double elapsed = Seconds(start);
+
+		// Die Böen summieren sich ohne Fortschreiben der Flotte auf, bleiben aber endlich.
+		uint32_t finite = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			finite += std::isfinite(fleet.GetField(GliderFleet::AirVelocityD)[i]) ? 1 : 0;
+		}
+
+		std::printf("%4u gliders (%4u lanes): %u steps in %.2f s, %.1fM gust-steps/s, %.1f ns per gust-step\n",
+			count, fleet.GetPaddedCount(), steps, elapsed, static_cast<double>(steps) * count / elapsed / 1.0e6,
+			elapsed * 1.0e9 / (static_cast<double>(steps) * count));
+
+		CHECK(turbulence.GetStepCount() == steps);
+		CHECK(finite == count);
+	}
+
+	return Test::RunTests("TurbulenceBench");
+}
@@ -0,0 +1,193 @@
+﻿#include "Simulation/FlightDynamics.h"
+#include "Simulation/Turbulence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	const float StepSeconds = 1.0f / 120.0f;
+	const uint32_t Axes = 3;
+
+	// Flotte in fester Höhe über Grund und mit fester Fluggeschwindigkeit nach Norden. Die Flotte selbst
+	// wird nicht fortgeschrieben, Höhen- und Geschwindigkeitsstufe bleiben damit gleich.
+	void Populate(GliderFleet& fleet, uint32_t count, float height, float airspeed)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			fleet.Add(GliderInitialState::Level(0.0f, 100.0f * i, height, 0.0f, 0.0f, airspeed));
+		}
+		for (uint32_t i = 0; i < fleet.GetPaddedCount(); i++)
+		{
+			fleet.GetField(GliderFleet::PositionD)[i] = -height;
+			fleet.GetField(GliderFleet::GroundHeight)[i] = 0.0f;
+			fleet.GetField(GliderFleet::Airspeed)[i] = airspeed;
+			fleet.GetField(GliderFleet::VelocityN)[i] = airspeed;
+			fleet.GetField(GliderFleet::VelocityE)[i] = 0.0f;
+		}
+	}
+
+	// Einen Schritt rechnen und nur die Böen zurücklassen: längs nach Nord, quer nach Ost, vertikal nach unten.
+	void StepGusts(Turbulence& turbulence, GliderFleet& fleet)
+	{
+		static const GliderFleet::Field fields[Axes] = { GliderFleet::AirVelocityN, GliderFleet::AirVelocityE, GliderFleet::AirVelocityD };
+		for (GliderFleet::Field field : fields)
+		{
+			std::fill(fleet.GetField(field), fleet.GetField(field) + fleet.GetPaddedCount(), 0.0f);
+		}
+		turbulence.Step(StepSeconds, fleet);
+	}
+
+	// Autokorrelation des Dryden-Modells: erste Ordnung längs, (1 - τ / 2T) e^(-τ / T) quer und vertikal.
+	double ModelCorrelation(uint32_t axis, double lag, double timeConstant)
+	{
+		double decay = std::exp(-lag / timeConstant);
+		return axis == 0 ? decay : (1.0 - lag / (2.0 * timeConstant)) * decay;
+	}
+
+	// Eine Stunde für 64 Flugzeuge in 300 m Höhe: Standardabweichung und Autokorrelation bei T/2, T und 2T
+	// stimmen mit dem Modell überein, das GetModel für diese Stufe angibt.
+	void TestStatisticsMatchModel()
+	{
+		const uint32_t count = 64;
+		const float height = 300.0f;
+		const float airspeed = 30.0f;
+		const uint32_t lagCount = 3;
+		const double lagFactors[lagCount] = { 0.5, 1.0, 2.0 };
+
+		GliderFleet fleet((GliderParameters()));
+		Populate(fleet, count, height, airspeed);
+		Turbulence turbulence(3);
+
+		float sigma[Axes], timeConstant[Axes];
+		turbulence.GetModel(height, airspeed, sigma, timeConstant);
+
+		uint32_t lags[Axes][lagCount];
+		uint32_t history = 0;
+		for (uint32_t axis = 0; axis < Axes; axis++)
+		{
+			for (uint32_t lag = 0; lag < lagCount; lag++)
+			{
+				lags[axis][lag] = static_cast<uint32_t>(lagFactors[lag] * timeConstant[axis] / StepSeconds + 0.5);
+				history = std::max(history, lags[axis][lag] + 1);
+			}
+		}
+
+		// Einschwingen über zehn Zeitkonstanten, danach eine Stunde auswerten.
+		const uint32_t settle = static_cast<uint32_t>(10.0f * std::max(timeConstant[0], timeConstant[2]) / StepSeconds);
+		const uint32_t steps = 3600 * 120;
+		const GliderFleet::Field fields[Axes] = { GliderFleet::AirVelocityN, GliderFleet::AirVelocityE, GliderFleet::AirVelocityD };
+
+		std::vector<float> ring(static_cast<size_t>(Axes) * count * history);
+		double sum[Axes] = {}, squares[Axes] = {}, products[Axes][lagCount] = {};
+		uint64_t pairs[Axes][lagCount] = {};
+		for (uint32_t step = 0; step < settle + steps; step++)
+		{
+			StepGusts(turbulence, fleet);
+			if (step < settle)
+			{
+				continue;
+			}
+
+			uint32_t t = step - settle;
+			for (uint32_t axis = 0; axis < Axes; axis++)
+			{
+				const float* gusts = fleet.GetField(fields[axis]);
+				for (uint32_t i = 0; i < count; i++)
+				{
+					float* past = &ring[(static_cast<size_t>(axis) * count + i) * history];
+					double x = gusts[i];
+					sum[axis] += x;
+					squares[axis] += x * x;
+					for (uint32_t lag = 0; lag < lagCount; lag++)
+					{
+						if (t >= lags[axis][lag])
+						{
+							products[axis][lag] += x * past[(t - lags[axis][lag]) % history];
+							pairs[axis][lag]++;
+						}
+					}
+					past[t % history] = gusts[i];
+				}
+			}
+		}
+
+		for (uint32_t axis = 0; axis < Axes; axis++)
+		{
+			double samples = static_cast<double>(steps) * count;
+			double mean = sum[axis] / samples;
+			double variance = squares[axis] / samples - mean * mean;
+			double deviation = std::sqrt(variance);
+			std::printf("axis %u: sigma %.3f (model %.3f), T %.2f s, correlation", axis, deviation, sigma[axis], timeConstant[axis]);
+			CHECK(std::abs(deviation - sigma[axis]) < 0.03 * sigma[axis]);
+
+			for (uint32_t lag = 0; lag < lagCount; lag++)
+			{
+				double correlation = (products[axis][lag] / pairs[axis][lag] - mean * mean) / variance;
+				double model = ModelCorrelation(axis, lags[axis][lag] * StepSeconds, timeConstant[axis]);
+				std::printf(" %.3f (%.3f)", correlation, model);
+				CHECK(std::abs(correlation - model) < 0.03);
+			}
+			std::printf("\n");
+		}
+	}
+
+	// Derselbe Startwert ergibt dieselben Böen, ein anderer andere; jedes Flugzeug erhält eigenes Rauschen.
+	void TestSeedReproducesGusts()
+	{
+		GliderFleet first((GliderParameters()));
+		GliderFleet second((GliderParameters()));
+		GliderFleet other((GliderParameters()));
+		Populate(first, 8, 500.0f, 25.0f);
+		Populate(second, 8, 500.0f, 25.0f);
+		Populate(other, 8, 500.0f, 25.0f);
+
+		Turbulence a(11), b(11), c(12);
+		for (uint32_t step = 0; step < 600; step++)
+		{
+			StepGusts(a, first);
+			StepGusts(b, second);
+			StepGusts(c, other);
+		}
+
+		const float* gustsA = first.GetField(GliderFleet::AirVelocityD);
+		const float* gustsB = second.GetField(GliderFleet::AirVelocityD);
+		const float* gustsC = other.GetField(GliderFleet::AirVelocityD);
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			CHECK(gustsA[i] == gustsB[i]);
+			CHECK(gustsA[i] != gustsC[i]);
+			CHECK(i == 0 || gustsA[i] != gustsA[0]);
+		}
+		CHECK(a.GetStepCount() == 600);
+	}
+
+	// Das Modell: σ wächst bodennah mit der Höhe bis zum Wert für große Höhen, T = L / V.
+	void TestModel()
+	{
+		Turbulence turbulence(1, 7.7f, 1.5f);
+		float sigma[Axes], timeConstant[Axes];
+
+		turbulence.GetModel(1000.0f, 50.0f, sigma, timeConstant);
+		for (uint32_t axis = 0; axis < Axes; axis++)
+		{
+			CHECK(std::abs(sigma[axis] - 1.5f) < 1.0e-5f);
+			CHECK(std::abs(timeConstant[axis] - 1750.0f * 0.3048f / 50.0f) < 1.0e-4f);
+		}
+
+		turbulence.GetModel(50.0f, 25.0f, sigma, timeConstant);
+		CHECK(std::abs(sigma[2] - 0.77f) < 1.0e-5f);
+		CHECK(sigma[0] == sigma[1] && sigma[0] > sigma[2]);
+		CHECK(std::abs(timeConstant[2] - 50.0f / 25.0f) < 1.0e-4f);
+		CHECK(timeConstant[0] > timeConstant[2]);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("TurbulenceTests", TestModel, TestSeedReproducesGusts, TestStatisticsMatchModel);
+}
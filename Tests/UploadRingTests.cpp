@@ -0,0 +1,195 @@
+﻿#include "Common/UploadRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+using namespace DX;
+
+namespace
+{
+	void TestConstruction()
+	{
+		CHECK_THROWS(UploadRing(1000, 256), std::invalid_argument);
+		CHECK_THROWS(UploadRing(1024, 100), std::invalid_argument);
+		CHECK_THROWS(UploadRing(0, 256), std::invalid_argument);
+
+		UploadRing ring(1024, 256);
+		CHECK_THROWS(ring.Allocate(16), std::logic_error);
+	}
+
+	void TestAlignment()
+	{
+		std::vector<uint8_t> memory(1024);
+		UploadRing ring(1024, 256);
+		ring.SetMemory(memory.data(), memory.data());
+
+		UploadAllocation first = ring.Allocate(16);
+		UploadAllocation second = ring.Allocate(300);
+		CHECK(first.IsValid() && first.offset == 0 && first.data == memory.data());
+		CHECK(second.IsValid() && second.offset == 256 && second.size == 300);
+		CHECK(!ring.Allocate(0).IsValid());
+		CHECK(!ring.Allocate(2000).IsValid());
+		CHECK(ring.GetStatistics().failedAllocations == 2);
+	}
+
+	// Ein Ausschnitt, der nicht mehr vor das Ende passt, beginnt am Anfang, sobald dort frei ist.
+	void TestWrapAtEnd()
+	{
+		std::vector<uint8_t> memory(1024);
+		UploadRing ring(1024, 256);
+		ring.SetMemory(memory.data(), memory.data());
+
+		CHECK(ring.Allocate(512).offset == 0);
+		ring.EndFrame(1);
+		CHECK(ring.Allocate(256).offset == 512);
+		ring.EndFrame(2);
+		ring.Retire(1);
+
+		UploadAllocation wrapped = ring.Allocate(512);
+		CHECK(wrapped.IsValid() && wrapped.offset == 0);
+		CHECK(ring.GetStatistics().wraps == 1);
+		CHECK(wrapped.offset + wrapped.size <= ring.GetCapacity());
+
+		// Das übersprungene Ende zählt zum belegten Speicher, bis sein Frame freigegeben ist.
+		CHECK(ring.GetStatistics().usedBytes == 1024);
+	}
+
+	// Holt der Kopf noch benutzte Daten ein, schlägt Allocate fehl, statt sie zu überschreiben.
+	void TestOverrunRefused()
+	{
+		std::vector<uint8_t> memory(1024);
+		UploadRing ring(1024, 256);
+		ring.SetMemory(memory.data(), memory.data());
+
+		CHECK(ring.Allocate(768).IsValid());
+		ring.EndFrame(1);
+		CHECK(ring.Allocate(256).offset == 768);
+		CHECK(!ring.Allocate(16).IsValid());
+		ring.EndFrame(2);
+		CHECK(!ring.Allocate(16).IsValid());
+		CHECK(ring.GetStatistics().failedAllocations == 2);
+
+		ring.Retire(1);
+		UploadAllocation reused = ring.Allocate(768);
+		CHECK(reused.IsValid() && reused.offset == 0);
+		CHECK(!ring.Allocate(16).IsValid());
+	}
+
+	// Retire gibt Frames nur in Fence-Reihenfolge und nur bis zum erreichten Wert frei.
+	void TestRetireFollowsFences()
+	{
+		std::vector<uint8_t> memory(1024);
+		UploadRing ring(1024, 256);
+		ring.SetMemory(memory.data(), memory.data());
+
+		for (uint64_t fence = 10; fence <= 30; fence += 10)
+		{
+			CHECK(ring.Allocate(256).IsValid());
+			ring.EndFrame(fence);
+		}
+		CHECK(ring.GetStatistics().framesInFlight == 3);
+		CHECK_THROWS(ring.EndFrame(30), std::invalid_argument);
+
+		ring.Retire(9);
+		CHECK(ring.GetStatistics().framesInFlight == 3 && ring.GetStatistics().usedBytes == 768);
+		ring.Retire(15);
+		CHECK(ring.GetStatistics().framesInFlight == 2 && ring.GetStatistics().usedBytes == 512);
+
+		// Ein älterer Wert gibt nichts mehr frei.
+		ring.Retire(10);
+		CHECK(ring.GetStatistics().framesInFlight == 2);
+		ring.Retire(30);
+		CHECK(ring.GetStatistics().framesInFlight == 0 && ring.GetStatistics().usedBytes == 0);
+
+		CHECK(ring.Allocate(256).IsValid());
+		ring.Reset();
+		CHECK(ring.GetStatistics().usedBytes == 0);
+	}
+
+	// Viele Frames mit zufälligen Größen und zwei Frames Verzögerung der GPU.
+	void TestLongRun()
+	{
+		const uint32_t capacity = 4096;
+		std::vector<uint8_t> memory(capacity);
+		UploadRing ring(capacity, 256);
+		ring.SetMemory(memory.data(), memory.data());
+
+		uint32_t seed = 1;
+		for (uint64_t frame = 1; frame < 20000; frame++)
+		{
+			if (frame > 3)
+			{
+				ring.Retire(frame - 3);
+			}
+			for (int i = 0; i < 5; i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				uint32_t size = 16 + (seed >> 16) % 400;
+				UploadAllocation allocation = ring.Allocate(size);
+				if (allocation.IsValid())
+				{
+					CHECK(allocation.offset % 256 == 0 && allocation.offset + size <= capacity);
+				}
+			}
+			ring.EndFrame(frame);
+			CHECK(ring.GetStatistics().usedBytes <= capacity);
+		}
+		CHECK(ring.GetStatistics().wraps > 0);
+	}
+
+	// Parallel aufzeichnende Durchgänge dürfen keine überlappenden Ausschnitte erhalten.
+	void TestConcurrentAllocate()
+	{
+		const uint32_t threadCount = 4;
+		const uint32_t perThread = 64;
+		std::vector<uint8_t> memory(threadCount * perThread * 256);
+		UploadRing ring(static_cast<uint32_t>(memory.size()), 256);
+		ring.SetMemory(memory.data(), memory.data());
+
+		std::vector<std::vector<uint32_t>> offsets(threadCount);
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			threads.emplace_back([&ring, &offsets, i]()
+			{
+				for (uint32_t k = 0; k < perThread; k++)
+				{
+					UploadAllocation allocation = ring.Allocate(200);
+					if (allocation.IsValid())
+					{
+						offsets[i].push_back(allocation.offset);
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		std::vector<uint32_t> all;
+		for (const std::vector<uint32_t>& list : offsets)
+		{
+			all.insert(all.end(), list.begin(), list.end());
+		}
+		std::sort(all.begin(), all.end());
+		CHECK(all.size() == threadCount * perThread);
+		CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+		CHECK(ring.GetStatistics().allocations == threadCount * perThread);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("UploadRingTests",
+		TestConstruction,
+		TestAlignment,
+		TestWrapAtEnd,
+		TestOverrunRefused,
+		TestRetireFollowsFences,
+		TestLongRun,
+		TestConcurrentAllocate);
+}
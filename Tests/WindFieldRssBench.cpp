@@ -0,0 +1,126 @@
+﻿#include "Simulation/WindField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include "TestSupport.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace Open_Glider_Simulator;
+
+// Erzeugt ein Windgitter und fliegt ein Flugzeug quer darüber, während die Simulationszeit durch alle
+// Zeitscheiben läuft. Gemessen wird der belegte Hauptspeicher (RSS): Er darf nicht mit der Dateigröße wachsen,
+// sondern nur um die Kacheln entlang des Flugwegs. Aufruf: WindFieldRssBench [Gitterpunkte je Achse] [Zeitscheiben].
+// Ohne Angaben entsteht eine Datei von gut 4 GB.
+namespace
+{
+	const char* const TempPath = "WindFieldRssBench.ogwf";
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Belegter Hauptspeicher in MB; 0, wo das System ihn nicht einfach liefert.
+	double GetResidentMegabytes()
+	{
+#if defined(__linux__)
+		std::ifstream statm("/proc/self/statm");
+		unsigned long size = 0;
+		unsigned long resident = 0;
+		statm >> size >> resident;
+		return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#else
+		return 0.0;
+#endif
+	}
+
+	void Wind(float north, float east, float altitude, float time, float velocity[3])
+	{
+		velocity[0] = 5.0f * std::sin(north * 1.0e-4f + time * 1.0e-3f);
+		velocity[1] = 5.0f * std::cos(east * 1.0e-4f);
+		velocity[2] = -altitude * 1.0e-3f;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t count = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1024;
+	uint32_t sliceCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 16;
+	if (count < 2 || count > WindField::MaxAxisCount || sliceCount < 2 || sliceCount > WindField::MaxSliceCount)
+	{
+		std::fprintf(stderr, "usage: WindFieldRssBench [grid points per axis] [slices]\n");
+		return 2;
+	}
+
+	WindGridDescription description = {};
+	description.countN = count;
+	description.countE = count;
+	description.levelCount = 32;
+	description.sliceCount = sliceCount;
+	description.spacing = 500.0f;
+	description.levelSpacing = 200.0f;
+	description.sliceSeconds = 3600.0f;
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		std::ofstream stream(TempPath, std::ios::binary | std::ios::trunc);
+		WindField::Write(stream, description, Wind);
+		CHECK(stream.good());
+	}
+	std::ifstream written(TempPath, std::ios::binary | std::ios::ate);
+	double fileMegabytes = static_cast<double>(written.tellg()) / (1024.0 * 1024.0);
+	double sliceMegabytes = fileMegabytes / sliceCount;
+	std::printf("grid %u x %u x %u, %u slices: %.0f MB written in %.1f s\n", count, count, description.levelCount, sliceCount,
+		fileMegabytes, Milliseconds(start) / 1000.0);
+
+	WindField field;
+	std::string path = TempPath;
+	field.Open(std::wstring(path.begin(), path.end()));
+	double baseline = GetResidentMegabytes();
+
+	// Ein Flug diagonal über das Gitter in festen Schritten, steigend und sinkend; zwischendurch wird der
+	// Speicher gemessen. Der Flug dauert alle Zeitscheiben, damit jede einmal eingeblendet wird.
+	const float extent = (count - 1) * description.spacing;
+	const float duration = (sliceCount - 1) * description.sliceSeconds;
+	const uint32_t steps = 200000;
+	const uint32_t reports = 8;
+	double peak = baseline;
+	float check = 0.0f;
+	start = std::chrono::steady_clock::now();
+	for (uint32_t step = 0; step <= steps; step++)
+	{
+		float fraction = static_cast<float>(step) / steps;
+		field.SetTime(fraction * duration);
+
+		float velocity[3];
+		field.Sample(fraction * extent, fraction * extent, -1000.0f - 800.0f * std::sin(fraction * 40.0f), velocity);
+		check += velocity[0] + velocity[1] + velocity[2];
+
+		if (step % (steps / reports) == 0)
+		{
+			double resident = GetResidentMegabytes();
+			peak = std::max(peak, resident);
+			std::printf("  t %6.0f s: RSS %.1f MB\n", fraction * duration, resident);
+		}
+	}
+	double elapsed = Milliseconds(start);
+	field.Close();
+	std::remove(TempPath);
+
+	// Ohne Einblenden nach Bedarf läge jede Zeitscheibe ganz im Speicher. Erlaubt ist ein Achtel der beiden
+	// eingeblendeten Scheiben; tatsächlich braucht der Flugweg nur wenige MB.
+	double growth = peak - baseline;
+	std::printf("RSS: baseline %.1f MB, peak %.1f MB (+%.1f MB) for a %.0f MB file, %.0f ns per step (%.1f)\n",
+		baseline, peak, growth, fileMegabytes, elapsed * 1.0e6 / steps, check);
+	CHECK(growth <= std::max(sliceMegabytes / 4.0, 8.0));
+
+	return Test::RunTests("WindFieldRssBench");
+}
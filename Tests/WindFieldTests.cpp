@@ -0,0 +1,165 @@
+﻿#include "Simulation/WindField.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "TestSupport.h"
+
+using namespace Open_Glider_Simulator;
+
+namespace
+{
+	const char* const TempPath = "WindFieldTests.ogwf";
+
+	// Lage der Anzahlen im Dateikopf: nach Kennung und Version folgt die Beschreibung.
+	const size_t CountNOffset = 8;
+	const size_t SliceCountOffset = 20;
+
+	WindGridDescription GetDescription()
+	{
+		WindGridDescription description = {};
+		description.countN = 20;
+		description.countE = 18;
+		description.levelCount = 4;
+		description.sliceCount = 3;
+		description.spacing = 100.0f;
+		description.levelSpacing = 50.0f;
+		description.sliceSeconds = 10.0f;
+		return description;
+	}
+
+	// Linear in allen Richtungen, damit die Interpolation exakt bleibt.
+	void LinearWind(float north, float east, float altitude, float time, float velocity[3])
+	{
+		velocity[0] = north * 0.001f + time * 0.1f;
+		velocity[1] = east * 0.002f;
+		velocity[2] = -altitude * 0.01f;
+	}
+
+	std::string MakeFile(const WindGridDescription& description)
+	{
+		std::ostringstream stream;
+		WindField::Write(stream, description, LinearWind);
+		return stream.str();
+	}
+
+	void WriteFile(const std::string& bytes)
+	{
+		std::ofstream stream(TempPath, std::ios::binary | std::ios::trunc);
+		stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	void Patch(std::string& bytes, size_t offset, uint32_t value)
+	{
+		std::memcpy(&bytes[offset], &value, sizeof(value));
+	}
+
+	std::wstring GetPath()
+	{
+		std::string path = TempPath;
+		return std::wstring(path.begin(), path.end());
+	}
+
+	bool Near(float a, float b)
+	{
+		return std::fabs(a - b) < 0.02f;
+	}
+
+	void TestUniformWithoutFile()
+	{
+		WindField field;
+		field.SetUniform(1.0f, 2.0f, 3.0f);
+		float velocity[3];
+		field.Sample(0.0f, 0.0f, 0.0f, velocity);
+		CHECK(velocity[0] == 1.0f && velocity[1] == 2.0f && velocity[2] == 3.0f);
+	}
+
+	void TestInterpolation()
+	{
+		WriteFile(MakeFile(GetDescription()));
+		WindField field;
+		field.Open(GetPath());
+		CHECK(field.IsOpen());
+
+		field.SetTime(5.0f);
+		float velocity[3];
+		field.Sample(1250.0f, 830.0f, -75.0f, velocity);
+		CHECK(Near(velocity[0], 1.25f + 0.5f));
+		CHECK(Near(velocity[1], 1.66f));
+		CHECK(Near(velocity[2], -0.75f));
+
+		// Außerhalb des Gitters gilt der Randwert.
+		field.SetTime(100.0f);
+		field.Sample(-500.0f, 1.0e6f, -1.0e5f, velocity);
+		CHECK(Near(velocity[0], 2.0f));
+		CHECK(Near(velocity[1], 3.4f));
+		CHECK(Near(velocity[2], -1.5f));
+	}
+
+	void TestNonFiniteQueries()
+	{
+		WriteFile(MakeFile(GetDescription()));
+		WindField field;
+		field.Open(GetPath());
+
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		const float infinity = std::numeric_limits<float>::infinity();
+		float velocity[3];
+		CHECK_THROWS(field.Sample(nan, 0.0f, 0.0f, velocity), std::invalid_argument);
+		CHECK_THROWS(field.Sample(0.0f, infinity, 0.0f, velocity), std::invalid_argument);
+		CHECK_THROWS(field.Sample(0.0f, 0.0f, -infinity, velocity), std::invalid_argument);
+		CHECK_THROWS(field.SetTime(nan), std::invalid_argument);
+	}
+
+	void TestInvalidHeaders()
+	{
+		WindGridDescription tooLarge = GetDescription();
+		tooLarge.countN = WindField::MaxAxisCount + 1;
+		std::ostringstream stream;
+		CHECK_THROWS(WindField::Write(stream, tooLarge, LinearWind), std::invalid_argument);
+
+		WindField field;
+		std::string valid = MakeFile(GetDescription());
+
+		// Anzahlen über den Obergrenzen, auch wenn ihr Produkt in 32 Bit überliefe.
+		std::string bytes = valid;
+		Patch(bytes, CountNOffset, 0x80000000u);
+		WriteFile(bytes);
+		CHECK_THROWS(field.Open(GetPath()), std::runtime_error);
+		CHECK(!field.IsOpen());
+
+		bytes = valid;
+		Patch(bytes, SliceCountOffset, WindField::MaxSliceCount + 1);
+		WriteFile(bytes);
+		CHECK_THROWS(field.Open(GetPath()), std::runtime_error);
+
+		// Gültige Anzahlen, deren Zeitscheiben weit über das Dateiende reichen.
+		bytes = valid;
+		Patch(bytes, CountNOffset, WindField::MaxAxisCount);
+		Patch(bytes, CountNOffset + 4, WindField::MaxAxisCount);
+		Patch(bytes, CountNOffset + 8, WindField::MaxLevelCount);
+		Patch(bytes, SliceCountOffset, WindField::MaxSliceCount);
+		WriteFile(bytes);
+		CHECK_THROWS(field.Open(GetPath()), std::runtime_error);
+
+		WriteFile(valid.substr(0, valid.size() - 1));
+		CHECK_THROWS(field.Open(GetPath()), std::runtime_error);
+		CHECK(!field.IsOpen());
+
+		WriteFile(valid);
+		field.Open(GetPath());
+		CHECK(field.IsOpen());
+		field.Close();
+		std::remove(TempPath);
+	}
+}
+
+int main()
+{
+	return Test::RunTests("WindFieldTests", TestUniformWithoutFile, TestInterpolation, TestNonFiniteQueries, TestInvalidHeaders);
+}
@@ -0,0 +1,99 @@
+﻿#include "Common/AssetPack.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace DX;
+
+// Packt Dateien in ein Asset-Archiv, wie es die App als Content.ogp im Installationsordner erwartet.
+// Aufruf: AssetPacker [--lz4] <Archiv> <Datei>...
+// Jede Datei wird unter ihrem Namen ohne Verzeichnis abgelegt, also so, wie die Renderer sie anfordern.
+namespace
+{
+	std::string GetFileName(const std::string& path)
+	{
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? path : path.substr(separator + 1);
+	}
+
+	std::vector<char> ReadFile(const std::string& path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream)
+		{
+			throw std::runtime_error("AssetPacker: " + path + " lässt sich nicht öffnen.");
+		}
+
+		std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		if (stream.bad())
+		{
+			throw std::runtime_error("AssetPacker: " + path + " lässt sich nicht lesen.");
+		}
+		return data;
+	}
+
+	int PrintUsage()
+	{
+		std::fprintf(stderr, "usage: AssetPacker [--lz4] <pack> <file>...\n");
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	AssetCompression compression = AssetCompression::None;
+	int argument = 1;
+	if (argument < argc && std::strcmp(argv[argument], "--lz4") == 0)
+	{
+		compression = AssetCompression::Lz4;
+		argument++;
+	}
+	if (argc - argument < 2)
+	{
+		return PrintUsage();
+	}
+
+	const std::string output = argv[argument++];
+	try
+	{
+		AssetPackWriter writer;
+		size_t inputBytes = 0;
+		for (; argument < argc; argument++)
+		{
+			std::vector<char> data = ReadFile(argv[argument]);
+			writer.Add(GetFileName(argv[argument]), data.data(), data.size(), compression);
+			inputBytes += data.size();
+		}
+
+		// Erst vollständig in eine temporäre Datei schreiben, damit ein Abbruch kein halbes Archiv hinterlässt.
+		const std::string temporary = output + ".tmp";
+		{
+			std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+			writer.Write(stream);
+			stream.flush();
+			if (!stream)
+			{
+				throw std::runtime_error("AssetPacker: " + temporary + " lässt sich nicht schreiben.");
+			}
+		}
+		std::remove(output.c_str());
+		if (std::rename(temporary.c_str(), output.c_str()) != 0)
+		{
+			throw std::runtime_error("AssetPacker: " + output + " lässt sich nicht ersetzen.");
+		}
+
+		std::printf("AssetPacker: %zu assets, %zu bytes -> %s\n", writer.GetAssetCount(), inputBytes, output.c_str());
+	}
+	catch (const std::exception& exception)
+	{
+		std::fprintf(stderr, "%s\n", exception.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+﻿#include "Common/ThreadPool.h"
+#include "Simulation/LiftMap.h"
+#include "Terrain/ProceduralTerrain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+using namespace Open_Glider_Simulator;
+
+// Berechnet Lift Maps für ein quadratisches Gebiet über dem prozeduralen Gelände, wie die App beim Start und
+// bei jedem Wechsel der Windstufe: zuerst die Geländehöhen, dann je eine Karte für Wind aus vier Richtungen.
+// Gemeldet werden die Zeiten, Gitterpunkte je Sekunde, der Speicher je Karte und der stärkste Hang- und
+// Wellenaufwind. Aufruf: LiftMapBake [Kantenlänge in km] [Gitterabstand in m] [Wind in m/s] [Threads].
+namespace
+{
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	int PrintUsage()
+	{
+		std::fprintf(stderr, "usage: LiftMapBake [size km] [spacing m] [wind m/s] [worker threads]\n");
+		return 2;
+	}
+
+	struct LiftExtremes
+	{
+		float	ridge;
+		float	wave;
+		bool	finite;
+	};
+
+	// Stichproben auf einem groben Gitter: 100 m über Grund für den Hangaufwind, 3000 m über Grund für die Welle.
+	LiftExtremes Measure(const LiftMap& map, const ProceduralTerrain& terrain)
+	{
+		const LiftMapRegion& region = map.GetRegion();
+		const uint32_t stride = 4;
+
+		LiftExtremes extremes = { 0.0f, 0.0f, true };
+		for (uint32_t n = 1; n + 1 < region.countN; n += stride)
+		{
+			for (uint32_t e = 1; e + 1 < region.countE; e += stride)
+			{
+				float north = region.originN + n * region.spacing;
+				float east = region.originE + e * region.spacing;
+				float ground = terrain.GetHeight(north, east);
+				float ridge = map.Sample(north, east, -(ground + 100.0f));
+				float wave = map.Sample(north, east, -(ground + 3000.0f));
+				extremes.ridge = std::max(extremes.ridge, ridge);
+				extremes.wave = std::max(extremes.wave, wave);
+				extremes.finite = extremes.finite && std::isfinite(ridge) && std::isfinite(wave);
+			}
+		}
+		return extremes;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	float size = argc > 1 ? static_cast<float>(std::atof(argv[1])) * 1000.0f : 100000.0f;
+	float spacing = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 100.0f;
+	float wind = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 10.0f;
+	uint32_t threads = argc > 4 ? static_cast<uint32_t>(std::atoi(argv[4])) : 0;
+	if (!(size >= spacing) || !(spacing > 0.0f) || !(wind >= 0.0f) || argc > 5)
+	{
+		return PrintUsage();
+	}
+
+	try
+	{
+		DX::ThreadPool threadPool(threads);
+		ProceduralTerrain terrain;
+		const ProceduralTerrain& source = terrain;
+		auto heights = [&source](float originN, float originE, float step, uint32_t countN, uint32_t countE, float* values)
+		{
+			source.GetHeights(originN, originE, step, countN, countE, values);
+		};
+
+		uint32_t count = static_cast<uint32_t>(size / spacing) + 1;
+		LiftMapRegion region = { -size / 2.0f, -size / 2.0f, spacing, count, count };
+		double cells = static_cast<double>(count) * count;
+
+		auto start = std::chrono::steady_clock::now();
+		LiftMapBaker baker(threadPool, region, heights);
+		double heightTime = Milliseconds(start);
+
+		std::printf("%.0f x %.0f km at %.0f m: %u x %u cells, %.1f MB per map, %u worker threads\n", size / 1000.0f, size / 1000.0f,
+			spacing, count, count, cells * 16.0 / (1024.0 * 1024.0), threadPool.GetThreadCount());
+		std::printf("terrain heights  %8.1f ms (%.1fM cells/s)\n", heightTime, cells / heightTime / 1000.0);
+
+		// Wind aus Nord, Ost, Süd und West; die Karte speichert den Wind in Richtung der Strömung.
+		static const char* const names[] = { "north", "east", "south", "west" };
+		static const float directions[][2] = { { -1.0f, 0.0f }, { 0.0f, -1.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } };
+		bool finite = true;
+		double total = 0.0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			start = std::chrono::steady_clock::now();
+			std::shared_ptr<const LiftMap> map = baker.Bake(wind * directions[i][0], wind * directions[i][1]);
+			double bakeTime = Milliseconds(start);
+			total += bakeTime;
+
+			LiftExtremes extremes = Measure(*map, terrain);
+			finite = finite && extremes.finite;
+			std::printf("wind from %-5s  %8.1f ms (%.1fM cells/s), strongest ridge lift %.1f m/s, wave %.1f m/s\n", names[i], bakeTime,
+				cells / bakeTime / 1000.0, extremes.ridge, extremes.wave);
+		}
+
+		// Dieselbe Windstufe noch einmal kommt aus dem Zwischenspeicher.
+		start = std::chrono::steady_clock::now();
+		baker.Bake(wind * directions[0][0] + 0.1f, wind * directions[0][1]);
+		std::printf("cached bake      %8.3f ms\n", Milliseconds(start));
+		std::printf("average bake     %8.1f ms\n", total / 4.0);
+
+		return finite ? 0 : 1;
+	}
+	catch (const std::exception& exception)
+	{
+		std::fprintf(stderr, "LiftMapBake: %s\n", exception.what());
+		return 1;
+	}
+}
@@ -0,0 +1,86 @@
+﻿#include "Common/MeshProcessing.h"
+#include "Terrain/TerrainMeshGenerator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <vector>
+
+using namespace Open_Glider_Simulator;
+
+// Zeigt, was Quantisierung und Umsortieren der Indizes beim Geländenetz einer Kachel bringen: Bytes je
+// Scheitelpunkt und je Kachel vorher und nachher, Indexbreite und ACMR des gemeinsamen Indexpuffers für
+// FIFO-Caches verschiedener Größe. Aufruf: MeshReport [Kachelauflösung]; ohne Angabe 65 wie in der App.
+namespace
+{
+	// Scheitelpunkt vor der Quantisierung: Lage, Farbe und Überblendhöhe als float.
+	struct FloatTerrainVertex
+	{
+		float	position[3];
+		float	color[3];
+		float	morphHeight;
+	};
+
+	int PrintUsage()
+	{
+		std::fprintf(stderr, "usage: MeshReport [tile resolution]\n");
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t resolution = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 65;
+	if (argc > 2)
+	{
+		return PrintUsage();
+	}
+
+	try
+	{
+		TerrainPyramidDescription description = {};
+		description.size = 1000.0f;
+		description.levelCount = 1;
+		description.resolution = resolution;
+		description.geometricError.assign(1, 0.0f);
+		TerrainMeshGenerator generator(description);
+
+		const uint32_t vertexCount = generator.GetVertexCount();
+		std::vector<uint32_t> original;
+		generator.GenerateTriangles(original);
+		std::vector<uint32_t> optimized = original;
+
+		auto start = std::chrono::steady_clock::now();
+		DX::Mesh::OptimizeVertexCache(optimized.data(), optimized.size(), vertexCount);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		DX::Mesh::PackedIndices packed;
+		generator.GenerateIndices(packed);
+
+		std::printf("tile %u x %u with skirts: %u vertices, %zu triangles\n", resolution, resolution, vertexCount, original.size() / 3);
+		std::printf("vertex:  %2zu -> %2zu bytes, %7.1f -> %7.1f KB per tile\n", sizeof(FloatTerrainVertex), sizeof(TerrainVertex),
+			vertexCount * sizeof(FloatTerrainVertex) / 1024.0, vertexCount * sizeof(TerrainVertex) / 1024.0);
+		std::printf("index:   %2zu -> %2u bytes, %7.1f -> %7.1f KB shared by all tiles\n", sizeof(uint32_t), packed.is32Bit ? 4u : 2u,
+			original.size() * sizeof(uint32_t) / 1024.0, packed.data.size() / 1024.0);
+
+		static const uint32_t cacheSizes[] = { 8, 16, 24, 32 };
+		bool improved = true;
+		for (uint32_t cacheSize : cacheSizes)
+		{
+			float before = DX::Mesh::ComputeAcmr(original.data(), original.size(), vertexCount, cacheSize);
+			float after = DX::Mesh::ComputeAcmr(optimized.data(), optimized.size(), vertexCount, cacheSize);
+			std::printf("ACMR with a %2u-entry FIFO: %.3f -> %.3f\n", cacheSize, before, after);
+			improved = improved && after <= before;
+		}
+		std::printf("reordering took %.2f ms\n", milliseconds);
+
+		// Das Umsortieren darf den Cache in keiner Größe schlechter nutzen als die Reihenfolge des Gitters.
+		return improved ? 0 : 1;
+	}
+	catch (const std::exception& exception)
+	{
+		std::fprintf(stderr, "MeshReport: %s\n", exception.what());
+		return 1;
+	}
+}